@@ -0,0 +1,155 @@
+/*
+ * Host benchmark of the two band engines of the sketch, 5 coupled and 10 bands
+ * - The frame path: frame FFT (fft_engine.cpp with the algorithm of
+ *   fft_autotune_config.h), magnitude and RMS of the bands of band_tables.h
+ * - The biquad bank (biquad_bank.cpp), in blocks of BIQUAD_BLOCK samples
+ * Both are timed over many frames of the same signal, in ns per sample. On the
+ * board the cycles per sample come from FFT_AUTOTUNE_MODE, the ratio between
+ * the engines is the part that carries over.
+ * The latency is measured the same way for both: a tone in the middle of a band
+ * starts after silence, the samples from its onset to the refresh of the bands
+ * that shows it over half its steady level, worst band and worst onset.
+ * biquad_bank.cpp is built into this file, with Arduino.h and Print replaced
+ * by the host versions below.
+ *
+ * Build: the CMSIS DSP sources of the sketch are C, built first
+ *   gcc -O2 -c -D__FPU_PRESENT=1 -isystem "../Arduino core changes/CMSIS/Include" -isystem "../MAX32620 Arduino BSP" \
+ *       ../Max32620_Funky_Music/arm_{rfft_fast_f32,rfft_fast_init_f32,rfft_f32,rfft_init_f32,cfft_f32,cfft_radix8_f32,cfft_radix2_f32,cfft_radix2_init_f32,cfft_radix4_f32,cfft_radix4_init_f32,bitreversal,common_tables,const_structs,cmplx_mag_f32,rms_f32}.c \
+ *       ../Max32620_Funky_Music_FreeRTOS/host/host_hooks.c
+ *   g++ -O2 -D__FPU_PRESENT=1 -I../Max32620_Funky_Music -isystem "../Arduino core changes/CMSIS/Include" -isystem "../MAX32620 Arduino BSP" \
+ *       band_engine_bench.cpp ../Max32620_Funky_Music/{fft_engine,fft_algorithms,band_tables}.cpp arm_*.o host_hooks.o -o band_engine_bench
+ * Usage: band_engine_bench
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include "arm_math.h"
+
+/* **** Host versions of the headers of biquad_bank.cpp **** */
+// Their include guards keep the target headers out
+#define Arduino_h
+#define Print_h
+
+// Only biquadBankBenchmark prints, it is not run here
+class Print {
+public:
+  size_t print(const char *text){ return printf("%s", text); }
+  size_t print(int value){ return printf("%d", value); }
+  size_t print(unsigned int value){ return printf("%u", value); }
+  size_t println(const char *text){ return printf("%s\n", text); }
+};
+
+// Cycle counter of biquadBankBenchmark, the host times with std::chrono
+struct CycleCounterStandin {
+  uint32_t DEMCR;
+  uint32_t CTRL;
+  uint32_t CYCCNT;
+};
+static CycleCounterStandin cycle_counter;
+#define CoreDebug (&cycle_counter)
+#define DWT (&cycle_counter)
+#define CoreDebug_DEMCR_TRCENA_Msk 0
+#define DWT_CTRL_CYCCNTENA_Msk 0
+
+#include "biquad_bank.cpp"
+#include "fft_engine.h"
+#include "fft_autotune.h"
+#include "fft_autotune_config.h"
+
+/* **** Definitions **** */
+#define BENCH_FRAME_SIZE 256
+// Frames timed, after as many to warm up
+#define BENCH_FRAMES 2048
+
+/* **** Globals **** */
+static fft_engine_t frame_engine;
+static float32_t frame_input[BENCH_FRAME_SIZE];
+static float32_t frame_output[BENCH_FRAME_SIZE];
+static float32_t frame_mag[BENCH_FRAME_SIZE/2];
+static uint32_t signal[BENCH_FRAME_SIZE];
+
+/* **** Functions **** */
+
+/* The frame path of the sketch over one frame of ADC counts */
+static void frameBands(const uint32_t *samples, float32_t *bands, int band_count){
+  const uint8_t (*table)[2] = (band_count == 5) ? band_table_coupled : band_table_single;
+  for(int i = 0; i<BENCH_FRAME_SIZE; i++) frame_input[i] = (float32_t)samples[i]*BIQUAD_ADC_SCALE;
+  fftEngineRun(&frame_engine, frame_input, frame_output);
+  arm_cmplx_mag_f32(frame_output, frame_mag, BENCH_FRAME_SIZE/2);
+  for(int i = 0; i<band_count; i++){
+    arm_rms_f32(&frame_mag[table[i][0]], table[i][1] - table[i][0], &bands[i]);
+  }
+}
+
+/* Latency of the frame path, as biquadBankLatency: the bands are refreshed at
+   the end of every frame, the tone starts at every place of the frame */
+static int frameLatency(int band_count){
+  const uint8_t (*table)[2] = (band_count == 5) ? band_table_coupled : band_table_single;
+  uint32_t samples[BENCH_FRAME_SIZE];
+  float32_t bands[BIQUAD_MAX_BANDS];
+  int latency = 0;
+
+  for(int i = 0; i<band_count; i++){
+    const float32_t frequency = 0.5f*(table[i][0] + table[i][1])/BAND_TABLE_FRAME_SIZE;
+
+    // Steady level, a whole frame of the tone
+    for(int n = 0; n<BENCH_FRAME_SIZE; n++) samples[n] = toneSample(frequency, n);
+    frameBands(samples, bands, band_count);
+    const float32_t level = bands[i];
+
+    for(int onset = 0; onset<BENCH_FRAME_SIZE; onset++){
+      int end = 0;
+      do{
+        for(int n = 0; n<BENCH_FRAME_SIZE; n++){
+          int sample = end + n;
+          samples[n] = (sample < onset) ? BIQUAD_LATENCY_MIDDLE : toneSample(frequency, sample - onset);
+        }
+        frameBands(samples, bands, band_count);
+        end += BENCH_FRAME_SIZE;
+      }while((bands[i] < level/2) && (end < BIQUAD_LATENCY_MAX));
+      if(end - onset > latency) latency = end - onset;
+    }
+  }
+  return latency;
+}
+
+/* ns per sample of "process" over BENCH_FRAMES frames of the signal */
+template<typename F> static double timeFrames(F process){
+  for(int f = 0; f<BENCH_FRAMES; f++) process();
+  auto start = std::chrono::steady_clock::now();
+  for(int f = 0; f<BENCH_FRAMES; f++) process();
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  return ns/((double)BENCH_FRAMES*BENCH_FRAME_SIZE);
+}
+
+int main(void){
+  const int band_counts[2] = {5, 10};
+  float32_t bands[BIQUAD_MAX_BANDS];
+
+  if(fftEngineInit(&frame_engine, FFT_AUTOTUNE_ALGO(BENCH_FRAME_SIZE), BENCH_FRAME_SIZE) != ARM_MATH_SUCCESS){
+    printf("The FFT engine could not be initialized\n");
+    return 1;
+  }
+  // The square wave of the benchmarks of the board
+  for(int i = 0; i<BENCH_FRAME_SIZE; i++) signal[i] = (i & 0x08) ? 600 : 400;
+
+  for(int b = 0; b<2; b++){
+    const int band_count = band_counts[b];
+
+    double frame_ns = timeFrames([&](){ frameBands(signal, bands, band_count); });
+    printf("Frame FFT, %2d bands:   %6.2f ns per sample, latency %4d samples\n",
+           band_count, frame_ns, frameLatency(band_count));
+
+    biquadBankInit(band_count);
+    double biquad_ns = timeFrames([&](){
+      for(int i = 0; i<BENCH_FRAME_SIZE; i += BIQUAD_BLOCK) biquadBankProcess(&signal[i], BIQUAD_BLOCK, bands);
+    });
+    printf("Biquad bank, %2d bands: %6.2f ns per sample, latency %4d samples\n",
+           band_count, biquad_ns, biquadBankLatency(band_count));
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Host microbenchmark of the Print conversions: the original printNumber and
+ * printFloat (doubles, one write per character) against FastFormat.cpp (MAX32620
+ * Arduino BSP, integer arithmetic and a single write), and snprintf for reference
+ * The writes go to a sink that counts them, as a Print would. On the host the
+ * doubles run on the FPU, on the Cortex-M4F they are software calls, so the gap
+ * on the board is wider than the one printed here.
+ *
+ * Build: g++ -O2 -I"../MAX32620 Arduino BSP" fast_format_bench.cpp "../MAX32620 Arduino BSP/FastFormat.cpp" -o fast_format_bench
+ * Usage: fast_format_bench
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include "FastFormat.h"
+
+/* **** Definitions **** */
+#define VALUES 100000
+#define ROUNDS 20
+
+// Counts the bytes and the calls, as the write of a Print
+struct Sink {
+  size_t bytes;
+  size_t calls;
+  size_t write(const char *buffer, size_t size){
+    bytes += size;
+    calls++;
+    volatile char first = buffer[0];
+    (void)first;
+    return size;
+  }
+  size_t write(const char *text){ return write(text, strlen(text)); }
+  size_t write(char c){ return write(&c, 1); }
+};
+
+/* **** Globals **** */
+static Sink sink;
+static float values[VALUES];
+static unsigned long integers[VALUES];
+
+/* **** Functions **** */
+/* The original Print::printNumber */
+static size_t originalNumber(unsigned long n, uint8_t base){
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while(n);
+  return sink.write(str);
+}
+
+/* The original Print::printFloat */
+static size_t originalFloat(double number, uint8_t digits){
+  size_t n = 0;
+  if (isnan(number)) return sink.write("nan");
+  if (isinf(number)) return sink.write("inf");
+  if (number > 4294967040.0) return sink.write("ovf");
+  if (number <-4294967040.0) return sink.write("ovf");
+  if (number < 0.0) {
+    n += sink.write('-');
+    number = -number;
+  }
+  double rounding = 0.5;
+  for (uint8_t i=0; i<digits; ++i) rounding /= 10.0;
+  number += rounding;
+  unsigned long int_part = (unsigned long)number;
+  double remainder = number - (double)int_part;
+  n += originalNumber(int_part, 10);
+  if (digits > 0) n += sink.write('.');
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    unsigned int toPrint = (unsigned int)remainder;
+    n += originalNumber(toPrint, 10);
+    remainder -= toPrint;
+  }
+  return n;
+}
+
+/* Runs f over every value, prints the time and the writes per call */
+template<typename F> static double run(const char *name, F f){
+  sink = Sink();
+  auto start = std::chrono::steady_clock::now();
+  for(int r = 0; r<ROUNDS; r++){
+    for(int i = 0; i<VALUES; i++) f(i);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  ns /= (double)ROUNDS*VALUES;
+  printf("%-30s %6.1f ns/call  %4.2f writes/call\n", name, ns, (double)sink.calls/((double)ROUNDS*VALUES));
+  return ns;
+}
+
+int main(void){
+  std::mt19937 rng(2);
+  // The range of the bands of the sketch
+  std::uniform_real_distribution<float> band(-60.0f, 60.0f);
+  for(int i = 0; i<VALUES; i++){
+    values[i] = band(rng);
+    integers[i] = rng();
+  }
+
+  double float_original = run("original printFloat(x, 2)", [](int i){ originalFloat(values[i], 2); });
+  double float_fast = run("printFloat(x, 2)", [](int i){
+    char buffer[FAST_FORMAT_BUFFER_SIZE];
+    sink.write(buffer, fastFormatFixed(buffer, values[i], 2));
+  });
+  double number_original = run("original printNumber(u32, 10)", [](int i){ originalNumber(integers[i], 10); });
+  double number_fast = run("printNumber(u32, 10)", [](int i){
+    char buffer[32];
+    char *end = buffer + sizeof(buffer);
+    char *text = fastFormatUnsigned(end, integers[i], 10);
+    sink.write(text, end - text);
+  });
+  run("print(x, SHORTEST)", [](int i){
+    char buffer[FAST_FORMAT_BUFFER_SIZE];
+    sink.write(buffer, fastFormatShortest(buffer, values[i]));
+  });
+  run("snprintf(\"%.9g\")", [](int i){
+    char buffer[32];
+    sink.write(buffer, snprintf(buffer, sizeof(buffer), "%.9g", values[i]));
+  });
+
+  printf("Speedup: float %.1fx, integer %.1fx\n", float_original/float_fast, number_original/number_fast);
+  return 0;
+}
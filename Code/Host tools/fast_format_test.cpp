@@ -0,0 +1,140 @@
+/*
+ * Host test of FastFormat.cpp (MAX32620 Arduino BSP), the number to text
+ * conversions of Print, against the C library
+ * - fastFormatShortest: random float bit patterns read back with strtof as the same float
+ * - fastFormatFixed: random floats with 0 to FAST_FORMAT_MAX_DIGITS decimals, against
+ *   the exact decimal value printed by printf, rounded half up as printFloat does
+ *   (printf rounds the exact ties to even, 0.125 gives "0.12" and printFloat "0.13")
+ * - fastFormatFixed: "nan", "inf", "ovf" and the signs, as the original printFloat
+ * - fastFormatUnsigned: every base, against strtoul
+ *
+ * Build: g++ -O2 -I"../MAX32620 Arduino BSP" fast_format_test.cpp "../MAX32620 Arduino BSP/FastFormat.cpp" -o fast_format_test
+ * Usage: fast_format_test, returns 0 if every check passed
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <random>
+#include <string>
+#include "FastFormat.h"
+
+/* **** Definitions **** */
+#define SHORTEST_TESTS 1000000
+#define FIXED_TESTS    1000000
+
+/* **** Globals **** */
+static int failures = 0;
+
+/* **** Functions **** */
+static void fail(const char *test, const std::string &got, const std::string &expected){
+  if(failures++ < 10) printf("FAILED %s: \"%s\", expected \"%s\"\n", test, got.c_str(), expected.c_str());
+}
+
+/* The exact value of the float, printed by printf, rounded half up to digits decimals */
+static std::string fixedReference(float value, int digits){
+  if(isnan(value)) return "nan";
+  if(isinf(value)) return "inf";
+  if(value > 4294967040.0f || value < -4294967040.0f) return "ovf";
+
+  // A float has at most 149 decimals, 160 prints it exactly
+  char exact[256];
+  snprintf(exact, sizeof(exact), "%.160f", fabs((double)value));
+  std::string text(exact);
+  size_t point = text.find('.');
+  std::string integer = text.substr(0, point);
+  std::string decimals = text.substr(point + 1, digits);
+  bool round_up = text[point + 1 + digits] >= '5';
+
+  std::string number = integer + decimals;
+  for(int i = (int)number.size() - 1; round_up && i >= 0; i--){
+    if(number[i] == '9') number[i] = '0';
+    else{ number[i]++; round_up = false; }
+  }
+  if(round_up) number = "1" + number;
+
+  std::string result = (value < 0.0f) ? "-" : "";
+  result += number.substr(0, number.size() - digits);
+  if(digits > 0) result += "." + number.substr(number.size() - digits);
+  return result;
+}
+
+static void testShortest(std::mt19937 &rng){
+  char buffer[FAST_FORMAT_BUFFER_SIZE + 1];
+  for(int i = 0; i<SHORTEST_TESTS; i++){
+    uint32_t bits = rng();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    if(isnan(value) || isinf(value)) continue;
+
+    size_t length = fastFormatShortest(buffer, value);
+    buffer[length] = 0;
+    float back = strtof(buffer, NULL);
+    if(memcmp(&back, &value, sizeof(value))){
+      char expected[32];
+      snprintf(expected, sizeof(expected), "%.9g", value);
+      fail("fastFormatShortest", buffer, expected);
+    }
+  }
+}
+
+static void testFixed(std::mt19937 &rng){
+  char buffer[FAST_FORMAT_BUFFER_SIZE + 1];
+  for(int i = 0; i<FIXED_TESTS; i++){
+    // Every magnitude up to the overflow limit, with the short decimals of sensor values often
+    float value = (float)(rng() % 2000000000u) / (float)(1u << (rng() % 32));
+    if(i & 1) value = roundf(value*100.0f)/100.0f;
+    if(rng() & 1) value = -value;
+    int digits = rng() % (FAST_FORMAT_MAX_DIGITS + 1);
+
+    size_t length = fastFormatFixed(buffer, value, digits);
+    buffer[length] = 0;
+    std::string expected = fixedReference(value, digits);
+    if(expected != buffer) fail("fastFormatFixed", buffer, expected);
+  }
+
+  // Special values, and the exact ties printf rounds to even
+  struct { float value; int digits; const char *text; } cases[] = {
+    {NAN, 2, "nan"}, {INFINITY, 2, "inf"}, {-INFINITY, 2, "inf"},
+    {4294967296.0f, 2, "ovf"}, {-4294967296.0f, 0, "ovf"}, {4294967040.0f, 0, "4294967040"},
+    {0.0f, 2, "0.00"}, {-0.0f, 2, "0.00"}, {-0.001f, 2, "-0.00"},
+    {0.125f, 2, "0.13"}, {2.5f, 0, "3"}, {1.999f, 2, "2.00"}, {-1.5f, 0, "-2"},
+  };
+  for(auto &c : cases){
+    size_t length = fastFormatFixed(buffer, c.value, c.digits);
+    buffer[length] = 0;
+    if(strcmp(buffer, c.text)) fail("fastFormatFixed special", buffer, c.text);
+  }
+}
+
+static void testUnsigned(std::mt19937 &rng){
+  char buffer[33];
+  for(int i = 0; i<100000; i++){
+    unsigned long value = rng();
+    if(i & 1) value >>= rng() % 32;
+    uint8_t base = 2 + rng() % 35;
+    char *end = buffer + 32;
+    *end = 0;
+    char *text = fastFormatUnsigned(end, value, base);
+    if(strtoul(text, NULL, base) != value || (text[0] == '0' && text[1] != 0)){
+      fail("fastFormatUnsigned", text, std::to_string(value) + " in base " + std::to_string(base));
+    }
+  }
+}
+
+int main(void){
+  std::mt19937 rng(1);
+  testShortest(rng);
+  testFixed(rng);
+  testUnsigned(rng);
+
+  if(failures){
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Host version of the FFT autotuner of the sketch (fft_autotune.h)
+ * Picks the fastest transform of every size with the cycle model of
+ * fft_autotune_model.cpp, and writes fft_autotune_config.h. The header marks
+ * its cycles as not measured: the sketch skips the FFT regression check and
+ * says so in one line at boot, until it is replaced by the one of FFT_AUTOTUNE_MODE
+ *
+ * Build: g++ -O2 -I../Max32620_Funky_Music fft_autotune_host.cpp ../Max32620_Funky_Music/fft_autotune_model.cpp \
+ *            ../Max32620_Funky_Music/fft_algorithms.cpp -o fft_autotune_host
+ * Usage: fft_autotune_host [../Max32620_Funky_Music/fft_autotune_config.h]
+ *        Without a file the header goes to the standard output
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include "fft_autotune_model.h"
+
+/* **** Functions **** */
+static void writeFile(const char *text, void *context){
+  fputs(text, (FILE *)context);
+}
+
+int main(int argc, char **argv){
+  FILE *out = stdout;
+  if(argc > 1){
+    out = fopen(argv[1], "w");
+    if(out == NULL){
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  fftAutotuneWriteConfig(fftAutotuneEstimate, 0, writeFile, out);
+
+  if(out != stdout) fclose(out);
+  return 0;
+}
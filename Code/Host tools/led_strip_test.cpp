@@ -0,0 +1,230 @@
+/*
+ * Host test of the led strip encoders of the sketch (led_strip.cpp)
+ * - ledStripEncodeWs2812: the MOSI waveform is read back as a WS2812B does,
+ *   from the width of the high pulses. Every pulse has to be a 0 (250 to 550 ns)
+ *   or a 1 (650 to 950 ns), a bit every 1.25 us +-600 ns, the line low before
+ *   the first bit and for the 280 us of the reset after the last one. The
+ *   colors read back are the pixels in GRB order, scaled by the brightness
+ * - ledStripEncodeApa102: start frame, one 0xFF/BGR frame per pixel, and the
+ *   end frame clocking the data out to the last pixel, at least count/2 + 32
+ *   zero bits
+ * - ledStripShow: two buffers sent one after the other, the third frame dropped
+ * led_strip.cpp is built into this file, with SPIClass replaced by the host
+ * version below, which holds the requests until complete() is called.
+ *
+ * Build: g++ -O2 -I../Max32620_Funky_Music -I"../MAX32620 Arduino BSP" led_strip_test.cpp -o led_strip_test
+ * Usage: led_strip_test, returns 0 if every check passed
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#include "mxc_errors.h"
+
+/* **** Host version of SPI.h **** */
+// Its include guard keeps the target header out
+#define _SPI_H_INCLUDED
+
+#define MSBFIRST 1
+#define SPI_MODE0 0x00
+
+typedef enum { SPIM_WIDTH_1 = 0 } spim_width_t;
+typedef struct spim_req spim_req_t;
+typedef void (*spim_callback_fn)(spim_req_t *req, int error_code);
+struct spim_req {
+  uint8_t ssel;
+  uint8_t deass;
+  const uint8_t *tx_data;
+  uint8_t *rx_data;
+  spim_width_t width;
+  unsigned len;
+  unsigned read_num;
+  unsigned write_num;
+  spim_callback_fn callback;
+};
+
+class SPISettings {
+  public:
+    SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : clock(clock) {}
+    uint32_t clock;
+};
+
+// One request transferred and one waiting, as SPI_ASYNC_QUEUE_SIZE 1 would
+class SPIClass {
+  public:
+    std::vector<spim_req_t *> queued;
+    uint32_t clock = 0;
+    void begin(void){}
+    void beginTransaction(SPISettings settings){ clock = settings.clock; }
+    void endTransaction(void){}
+    int transferAsync(spim_req_t *req){
+      if(queued.size() >= 2) return E_BUSY;
+      queued.push_back(req);
+      return E_NO_ERROR;
+    }
+    // End of the oldest transfer
+    void complete(void){
+      spim_req_t *req = queued.front();
+      queued.erase(queued.begin());
+      req->write_num = req->len;
+      req->callback(req, E_NO_ERROR);
+    }
+};
+
+#include "led_strip.cpp"
+
+/* **** Definitions **** */
+#define TRIALS 50
+// WS2812B datasheet: T0H 0.4 us, T1H 0.8 us, +-150 ns. Bit period 1.25 us, +-600 ns
+#define WS2812_T0H_MIN 250.0
+#define WS2812_T0H_MAX 550.0
+#define WS2812_T1H_MIN 650.0
+#define WS2812_T1H_MAX 950.0
+#define WS2812_PERIOD 1250.0
+#define WS2812_PERIOD_TOLERANCE 600.0
+#define WS2812_RESET_NS 280000.0
+#define CHECK(condition) do{ if(!(condition)){ printf("FAILED line %d: %s\n", __LINE__, #condition); failures++; } }while(0)
+
+/* **** Globals **** */
+static int failures = 0;
+
+/* **** Functions **** */
+static uint8_t scaled(uint8_t value, uint8_t brightness){
+  return (uint8_t)((value * (brightness + 1)) >> 8);
+}
+
+/* Data bits of the MOSI waveform, as a WS2812 reads them. Checks the timings */
+static std::vector<int> ws2812Decode(const uint8_t *frame, size_t length){
+  const double bit_ns = 1e9/LED_STRIP_WS2812_CLOCK;
+  std::vector<int> line;
+  std::vector<int> data;
+
+  for(size_t i = 0; i<length; i++){
+    for(int b = 7; b>=0; b--) line.push_back((frame[i] >> b) & 1);
+  }
+  CHECK(line[0] == 0);
+
+  long last_rise = -1;
+  size_t i = 0;
+  while(i < line.size()){
+    if(!line[i]){
+      i++;
+      continue;
+    }
+    size_t rise = i;
+    while((i < line.size()) && line[i]) i++;
+    double high = (i - rise)*bit_ns;
+    CHECK(((high >= WS2812_T0H_MIN) && (high <= WS2812_T0H_MAX)) ||
+          ((high >= WS2812_T1H_MIN) && (high <= WS2812_T1H_MAX)));
+    if(last_rise >= 0){
+      double period = (rise - last_rise)*bit_ns;
+      CHECK((period >= WS2812_PERIOD - WS2812_PERIOD_TOLERANCE) && (period <= WS2812_PERIOD + WS2812_PERIOD_TOLERANCE));
+    }
+    last_rise = rise;
+    data.push_back(high > (WS2812_T0H_MAX + WS2812_T1H_MIN)/2);
+  }
+
+  // Low after the last bit, latching the colors
+  size_t last_high = line.size();
+  while((last_high > 0) && !line[last_high - 1]) last_high--;
+  CHECK((line.size() - last_high)*bit_ns >= WS2812_RESET_NS);
+  return data;
+}
+
+static void testWs2812(const std::vector<uint8_t> &pixels, uint16_t count, uint8_t brightness){
+  std::vector<uint8_t> frame(FRAME_BUFFER_SIZE);
+  size_t length = ledStripEncodeWs2812(pixels.data(), count, brightness, frame.data());
+  CHECK(length == (size_t)LED_STRIP_WS2812_FRAME_SIZE(count));
+
+  std::vector<int> data = ws2812Decode(frame.data(), length);
+  CHECK(data.size() == (size_t)24*count);
+  if(data.size() != (size_t)24*count) return;
+
+  // Green, red, blue, MSB first
+  const int order[3] = {1, 0, 2};
+  for(int p = 0; p<count; p++){
+    for(int c = 0; c<3; c++){
+      int value = 0;
+      for(int b = 0; b<8; b++) value = (value << 1) | data[24*p + 8*c + b];
+      CHECK(value == scaled(pixels[3*p + order[c]], brightness));
+    }
+  }
+}
+
+static void testApa102(const std::vector<uint8_t> &pixels, uint16_t count, uint8_t brightness){
+  std::vector<uint8_t> frame(FRAME_BUFFER_SIZE);
+  size_t length = ledStripEncodeApa102(pixels.data(), count, brightness, frame.data());
+  CHECK(length == (size_t)LED_STRIP_APA102_FRAME_SIZE(count));
+
+  CHECK((frame[0] == 0) && (frame[1] == 0) && (frame[2] == 0) && (frame[3] == 0));
+  for(int p = 0; p<count; p++){
+    const uint8_t *led = &frame[4 + 4*p];
+    CHECK(led[0] == 0xFF);
+    CHECK(led[1] == scaled(pixels[3*p + 2], brightness));
+    CHECK(led[2] == scaled(pixels[3*p + 1], brightness));
+    CHECK(led[3] == scaled(pixels[3*p], brightness));
+  }
+
+  // Half a clock of delay per pixel, and the 32 bits of the SK9822 reset frame
+  size_t end = 4 + 4*count;
+  CHECK((length - end)*8 >= (size_t)count/2 + 32);
+  for(size_t i = end; i<length; i++) CHECK(frame[i] == 0);
+}
+
+static void testShow(void){
+  SPIClass spi;
+
+  CHECK(ledStripShow() == E_UNINITIALIZED);
+  CHECK(ledStripBegin(spi, 5, 10) == E_BAD_PARAM);
+  CHECK(ledStripBegin(spi, LED_STRIP_WS2812, 0) == E_BAD_PARAM);
+  CHECK(ledStripBegin(spi, LED_STRIP_WS2812, LED_STRIP_MAX_PIXELS + 1) == E_BAD_PARAM);
+  CHECK(ledStripBegin(spi, LED_STRIP_WS2812, 10) == E_NO_ERROR);
+  CHECK(spi.clock == LED_STRIP_WS2812_CLOCK);
+
+  ledStripSetPixel(0, 255, 0, 0);
+  ledStripSetPixel(10, 1, 1, 1); // Past the end, ignored
+  CHECK(ledStripShow() == E_NO_ERROR);
+  CHECK(ledStripShow() == E_NO_ERROR);
+  CHECK(ledStripShow() == E_BUSY);
+  CHECK(spi.queued[0]->tx_data != spi.queued[1]->tx_data);
+  CHECK(spi.queued[0]->len == LED_STRIP_WS2812_FRAME_SIZE(10));
+
+  // The first buffer is free again once sent
+  CHECK(ledStripBusy());
+  spi.complete();
+  CHECK(ledStripShow() == E_NO_ERROR);
+  spi.complete();
+  spi.complete();
+  CHECK(!ledStripBusy());
+  CHECK((ledStripFrames() == 3) && (ledStripDropped() == 1));
+
+  CHECK(ledStripBegin(spi, LED_STRIP_APA102, 20) == E_NO_ERROR);
+  CHECK(spi.clock == LED_STRIP_APA102_CLOCK);
+  CHECK(ledStripShow() == E_NO_ERROR);
+  CHECK(spi.queued[0]->len == LED_STRIP_APA102_FRAME_SIZE(20));
+  spi.complete();
+}
+
+int main(void){
+  srand(1);
+  for(int trial = 0; trial<TRIALS; trial++){
+    uint16_t count = (trial == 0) ? LED_STRIP_MAX_PIXELS : 1 + rand() % LED_STRIP_MAX_PIXELS;
+    uint8_t brightness = (trial < 2) ? 255 : rand();
+    std::vector<uint8_t> pixels(3*count);
+    for(auto &value : pixels) value = rand();
+
+    testWs2812(pixels, count, brightness);
+    testApa102(pixels, count, brightness);
+  }
+  testShow();
+
+  if(failures){
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
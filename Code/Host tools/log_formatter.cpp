@@ -0,0 +1,152 @@
+/*
+ * Rebuilds the text of the deferred log records
+ * See log_formatter.h
+ *
+*/
+
+/* **** Includes **** */
+#include "log_formatter.h"
+#include <stdio.h>
+#include <string.h>
+
+/* **** Definitions **** */
+#define ELF_SECTION_PROGBITS 1
+#define ELF_SECTION_ALLOC    0x2
+
+/* **** Functions **** */
+static uint16_t get16(const uint8_t *p){
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p){
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool LogFormatter::load(const char *path){
+  _sections.clear();
+  FILE *file = fopen(path, "rb");
+  if(!file) return false;
+  std::vector<uint8_t> elf;
+  uint8_t buffer[4096];
+  size_t n;
+  while((n = fread(buffer, 1, sizeof(buffer), file)) > 0) elf.insert(elf.end(), buffer, buffer + n);
+  fclose(file);
+
+  // 32 bits, little endian
+  if(elf.size() < 52 || memcmp(elf.data(), "\x7f" "ELF", 4) != 0 || elf[4] != 1 || elf[5] != 1) return false;
+  uint32_t section_offset = get32(&elf[0x20]);
+  uint16_t section_size = get16(&elf[0x2E]);
+  uint16_t sections = get16(&elf[0x30]);
+  if(section_size < 40 || section_offset + (uint64_t)sections*section_size > elf.size()) return false;
+
+  // Sections loaded in the flash or the RAM of the target, with their content in the file
+  for(int i = 0; i<sections; i++){
+    const uint8_t *header = &elf[section_offset + i*section_size];
+    uint32_t type = get32(header + 4);
+    uint32_t flags = get32(header + 8);
+    uint32_t address = get32(header + 12);
+    uint32_t offset = get32(header + 16);
+    uint32_t size = get32(header + 20);
+    if(type != ELF_SECTION_PROGBITS || !(flags & ELF_SECTION_ALLOC) || size == 0) continue;
+    if(offset + (uint64_t)size > elf.size()) return false;
+
+    Section section;
+    section.address = address;
+    section.data.assign(elf.begin() + offset, elf.begin() + offset + size);
+    _sections.push_back(section);
+  }
+  return !_sections.empty();
+}
+
+const char *LogFormatter::string(uint32_t address) const{
+  for(size_t i = 0; i<_sections.size(); i++){
+    const Section &section = _sections[i];
+    if(address < section.address || address - section.address >= section.data.size()) continue;
+    const char *text = (const char *)&section.data[address - section.address];
+    // Has to end inside the section
+    if(!memchr(text, 0, section.data.size() - (address - section.address))) return NULL;
+    return text;
+  }
+  return NULL;
+}
+
+std::string LogFormatter::format(const TelemetryLogRecord &record) const{
+  char text[256];
+  const char *format = string(record.format);
+  if(!format){
+    std::string raw;
+    snprintf(text, sizeof(text), "<format 0x%08X>", record.format);
+    raw = text;
+    for(size_t i = 0; i<record.args.size(); i++){
+      snprintf(text, sizeof(text), " 0x%08X", record.args[i]);
+      raw += text;
+    }
+    return raw;
+  }
+
+  std::string result;
+  size_t arg = 0;
+  for(const char *p = format; *p; p++){
+    if(*p != '%'){
+      result += *p;
+      continue;
+    }
+    if(p[1] == '%'){
+      result += '%';
+      p++;
+      continue;
+    }
+
+    // Flags, width and precision are kept, the length modifiers are dropped:
+    // every argument was sent as a 32 bits word
+    std::string spec = "%";
+    p++;
+    while(*p && strchr("-+ #0123456789.", *p)) spec += *p++;
+    while(*p && strchr("hlLqjzt", *p)) p++;
+    if(!*p) break;
+    char conversion = *p;
+
+    if(arg >= record.args.size()){
+      result += "<?>";
+      continue;
+    }
+    uint32_t word = record.args[arg++];
+    switch(conversion){
+      case 'd':
+      case 'i':
+        snprintf(text, sizeof(text), (spec + 'd').c_str(), (int)(int32_t)word);
+        break;
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+        snprintf(text, sizeof(text), (spec + conversion).c_str(), (unsigned)word);
+        break;
+      case 'c':
+        snprintf(text, sizeof(text), (spec + 'c').c_str(), (int)word);
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':{
+        float value;
+        memcpy(&value, &word, sizeof(value));
+        snprintf(text, sizeof(text), (spec + conversion).c_str(), (double)value);
+        break;
+      }
+      case 's':{
+        const char *s = string(word);
+        if(s) snprintf(text, sizeof(text), (spec + 's').c_str(), s);
+        else snprintf(text, sizeof(text), "<string 0x%08X>", word);
+        break;
+      }
+      default:
+        snprintf(text, sizeof(text), "0x%08X", word);
+        break;
+    }
+    result += text;
+  }
+  return result;
+}
@@ -0,0 +1,41 @@
+/*
+ * Rebuilds the text of the deferred log records (Max32620_Funky_Music/deferred_log.h)
+ * The ID of each record is the address of its format string, so the table of the
+ * strings is the .elf built by the Arduino IDE (see "Show verbose output during
+ * compilation" for its folder). The loaded sections of the ELF are read once,
+ * and the format and %s strings are looked up at their addresses.
+ *
+*/
+
+#ifndef LOG_FORMATTER_H
+#define LOG_FORMATTER_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "telemetry_decoder.h"
+
+/* **** Definitions **** */
+class LogFormatter {
+  public:
+    // Reads the ELF of the firmware, false if it is not a 32 bits little endian ELF
+    bool load(const char *path);
+    bool loaded() const { return !_sections.empty(); }
+
+    // Text of a record, or its raw words if the format is not found
+    std::string format(const TelemetryLogRecord &record) const;
+
+  private:
+    struct Section {
+      uint32_t address;
+      std::vector<uint8_t> data;
+    };
+
+    // String at an address of the firmware, NULL if it is not in a loaded section
+    const char *string(uint32_t address) const;
+
+    std::vector<Section> _sections;
+};
+
+#endif /* LOG_FORMATTER_H */
@@ -0,0 +1,328 @@
+/*
+ * Host test of SPI (MAX32620 Arduino BSP), over a model of the SPIM driver
+ * whose slave answers each byte with its complement
+ * - transfer16: the bytes on MOSI and the value read back, MSBFIRST and LSBFIRST
+ * - reverseBits: every alignment of the buffer and every length up to a few
+ *   words, against the byte by byte reversal
+ * - transfer of a buffer in LSBFIRST: reversed on the wire, received bytes restored
+ * - transferAsync: one request transferred and SPI_ASYNC_QUEUE_SIZE waiting,
+ *   E_BUSY after, started from the interrupt in their order
+ * - Short writes completed inside the driver call, chained from their callbacks
+ * - end() calling the callbacks of the waiting requests with E_SHUTDOWN
+ * SPI.cpp is built into this file, with the SPIM driver and the system headers
+ * replaced by the host versions below.
+ *
+ * Build: g++ -O2 -I"../MAX32620 Arduino BSP" spi_test.cpp -o spi_test
+ * Usage: spi_test, returns 0 if every check passed
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "mxc_errors.h"
+
+/* **** Host versions of the headers of SPI.cpp **** */
+// Their include guards keep the target headers out
+#define Arduino_h
+#define _MXC_CONFIG_H
+#define _MXC_SYS_H_
+#define _MXC_SPIM_REGS_H_
+#define _SPIM_H_
+#define _VARIANT_MAX32620FTHR_H_
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define CONCAT(a, b) CONCAT_(a, b)
+#define CONCAT_(a, b) a##b
+#define DEFAULT_SPIM_PORT 0
+#define MXC_CFG_SPIM_INSTANCES 1
+
+typedef enum { GPIO_P0_IRQn = 10, GPIO_P1_IRQn, GPIO_P2_IRQn, GPIO_P3_IRQn, GPIO_P4_IRQn, SPIM0_IRQn = 20 } IRQn_Type;
+enum { PORT_0, PORT_1, PORT_2, PORT_3, PORT_4 };
+
+// Nesting of NVIC_DisableIRQ of the SPIM interrupt, the interrupt is run by hand
+static int irq_disabled = 0;
+static void NVIC_DisableIRQ(IRQn_Type irqn){ if(irqn == SPIM0_IRQn) irq_disabled++; }
+static void NVIC_EnableIRQ(IRQn_Type irqn){ if(irqn == SPIM0_IRQn) irq_disabled = 0; }
+static void noInterrupts(void){}
+static void interrupts(void){}
+#define interruptsStatus() 1
+
+static uint32_t __RBIT(uint32_t value){
+  uint32_t result = 0;
+  for(int i = 0; i<32; i++) if(value & (1u << i)) result |= 1u << (31 - i);
+  return result;
+}
+static uint32_t __REV(uint32_t value){ return __builtin_bswap32(value); }
+static uint32_t SystemCoreClock = 96000000;
+
+typedef enum { SPIM_WIDTH_1 = 0 } spim_width_t;
+typedef int clkman_clk_t;
+typedef int clkman_scale_t;
+typedef int ioman_cfg_t;
+enum { CLKMAN_SCALE_DISABLED, CLKMAN_SCALE_DIV_1, CLKMAN_SCALE_DIV_2, CLKMAN_SCALE_DIV_4, CLKMAN_SCALE_DIV_8,
+       CLKMAN_SCALE_DIV_16, CLKMAN_SCALE_DIV_32, CLKMAN_SCALE_DIV_64, CLKMAN_SCALE_DIV_128, CLKMAN_SCALE_DIV_256,
+       CLKMAN_SCALE_AUTO };
+#define CLKMAN_CLK_SPIM0 0
+#define IOMAN_SPIM0(...) 0
+#define IOMAN_SPIM1(...) 0
+#define IOMAN_SPIM2(...) 0
+typedef struct { clkman_scale_t clk_scale; ioman_cfg_t io_cfg; } sys_cfg_spim_t;
+typedef struct { uint8_t mode; uint32_t ssel_pol; uint32_t baud; } spim_cfg_t;
+
+typedef struct spim_req spim_req_t;
+typedef void (*spim_callback_fn)(spim_req_t *req, int error_code);
+struct spim_req {
+  uint8_t ssel;
+  uint8_t deass;
+  const uint8_t *tx_data;
+  uint8_t *rx_data;
+  spim_width_t width;
+  unsigned len;
+  unsigned read_num;
+  unsigned write_num;
+  spim_callback_fn callback;
+};
+
+typedef struct { uint32_t mstr_cfg; } mxc_spim_regs_t;
+static mxc_spim_regs_t spim_regs;
+#define MXC_SPIM_GET_SPIM(i) (&spim_regs)
+#define MXC_SPIM_GET_IRQ(i) SPIM0_IRQn
+#define MXC_F_SPIM_MSTR_CFG_SPI_MODE_POS 4
+#define MXC_F_SPIM_MSTR_CFG_SPI_MODE (0x3UL << MXC_F_SPIM_MSTR_CFG_SPI_MODE_POS)
+#define MXC_F_SPIM_MSTR_CFG_SCK_HI_CLK_POS 8
+#define MXC_F_SPIM_MSTR_CFG_SCK_HI_CLK (0xFUL << MXC_F_SPIM_MSTR_CFG_SCK_HI_CLK_POS)
+#define MXC_F_SPIM_MSTR_CFG_SCK_LO_CLK_POS 12
+#define MXC_F_SPIM_MSTR_CFG_SCK_LO_CLK (0xFUL << MXC_F_SPIM_MSTR_CFG_SCK_LO_CLK_POS)
+
+static void CLKMAN_SetClkScale(clkman_clk_t clk, clkman_scale_t scale){}
+static uint32_t SYS_SPIM_GetFreq(mxc_spim_regs_t *spim){ return 48000000; }
+static uint32_t SYS_GetFreq(int scale){ return 1000000; }
+
+static int SPIM_Init(mxc_spim_regs_t *spim, const spim_cfg_t *cfg, const sys_cfg_spim_t *sys_cfg);
+static int SPIM_Shutdown(mxc_spim_regs_t *spim);
+static int SPIM_Trans(mxc_spim_regs_t *spim, spim_req_t *req);
+static int SPIM_TransAsync(mxc_spim_regs_t *spim, spim_req_t *req);
+static void SPIM_Handler(mxc_spim_regs_t *spim);
+
+#include "SPI.cpp"
+
+/* **** Definitions **** */
+// Writes of up to a FIFO are done inside SPIM_TransAsync, as the driver does
+#define SPIM_FIFO_BYTES 16
+#define CHECK(condition) do{ if(!(condition)){ printf("FAILED line %d: %s\n", __LINE__, #condition); failures++; } }while(0)
+
+/* **** Globals **** */
+static int failures = 0;
+static std::vector<uint8_t> mosi;      // Bytes sent on the bus
+static spim_req_t *in_flight = NULL;   // Request of the driver, done by the next interrupt
+
+static int completed = 0;
+static std::vector<unsigned> completed_lengths;
+static int shutdowns = 0;
+static spim_req_t chained;
+static uint8_t chained_data[8];
+static int chains = 0;
+
+/* **** Functions **** */
+// The slave answers each byte with its complement
+static void busTransfer(spim_req_t *req){
+  for(unsigned i = 0; i<req->len; i++){
+    uint8_t sent = req->tx_data ? req->tx_data[i] : 0xFF;
+    mosi.push_back(sent);
+    if(req->rx_data) req->rx_data[i] = ~sent;
+  }
+  req->read_num = req->rx_data ? req->len : 0;
+  req->write_num = req->tx_data ? req->len : 0;
+}
+
+static int SPIM_Init(mxc_spim_regs_t *spim, const spim_cfg_t *cfg, const sys_cfg_spim_t *sys_cfg){ return E_NO_ERROR; }
+static int SPIM_Shutdown(mxc_spim_regs_t *spim){
+  spim_req_t *req = in_flight;
+  in_flight = NULL;
+  if((req != NULL) && (req->callback != NULL)) req->callback(req, E_SHUTDOWN);
+  return E_NO_ERROR;
+}
+static int SPIM_Trans(mxc_spim_regs_t *spim, spim_req_t *req){
+  if(in_flight != NULL) return E_BUSY;
+  busTransfer(req);
+  return req->len;
+}
+static int SPIM_TransAsync(mxc_spim_regs_t *spim, spim_req_t *req){
+  // Called with the SPIM interrupt disabled, or from it
+  CHECK(irq_disabled > 0);
+  if(in_flight != NULL) return E_BUSY;
+  if((req->len <= SPIM_FIFO_BYTES) && (req->rx_data == NULL)){
+    busTransfer(req);
+    if(req->callback != NULL) req->callback(req, E_NO_ERROR);
+    return E_NO_ERROR;
+  }
+  in_flight = req;
+  return E_NO_ERROR;
+}
+static void SPIM_Handler(mxc_spim_regs_t *spim){
+  spim_req_t *req = in_flight;
+  if(req == NULL) return;
+  in_flight = NULL;
+  busTransfer(req);
+  if(req->callback != NULL) req->callback(req, E_NO_ERROR);
+}
+
+// The end of the transfer in flight, from the SPIM interrupt
+static void interrupt(void){
+  irq_disabled++;
+  SPIM0_IRQHandler();
+  irq_disabled = 0;
+}
+
+static void doneCallback(spim_req_t *req, int error){
+  CHECK(error == E_NO_ERROR);
+  completed++;
+  completed_lengths.push_back(req->len);
+}
+
+static void shutdownCallback(spim_req_t *req, int error){
+  if(error == E_SHUTDOWN) shutdowns++;
+}
+
+static void chainCallback(spim_req_t *req, int error){
+  completed++;
+  if(++chains < 4) CHECK(SPI.transferAsync(&chained) == E_NO_ERROR);
+}
+
+static void setRequest(spim_req_t *req, const uint8_t *tx, uint8_t *rx, unsigned length, spim_callback_fn callback){
+  memset(req, 0, sizeof(*req));
+  req->tx_data = tx;
+  req->rx_data = rx;
+  req->width = SPIM_WIDTH_1;
+  req->len = length;
+  req->callback = callback;
+}
+
+static uint8_t reverseByte(uint8_t value){ return __RBIT(value) >> 24; }
+
+static void testTransfer16(void){
+  const uint16_t values[] = { 0x1234, 0x8001, 0x00FF, 0xA5C3 };
+
+  for(uint16_t value : values){
+    SPI.setBitOrder(MSBFIRST);
+    mosi.clear();
+    uint16_t received = SPI.transfer16(value);
+    CHECK((mosi.size() == 2) && (mosi[0] == (value >> 8)) && (mosi[1] == (value & 0xFF)));
+    CHECK(received == (uint16_t)~value);
+
+    // Bit 0 first: the low byte reversed, then the high byte reversed
+    SPI.setBitOrder(LSBFIRST);
+    mosi.clear();
+    received = SPI.transfer16(value);
+    CHECK((mosi.size() == 2) && (mosi[0] == reverseByte(value & 0xFF)) && (mosi[1] == reverseByte(value >> 8)));
+    CHECK(received == (uint16_t)~value);
+  }
+
+  SPI.setBitOrder(LSBFIRST);
+  mosi.clear();
+  CHECK(SPI.transfer(0x01) == 0xFE);
+  CHECK(mosi[0] == 0x80);
+  SPI.setBitOrder(MSBFIRST);
+}
+
+static void testReverseBits(void){
+  alignas(4) uint8_t buffer[64];
+  uint8_t reference[64];
+
+  for(int offset = 0; offset<4; offset++){
+    for(int length = 0; length<50; length++){
+      for(int i = 0; i<64; i++) buffer[i] = reference[i] = rand();
+      SPIClass::reverseBits(buffer + offset, length);
+      for(int i = 0; i<64; i++){
+        uint8_t expected = ((i >= offset) && (i < offset + length)) ? reverseByte(reference[i]) : reference[i];
+        if(buffer[i] != expected){
+          printf("reverseBits offset %d length %d: byte %d is 0x%02X, expected 0x%02X\n",
+                 offset, length, i, buffer[i], expected);
+          failures++;
+          break;
+        }
+      }
+    }
+  }
+
+  // LSBFIRST buffer, reversed on the wire and the received bytes restored
+  uint8_t data[10];
+  for(int i = 0; i<10; i++) data[i] = i+1;
+  SPI.setBitOrder(LSBFIRST);
+  mosi.clear();
+  SPI.transfer(data, sizeof(data));
+  CHECK((mosi[0] == 0x80) && (mosi[1] == 0x40) && (mosi[9] == 0x50));
+  CHECK((data[0] == (uint8_t)~1) && (data[9] == (uint8_t)~10));
+  SPI.setBitOrder(MSBFIRST);
+}
+
+static void testQueue(void){
+  static uint8_t frames[SPI_ASYNC_QUEUE_SIZE + 2][100];
+  spim_req_t requests[SPI_ASYNC_QUEUE_SIZE + 2];
+
+  // One transferred, SPI_ASYNC_QUEUE_SIZE waiting, the next one refused
+  completed = 0;
+  completed_lengths.clear();
+  for(int i = 0; i<SPI_ASYNC_QUEUE_SIZE + 2; i++){
+    setRequest(&requests[i], frames[i], NULL, 100 - i, doneCallback);
+    int expected = (i <= SPI_ASYNC_QUEUE_SIZE) ? E_NO_ERROR : E_BUSY;
+    CHECK(SPI.transferAsync(&requests[i]) == expected);
+    CHECK(SPI.busy());
+  }
+  CHECK(irq_disabled == 0);
+
+  // Each interrupt ends one and starts the next
+  interrupt();
+  CHECK((completed == 1) && (in_flight != NULL));
+  for(int i = 0; i<SPI_ASYNC_QUEUE_SIZE; i++) interrupt();
+  CHECK(completed == SPI_ASYNC_QUEUE_SIZE + 1);
+  CHECK(!SPI.busy());
+  CHECK(completed_lengths.size() == SPI_ASYNC_QUEUE_SIZE + 1);
+  for(unsigned i = 0; i<completed_lengths.size(); i++) CHECK(completed_lengths[i] == 100 - i);
+  CHECK(requests[0].write_num == 100);
+
+  // Short writes done inside the driver call, the next one queued from the callback
+  completed = 0;
+  chains = 0;
+  setRequest(&chained, chained_data, NULL, sizeof(chained_data), chainCallback);
+  CHECK(SPI.transferAsync(&chained) == E_NO_ERROR);
+  CHECK(completed == 4);
+  CHECK(!SPI.busy());
+  CHECK(irq_disabled == 0);
+
+  // Blocking transfer once the queue is empty
+  mosi.clear();
+  SPI.transfer(0x55);
+  CHECK(mosi.size() == 1);
+
+  // end() calls the callbacks of the transferred and waiting requests
+  shutdowns = 0;
+  setRequest(&requests[0], frames[0], NULL, 100, shutdownCallback);
+  setRequest(&requests[1], frames[1], NULL, 100, shutdownCallback);
+  CHECK(SPI.transferAsync(&requests[0]) == E_NO_ERROR);
+  CHECK(SPI.transferAsync(&requests[1]) == E_NO_ERROR);
+  SPI.end();
+  CHECK(shutdowns == 2);
+  CHECK(!SPI.busy());
+}
+
+int main(void){
+  SPI.begin();
+  SPI.beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
+
+  testTransfer16();
+  testReverseBits();
+  testQueue();
+
+  if(failures){
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Host test of SpscQueue.h (MAX32620 Arduino BSP), the queue of the
+ * interrupt to loop handoffs of the sketch
+ * - Single thread: capacity, full and empty queues, order, peek, clear, and
+ *   the wrap of the 16 bits indexes
+ * - Two threads, one producer and one consumer as the interrupt and the loop:
+ *   every element arrives once, in order and not torn. A second run drops
+ *   elements with clear() from the consumer, as the sketch does with stale frames
+ * Build it with ThreadSanitizer, it reports any access not ordered by the
+ * acquire/release pairs of the queue. The spin loops yield, so it also ends
+ * on a single CPU.
+ *
+ * Build: g++ -O2 -g -fsanitize=thread -pthread -I"../MAX32620 Arduino BSP" spsc_queue_test.cpp -o spsc_queue_test
+ * Usage: spsc_queue_test, returns 0 if every check passed
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include "SpscQueue.h"
+
+/* **** Definitions **** */
+#define STRESS_ELEMENTS 200000
+
+// Two words that have to match, a torn copy breaks the pair
+struct Element {
+  uint32_t sequence;
+  uint32_t check;
+};
+
+#define CHECK(condition) \
+  do{ if(!(condition)){ printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); failures++; } }while(0)
+
+/* **** Globals **** */
+static int failures = 0;
+
+/* **** Functions **** */
+static uint32_t checkOf(uint32_t sequence){
+  return ~sequence * 2654435761u;
+}
+
+static void testSingleThread(void){
+  SpscQueue<uint16_t, 4> queue;
+  uint16_t value = 0;
+
+  CHECK(queue.capacity() == 4);
+  CHECK(queue.isEmpty() && !queue.isFull());
+  CHECK(!queue.pop(value) && !queue.peek(value));
+
+  for(uint16_t i = 0; i<4; i++) CHECK(queue.push(i));
+  CHECK(queue.isFull() && queue.available() == 4 && queue.availableForWrite() == 0);
+  CHECK(!queue.push(99));
+
+  CHECK(queue.peek(value) && value == 0);
+  for(uint16_t i = 0; i<4; i++) CHECK(queue.pop(value) && value == i);
+  CHECK(queue.isEmpty());
+
+  queue.push(1);
+  queue.push(2);
+  queue.clear();
+  CHECK(queue.isEmpty() && !queue.pop(value));
+
+  // Past the wrap of the free running indexes, with a partially full queue
+  uint16_t expected = 0;
+  uint16_t next = 0;
+  CHECK(queue.push(next++) && queue.push(next++));
+  for(uint32_t i = 0; i<70000; i++){
+    CHECK(queue.push(next++));
+    CHECK(queue.pop(value) && value == expected++);
+  }
+  while(queue.pop(value)) CHECK(value == expected++);
+  CHECK(expected == next);
+}
+
+/* Producer and consumer threads, "drop" makes the consumer clear the queue now and then */
+static void testTwoThreads(bool drop){
+  static SpscQueue<Element, 64> queue;
+  uint32_t received = 0;
+  uint32_t bad = 0;
+  // Set once every element was pushed, clear() may have dropped the last ones
+  std::atomic<bool> done(false);
+
+  std::thread producer([&]{
+    for(uint32_t i = 0; i<STRESS_ELEMENTS; ){
+      Element element = {i, checkOf(i)};
+      if(queue.push(element)) i++;
+      else std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  std::thread consumer([&]{
+    uint32_t expected = 0;
+    Element element;
+    while(true){
+      if(!queue.pop(element)){
+        // Empty after the last push, nothing more can arrive
+        if(done.load(std::memory_order_acquire) && queue.isEmpty()) break;
+        std::this_thread::yield();
+        continue;
+      }
+      // Without drops every element arrives, with them the sequence only grows
+      if(element.check != checkOf(element.sequence)) bad++;
+      if(drop ? (element.sequence < expected) : (element.sequence != expected)) bad++;
+      expected = element.sequence + 1;
+      received++;
+      if(drop && (received % 1000 == 0)) queue.clear();
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  printf("%s: %u elements received, %u bad\n", drop ? "Two threads with clear" : "Two threads",
+         (unsigned)received, (unsigned)bad);
+  CHECK(bad == 0);
+  if(!drop) CHECK(received == STRESS_ELEMENTS);
+  CHECK(queue.isEmpty());
+}
+
+int main(void){
+  testSingleThread();
+  testTwoThreads(false);
+  testTwoThreads(true);
+
+  if(failures){
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
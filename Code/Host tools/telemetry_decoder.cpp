@@ -0,0 +1,233 @@
+/*
+ * Host decoder of the binary telemetry stream of the sketch
+ * See telemetry_decoder.h
+ *
+*/
+
+/* **** Includes **** */
+#include "telemetry_decoder.h"
+#include <string.h>
+
+/* **** Definitions **** */
+// Reflected polynomial of the CRC-32, the one of the CRC32 peripheral in little endian mode
+#define CRC32_POLYNOMIAL 0xEDB88320UL
+
+/* **** Functions **** */
+static uint16_t get16(const uint8_t *p){
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p){
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static float getFloat(const uint8_t *p){
+  uint32_t bits = get32(p);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+TelemetryDecoder::TelemetryDecoder(){
+  _encoded.reserve(TELEMETRY_MAX_ENCODED);
+  _packet.reserve(TELEMETRY_MAX_PACKET);
+  reset();
+}
+
+void TelemetryDecoder::reset(){
+  _encoded.clear();
+  _frames.clear();
+  _logs.clear();
+  memset(&_stats, 0, sizeof(_stats));
+  _overflow = false;
+  _synced = false;
+  _next_sequence = 0;
+}
+
+uint32_t TelemetryDecoder::crc32(const uint8_t *data, size_t length){
+  static uint32_t table[256];
+  static bool table_done = false;
+  if(!table_done){
+    for(uint32_t i = 0; i<256; i++){
+      uint32_t c = i;
+      for(int k = 0; k<8; k++) c = (c & 1) ? (c >> 1) ^ CRC32_POLYNOMIAL : c >> 1;
+      table[i] = c;
+    }
+    table_done = true;
+  }
+
+  uint32_t crc = 0xFFFFFFFFUL;
+  for(size_t i = 0; i<length; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFUL;
+}
+
+bool TelemetryDecoder::cobsDecode(const uint8_t *in, size_t length, std::vector<uint8_t> &out){
+  out.clear();
+  size_t i = 0;
+  while(i < length){
+    uint8_t code = in[i++];
+    if(code == 0) return false;
+    if(i + code - 1 > length) return false;
+    out.insert(out.end(), in + i, in + i + code - 1);
+    i += code - 1;
+    // The zero replaced by the code, except after a full block and at the end
+    if(code != 0xFF && i < length) out.push_back(0);
+  }
+  return true;
+}
+
+bool TelemetryDecoder::parseFrame(const uint8_t *packet, size_t length, TelemetryFrame &frame){
+  if(length < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE || (length & 3)) return false;
+  if(packet[0] != TELEMETRY_PACKET_FRAME) return false;
+
+  const uint8_t *end = packet + length - TELEMETRY_CRC_SIZE;
+  uint8_t blocks = packet[1];
+  frame.sequence = get16(&packet[2]);
+  frame.timestamp = get32(&packet[4]);
+  uint8_t bands_count = packet[8];
+  frame.leds = get16(&packet[10]);
+
+  const uint8_t *p = packet + TELEMETRY_HEADER_SIZE;
+  if(bands_count > TELEMETRY_MAX_BANDS || p + 4*bands_count > end) return false;
+  frame.bands.resize(bands_count);
+  for(int i = 0; i<bands_count; i++, p += 4) frame.bands[i] = getFloat(p);
+
+  frame.raw.clear();
+  if(blocks & TELEMETRY_BLOCK_RAW){
+    if(p + TELEMETRY_BLOCK_HEADER_SIZE > end) return false;
+    uint16_t count = get16(p);
+    p += TELEMETRY_BLOCK_HEADER_SIZE;
+    size_t padded = 2*((count + 1) & ~1);
+    if(count > TELEMETRY_MAX_RAW || p + padded > end) return false;
+    frame.raw.resize(count);
+    for(int i = 0; i<count; i++) frame.raw[i] = get16(p + 2*i);
+    p += padded;
+  }
+
+  frame.magnitude.clear();
+  if(blocks & TELEMETRY_BLOCK_MAGNITUDE){
+    if(p + TELEMETRY_BLOCK_HEADER_SIZE > end) return false;
+    uint16_t count = get16(p);
+    p += TELEMETRY_BLOCK_HEADER_SIZE;
+    if(count > TELEMETRY_MAX_MAGNITUDE || p + 4*count > end) return false;
+    frame.magnitude.resize(count);
+    for(int i = 0; i<count; i++, p += 4) frame.magnitude[i] = getFloat(p);
+  }
+
+  frame.spectrum.clear();
+  frame.spectrum_cycles = 0;
+  if(blocks & TELEMETRY_BLOCK_SPECTRUM){
+    if(p + TELEMETRY_BLOCK_HEADER_SIZE > end) return false;
+    uint16_t length = get16(p);
+    frame.spectrum_cycles = get16(p + 2);
+    p += TELEMETRY_BLOCK_HEADER_SIZE;
+    size_t padded = (length + 3) & ~3;
+    if(length > TELEMETRY_MAX_SPECTRUM || p + padded > end) return false;
+    frame.spectrum.assign(p, p + length);
+    p += padded;
+  }
+
+  return p == end;
+}
+
+bool TelemetryDecoder::parseLog(const uint8_t *packet, size_t length, TelemetryLog &log){
+  if(length < TELEMETRY_LOG_HEADER_SIZE + TELEMETRY_CRC_SIZE || (length & 3)) return false;
+  if(packet[0] != TELEMETRY_PACKET_LOG) return false;
+
+  const uint8_t *end = packet + length - TELEMETRY_CRC_SIZE;
+  uint8_t records = packet[1];
+  log.dropped = get16(&packet[2]);
+  log.records.resize(records);
+
+  const uint8_t *p = packet + TELEMETRY_LOG_HEADER_SIZE;
+  for(int r = 0; r<records; r++){
+    if(p + 8 > end) return false;
+    uint32_t first = get32(p);
+    TelemetryLogRecord &record = log.records[r];
+    record.format = first & TELEMETRY_LOG_ADDRESS_MASK;
+    record.timestamp = get32(p + 4);
+    uint32_t count = first >> TELEMETRY_LOG_COUNT_POS;
+    p += 8;
+    if(p + 4*count > end) return false;
+    record.args.resize(count);
+    for(uint32_t i = 0; i<count; i++, p += 4) record.args[i] = get32(p);
+  }
+
+  return p == end;
+}
+
+void TelemetryDecoder::packetDone(){
+  if(!cobsDecode(_encoded.data(), _encoded.size(), _packet) || _packet.size() < TELEMETRY_CRC_SIZE){
+    _stats.format_errors++;
+    return;
+  }
+
+  size_t length = _packet.size() - TELEMETRY_CRC_SIZE;
+  if(crc32(_packet.data(), length) != get32(&_packet[length])){
+    _stats.crc_errors++;
+    return;
+  }
+
+  if(_packet[0] == TELEMETRY_PACKET_LOG){
+    TelemetryLog log;
+    if(!parseLog(_packet.data(), _packet.size(), log)){
+      _stats.format_errors++;
+      return;
+    }
+    _stats.log_records += log.records.size();
+    _stats.log_dropped += log.dropped;
+    _logs.push_back(log);
+    return;
+  }
+
+  TelemetryFrame frame;
+  if(!parseFrame(_packet.data(), _packet.size(), frame)){
+    _stats.format_errors++;
+    return;
+  }
+
+  if(_stats.frames > 0) _stats.lost_frames += (uint16_t)(frame.sequence - _next_sequence);
+  _next_sequence = frame.sequence + 1;
+  _stats.frames++;
+  _frames.push_back(frame);
+}
+
+size_t TelemetryDecoder::feed(const uint8_t *data, size_t length){
+  size_t before = _stats.frames;
+
+  for(size_t i = 0; i<length; i++){
+    uint8_t byte = data[i];
+    if(byte != TELEMETRY_DELIMITER){
+      if(!_synced || _overflow) continue;
+      if(_encoded.size() >= TELEMETRY_MAX_ENCODED){
+        _overflow = true;
+        _stats.overflows++;
+        continue;
+      }
+      _encoded.push_back(byte);
+      continue;
+    }
+
+    // The bytes before the first delimiter are the end of a packet already started
+    if(_synced && !_overflow && !_encoded.empty()) packetDone();
+    _synced = true;
+    _overflow = false;
+    _encoded.clear();
+  }
+
+  return _stats.frames - before;
+}
+
+bool TelemetryDecoder::next(TelemetryFrame &frame){
+  if(_frames.empty()) return false;
+  frame = _frames.front();
+  _frames.pop_front();
+  return true;
+}
+
+bool TelemetryDecoder::nextLog(TelemetryLog &log){
+  if(_logs.empty()) return false;
+  log = _logs.front();
+  _logs.pop_front();
+  return true;
+}
@@ -0,0 +1,94 @@
+/*
+ * Host decoder of the binary telemetry stream of the sketch
+ * Bytes are fed as they are received, in chunks of any size. They are split at
+ * the 0x00 delimiters, COBS decoded, checked against their CRC-32 and parsed
+ * following Max32620_Funky_Music/telemetry_protocol.h
+ * Frame and log packets are queued apart, see next and nextLog
+ * Bad packets are dropped and counted, the stream resyncs on the next delimiter
+ *
+*/
+
+#ifndef TELEMETRY_DECODER_H
+#define TELEMETRY_DECODER_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+#include "telemetry_protocol.h"
+
+/* **** Definitions **** */
+struct TelemetryFrame {
+  uint16_t sequence;
+  uint32_t timestamp;
+  uint16_t leds;
+  std::vector<float> bands;
+  // Empty if the block was not sent
+  std::vector<uint16_t> raw;
+  std::vector<float> magnitude;
+  // Still compressed, see spectrum_codec.h
+  std::vector<uint8_t> spectrum;
+  uint16_t spectrum_cycles;
+};
+
+struct TelemetryLogRecord {
+  // Address of the format string, in the .elf of the firmware
+  uint32_t format;
+  uint32_t timestamp;
+  std::vector<uint32_t> args;
+};
+
+struct TelemetryLog {
+  // Records lost on the MCU, because the ring was full
+  uint16_t dropped;
+  std::vector<TelemetryLogRecord> records;
+};
+
+struct TelemetryStats {
+  uint32_t frames;
+  uint32_t crc_errors;
+  // Bad COBS encoding, wrong sizes or unknown packet types
+  uint32_t format_errors;
+  // Packets longer than TELEMETRY_MAX_ENCODED, usually text mixed in the stream
+  uint32_t overflows;
+  // Gaps in the sequence numbers
+  uint32_t lost_frames;
+  uint32_t log_records;
+  uint32_t log_dropped;
+};
+
+class TelemetryDecoder {
+  public:
+    TelemetryDecoder();
+
+    // Feeds received bytes, returns the number of frames completed by them
+    size_t feed(const uint8_t *data, size_t length);
+    // Takes the oldest decoded frame, false if there is none
+    bool next(TelemetryFrame &frame);
+    // Takes the oldest log packet, false if there is none
+    bool nextLog(TelemetryLog &log);
+    const TelemetryStats &stats() const { return _stats; }
+    void reset();
+
+    // Building blocks, also used by the other host tools
+    static uint32_t crc32(const uint8_t *data, size_t length);
+    static bool cobsDecode(const uint8_t *in, size_t length, std::vector<uint8_t> &out);
+    // Parses a decoded packet, CRC included
+    static bool parseFrame(const uint8_t *packet, size_t length, TelemetryFrame &frame);
+    static bool parseLog(const uint8_t *packet, size_t length, TelemetryLog &log);
+
+  private:
+    void packetDone();
+
+    std::vector<uint8_t> _encoded;
+    std::vector<uint8_t> _packet;
+    std::deque<TelemetryFrame> _frames;
+    std::deque<TelemetryLog> _logs;
+    TelemetryStats _stats;
+    bool _overflow;
+    bool _synced;
+    uint16_t _next_sequence;
+};
+
+#endif /* TELEMETRY_DECODER_H */
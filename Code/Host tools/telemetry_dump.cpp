@@ -0,0 +1,156 @@
+/*
+ * Prints the telemetry frames sent by the sketch (TELEMETRY_MODE), one line per frame:
+ *   sequence timestamp_us leds bands... [raw samples count] [magnitude bins count] [spectrum ...]
+ * The compressed spectrum is decoded, and its size and encode cycles printed
+ * The deferred log records are printed as "log <millis>: <text>", formatted with
+ * the strings of the firmware .elf if given
+ * Reads a serial port (UART adapter or the USB CDC port) or the standard input
+ *
+ * Build: g++ -O2 -I../Max32620_Funky_Music telemetry_dump.cpp telemetry_decoder.cpp log_formatter.cpp \
+ *            ../Max32620_Funky_Music/spectrum_codec.cpp -o telemetry_dump
+ * Usage: telemetry_dump /dev/ttyACM0 [baud] [Max32620_Funky_Music.ino.elf]
+ *        telemetry_dump - < capture.bin
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "telemetry_decoder.h"
+#include "spectrum_codec.h"
+#include "log_formatter.h"
+
+/* **** Globals **** */
+static volatile sig_atomic_t stop = 0;
+static spectrum_codec_t spectrum_codec;
+static float spectrum[SPECTRUM_CODEC_MAX_BINS];
+static LogFormatter log_formatter;
+
+/* **** Functions **** */
+static void onSignal(int){
+  stop = 1;
+}
+
+static speed_t baudConstant(long baud){
+  switch(baud){
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+#ifdef B460800
+    case 460800: return B460800;
+#endif
+#ifdef B921600
+    case 921600: return B921600;
+#endif
+    default: return 0;
+  }
+}
+
+// Raw mode, no echo and no translation of the bytes
+static int openPort(const char *path, long baud){
+  int fd = open(path, O_RDONLY | O_NOCTTY);
+  if(fd < 0) return -1;
+
+  struct termios tty;
+  if(tcgetattr(fd, &tty) == 0){
+    cfmakeraw(&tty);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
+    speed_t speed = baudConstant(baud);
+    if(speed){
+      cfsetispeed(&tty, speed);
+      cfsetospeed(&tty, speed);
+    }
+    tcsetattr(fd, TCSANOW, &tty);
+  }
+  return fd;
+}
+
+static void printFrame(const TelemetryFrame &frame){
+  printf("%u %lu %03X", frame.sequence, (unsigned long)frame.timestamp, frame.leds);
+  for(size_t i = 0; i<frame.bands.size(); i++) printf(" %.2f", frame.bands[i]);
+  if(!frame.raw.empty()) printf(" [raw %u]", (unsigned)frame.raw.size());
+  if(!frame.magnitude.empty()) printf(" [magnitude %u]", (unsigned)frame.magnitude.size());
+  if(!frame.spectrum.empty()){
+    int bins = spectrumCodecDecode(&spectrum_codec, frame.spectrum.data(), frame.spectrum.size(), spectrum);
+    if(bins > 0){
+      // Loudest bin, as a quick check of the decoded spectrum
+      int peak = 0;
+      for(int i = 1; i<bins; i++) if(spectrum[i] > spectrum[peak]) peak = i;
+      printf(" [spectrum %d bins, %u bytes, %u cycles, peak %d %.3f]", bins, (unsigned)frame.spectrum.size(),
+             frame.spectrum_cycles, peak, spectrum[peak]);
+    }
+    else if(bins == 0) printf(" [spectrum waiting keyframe]");
+    else printf(" [spectrum error]");
+  }
+  printf("\n");
+}
+
+static void printLog(const TelemetryLog &log){
+  if(log.dropped) printf("log: %u records dropped\n", log.dropped);
+  for(size_t i = 0; i<log.records.size(); i++){
+    const TelemetryLogRecord &record = log.records[i];
+    printf("log %lu: %s\n", (unsigned long)record.timestamp, log_formatter.format(record).c_str());
+  }
+}
+
+int main(int argc, char **argv){
+  if(argc < 2){
+    fprintf(stderr, "Usage: %s <serial port | -> [baud] [firmware elf]\n", argv[0]);
+    return 1;
+  }
+
+  long baud = argc > 2 ? atol(argv[2]) : 115200;
+  int fd = strcmp(argv[1], "-") == 0 ? STDIN_FILENO : openPort(argv[1], baud);
+  if(fd < 0){
+    perror(argv[1]);
+    return 1;
+  }
+
+  if(argc > 3 && !log_formatter.load(argv[3])){
+    fprintf(stderr, "%s: not a 32 bits little endian ELF\n", argv[3]);
+    return 1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  TelemetryDecoder decoder;
+  TelemetryFrame frame;
+  spectrumCodecInit(&spectrum_codec, SPECTRUM_CODEC_MAX_BINS, SPECTRUM_CODEC_DEFAULT_BITS,
+                    SPECTRUM_CODEC_DEFAULT_LOG2_MIN, SPECTRUM_CODEC_DEFAULT_LOG2_MAX);
+  uint16_t next_sequence = 0;
+  uint8_t buffer[1024];
+  while(!stop){
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if(n <= 0) break;
+    decoder.feed(buffer, n);
+    while(decoder.next(frame)){
+      // The deltas of the spectrum refer to the frame that was lost
+      if(frame.sequence != next_sequence) spectrumCodecReset(&spectrum_codec);
+      next_sequence = frame.sequence + 1;
+      printFrame(frame);
+    }
+    TelemetryLog log;
+    while(decoder.nextLog(log)) printLog(log);
+    fflush(stdout);
+  }
+
+  const TelemetryStats &stats = decoder.stats();
+  fprintf(stderr, "Frames: %u, lost: %u, CRC errors: %u, format errors: %u, overflows: %u\n",
+          stats.frames, stats.lost_frames, stats.crc_errors, stats.format_errors, stats.overflows);
+  if(stats.log_records || stats.log_dropped)
+    fprintf(stderr, "Log records: %u, dropped: %u\n", stats.log_records, stats.log_dropped);
+  if(spectrum_codec.total_encoded)
+    fprintf(stderr, "Spectrum compression ratio: %.2f\n", spectrumCodecRatio(&spectrum_codec));
+  return 0;
+}
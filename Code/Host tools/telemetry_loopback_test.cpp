@@ -0,0 +1,307 @@
+/*
+ * Loopback test of the binary telemetry: the encoder of the sketch (telemetry.cpp)
+ * writes to a pseudo-terminal and the host decoder reads it back
+ * - Print path: frames with every mix of the optional blocks, and text injected
+ *   in the middle of the stream, as DEBUG_MODE does on a shared port. The frame
+ *   hit by the text is lost and counted, every other one is decoded as sent
+ * - The same bytes split at the delimiters by hand and checked with the building
+ *   blocks, cobsDecode, crc32 and parseFrame
+ * - writeAsync() path: the encoded buffers stay busy until the port calls back,
+ *   a frame sent with every buffer busy is dropped and shows as a sequence gap
+ * - A log packet, through telemetrySendPacket and parseLog
+ * telemetry.cpp is built into this file, with the CRC32 peripheral, Print and
+ * MXC_HardwareSerial replaced by the host versions below.
+ *
+ * Build: g++ -O2 -I../Max32620_Funky_Music -I"../MAX32620 Arduino BSP" telemetry_loopback_test.cpp \
+ *            telemetry_decoder.cpp -lutil -o telemetry_loopback_test
+ * Usage: telemetry_loopback_test, returns 0 if every check passed
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <pty.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include "mxc_errors.h"
+
+/* **** Host versions of the headers of telemetry.cpp **** */
+// Their include guards keep the target headers out
+#define _ARM_MATH_H
+#define Print_h
+#define MXC_HardwareSerial_h
+#define _MXC_CONFIG_H
+#define _CRC_H_
+
+typedef float float32_t;
+
+typedef struct uart_req uart_req_t;
+struct uart_req {
+  uint8_t *data;
+  unsigned len;
+  unsigned num;
+  void (*callback)(uart_req_t *, int);
+};
+
+class Print {
+  public:
+    virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+};
+
+// Sends a request once send() is called, as the interrupt of the port would
+class MXC_HardwareSerial {
+  public:
+    int fd;
+    std::vector<uart_req_t *> pending;
+    int writeAsync(uart_req_t *req);
+    void send(void);
+};
+
+// CRC32 peripheral in little endian mode, the same result as the zlib CRC-32
+static uint32_t crc_value;
+static void CRC32_Init(uint8_t lilEndian){}
+static void CRC32_Reseed(uint32_t seed){ crc_value = seed; }
+static void CRC32_AddData(uint32_t data){
+  for(int i = 0; i<32; i++){
+    uint32_t bit = (crc_value ^ (data >> i)) & 1;
+    crc_value = (crc_value >> 1) ^ (bit ? 0xEDB88320u : 0);
+  }
+}
+static uint32_t CRC32_GetCRC(void){ return crc_value ^ 0xFFFFFFFFu; }
+
+#include "telemetry.cpp"
+#include "telemetry_decoder.h"
+
+/* **** Definitions **** */
+#define FRAMES 300
+#define GARBAGE_FRAME 50
+#define BANDS 10
+#define RAW_MAX 257
+#define MAGNITUDE_BINS 128
+
+#define CHECK(condition) \
+  do{ if(!(condition)){ printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); failures++; } }while(0)
+
+// Contents of a frame, from its sequence number
+struct FrameData {
+  float32_t bands[BANDS];
+  uint32_t raw[RAW_MAX];
+  float32_t magnitude[MAGNITUDE_BINS];
+  uint8_t spectrum[7];
+  telemetry_frame_t frame;
+};
+
+class FdPrint : public Print {
+  public:
+    int fd;
+    size_t write(const uint8_t *buffer, size_t size){
+      size_t done = 0;
+      while(done < size){
+        ssize_t n = ::write(fd, buffer + done, size - done);
+        if(n <= 0) break;
+        done += n;
+      }
+      return done;
+    }
+};
+
+/* **** Globals **** */
+static int failures = 0;
+static int master_fd, slave_fd;
+
+/* **** Functions **** */
+int MXC_HardwareSerial::writeAsync(uart_req_t *req){
+  req->num = 0;
+  pending.push_back(req);
+  return E_NO_ERROR;
+}
+
+void MXC_HardwareSerial::send(void){
+  for(uart_req_t *req : pending){
+    req->num = ::write(fd, req->data, req->len);
+    req->callback(req, E_NO_ERROR);
+  }
+  pending.clear();
+}
+
+/* Every mix of the optional blocks, zeros included to exercise the COBS codes */
+static void makeFrame(uint16_t sequence, FrameData &data){
+  telemetry_frame_t &frame = data.frame;
+  for(int i = 0; i<BANDS; i++) data.bands[i] = sequence*0.25f + i;
+  for(int i = 0; i<RAW_MAX; i++) data.raw[i] = (sequence*i) & 0x3FF;
+  for(int i = 0; i<MAGNITUDE_BINS; i++) data.magnitude[i] = (i % 3) ? i*0.5f : 0.0f;
+  memcpy(data.spectrum, "abcde\0f", 7);
+
+  frame.timestamp = sequence*1000u;
+  frame.bands = data.bands;
+  frame.bands_count = BANDS;
+  frame.leds = sequence & 0x3FF;
+  frame.raw = (sequence % 3) ? data.raw : NULL;
+  frame.raw_count = (sequence & 1) ? RAW_MAX : RAW_MAX - 1;
+  frame.magnitude = (sequence % 5) ? data.magnitude : NULL;
+  frame.magnitude_count = MAGNITUDE_BINS;
+  frame.spectrum = (sequence & 1) ? data.spectrum : NULL;
+  frame.spectrum_length = 7;
+  frame.spectrum_cycles = 1234;
+}
+
+/* Returns true if the decoded frame holds what makeFrame sent with its sequence */
+static bool frameMatches(const TelemetryFrame &decoded){
+  static FrameData data;
+  makeFrame(decoded.sequence, data);
+  const telemetry_frame_t &frame = data.frame;
+
+  if((decoded.timestamp != frame.timestamp) || (decoded.leds != frame.leds)) return false;
+  if(decoded.bands.size() != BANDS || memcmp(decoded.bands.data(), data.bands, sizeof(data.bands))) return false;
+  if(decoded.raw.size() != (frame.raw ? frame.raw_count : 0u)) return false;
+  for(size_t i = 0; i<decoded.raw.size(); i++) if(decoded.raw[i] != data.raw[i]) return false;
+  if(decoded.magnitude.size() != (frame.magnitude ? MAGNITUDE_BINS : 0u)) return false;
+  if(frame.magnitude && memcmp(decoded.magnitude.data(), data.magnitude, sizeof(data.magnitude))) return false;
+  if(decoded.spectrum.size() != (frame.spectrum ? 7u : 0u)) return false;
+  if(frame.spectrum && (memcmp(decoded.spectrum.data(), data.spectrum, 7) || decoded.spectrum_cycles != 1234)) return false;
+  return true;
+}
+
+/* Everything the pseudo-terminal has now */
+static void drain(std::vector<uint8_t> &stream){
+  uint8_t buffer[4096];
+  ssize_t n;
+  while((n = read(master_fd, buffer, sizeof(buffer))) > 0) stream.insert(stream.end(), buffer, buffer + n);
+}
+
+static void testPrint(void){
+  static FrameData data;
+  std::vector<uint8_t> stream;
+  FdPrint out;
+  out.fd = slave_fd;
+  telemetryInit();
+
+  for(int i = 0; i<FRAMES; i++){
+    makeFrame(i, data);
+    if(i == GARBAGE_FRAME) out.write((const uint8_t *)"Wake to first frame: 120 us\r\n", 29);
+    CHECK(telemetrySendFrame(&data.frame, out) > 0);
+    // A frame is below the buffer of the pseudo-terminal
+    drain(stream);
+  }
+
+  // Fed in odd chunks, as read from a port
+  TelemetryDecoder decoder;
+  for(size_t i = 0; i<stream.size(); i += 37) decoder.feed(&stream[i], std::min<size_t>(37, stream.size() - i));
+  TelemetryFrame decoded;
+  int frames = 0, bad = 0;
+  while(decoder.next(decoded)){
+    frames++;
+    if(!frameMatches(decoded) || decoded.sequence == GARBAGE_FRAME) bad++;
+  }
+  const TelemetryStats &stats = decoder.stats();
+  printf("Print: %d frames decoded, %d bad, lost %u, CRC errors %u, format errors %u\n", frames, bad,
+         (unsigned)stats.lost_frames, (unsigned)stats.crc_errors, (unsigned)stats.format_errors);
+  CHECK(frames == FRAMES - 1 && bad == 0);
+  CHECK(stats.lost_frames == 1 && stats.crc_errors + stats.format_errors == 1);
+
+  // The same stream with the building blocks
+  int checked = 0;
+  size_t start = 0;
+  for(size_t i = 0; i<stream.size(); i++){
+    if(stream[i] != TELEMETRY_DELIMITER) continue;
+    std::vector<uint8_t> packet;
+    if((i > start) && TelemetryDecoder::cobsDecode(&stream[start], i - start, packet) &&
+       (packet.size() > TELEMETRY_CRC_SIZE)){
+      size_t length = packet.size() - TELEMETRY_CRC_SIZE;
+      uint32_t crc = packet[length] | (packet[length+1] << 8) | (packet[length+2] << 16) | ((uint32_t)packet[length+3] << 24);
+      if(TelemetryDecoder::crc32(packet.data(), length) == crc){
+        CHECK(TelemetryDecoder::parseFrame(packet.data(), packet.size(), decoded) && frameMatches(decoded));
+        checked++;
+      }
+    }
+    start = i + 1;
+  }
+  CHECK(checked == FRAMES - 1);
+}
+
+static void testAsync(void){
+  static FrameData data;
+  std::vector<uint8_t> stream;
+  MXC_HardwareSerial port;
+  port.fd = slave_fd;
+  telemetryInit();
+
+  // Frames 0 and 1 take the buffers, 2 is dropped until the port sends them
+  for(int i = 0; i<3; i++){
+    makeFrame(i, data);
+    size_t length = telemetrySendFrame(&data.frame, port);
+    CHECK((i < TELEMETRY_ASYNC_BUFFERS) ? (length > 0) : (length == 0));
+  }
+  CHECK(telemetryAsyncFree() == 0);
+  port.send();
+  CHECK(telemetryAsyncFree() == TELEMETRY_ASYNC_BUFFERS);
+  makeFrame(3, data);
+  CHECK(telemetrySendFrame(&data.frame, port) > 0);
+  port.send();
+  drain(stream);
+
+  TelemetryDecoder decoder;
+  decoder.feed(stream.data(), stream.size());
+  TelemetryFrame decoded;
+  uint16_t sequences[4];
+  int frames = 0;
+  while(decoder.next(decoded) && frames < 4){
+    CHECK(frameMatches(decoded));
+    sequences[frames++] = decoded.sequence;
+  }
+  printf("writeAsync: %d frames decoded, lost %u\n", frames, (unsigned)decoder.stats().lost_frames);
+  CHECK(frames == 3 && sequences[0] == 0 && sequences[1] == 1 && sequences[2] == 3);
+  CHECK(decoder.stats().lost_frames == 1);
+}
+
+static void testLog(void){
+  // Header and two records: format address with the argument count, timestamp, arguments
+  uint32_t packet[] = {
+    TELEMETRY_PACKET_LOG | (2 << 8) | (5u << 16),
+    0x00001000 | (2u << TELEMETRY_LOG_COUNT_POS), 1500, 7, 0x40490FDB,
+    0x00002000, 1501,
+  };
+  std::vector<uint8_t> stream;
+  FdPrint out;
+  out.fd = slave_fd;
+  telemetryInit();
+  CHECK(telemetrySendPacket((const uint8_t *)packet, sizeof(packet), out) > 0);
+  drain(stream);
+
+  TelemetryDecoder decoder;
+  decoder.feed(stream.data(), stream.size());
+  TelemetryLog log;
+  CHECK(decoder.nextLog(log));
+  CHECK(log.dropped == 5 && log.records.size() == 2);
+  if(log.records.size() == 2){
+    CHECK(log.records[0].format == 0x1000 && log.records[0].timestamp == 1500);
+    CHECK(log.records[0].args.size() == 2 && log.records[0].args[1] == 0x40490FDB);
+    CHECK(log.records[1].format == 0x2000 && log.records[1].args.empty());
+  }
+}
+
+int main(void){
+  struct termios raw_mode;
+  cfmakeraw(&raw_mode);
+  if(openpty(&master_fd, &slave_fd, NULL, &raw_mode, NULL) != 0){
+    perror("openpty");
+    return 1;
+  }
+  fcntl(master_fd, F_SETFL, fcntl(master_fd, F_GETFL) | O_NONBLOCK);
+
+  testPrint();
+  testAsync();
+  testLog();
+
+  if(failures){
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
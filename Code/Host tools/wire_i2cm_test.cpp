@@ -0,0 +1,521 @@
+/*
+ * Host test of Wire (MAX32620 Arduino BSP) and of the I2CM driver under it,
+ * against a register model of the I2CM with an EEPROM like slave at 0x50
+ * - Blocking API: endTransmission, endTransmission(false) then requestFrom, NACK
+ * - readAsync/writeAsync of 100 bytes, over the FIFO and over BUFFER_LENGTH
+ * - Queue full: one active request plus WIRE_ASYNC_QUEUE_SIZE waiting, E_BUSY after
+ * - Requests chained from the callbacks, and a blocking call refused from them
+ * - Slave holding the bus: the blocking call returns after WIRE_TIMEOUT_MS, the
+ *   requests are ended with E_SHUTDOWN and the bus works again at the same clock
+ * Wire.cpp and i2cm.c are built into this file, with the registers, the NVIC
+ * and the system headers replaced by the host versions below. A thread plays
+ * the hardware: it moves the FIFOs and runs the I2CM interrupt, the NVIC is a
+ * mutex it holds meanwhile.
+ * i2cm.c keeps the active request in a 32 bits lock: -fpermissive lets the
+ * cast through and -no-pie keeps the requests, all static, below 4 GB.
+ *
+ * Build: g++ -O2 -fpermissive -no-pie -pthread -I"../MAX32620 Arduino BSP" wire_i2cm_test.cpp -o wire_i2cm_test
+ * Usage: wire_i2cm_test, returns 0 if every check passed
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "mxc_errors.h"
+
+/* **** Host versions of the headers of Wire.cpp and i2cm.c **** */
+// Their include guards keep the target headers out
+#define Arduino_h
+#define Stream_h
+#define _MXC_CONFIG_H
+#define _MXC_SYS_H_
+#define _MXC_LOCK_H_
+#define _MXC_ASSERT_H_
+
+#define CONCAT(a, b) CONCAT_(a, b)
+#define CONCAT_(a, b) a##b
+#define DEFAULT_I2CM_PORT 0
+#define __STATIC_INLINE static inline
+#define MXC_ASSERT(expr)
+
+// Exception number of the running interrupt, and the interrupts masked, per thread
+static thread_local uint32_t ipsr = 0;
+static thread_local uint32_t primask = 0;
+static uint32_t __get_IPSR(void){ return ipsr; }
+static uint32_t __get_PRIMASK(void){ return primask; }
+
+static uint32_t millis(void){
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+class Print {
+  public:
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size){
+      size_t n = 0;
+      while(size--) n += write(*buffer++);
+      return n;
+    }
+    void setWriteError(int error = 1){ write_error = error; }
+    int write_error = 0;
+};
+
+class Stream : public Print {
+  public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+    virtual void flush(void) = 0;
+};
+
+#define MXC_CFG_I2CM_INSTANCES 3
+#define MXC_I2CM_FIFO_DEPTH 8
+typedef enum { I2CM0_IRQn = 0, I2CM1_IRQn, I2CM2_IRQn } IRQn_Type;
+#define I2CM_IRQ_EXCEPTION 16 // Exception number of I2CM0_IRQn
+
+// The register map only, the structures are the models below
+#define mxc_i2cm_regs_t mxc_i2cm_map_t
+#define mxc_i2cm_fifo_regs_t mxc_i2cm_fifo_map_t
+#include "i2cm_regs.h"
+#undef mxc_i2cm_regs_t
+#undef mxc_i2cm_fifo_regs_t
+
+struct FakeI2cm;
+// Plain register
+struct Reg {
+  std::atomic<uint32_t> v{0};
+  operator uint32_t() const { return v; }
+  Reg &operator=(uint32_t x){ v = x; return *this; }
+  Reg &operator|=(uint32_t x){ v |= x; return *this; }
+  Reg &operator&=(uint32_t x){ v &= x; return *this; }
+};
+// Write 1 to clear
+struct W1cReg {
+  std::atomic<uint32_t> v{0};
+  operator uint32_t() const { return v; }
+  W1cReg &operator=(uint32_t x){ v &= ~x; return *this; }
+  W1cReg &operator=(const W1cReg &other){ return *this = (uint32_t)other; }
+};
+// MSTR_RESET_EN empties the FIFOs and stops the transaction
+struct CtrlReg {
+  FakeI2cm *dev;
+  std::atomic<uint32_t> v{0};
+  operator uint32_t() const { return v; }
+  CtrlReg &operator=(uint32_t x);
+  CtrlReg &operator|=(uint32_t x){ return *this = v | x; }
+  CtrlReg &operator&=(uint32_t x){ return *this = v & x; }
+};
+// TX_START starts the transaction, TX_IN_PROGRESS until the stop
+struct TransReg {
+  FakeI2cm *dev;
+  operator uint32_t() const;
+  TransReg &operator=(uint32_t x);
+  TransReg &operator|=(uint32_t x){ return *this = (uint32_t)*this | x; }
+};
+// RX FIFO count, and SCL/SDA always high
+struct BbReg {
+  FakeI2cm *dev;
+  operator uint32_t() const;
+};
+struct TxFifo {
+  FakeI2cm *dev;
+  operator uint32_t() const;
+  TxFifo &operator=(uint32_t x);
+};
+struct RxFifo {
+  FakeI2cm *dev;
+  operator uint32_t() const;
+};
+
+typedef struct {
+  Reg fs_clk_div;
+  Reg timeout;
+  CtrlReg ctrl;
+  TransReg trans;
+  W1cReg intfl;
+  Reg inten;
+  BbReg bb;
+} mxc_i2cm_regs_t;
+
+typedef struct {
+  TxFifo tx;
+  RxFifo rx;
+} mxc_i2cm_fifo_regs_t;
+
+mxc_i2cm_regs_t *fakeRegs(int index);
+mxc_i2cm_fifo_regs_t *fakeFifo(int index);
+int fakeIndex(mxc_i2cm_regs_t *regs);
+#define MXC_I2CM_GET_IRQ(i) ((IRQn_Type)(i))
+#define MXC_I2CM_GET_I2CM(i) fakeRegs(i)
+#define MXC_I2CM_GET_FIFO(i) fakeFifo(i)
+#define MXC_I2CM_GET_IDX(p) fakeIndex(p)
+
+static void NVIC_DisableIRQ(IRQn_Type irqn);
+static void NVIC_EnableIRQ(IRQn_Type irqn);
+
+typedef int ioman_cfg_t;
+typedef enum { CLKMAN_SCALE_DIV_1 = 1 } clkman_scale_t;
+typedef struct {
+  clkman_scale_t clk_scale;
+  ioman_cfg_t io_cfg;
+} sys_cfg_i2cm_t;
+static int SYS_I2CM_Init(mxc_i2cm_regs_t *i2cm, const sys_cfg_i2cm_t *sys_cfg){ return E_NO_ERROR; }
+static int SYS_I2CM_Shutdown(mxc_i2cm_regs_t *i2cm){ return E_NO_ERROR; }
+static uint32_t SYS_I2CM_GetFreq(mxc_i2cm_regs_t *i2cm){ return 48000000; }
+
+static int mxc_get_lock(uint32_t *lock, uint32_t value){
+  uint32_t unlocked = 0;
+  return __atomic_compare_exchange_n(lock, &unlocked, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? E_NO_ERROR : E_BUSY;
+}
+static void mxc_free_lock(uint32_t *lock){ __atomic_store_n(lock, 0, __ATOMIC_SEQ_CST); }
+
+#include "i2cm.c"
+#include "Wire.cpp"
+
+/* **** Definitions **** */
+#define SLAVE_ADDRESS 0x50
+#define CHECK(condition) do{ if(!(condition)){ printf("FAILED line %d: %s\n", __LINE__, #condition); failures++; } }while(0)
+
+// I2CM and slave: the FIFOs, the transaction, the memory of the slave
+struct FakeI2cm {
+  mxc_i2cm_regs_t regs;
+  mxc_i2cm_fifo_regs_t fifo;
+  std::deque<uint16_t> tx, rx;
+  bool running = false;
+  uint32_t pending_rx = 0;
+  bool address_byte = false; // First byte written after the start, the memory address
+  uint8_t memory[256];
+  uint8_t pointer = 0;
+  std::atomic<bool> hold{false}; // Slave holding SCL low, the transaction stops moving
+  long transactions = 0;
+};
+
+/* **** Globals **** */
+static int failures = 0;
+static FakeI2cm devices[MXC_CFG_I2CM_INSTANCES];
+static std::recursive_mutex nvic_lock;
+static thread_local int nvic_depth = 0;
+static std::atomic<bool> irq_enabled[MXC_CFG_I2CM_INSTANCES];
+static std::atomic<bool> quit{false};
+
+/* **** Functions **** */
+mxc_i2cm_regs_t *fakeRegs(int index){ return &devices[index].regs; }
+mxc_i2cm_fifo_regs_t *fakeFifo(int index){ return &devices[index].fifo; }
+int fakeIndex(mxc_i2cm_regs_t *regs){
+  for(int i = 0; i<MXC_CFG_I2CM_INSTANCES; i++) if(regs == &devices[i].regs) return i;
+  return -1;
+}
+
+CtrlReg &CtrlReg::operator=(uint32_t x){
+  v = x;
+  if(x & MXC_F_I2CM_CTRL_MSTR_RESET_EN){
+    dev->tx.clear();
+    dev->rx.clear();
+    dev->running = false;
+    dev->pending_rx = 0;
+  }
+  return *this;
+}
+TransReg::operator uint32_t() const { return dev->running ? MXC_F_I2CM_TRANS_TX_IN_PROGRESS : 0; }
+TransReg &TransReg::operator=(uint32_t x){
+  if(x & MXC_F_I2CM_TRANS_TX_START) dev->running = true;
+  return *this;
+}
+BbReg::operator uint32_t() const {
+  return ((uint32_t)dev->rx.size() << MXC_F_I2CM_BB_RX_FIFO_CNT_POS) | MXC_F_I2CM_BB_BB_SCL_IN_VAL | MXC_F_I2CM_BB_BB_SDA_IN_VAL;
+}
+TxFifo::operator uint32_t() const { return dev->tx.size() >= MXC_I2CM_FIFO_DEPTH; }
+TxFifo &TxFifo::operator=(uint32_t x){
+  if(dev->tx.size() >= MXC_I2CM_FIFO_DEPTH){
+    printf("TX FIFO overflow\n");
+    abort();
+  }
+  dev->tx.push_back(x);
+  return *this;
+}
+RxFifo::operator uint32_t() const {
+  if(dev->rx.empty()) return MXC_S_I2CM_RSTLS_TAG_EMPTY;
+  uint16_t value = dev->rx.front();
+  dev->rx.pop_front();
+  return value;
+}
+
+// The NVIC of one interrupt: the hardware thread runs the handler with the lock held
+static void NVIC_DisableIRQ(IRQn_Type irqn){
+  nvic_lock.lock();
+  nvic_depth++;
+}
+static void NVIC_EnableIRQ(IRQn_Type irqn){
+  irq_enabled[irqn] = true;
+  if(nvic_depth > 0){
+    nvic_depth--;
+    nvic_lock.unlock();
+  }
+}
+
+// One step of the bus: a tag of the TX FIFO, or a byte read from the slave
+static void busStep(FakeI2cm &d){
+  if(d.running && !d.hold){
+    if(d.pending_rx){
+      if(d.rx.size() < MXC_I2CM_FIFO_DEPTH){
+        d.rx.push_back(MXC_S_I2CM_RSTLS_TAG_DATA | d.memory[d.pointer++]);
+        d.pending_rx--;
+      }
+    }
+    else if(!d.tx.empty()){
+      uint16_t tag = d.tx.front();
+      d.tx.pop_front();
+      switch(tag & 0x700){
+        case MXC_S_I2CM_TRANS_TAG_START:
+          if(((tag >> 1) & 0x7F) != SLAVE_ADDRESS){
+            d.regs.intfl.v |= MXC_F_I2CM_INTFL_TX_NACKED;
+            d.running = false;
+            d.tx.clear();
+            break;
+          }
+          d.address_byte = !(tag & I2CM_READ_BIT);
+          break;
+        case MXC_S_I2CM_TRANS_TAG_TXDATA_ACK:
+          if(d.address_byte){
+            d.pointer = tag & 0xFF;
+            d.address_byte = false;
+          }
+          else d.memory[d.pointer++] = tag & 0xFF;
+          break;
+        case MXC_S_I2CM_TRANS_TAG_RXDATA_COUNT: d.pending_rx += (tag & 0xFF) + 1; break;
+        case MXC_S_I2CM_TRANS_TAG_RXDATA_NACK: d.pending_rx += 1; break;
+        case MXC_S_I2CM_TRANS_TAG_STOP:
+          d.running = false;
+          d.transactions++;
+          d.regs.intfl.v |= MXC_F_I2CM_INTFL_TX_DONE;
+          break;
+        default:
+          printf("Unexpected tag %x\n", tag);
+          abort();
+      }
+    }
+  }
+
+  uint32_t flags = 0;
+  if(d.tx.empty()) flags |= MXC_F_I2CM_INTFL_TX_FIFO_EMPTY;
+  if(d.tx.size() <= MXC_I2CM_FIFO_DEPTH/4) flags |= MXC_F_I2CM_INTFL_TX_FIFO_3Q_EMPTY;
+  if(d.rx.size() >= 1) flags |= MXC_F_I2CM_INTFL_RX_FIFO_NOT_EMPTY;
+  if(d.rx.size() >= MXC_I2CM_FIFO_DEPTH/2) flags |= MXC_F_I2CM_INTFL_RX_FIFO_2Q_FULL;
+  if(d.rx.size() >= 3*MXC_I2CM_FIFO_DEPTH/4) flags |= MXC_F_I2CM_INTFL_RX_FIFO_3Q_FULL;
+  d.regs.intfl.v |= flags;
+}
+
+static void hardware(void){
+  ipsr = I2CM_IRQ_EXCEPTION;
+  while(!quit){
+    {
+      std::lock_guard<std::recursive_mutex> guard(nvic_lock);
+      busStep(devices[0]);
+      if(irq_enabled[0] && (devices[0].regs.intfl & devices[0].regs.inten)) I2CM0_IRQHandler();
+    }
+    std::this_thread::yield();
+  }
+}
+
+/* Requests of the async tests, in static memory as the driver keeps them */
+static i2cm_req_t requests[WIRE_ASYNC_QUEUE_SIZE + 2];
+static uint8_t written[100], readBack[100];
+static uint8_t registerAddress = 0x10;
+static std::atomic<int> completed{0}, lastError{99}, shutdowns{0}, chained{0}, refusedFromCallback{0};
+
+static void setRequest(i2cm_req_t *req, uint8_t addr, const uint8_t *cmd, uint32_t cmdLength,
+                       uint8_t *data, uint32_t length, i2cm_callback_fn callback){
+  req->addr = addr;
+  req->cmd_data = cmd;
+  req->cmd_len = cmdLength;
+  req->data = data;
+  req->data_len = length;
+  req->callback = callback;
+}
+
+static void doneCallback(i2cm_req_t *req, int error){
+  lastError = error;
+  if(error == E_SHUTDOWN) shutdowns++;
+  completed++;
+}
+
+// Queues the next read from the callback of the previous one, and tries a blocking
+// read, refused at once instead of waiting for its timeout
+static void chainCallback(i2cm_req_t *req, int error){
+  uint32_t start = millis();
+  if((Wire.requestFrom(SLAVE_ADDRESS, 1) == 0) && ((millis() - start) < WIRE_TIMEOUT_MS/2)) refusedFromCallback++;
+  completed++;
+  if(chained++ < 3){
+    setRequest(req, SLAVE_ADDRESS, &registerAddress, 1, readBack, 10, chainCallback);
+    CHECK(Wire.readAsync(req) == E_NO_ERROR);
+  }
+}
+
+static void waitCompleted(int count){
+  uint32_t start = millis();
+  while((completed < count) && ((millis() - start) < 1000)) std::this_thread::yield();
+  CHECK(completed == count);
+}
+
+static void testBlocking(void){
+  Wire.beginTransmission(SLAVE_ADDRESS);
+  Wire.write((uint8_t)0x20);
+  Wire.write((uint8_t)0xAB);
+  Wire.write((uint8_t)0xCD);
+  CHECK(Wire.endTransmission() == 0);
+
+  // The register address, then the read after a repeated start
+  Wire.beginTransmission(SLAVE_ADDRESS);
+  Wire.write((uint8_t)0x20);
+  CHECK(Wire.endTransmission(false) == 0);
+  CHECK(Wire.requestFrom(SLAVE_ADDRESS, 2) == 2);
+  CHECK(Wire.read() == 0xAB);
+  CHECK(Wire.read() == 0xCD);
+  CHECK(Wire.read() == -1);
+
+  // NACK of the address
+  Wire.beginTransmission(0x33);
+  Wire.write((uint8_t)1);
+  CHECK(Wire.endTransmission() == 4);
+  CHECK(Wire.requestFrom(0x33, 1) == 0);
+
+  // Interrupts masked, the completion would never come
+  primask = 1;
+  Wire.beginTransmission(SLAVE_ADDRESS);
+  Wire.write((uint8_t)0x20);
+  CHECK(Wire.endTransmission() == 4);
+  primask = 0;
+}
+
+static void testLongTransfer(void){
+  // The memory address in front of the data to write
+  static uint8_t toWrite[101];
+  toWrite[0] = registerAddress;
+  for(int i = 0; i<100; i++) toWrite[i+1] = written[i] = 200 - i;
+
+  completed = 0;
+  setRequest(&requests[0], SLAVE_ADDRESS, NULL, 0, toWrite, sizeof(toWrite), doneCallback);
+  setRequest(&requests[1], SLAVE_ADDRESS, &registerAddress, 1, readBack, sizeof(readBack), doneCallback);
+  CHECK(Wire.writeAsync(&requests[0]) == E_NO_ERROR);
+  CHECK(Wire.readAsync(&requests[1]) == E_NO_ERROR);
+  waitCompleted(2);
+  CHECK(lastError == E_NO_ERROR);
+  CHECK(memcmp(written, readBack, sizeof(readBack)) == 0);
+  CHECK(requests[1].data_num == sizeof(readBack));
+  CHECK(!Wire.busy());
+
+  // NACK
+  completed = 0;
+  setRequest(&requests[2], 0x22, NULL, 0, readBack, 3, doneCallback);
+  CHECK(Wire.writeAsync(&requests[2]) == E_NO_ERROR);
+  waitCompleted(1);
+  CHECK(lastError == E_COMM_ERR);
+}
+
+static void testQueueFull(void){
+  int queued = 0, refused = 0;
+
+  // Nothing completes while the interrupt is disabled: the first request is
+  // started, WIRE_ASYNC_QUEUE_SIZE wait, the next one is refused
+  completed = 0;
+  NVIC_DisableIRQ(I2CM0_IRQn);
+  for(int i = 0; i<WIRE_ASYNC_QUEUE_SIZE + 2; i++){
+    setRequest(&requests[i], SLAVE_ADDRESS, &registerAddress, 1, readBack, 50, doneCallback);
+    int error = Wire.readAsync(&requests[i]);
+    if(error == E_NO_ERROR) queued++;
+    else if(error == E_BUSY) refused++;
+  }
+  NVIC_EnableIRQ(I2CM0_IRQn);
+  CHECK(queued == WIRE_ASYNC_QUEUE_SIZE + 1);
+  CHECK(refused == 1);
+  waitCompleted(queued);
+  CHECK(!Wire.busy());
+}
+
+static void testChained(void){
+  completed = 0;
+  chained = 0;
+  refusedFromCallback = 0;
+  setRequest(&requests[0], SLAVE_ADDRESS, &registerAddress, 1, readBack, 10, chainCallback);
+  CHECK(Wire.readAsync(&requests[0]) == E_NO_ERROR);
+  waitCompleted(4);
+  CHECK(refusedFromCallback == 4);
+  uint32_t start = millis();
+  while(Wire.busy() && ((millis() - start) < 1000)) std::this_thread::yield();
+  CHECK(!Wire.busy());
+}
+
+static void testTimeout(void){
+  Wire.setClock(100000);
+  uint32_t clock = devices[0].regs.fs_clk_div;
+
+  // Slave holding the bus during an async write, the blocking one waits behind it
+  completed = 0;
+  shutdowns = 0;
+  devices[0].hold = true;
+  setRequest(&requests[0], SLAVE_ADDRESS, NULL, 0, written, 20, doneCallback);
+  CHECK(Wire.writeAsync(&requests[0]) == E_NO_ERROR);
+  uint32_t start = millis();
+  Wire.beginTransmission(SLAVE_ADDRESS);
+  Wire.write((uint8_t)0x20);
+  CHECK(Wire.endTransmission() == 4);
+  uint32_t elapsed = millis() - start;
+  CHECK((elapsed >= WIRE_TIMEOUT_MS) && (elapsed < 2*WIRE_TIMEOUT_MS));
+  CHECK((completed == 1) && (shutdowns == 1));
+  CHECK(!Wire.busy());
+  CHECK(devices[0].regs.fs_clk_div == clock);
+
+  // The same with the queue full, the blocking call never gets in
+  completed = 0;
+  shutdowns = 0;
+  for(int i = 0; i<WIRE_ASYNC_QUEUE_SIZE + 1; i++){
+    setRequest(&requests[i], SLAVE_ADDRESS, &registerAddress, 1, readBack, 10, doneCallback);
+    CHECK(Wire.readAsync(&requests[i]) == E_NO_ERROR);
+  }
+  CHECK(Wire.requestFrom(SLAVE_ADDRESS, 1) == 0);
+  CHECK((completed == WIRE_ASYNC_QUEUE_SIZE + 1) && (shutdowns == WIRE_ASYNC_QUEUE_SIZE + 1));
+
+  // Released, the bus works again
+  devices[0].hold = false;
+  CHECK(Wire.requestFrom(SLAVE_ADDRESS, 32) == 32);
+  CHECK(devices[0].regs.fs_clk_div == clock);
+}
+
+int main(void){
+  for(int i = 0; i<MXC_CFG_I2CM_INSTANCES; i++){
+    FakeI2cm &d = devices[i];
+    d.regs.ctrl.dev = &d;
+    d.regs.trans.dev = &d;
+    d.regs.bb.dev = &d;
+    d.fifo.tx.dev = &d;
+    d.fifo.rx.dev = &d;
+    for(int j = 0; j<256; j++) d.memory[j] = j ^ 0x5A;
+  }
+  Wire.begin();
+  std::thread bus(hardware);
+
+  testBlocking();
+  testLongTransfer();
+  testQueueFull();
+  testChained();
+  testTimeout();
+
+  quit = true;
+  bus.join();
+
+  if(failures){
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
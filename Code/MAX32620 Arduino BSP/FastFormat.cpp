@@ -0,0 +1,419 @@
+/*
+  FastFormat.cpp - Number to text conversions used by Print
+  See FastFormat.h
+*/
+
+#include <string.h>
+#include "FastFormat.h"
+
+// "00" to "99", two digits per division by 100
+static const char digit_pairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static const uint32_t powers_of_10[FAST_FORMAT_MAX_DIGITS + 1] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+char *fastFormatUnsigned(char *end, unsigned long n, uint8_t base)
+{
+  char *p = end;
+
+  // prevent crash if called with base == 1
+  if (base < 2 || base > 36) base = 10;
+
+  if (base == 10) {
+    while (n >= 100) {
+      unsigned long pair = n % 100;
+      n /= 100;
+      p -= 2;
+      memcpy(p, &digit_pairs[2 * pair], 2);
+    }
+    if (n >= 10) {
+      p -= 2;
+      memcpy(p, &digit_pairs[2 * n], 2);
+    } else {
+      *--p = '0' + n;
+    }
+  } else if ((base & (base - 1)) == 0) {
+    // HEX, OCT and BIN with shifts
+    uint8_t shift = __builtin_ctz(base);
+    unsigned long mask = base - 1;
+    do {
+      uint8_t c = n & mask;
+      *--p = c < 10 ? c + '0' : c + 'A' - 10;
+      n >>= shift;
+    } while (n);
+  } else {
+    do {
+      uint8_t c = n % base;
+      n /= base;
+      *--p = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+  }
+  return p;
+}
+
+// Decimals of a fraction, with leading zeros
+static char *formatDecimals(char *p, uint32_t value, uint8_t digits)
+{
+  char *end = p + digits;
+  char *q = end;
+  while (q - p >= 2) {
+    q -= 2;
+    memcpy(q, &digit_pairs[2 * (value % 100)], 2);
+    value /= 100;
+  }
+  if (q > p) *--q = '0' + value % 10;
+  return end;
+}
+
+static size_t copyText(char *buffer, const char *text)
+{
+  size_t length = strlen(text);
+  memcpy(buffer, text, length);
+  return length;
+}
+
+size_t fastFormatFixed(char *buffer, float value, uint8_t digits)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t exponent = (bits >> 23) & 0xFF;
+  uint32_t mantissa = bits & 0x7FFFFF;
+
+  if (exponent == 0xFF) return copyText(buffer, mantissa ? "nan" : "inf");
+  if (value > 4294967040.0f || value < -4294967040.0f) return copyText(buffer, "ovf");
+  if (digits > FAST_FORMAT_MAX_DIGITS) digits = FAST_FORMAT_MAX_DIGITS;
+
+  char *p = buffer;
+  if (value < 0.0f) *p++ = '-';
+
+  // value = m * 2^e, exactly
+  uint32_t m = exponent ? mantissa | 0x800000 : mantissa;
+  int32_t e = exponent ? (int32_t)exponent - 150 : -149;
+
+  uint32_t int_part;
+  uint32_t fraction;  // fraction bits, below 2^shift
+  uint32_t shift;
+  if (e >= 0) {
+    // Below 2^32, the overflow was checked
+    int_part = m << e;
+    fraction = 0;
+    shift = 0;
+  } else if (e > -32) {
+    shift = -e;
+    int_part = m >> shift;
+    fraction = m & ((1UL << shift) - 1);
+  } else {
+    shift = -e;
+    int_part = 0;
+    fraction = m;
+  }
+
+  // round(fraction * 10^digits / 2^shift), the product is below 2^54
+  uint32_t decimals = 0;
+  if (shift > 0 && shift < 64) {
+    uint64_t scaled = (uint64_t)fraction * powers_of_10[digits];
+    decimals = (uint32_t)((scaled + (1ULL << (shift - 1))) >> shift);
+    if (decimals >= powers_of_10[digits]) {
+      decimals -= powers_of_10[digits];
+      int_part++;
+    }
+  }
+
+  char digits_buffer[10];
+  char *digits_end = digits_buffer + sizeof(digits_buffer);
+  char *first = fastFormatUnsigned(digits_end, int_part, 10);
+  memcpy(p, first, digits_end - first);
+  p += digits_end - first;
+
+  if (digits > 0) {
+    *p++ = '.';
+    p = formatDecimals(p, decimals, digits);
+  }
+  return p - buffer;
+}
+
+// Ryu (Ulf Adams, 2018), float to shortest decimal
+// The tables hold 5^i and 2^k/5^i with 59-61 significant bits
+
+#define FLOAT_MANTISSA_BITS 23
+#define FLOAT_BIAS 127
+#define FLOAT_POW5_INV_BITCOUNT 59
+#define FLOAT_POW5_BITCOUNT 61
+
+static const uint64_t FLOAT_POW5_INV_SPLIT[31] = {
+  576460752303423489ULL, 461168601842738791ULL, 368934881474191033ULL, 295147905179352826ULL,
+  472236648286964522ULL, 377789318629571618ULL, 302231454903657294ULL, 483570327845851670ULL,
+  386856262276681336ULL, 309485009821345069ULL, 495176015714152110ULL, 396140812571321688ULL,
+  316912650057057351ULL, 507060240091291761ULL, 405648192073033409ULL, 324518553658426727ULL,
+  519229685853482763ULL, 415383748682786211ULL, 332306998946228969ULL, 531691198313966350ULL,
+  425352958651173080ULL, 340282366920938464ULL, 544451787073501542ULL, 435561429658801234ULL,
+  348449143727040987ULL, 557518629963265579ULL, 446014903970612463ULL, 356811923176489971ULL,
+  570899077082383953ULL, 456719261665907162ULL, 365375409332725730u
+};
+
+static const uint64_t FLOAT_POW5_SPLIT[47] = {
+  1152921504606846976ULL, 1441151880758558720ULL, 1801439850948198400ULL, 2251799813685248000ULL,
+  1407374883553280000ULL, 1759218604441600000ULL, 2199023255552000000ULL, 1374389534720000000ULL,
+  1717986918400000000ULL, 2147483648000000000ULL, 1342177280000000000ULL, 1677721600000000000ULL,
+  2097152000000000000ULL, 1310720000000000000ULL, 1638400000000000000ULL, 2048000000000000000ULL,
+  1280000000000000000ULL, 1600000000000000000ULL, 2000000000000000000ULL, 1250000000000000000ULL,
+  1562500000000000000ULL, 1953125000000000000ULL, 1220703125000000000ULL, 1525878906250000000ULL,
+  1907348632812500000ULL, 1192092895507812500ULL, 1490116119384765625ULL, 1862645149230957031ULL,
+  1164153218269348144ULL, 1455191522836685180ULL, 1818989403545856475ULL, 2273736754432320594ULL,
+  1421085471520200371ULL, 1776356839400250464ULL, 2220446049250313080ULL, 1387778780781445675ULL,
+  1734723475976807094ULL, 2168404344971008868ULL, 1355252715606880542ULL, 1694065894508600678ULL,
+  2117582368135750847ULL, 1323488980084844279ULL, 1654361225106055349ULL, 2067951531382569187ULL,
+  1292469707114105741ULL, 1615587133892632177ULL, 2019483917365790221u
+};
+
+// ceil(log2(5^e)), for 0 <= e <= 3528
+static inline int32_t pow5bits(int32_t e)
+{
+  return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e)), for 0 <= e <= 1650
+static inline uint32_t log10Pow2(int32_t e)
+{
+  return ((uint32_t)e * 78913) >> 18;
+}
+
+// floor(log10(5^e)), for 0 <= e <= 2620
+static inline uint32_t log10Pow5(int32_t e)
+{
+  return ((uint32_t)e * 732923) >> 20;
+}
+
+static inline uint32_t pow5Factor(uint32_t value)
+{
+  uint32_t count = 0;
+  while (value % 5 == 0) {
+    value /= 5;
+    count++;
+  }
+  return count;
+}
+
+static inline bool multipleOfPowerOf5(uint32_t value, uint32_t p)
+{
+  return pow5Factor(value) >= p;
+}
+
+static inline bool multipleOfPowerOf2(uint32_t value, uint32_t p)
+{
+  return (value & ((1UL << p) - 1)) == 0;
+}
+
+// (m * factor) >> shift, with a 32x64 bits product, shift > 32
+static inline uint32_t mulShift(uint32_t m, uint64_t factor, int32_t shift)
+{
+  uint64_t low = (uint64_t)m * (uint32_t)factor;
+  uint64_t high = (uint64_t)m * (uint32_t)(factor >> 32);
+  uint64_t sum = (low >> 32) + high;
+  return (uint32_t)(sum >> (shift - 32));
+}
+
+static inline uint32_t mulPow5InvDivPow2(uint32_t m, uint32_t q, int32_t j)
+{
+  return mulShift(m, FLOAT_POW5_INV_SPLIT[q], j);
+}
+
+static inline uint32_t mulPow5DivPow2(uint32_t m, uint32_t i, int32_t j)
+{
+  return mulShift(m, FLOAT_POW5_SPLIT[i], j);
+}
+
+// Shortest output * 10^exponent in the rounding interval of the float
+static void floatToDecimal(uint32_t ieee_mantissa, uint32_t ieee_exponent, uint32_t &output, int32_t &exponent)
+{
+  int32_t e2;
+  uint32_t m2;
+  if (ieee_exponent == 0) {
+    e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+    m2 = ieee_mantissa;
+  } else {
+    e2 = (int32_t)ieee_exponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+    m2 = (1UL << FLOAT_MANTISSA_BITS) | ieee_mantissa;
+  }
+  const bool even = (m2 & 1) == 0;
+  const bool accept_bounds = even;
+
+  // Value and the bounds of its interval, times 4
+  const uint32_t mv = 4 * m2;
+  const uint32_t mp = 4 * m2 + 2;
+  const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+  const uint32_t mm = 4 * m2 - 1 - mm_shift;
+
+  // The same values in base 10
+  uint32_t vr, vp, vm;
+  int32_t e10;
+  bool vm_trailing_zeros = false;
+  bool vr_trailing_zeros = false;
+  uint8_t last_removed_digit = 0;
+  if (e2 >= 0) {
+    const uint32_t q = log10Pow2(e2);
+    e10 = (int32_t)q;
+    const int32_t k = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32_t)q) - 1;
+    const int32_t i = -e2 + (int32_t)q + k;
+    vr = mulPow5InvDivPow2(mv, q, i);
+    vp = mulPow5InvDivPow2(mp, q, i);
+    vm = mulPow5InvDivPow2(mm, q, i);
+    if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+      // The loop below removes at most one digit, the last one is needed for the rounding
+      const int32_t l = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32_t)(q - 1)) - 1;
+      last_removed_digit = (uint8_t)(mulPow5InvDivPow2(mv, q - 1, -e2 + (int32_t)q - 1 + l) % 10);
+    }
+    if (q <= 9) {
+      // Only one of mp, mv and mm can be a multiple of 5
+      if (mv % 5 == 0) {
+        vr_trailing_zeros = multipleOfPowerOf5(mv, q);
+      } else if (accept_bounds) {
+        vm_trailing_zeros = multipleOfPowerOf5(mm, q);
+      } else {
+        vp -= multipleOfPowerOf5(mp, q);
+      }
+    }
+  } else {
+    const uint32_t q = log10Pow5(-e2);
+    e10 = (int32_t)q + e2;
+    const int32_t i = -e2 - (int32_t)q;
+    const int32_t k = pow5bits(i) - FLOAT_POW5_BITCOUNT;
+    int32_t j = (int32_t)q - k;
+    vr = mulPow5DivPow2(mv, i, j);
+    vp = mulPow5DivPow2(mp, i, j);
+    vm = mulPow5DivPow2(mm, i, j);
+    if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+      j = (int32_t)q - 1 - (pow5bits(i + 1) - FLOAT_POW5_BITCOUNT);
+      last_removed_digit = (uint8_t)(mulPow5DivPow2(mv, i + 1, j) % 10);
+    }
+    if (q <= 1) {
+      // mv has at least q trailing 0 bits, mm has them if mm_shift is 1
+      vr_trailing_zeros = true;
+      if (accept_bounds) {
+        vm_trailing_zeros = mm_shift == 1;
+      } else {
+        --vp;
+      }
+    } else if (q < 31) {
+      vr_trailing_zeros = multipleOfPowerOf2(mv, q - 1);
+    }
+  }
+
+  // Remove the digits that are the same in the whole interval
+  int32_t removed = 0;
+  if (vm_trailing_zeros || vr_trailing_zeros) {
+    // General case, rare
+    while (vp / 10 > vm / 10) {
+      vm_trailing_zeros &= vm % 10 == 0;
+      vr_trailing_zeros &= last_removed_digit == 0;
+      last_removed_digit = (uint8_t)(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    if (vm_trailing_zeros) {
+      while (vm % 10 == 0) {
+        vr_trailing_zeros &= last_removed_digit == 0;
+        last_removed_digit = (uint8_t)(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+    }
+    // Round even if exactly halfway
+    if (vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0) last_removed_digit = 4;
+    output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed_digit >= 5);
+  } else {
+    // Common case
+    while (vp / 10 > vm / 10) {
+      last_removed_digit = (uint8_t)(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    output = vr + (vr == vm || last_removed_digit >= 5);
+  }
+  exponent = e10 + removed;
+}
+
+size_t fastFormatShortest(char *buffer, float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t ieee_exponent = (bits >> 23) & 0xFF;
+  uint32_t ieee_mantissa = bits & 0x7FFFFF;
+
+  char *p = buffer;
+  if (ieee_exponent == 0xFF && ieee_mantissa) return copyText(buffer, "nan");
+  if (bits >> 31) *p++ = '-';
+  if (ieee_exponent == 0xFF) return p - buffer + copyText(p, "inf");
+  if (ieee_exponent == 0 && ieee_mantissa == 0) {
+    *p++ = '0';
+    return p - buffer;
+  }
+
+  uint32_t output;
+  int32_t exponent;
+  floatToDecimal(ieee_mantissa, ieee_exponent, output, exponent);
+
+  char digits[10];
+  char *digits_end = digits + sizeof(digits);
+  char *first = fastFormatUnsigned(digits_end, output, 10);
+  int32_t length = digits_end - first;
+  // Digits before the decimal point
+  int32_t point = length + exponent;
+
+  if (point > -4 && point <= 9) {
+    if (point <= 0) {
+      *p++ = '0';
+      *p++ = '.';
+      while (point++ < 0) *p++ = '0';
+      memcpy(p, first, length);
+      p += length;
+    } else if (point < length) {
+      memcpy(p, first, point);
+      p += point;
+      *p++ = '.';
+      memcpy(p, first + point, length - point);
+      p += length - point;
+    } else {
+      memcpy(p, first, length);
+      p += length;
+      while (point-- > length) *p++ = '0';
+    }
+  } else {
+    *p++ = first[0];
+    if (length > 1) {
+      *p++ = '.';
+      memcpy(p, first + 1, length - 1);
+      p += length - 1;
+    }
+    *p++ = 'e';
+    int32_t e = point - 1;
+    if (e < 0) {
+      *p++ = '-';
+      e = -e;
+    }
+    if (e >= 10) {
+      memcpy(p, &digit_pairs[2 * e], 2);
+      p += 2;
+    } else {
+      *p++ = '0' + e;
+    }
+  }
+  return p - buffer;
+}
@@ -0,0 +1,39 @@
+/*
+  FastFormat.h - Number to text conversions used by Print
+  The Cortex-M4F only has a single precision FPU, so the doubles of the
+  original printFloat were done in software, with a multiply and a divide
+  per digit. These conversions only use integer arithmetic on the bits
+  of a float:
+  - integers: two decimal digits per division, from a digit pair table
+  - fixed decimals (print(x, 2)): exact rounding with a 32x32->64 multiply
+  - shortest (print(x, SHORTEST)): the Ryu algorithm for floats, the
+    fewest digits that read back as the same float
+  The text is written in a caller buffer, so Print sends it with a single
+  write(buffer, size).
+*/
+
+#ifndef FastFormat_h
+#define FastFormat_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// Enough for any of the conversions, sign included
+#define FAST_FORMAT_BUFFER_SIZE 24
+// Decimals supported by fastFormatFixed
+#define FAST_FORMAT_MAX_DIGITS 9
+
+// Digits of n in base (2 to 36), written backwards so they end just before end
+// Returns the first digit. Needs 32 chars for base 2
+char *fastFormatUnsigned(char *end, unsigned long n, uint8_t base);
+
+// value with digits decimals (up to FAST_FORMAT_MAX_DIGITS), rounded half up
+// Same output as the original printFloat: "nan", "inf", "ovf" beyond +-4294967040
+// Returns the length, buffer is not terminated
+size_t fastFormatFixed(char *buffer, float value, uint8_t digits);
+
+// Shortest decimal that reads back as value, scientific notation outside 1e-4..1e9
+// Returns the length, buffer is not terminated
+size_t fastFormatShortest(char *buffer, float value);
+
+#endif
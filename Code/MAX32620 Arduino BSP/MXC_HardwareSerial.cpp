@@ -27,6 +27,7 @@
 */
 
 #include "Arduino.h"
+#include <string.h>
 #include "MXC_HardwareSerial.h"
 #include "nvic_table.h"
 
@@ -46,12 +47,23 @@
 #define PARITY_MASK     0x06
 #define BIT_COUNT_MASK  0xF0
 
-MXC_HardwareSerial::MXC_HardwareSerial(uint32_t idx) :
+#define IS_POWER_OF_2(n) ((n) > 0 && (n) <= 32768 && ((n) & ((n) - 1)) == 0)
+#if !IS_POWER_OF_2(SERIAL0_TX_BUFFER_SIZE) || !IS_POWER_OF_2(SERIAL0_RX_BUFFER_SIZE) || \
+    !IS_POWER_OF_2(SERIAL1_TX_BUFFER_SIZE) || !IS_POWER_OF_2(SERIAL1_RX_BUFFER_SIZE) || \
+    !IS_POWER_OF_2(SERIAL2_TX_BUFFER_SIZE) || !IS_POWER_OF_2(SERIAL2_RX_BUFFER_SIZE)
+#error "Serial buffer sizes have to be powers of 2, up to 32768"
+#endif
+
+MXC_HardwareSerial::MXC_HardwareSerial(uint32_t idx, unsigned char *rx_buffer, rx_buffer_index_t rx_size,
+                                       unsigned char *tx_buffer, tx_buffer_index_t tx_size) :
   _uart(MXC_UART_GET_UART(idx)),
   _fifo(MXC_UART_GET_FIFO(idx)),
   _irqn(MXC_UART_GET_IRQ(idx)),
   _rx_buffer_head(0), _rx_buffer_tail(0),
-  _tx_buffer_head(0), _tx_buffer_tail(0)
+  _tx_buffer_head(0), _tx_buffer_tail(0),
+  _rx_buffer(rx_buffer), _tx_buffer(tx_buffer),
+  _rx_buffer_mask(rx_size - 1), _tx_buffer_mask(tx_size - 1),
+  _tx_async(NULL)
 {
 }
 
@@ -96,7 +108,7 @@ void MXC_HardwareSerial::end()
 
 int MXC_HardwareSerial::available(void)
 {
-  return ((unsigned int)(SERIAL_RX_BUFFER_SIZE + _rx_buffer_head - _rx_buffer_tail)) % SERIAL_RX_BUFFER_SIZE;
+  return (rx_buffer_index_t)(_rx_buffer_head - _rx_buffer_tail);
 }
 
 int MXC_HardwareSerial::peek(void)
@@ -104,35 +116,56 @@ int MXC_HardwareSerial::peek(void)
   if (_rx_buffer_head == _rx_buffer_tail) {
     return -1;
   } else {
-    return _rx_buffer[_rx_buffer_tail];
+    return _rx_buffer[_rx_buffer_tail & _rx_buffer_mask];
   }
 }
 
 int MXC_HardwareSerial::read(void)
 {
-  if (_rx_buffer_head == _rx_buffer_tail) {
+  rx_buffer_index_t tail = _rx_buffer_tail;
+  if (_rx_buffer_head == tail) {
     return -1;
   } else {
-    unsigned char c = _rx_buffer[_rx_buffer_tail];
-    _rx_buffer_tail = (rx_buffer_index_t)(_rx_buffer_tail + 1) % SERIAL_RX_BUFFER_SIZE;
+    unsigned char c = _rx_buffer[tail & _rx_buffer_mask];
+    __DMB();
+    _rx_buffer_tail = tail + 1;
     return c;
   }
 }
 
-int MXC_HardwareSerial::availableForWrite(void)
+size_t MXC_HardwareSerial::readBytes(char *buffer, size_t length)
 {
-  // Leading tail
-  if(_tx_buffer_tail > _tx_buffer_head){
-      return _tx_buffer_tail - _tx_buffer_head - 1;
-  }
-  // Leading Head
-  if(_tx_buffer_tail < _tx_buffer_head){
-      return SERIAL_TX_BUFFER_SIZE - _tx_buffer_head + 1;
-  }
-  
-  if(_tx_buffer_tail == _tx_buffer_head){
-    return SERIAL_TX_BUFFER_SIZE - 1;
+  size_t count = 0;
+  _startMillis = millis();
+
+  while (count < length) {
+    rx_buffer_index_t tail = _rx_buffer_tail;
+    size_t n = (rx_buffer_index_t)(_rx_buffer_head - tail);
+
+    if (n == 0) {
+      // Same timeout as Stream, counted from the last character received
+      if (millis() - _startMillis >= _timeout) break;
+      continue;
+    }
+    __DMB();
+
+    // Copy up to the end of the ring, the rest goes in the next pass
+    size_t offset = tail & _rx_buffer_mask;
+    if (n > length - count) n = length - count;
+    if (n > (size_t)_rx_buffer_mask + 1 - offset) n = _rx_buffer_mask + 1 - offset;
+    memcpy(buffer + count, &_rx_buffer[offset], n);
+    count += n;
+
+    __DMB();
+    _rx_buffer_tail = tail + n;
+    _startMillis = millis();
   }
+  return count;
+}
+
+int MXC_HardwareSerial::availableForWrite(void)
+{
+  return (_tx_buffer_mask + 1) - (tx_buffer_index_t)(_tx_buffer_head - _tx_buffer_tail);
 }
 
 void MXC_HardwareSerial::flush(void)
@@ -142,35 +175,85 @@ void MXC_HardwareSerial::flush(void)
 
 size_t MXC_HardwareSerial::write(uint8_t data)
 {
-  _uart->inten &= ~UART_WRITE_INTS;
+  return write(&data, 1);
+}
 
-  // Avoid software buffer if possible
-  if (_tx_buffer_head == _tx_buffer_tail) {
-    if (UART_NumWriteAvail(_uart)) {
+size_t MXC_HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  size_t written = 0;
 
-      _fifo->tx = data;
+  while (written < size) {
+    _uart->inten &= ~UART_WRITE_INTS;
 
-      // Enable almost empty interrupt
-      _uart->inten |= UART_WRITE_INTS;
+    // Avoid software buffer if possible
+    if ((_tx_buffer_head == _tx_buffer_tail) && (_tx_async == NULL) && _tx_requests.isEmpty()) {
+      int avail = UART_NumWriteAvail(_uart);
+      while (avail-- && (written < size)) {
+        _fifo->tx = buffer[written++];
+      }
+    }
+
+    // Copy the rest to the ring, up to its end or the tail
+    tx_buffer_index_t head = _tx_buffer_head;
+    size_t free = (_tx_buffer_mask + 1) - (tx_buffer_index_t)(head - _tx_buffer_tail);
+    size_t offset = head & _tx_buffer_mask;
+    size_t n = size - written;
+    if (n > free) n = free;
+    if (n > (size_t)_tx_buffer_mask + 1 - offset) n = _tx_buffer_mask + 1 - offset;
+    if (n) {
+      memcpy(&_tx_buffer[offset], buffer + written, n);
+      written += n;
+      __DMB();
+      _tx_buffer_head = head + n;
+      // The FIFO could have room already
+      _tx_start();
+    }
+
+    // Enable almost empty interrupt
+    _uart->inten |= UART_WRITE_INTS;
 
-      return 1;
+    // Wait for room if the ring is full
+    if (written < size) {
+      while ((tx_buffer_index_t)(_tx_buffer_head - _tx_buffer_tail) > _tx_buffer_mask);
     }
   }
 
-  tx_buffer_index_t i = (_tx_buffer_head + 1) % SERIAL_TX_BUFFER_SIZE;
+  return written;
+}
 
-  if (i == _tx_buffer_tail) {
-    _uart->inten |= UART_WRITE_INTS;
-    while (i == _tx_buffer_tail);
-    _uart->inten &= ~UART_WRITE_INTS;
+int MXC_HardwareSerial::writeAsync(uart_req_t *req)
+{
+  tx_request_t request = { req, 0 };
+  uint32_t primask;
+
+  if (req->data == NULL) {
+    return E_NULL_PTR;
+  }
+  if (!(_uart->ctrl & MXC_F_UART_CTRL_UART_EN)) {
+    return E_UNINITIALIZED;
   }
-  _tx_buffer[_tx_buffer_head] = data;
-  _tx_buffer_head = i;
 
-  // Enable interrupts
-  _uart->inten |= UART_WRITE_INTS;
+  req->num = 0;
+  if (req->len == 0) {
+    if (req->callback != NULL) {
+      req->callback(req, E_NO_ERROR);
+    }
+    return E_NO_ERROR;
+  }
 
-  return 1;
+  // The callbacks can queue the next request from the interrupt,
+  // so the queue gets more than one producer: it is written with the interrupts disabled
+  primask = __get_PRIMASK();
+  __disable_irq();
+  request.ring_mark = _tx_buffer_head;
+  if (!_tx_requests.push(request)) {
+    __set_PRIMASK(primask);
+    return E_BUSY;
+  }
+  _tx_start();
+  __set_PRIMASK(primask);
+
+  return E_NO_ERROR;
 }
 
 void MXC_HardwareSerial::_handler(void)
@@ -178,7 +261,13 @@ void MXC_HardwareSerial::_handler(void)
   uint32_t flags;
 
   flags = _uart->intfl;
-  _uart->intfl = flags;
+
+  // Write flags raised while write() has them masked stay pending,
+  // they interrupt again once write() enables them
+  _uart->intfl = flags & (_uart->inten | ~UART_WRITE_INTS);
+
+  // Write flags are ignored while write() is filling the FIFO
+  flags &= _uart->inten;
 
   if (flags & UART_READ_INTS) {
     _rx_handler();
@@ -195,45 +284,117 @@ void MXC_HardwareSerial::_rx_handler(void)
   _uart->inten &= ~UART_READ_INTS;
 
   int avail = UART_NumReadAvail(_uart);
+  rx_buffer_index_t head = _rx_buffer_head;
 
   while (avail--) {
-    rx_buffer_index_t i = (unsigned int)(_rx_buffer_head + 1) % SERIAL_RX_BUFFER_SIZE;
     char c = _fifo->rx;
-    if (i != _rx_buffer_tail) {
-      _rx_buffer[_rx_buffer_head] = c;
-      _rx_buffer_head = i;
+    // Drop the character if the ring is full
+    if ((rx_buffer_index_t)(head - _rx_buffer_tail) <= _rx_buffer_mask) {
+      _rx_buffer[head & _rx_buffer_mask] = c;
+      head++;
     }
   }
 
+  __DMB();
+  _rx_buffer_head = head;
+
   _uart->inten |= UART_READ_INTS;
 }
 
 void MXC_HardwareSerial::_tx_handler(void)
 {
-  int avail;
-  tx_buffer_index_t t;
-
   _uart->inten &= ~UART_WRITE_INTS;
 
-  avail = UART_NumWriteAvail(_uart);
+  _tx_start();
+
+  _uart->inten |= UART_WRITE_INTS;
+}
+
+// Sends the ring and the asynchronous requests, in the order they were written
+// Called with the write interrupts disabled
+void MXC_HardwareSerial::_tx_start(void)
+{
+  tx_request_t next;
+
+  if ((_tx_async != NULL) && !_tx_fill_async()) {
+    return;
+  }
+
+  while (_tx_requests.peek(next)) {
+    // The ring has to be sent up to the point where the request was queued
+    _tx_fill_fifo(next.ring_mark);
+    if (_tx_buffer_tail != next.ring_mark) {
+      return;
+    }
 
-  while (avail && (_tx_buffer_tail != _tx_buffer_head)) {
+    _tx_requests.pop(next);
+    _tx_async = next.req;
+    // A callback that queues the next request starts it itself
+    if (!_tx_fill_async() || (_tx_async != NULL)) {
+      return;
+    }
+  }
+
+  _tx_fill_fifo(_tx_buffer_head);
+}
+
+// Moves as many characters as fit from the request being sent to the FIFO
+// Returns 1 once the request is done, after calling its callback
+// Called with the write interrupts disabled
+int MXC_HardwareSerial::_tx_fill_async(void)
+{
+  uart_req_t *req = _tx_async;
+  int avail = UART_NumWriteAvail(_uart);
+
+  while (avail && (req->num < req->len)) {
 #if (MXC_UART_REV == 0)
     _uart->intfl = MXC_F_UART_INTFL_TX_DONE;
 #endif
-    _fifo->tx = _tx_buffer[_tx_buffer_tail];
+    _fifo->tx = req->data[req->num++];
+    avail--;
+  }
 
-    _tx_buffer_tail = (_tx_buffer_tail + 1) % SERIAL_TX_BUFFER_SIZE;
+  if (req->num < req->len) {
+    return 0;
+  }
 
+  _tx_async = NULL;
+  if (req->callback != NULL) {
+    req->callback(req, E_NO_ERROR);
+  }
+  return 1;
+}
+
+// Moves as many characters as fit from the ring to the FIFO, up to "end"
+// Called with the write interrupts disabled
+void MXC_HardwareSerial::_tx_fill_fifo(tx_buffer_index_t end)
+{
+  int avail = UART_NumWriteAvail(_uart);
+  tx_buffer_index_t tail = _tx_buffer_tail;
+
+  while (avail && (tail != end)) {
+#if (MXC_UART_REV == 0)
+    _uart->intfl = MXC_F_UART_INTFL_TX_DONE;
+#endif
+    _fifo->tx = _tx_buffer[tail & _tx_buffer_mask];
+    tail++;
     avail--;
   }
 
-  _uart->inten |= UART_WRITE_INTS;
+  __DMB();
+  _tx_buffer_tail = tail;
 }
 
-MXC_HardwareSerial Serial0(0);
-MXC_HardwareSerial Serial1(1);
-MXC_HardwareSerial Serial2(2);
+static unsigned char serial0_rx_buffer[SERIAL0_RX_BUFFER_SIZE];
+static unsigned char serial0_tx_buffer[SERIAL0_TX_BUFFER_SIZE];
+static unsigned char serial1_rx_buffer[SERIAL1_RX_BUFFER_SIZE];
+static unsigned char serial1_tx_buffer[SERIAL1_TX_BUFFER_SIZE];
+static unsigned char serial2_rx_buffer[SERIAL2_RX_BUFFER_SIZE];
+static unsigned char serial2_tx_buffer[SERIAL2_TX_BUFFER_SIZE];
+
+MXC_HardwareSerial Serial0(0, serial0_rx_buffer, SERIAL0_RX_BUFFER_SIZE, serial0_tx_buffer, SERIAL0_TX_BUFFER_SIZE);
+MXC_HardwareSerial Serial1(1, serial1_rx_buffer, SERIAL1_RX_BUFFER_SIZE, serial1_tx_buffer, SERIAL1_TX_BUFFER_SIZE);
+MXC_HardwareSerial Serial2(2, serial2_rx_buffer, SERIAL2_RX_BUFFER_SIZE, serial2_tx_buffer, SERIAL2_TX_BUFFER_SIZE);
 #ifndef USBCON
 HardwareSerial &Serial = CONCAT(Serial, DEFAULT_SERIAL_PORT);
 #endif
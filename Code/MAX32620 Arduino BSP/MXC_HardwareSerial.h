@@ -38,42 +38,48 @@
 #include "uart_regs.h"
 #include "uart.h"
 #include "HardwareSerial.h"
+#include "SpscQueue.h"
 
-// Define constants and variables for buffering incoming serial data.  We're
-// using a ring buffer (I think), in which head is the index of the location
-// to which to write the next incoming character and tail is the index of the
-// location from which to read.
-// NOTE: a "power of 2" buffer size is reccomended to dramatically
-//       optimize all the modulo operations for ring buffers.
-// WARNING: When buffer sizes are increased to > 256, the buffer index
-// variables are automatically increased in size, but the extra
-// atomicity guards needed for that are not implemented. This will
-// often work, but occasionally a race condition can occur that makes
-// Serial behave erratically. See https://github.com/arduino/Arduino/issues/2405
+// Define constants and variables for buffering serial data. Each port has a
+// ring buffer for reception and another for transmission, head is the index
+// of the location to which to write the next character and tail is the index
+// of the location from which to read.
+// The indexes run freely and are masked when used, so the sizes have to be
+// powers of 2 (up to 32768). Each port can have its own sizes, for example
+// SERIAL1_TX_BUFFER_SIZE, otherwise SERIAL_TX_BUFFER_SIZE is used.
 
 #if !defined(SERIAL_TX_BUFFER_SIZE)
-#if ((RAMEND - RAMSTART) < 1023)
-#define SERIAL_TX_BUFFER_SIZE 16
-#else
-#define SERIAL_TX_BUFFER_SIZE 64
-#endif
+#define SERIAL_TX_BUFFER_SIZE 256
 #endif
 #if !defined(SERIAL_RX_BUFFER_SIZE)
-#if ((RAMEND - RAMSTART) < 1023)
-#define SERIAL_RX_BUFFER_SIZE 16
-#else
 #define SERIAL_RX_BUFFER_SIZE 64
 #endif
+
+#if !defined(SERIAL0_TX_BUFFER_SIZE)
+#define SERIAL0_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
 #endif
-#if (SERIAL_TX_BUFFER_SIZE>256)
-typedef uint16_t tx_buffer_index_t;
-#else
-typedef uint8_t tx_buffer_index_t;
+#if !defined(SERIAL0_RX_BUFFER_SIZE)
+#define SERIAL0_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL1_TX_BUFFER_SIZE)
+#define SERIAL1_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL1_RX_BUFFER_SIZE)
+#define SERIAL1_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL2_TX_BUFFER_SIZE)
+#define SERIAL2_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
 #endif
-#if  (SERIAL_RX_BUFFER_SIZE>256)
+#if !defined(SERIAL2_RX_BUFFER_SIZE)
+#define SERIAL2_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+
+typedef uint16_t tx_buffer_index_t;
 typedef uint16_t rx_buffer_index_t;
-#else
-typedef uint8_t rx_buffer_index_t;
+
+// Number of writeAsync() requests that can wait for their turn, power of 2
+#if !defined(SERIAL_ASYNC_QUEUE_SIZE)
+#define SERIAL_ASYNC_QUEUE_SIZE 8
 #endif
 
 /*
@@ -122,27 +128,54 @@ class MXC_HardwareSerial : public HardwareSerial
     volatile tx_buffer_index_t _tx_buffer_head;
     volatile tx_buffer_index_t _tx_buffer_tail;
 
-    unsigned char _rx_buffer[SERIAL_RX_BUFFER_SIZE];
-    unsigned char _tx_buffer[SERIAL_TX_BUFFER_SIZE];
+    unsigned char * const _rx_buffer;
+    unsigned char * const _tx_buffer;
+    const rx_buffer_index_t _rx_buffer_mask;
+    const tx_buffer_index_t _tx_buffer_mask;
+
+    // Asynchronous requests, sent once the ring reaches the point
+    // where it was when they were queued
+    struct tx_request_t {
+      uart_req_t *req;
+      tx_buffer_index_t ring_mark;
+    };
+    SpscQueue<tx_request_t, SERIAL_ASYNC_QUEUE_SIZE> _tx_requests;
+    uart_req_t * volatile _tx_async; // Request being sent
 
   public:
-    inline MXC_HardwareSerial(uint32_t port);
+    MXC_HardwareSerial(uint32_t port, unsigned char *rx_buffer, rx_buffer_index_t rx_size,
+                       unsigned char *tx_buffer, tx_buffer_index_t tx_size);
     void begin(unsigned long baud) { begin(baud, SERIAL_8N1); }
     void begin(unsigned long, uint8_t);
     void end();
     int available(void);
     int peek(void);
     int read(void);
+    size_t readBytes(char *buffer, size_t length);
+    using Stream::readBytes; // pull in readBytes(uint8_t*, size) from Stream
     int availableForWrite(void);
     void flush(void);
     size_t write(uint8_t n);
-    using Print::write; // pull in write(str) and write(buf, size) from Print
+    size_t write(const uint8_t *buffer, size_t size);
+    using Print::write; // pull in write(str) from Print
+    // Zero copy transmission: req->data is sent as is, after anything written before.
+    // req->callback is called once every byte is in the FIFO: from the interrupt, or
+    // from writeAsync() itself, in the context of the caller, if the request fits in the FIFO.
+    // The request and its data have to stay allocated until then.
+    // It can be called from the loop and from the callbacks, that run in the interrupt
+    // of the port: the requests are queued with the interrupts disabled. Not from other
+    // interrupts, they could cut a write() in the middle.
+    // Returns E_BUSY if SERIAL_ASYNC_QUEUE_SIZE requests are already waiting
+    int writeAsync(uart_req_t *req);
     // Interrupt handlers - Not intended to be called externally
     inline void _handler(void);
 
   private:
     inline void _rx_handler(void);
     inline void _tx_handler(void);
+    inline void _tx_fill_fifo(tx_buffer_index_t end);
+    int _tx_fill_async(void);
+    void _tx_start(void);
 };
 
 extern MXC_HardwareSerial Serial0;
@@ -27,6 +27,7 @@
 #include "Arduino.h"
 
 #include "Print.h"
+#include "FastFormat.h"
 
 // Public Methods //////////////////////////////////////////////////////////////
 
@@ -82,9 +83,12 @@ size_t Print::print(long n, int base)
     return write(n);
   } else if (base == 10) {
     if (n < 0) {
-      int t = print('-');
-      n = -n;
-      return printNumber(n, 10) + t;
+      // Sign and digits in a single write
+      char buf[8 * sizeof(long) + 1];
+      char *end = &buf[sizeof(buf)];
+      char *str = fastFormatUnsigned(end, 0UL - (unsigned long)n, 10);
+      *--str = '-';
+      return write(str, end - str);
     }
     return printNumber(n, 10);
   } else {
@@ -100,6 +104,10 @@ size_t Print::print(unsigned long n, int base)
 
 size_t Print::print(double n, int digits)
 {
+  if (digits == SHORTEST) {
+    char buf[FAST_FORMAT_BUFFER_SIZE];
+    return write(buf, fastFormatShortest(buf, (float)n));
+  }
   return printFloat(n, digits);
 }
 
@@ -194,26 +202,22 @@ size_t Print::println(const Printable& x)
 
 size_t Print::printNumber(unsigned long n, uint8_t base)
 {
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-
-  *str = '\0';
-
-  // prevent crash if called with base == 1
-  if (base < 2) base = 10;
-
-  do {
-    char c = n % base;
-    n /= base;
+  char buf[8 * sizeof(long)]; // Assumes 8-bit chars, base 2 is the longest
+  char *end = &buf[sizeof(buf)];
+  char *str = fastFormatUnsigned(end, n, base);
 
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
-
-  return write(str);
+  return write(str, end - str);
 }
 
 size_t Print::printFloat(double number, uint8_t digits) 
 { 
+  // The FPU is single precision, the common case is done on the bits of a float
+  // Only when the value is a float, the doubles beyond it keep the original path
+  if ((digits <= FAST_FORMAT_MAX_DIGITS) && ((double)(float)number == number)) {
+    char buf[FAST_FORMAT_BUFFER_SIZE];
+    return write(buf, fastFormatFixed(buf, (float)number, digits));
+  }
+
   size_t n = 0;
   
   if (isnan(number)) return print("nan");
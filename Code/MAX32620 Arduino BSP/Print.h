@@ -30,6 +30,8 @@
 #define HEX 16
 #define OCT 8
 #define BIN 2
+// print(float, SHORTEST): the fewest digits that read back as the same float
+#define SHORTEST -1
 
 class Print
 {
@@ -54,9 +54,13 @@ static inline bool __interruptsStatus(void) {
 
 SPIClass::SPIClass(uint32_t index):
     initialized(false),
-    idx(index)
+    idx(index),
+    active(NULL),
+    asyncLocks(0)
 {
     spim = MXC_SPIM_GET_SPIM(idx);
+    irqn = MXC_SPIM_GET_IRQ(idx);
+    asyncTransfer.owner = this;
 }
 
 void SPIClass::setClockDivider(uint8_t divider)
@@ -107,12 +111,28 @@ void SPIClass::begin()
 
         SPIM_Init(spim, &cfg, &sys_cfg);
         initialized = true;
+
+        // The driver enables the interrupts it needs for each asynchronous transfer
+        NVIC_EnableIRQ(irqn);
     }
 }
 
 void SPIClass::end()
 {
+    spim_req_t *req;
+
+    NVIC_DisableIRQ(irqn);
+
+    // Calls the callback of the active request with E_SHUTDOWN
     SPIM_Shutdown(spim);
+    active = NULL;
+
+    // And of the waiting ones
+    while (requests.pop(req)) {
+        if (req->callback != NULL) {
+            req->callback(req, E_SHUTDOWN);
+        }
+    }
     initialized = false;
 }
 
@@ -185,6 +205,8 @@ int SPIClass::modifyClk(uint32_t baud)
     temp |= ((clocks << MXC_F_SPIM_MSTR_CFG_SCK_HI_CLK_POS) |
              (clocks << MXC_F_SPIM_MSTR_CFG_SCK_LO_CLK_POS));
     spim->mstr_cfg = temp;
+
+    return E_NO_ERROR;
 }
 
 void SPIClass::endTransaction(void)
@@ -239,68 +261,186 @@ void SPIClass::notUsingInterrupt(uint8_t intNum)
 
 uint8_t SPIClass::transfer(uint8_t value)
 {
-    spim_req_t req;
-
-    req.tx_data = &value;
-    req.rx_data = &value;
-    req.ssel = 0;
-    req.deass = 0;
-    req.width = SPIM_WIDTH_1;
-    req.len = sizeof(value);
-    req.callback = NULL;
-    
-    if(bitOrder == LSBFIRST){
-        value = __RBIT(value) >> 24;
-    }
-
-    SPIM_Trans(spim, &req);
+    transfer(&value, sizeof(value));
     
     return value;   // Received data
 }
 
 uint16_t SPIClass::transfer16(uint16_t value)
 {
-    uint8_t temp;
-    
-    // Least Significant Byte is sent 1st to ensure correct endianness
-    // Send LSB
-    temp = transfer(value);
-    value = (value & 0XFF00) | temp;
-
-    // Send MSB
-    temp = transfer(value >> 8);
-    value = (temp << 8) | (value & 0x00FF);
+    uint8_t data[2];
+
+    // The most significant byte goes first, in a single transaction.
+    // With LSBFIRST the whole 16 bits are reversed, so bit 0 goes first
+    if (bitOrder == LSBFIRST) {
+        value = __RBIT(value) >> 16;
+    }
+    data[0] = value >> 8;
+    data[1] = value;
+
+    transferSync(data, sizeof(data));
+
+    value = (data[0] << 8) | data[1];
+    if (bitOrder == LSBFIRST) {
+        value = __RBIT(value) >> 16;
+    }
     
     return value;
 }
 
 void SPIClass::transfer(void *buf, size_t count)
 {
-    spim_req_t req;
-    uint8_t n = 1;
+    // Changing the bit order of individual byte, both ways
+    if (bitOrder == LSBFIRST) {
+        reverseBits(buf, count);
+    }
+
+    transferSync(buf, count);
+
+    if (bitOrder == LSBFIRST) {
+        reverseBits(buf, count);
+    }
+}
+
+void SPIClass::reverseBits(void *buf, size_t count)
+{
     uint8_t *ptr = (uint8_t *)buf;
-    uint32_t num;
-    
-    req.tx_data = ptr;
-    req.rx_data = ptr;
+    uint32_t *word;
+
+    // Up to a word boundary
+    while (count && ((uintptr_t)ptr & 3)) {
+        *ptr = __RBIT(*ptr) >> 24;
+        ptr++;
+        count--;
+    }
+
+    // __RBIT reverses the 32 bits of the word, __REV puts its bytes back in order
+    word = (uint32_t *)ptr;
+    while (count >= 4) {
+        *word = __REV(__RBIT(*word));
+        word++;
+        count -= 4;
+    }
+
+    ptr = (uint8_t *)word;
+    while (count--) {
+        *ptr = __RBIT(*ptr) >> 24;
+        ptr++;
+    }
+}
+
+// Blocking transfer, in place. Waits for the asynchronous requests first
+int SPIClass::transferSync(void *buf, size_t count)
+{
+    spim_req_t req;
+
+    req.tx_data = (uint8_t *)buf;
+    req.rx_data = (uint8_t *)buf;
     req.ssel = 0;
     req.deass = 0;
     req.width = SPIM_WIDTH_1;
     req.len = count;
     req.callback = NULL;
-    
-    // Changing the bit order of individual byte
-    if (bitOrder == LSBFIRST) {
-        while (n <= count) {
-            num = *ptr;
-            *ptr++ = __RBIT(num) >> 24;
-            n++;
+
+    while (busy()) {}
+
+    return SPIM_Trans(spim, &req);
+}
+
+int SPIClass::transferAsync(spim_req_t *req)
+{
+    if ((req->tx_data == NULL) && (req->rx_data == NULL)) {
+        return E_NULL_PTR;
+    }
+
+    if (!initialized) {
+        return E_UNINITIALIZED;
+    }
+
+    if (req->len == 0) {
+        req->read_num = 0;
+        req->write_num = 0;
+        if (req->callback != NULL) {
+            req->callback(req, E_NO_ERROR);
         }
+        return E_NO_ERROR;
     }
-// TODO disable interrupt
-    SPIM_Trans(spim, &req);
-// TODO enable interrupts
-    
+
+    // The interrupt starts the next request as well. Nested when the callback
+    // of a request that failed to start queues another one
+    NVIC_DisableIRQ(irqn);
+    asyncLocks++;
+
+    int error = E_NO_ERROR;
+    if (requests.push(req)) {
+        startNext();
+    } else {
+        error = E_BUSY;
+    }
+
+    if (--asyncLocks == 0) {
+        NVIC_EnableIRQ(irqn);
+    }
+    return error;
+}
+
+bool SPIClass::busy(void)
+{
+    return (active != NULL) || !requests.isEmpty();
+}
+
+void SPIClass::_handler(void)
+{
+    SPIM_Handler(spim);
+
+    // Started once the driver has set the interrupts of the finished request
+    startNext();
+}
+
+// Starts the oldest request if nothing is being transferred
+// Called with the SPIM interrupt disabled, or from it
+void SPIClass::startNext(void)
+{
+    spim_req_t *next;
+    int error;
+
+    while ((active == NULL) && requests.pop(next)) {
+        active = next;
+
+        asyncTransfer.user = next;
+        asyncTransfer.req.ssel = next->ssel;
+        asyncTransfer.req.deass = next->deass;
+        asyncTransfer.req.tx_data = next->tx_data;
+        asyncTransfer.req.rx_data = next->rx_data;
+        asyncTransfer.req.width = next->width;
+        asyncTransfer.req.len = next->len;
+        asyncTransfer.req.callback = asyncDone;
+
+        // Small writes fit in the FIFO, and are done on return
+        error = SPIM_TransAsync(spim, &asyncTransfer.req);
+        if (error != E_NO_ERROR) {
+            active = NULL;
+            if (next->callback != NULL) {
+                next->callback(next, error);
+            }
+        }
+    }
+}
+
+void SPIClass::asyncDone(spim_req_t *req, int error)
+{
+    // req is the first member of the async_transfer_t
+    async_transfer_t *transfer = (async_transfer_t *)req;
+    spim_req_t *user = transfer->user;
+
+    user->read_num = req->read_num;
+    user->write_num = req->write_num;
+
+    // Requests queued by the callback wait until the driver is done with this one
+    if (user->callback != NULL) {
+        user->callback(user, error);
+    }
+    transfer->owner->active = NULL;
 }
 
 SPIClass SPI0 = SPIClass(0);
@@ -320,3 +460,11 @@ SPIClass SPI4 = SPIClass(4);
 SPIClass SPI5 = SPIClass(5);
 #endif
 SPIClass& SPI = CONCAT(SPI, DEFAULT_SPIM_PORT);
+
+extern "C" void SPIM0_IRQHandler(void) { SPI0._handler(); }
+#if (MXC_CFG_SPIM_INSTANCES > 1)
+extern "C" void SPIM1_IRQHandler(void) { SPI1._handler(); }
+#endif
+#if (MXC_CFG_SPIM_INSTANCES > 2)
+extern "C" void SPIM2_IRQHandler(void) { SPI2._handler(); }
+#endif
@@ -36,6 +36,7 @@
 
 #include <Arduino.h>
 #include <spim.h>
+#include "SpscQueue.h"
 
 // SPI_HAS_TRANSACTION means SPI has
 //   - beginTransaction()
@@ -47,6 +48,11 @@
 // SPI_HAS_NOTUSINGINTERRUPT means that SPI has notUsingInterrupt() method
 #define SPI_HAS_NOTUSINGINTERRUPT 1
 
+// Number of transferAsync() requests that can wait while one is transferred, power of 2
+#if !defined(SPI_ASYNC_QUEUE_SIZE)
+#define SPI_ASYNC_QUEUE_SIZE 2
+#endif
+
 // Transfer Modes
 #define SPI_MODE0 0x00
 #define SPI_MODE1 0x01
@@ -103,6 +109,21 @@ public:
     uint16_t transfer16(uint16_t);
     void transfer(void *buf, size_t count);
 
+    // Zero copy transfer in the background: req->tx_data is sent and/or req->rx_data
+    // is filled, and req->callback is called from the interrupt once done.
+    // While one request is transferred the next ones wait in a queue, so the next frame
+    // can be prepared in a second buffer and follows without a gap (double buffering).
+    // Data is sent as is, see reverseBits() for LSBFIRST.
+    // The request and its buffers have to stay allocated until the callback.
+    // Returns E_BUSY if SPI_ASYNC_QUEUE_SIZE requests are already waiting
+    int transferAsync(spim_req_t *req);
+    // true while requests are waiting or being transferred
+    bool busy(void);
+    // Reverses the bits of each byte, a word at a time, for LSBFIRST devices
+    static void reverseBits(void *buf, size_t count);
+    // Interrupt handler - Not intended to be called externally
+    void _handler(void);
+
 private:
     bool initialized;
     volatile uint8_t bitOrder;
@@ -112,8 +133,23 @@ private:
     uint32_t idx;
     
     mxc_spim_regs_t *spim;
-    
+    IRQn_Type irqn;
+
+    // The driver transfers a copy of the request, its callback starts the next one
+    struct async_transfer_t {
+        spim_req_t req;
+        SPIClass *owner;
+        spim_req_t *user;
+    };
+    async_transfer_t asyncTransfer;
+    SpscQueue<spim_req_t *, SPI_ASYNC_QUEUE_SIZE> requests;
+    spim_req_t * volatile active; // Request being transferred
+    uint8_t asyncLocks;
+
     int modifyClk(uint32_t);
+    int transferSync(void *buf, size_t count);
+    void startNext(void);
+    static void asyncDone(spim_req_t *req, int error);
 };
 
 extern SPIClass SPI0;
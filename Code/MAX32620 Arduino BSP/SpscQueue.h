@@ -0,0 +1,107 @@
+/*
+  SpscQueue.h - Lock-free single producer / single consumer queue
+  Used to hand data from an interrupt (producer) to the loop (consumer)
+  or the other way around: PMU frames, button events, serial bytes...
+
+  Header only and without dynamic memory, the storage lives in the object.
+  CAPACITY has to be a power of 2, so the free running indexes wrap with a
+  mask instead of a modulo. Only the producer writes _head and only the
+  consumer writes _tail, and data memory barriers (__DMB) make sure the
+  other side never sees an index before the element it refers to.
+  Host builds use the equivalent atomic builtins, so the queue can be
+  checked with ThreadSanitizer.
+*/
+
+#ifndef SpscQueue_h
+#define SpscQueue_h
+
+#include <inttypes.h>
+
+#if defined(__arm__)
+#include "max32620.h"
+#endif
+
+template <typename T, uint16_t CAPACITY>
+class SpscQueue
+{
+  private:
+    // Fails to compile if CAPACITY is not a power of 2 (or is bigger than 32768)
+    typedef char capacity_has_to_be_power_of_2[((CAPACITY & (CAPACITY - 1)) == 0 && CAPACITY > 0 && CAPACITY <= 32768) ? 1 : -1];
+    static const uint16_t MASK = CAPACITY - 1;
+
+    volatile uint16_t _head; // Next element to write, producer side
+    volatile uint16_t _tail; // Next element to read, consumer side
+    T _buffer[CAPACITY];
+
+    // Index written by the other side, the elements it refers to are read after it
+    static inline uint16_t acquire(const volatile uint16_t &index)
+    {
+#if defined(__arm__)
+      uint16_t value = index;
+      __DMB();
+      return value;
+#else
+      return __atomic_load_n(&index, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    // Index given to the other side, after the elements it refers to are written (or read)
+    static inline void release(volatile uint16_t &index, uint16_t value)
+    {
+#if defined(__arm__)
+      __DMB();
+      index = value;
+#else
+      __atomic_store_n(&index, value, __ATOMIC_RELEASE);
+#endif
+    }
+
+  public:
+    SpscQueue() : _head(0), _tail(0) {}
+
+    // Producer side. Returns false if the queue is full
+    bool push(const T &item)
+    {
+      uint16_t head = _head;
+      if ((uint16_t)(head - acquire(_tail)) >= CAPACITY)
+        return false;
+      _buffer[head & MASK] = item;
+      release(_head, head + 1);
+      return true;
+    }
+
+    // Consumer side. Returns false if the queue is empty
+    bool pop(T &item)
+    {
+      uint16_t tail = _tail;
+      if (acquire(_head) == tail)
+        return false;
+      item = _buffer[tail & MASK];
+      release(_tail, tail + 1);
+      return true;
+    }
+
+    // Consumer side. Gets the oldest element without removing it
+    bool peek(T &item)
+    {
+      uint16_t tail = _tail;
+      if (acquire(_head) == tail)
+        return false;
+      item = _buffer[tail & MASK];
+      return true;
+    }
+
+    // Consumer side. Drops every element in the queue
+    void clear(void)
+    {
+      release(_tail, acquire(_head));
+    }
+
+    uint16_t available(void) const { return (uint16_t)(acquire(_head) - acquire(_tail)); }
+    uint16_t availableForWrite(void) const { return CAPACITY - available(); }
+    bool isEmpty(void) const { return available() == 0; }
+    bool isFull(void) const { return available() >= CAPACITY; }
+    static uint16_t capacity(void) { return CAPACITY; }
+};
+
+#endif // SpscQueue_h
@@ -34,6 +34,7 @@
 #ifdef USBCON
 
 #include <stddef.h>
+#include <string.h>
 #include "mxc_config.h"
 #include "mxc_sys.h"
 #include "pwrman_regs.h"
@@ -54,6 +55,10 @@ int UsbCdcAcm::suspended = 0;
 int UsbCdcAcm::remote_wake_en = 0;
 int UsbCdcAcm::peeked = -1;
 
+uint8_t UsbCdcAcm::tx_buffer[USB_CDC_TX_BUFFER_SIZE];
+unsigned int UsbCdcAcm::tx_count = 0;
+uint32_t UsbCdcAcm::tx_first_millis = 0;
+
 /* This EP assignment must match the Configuration Descriptor */
 acm_cfg_t UsbCdcAcm::acm_cfg = {
         1,                  /* EP OUT */
@@ -150,6 +155,46 @@ int UsbCdcAcm::read(void)
     return -1;
 }
 
+/* ************************************************************************** */
+size_t UsbCdcAcm::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+
+    if (length == 0) {
+        return 0;
+    }
+
+    // Peeked character first
+    if (peeked != -1) {
+        buffer[count++] = (char)peeked;
+        peeked = -1;
+    }
+
+    _startMillis = millis();
+    while (count < length) {
+        int avail = acm_present() ? acm_canread() : 0;
+
+        if (avail <= 0) {
+            // Same timeout as Stream, counted from the last character received
+            if (millis() - _startMillis >= _timeout) {
+                break;
+            }
+            continue;
+        }
+
+        if ((size_t)avail > length - count) {
+            avail = length - count;
+        }
+        int n = acm_read((uint8_t*)&buffer[count], avail);
+        if (n <= 0) {
+            break;
+        }
+        count += n;
+        _startMillis = millis();
+    }
+    return count;
+}
+
 /* ************************************************************************** */
 int UsbCdcAcm::availableForWrite(void)
 {
@@ -159,13 +204,59 @@ int UsbCdcAcm::availableForWrite(void)
     return 0;
 }
 
+/* ************************************************************************** */
+void UsbCdcAcm::flush(void)
+{
+    if (tx_count && acm_present()) {
+        acm_write(tx_buffer, tx_count);
+    }
+    tx_count = 0;
+}
+
+/* ************************************************************************** */
+void UsbCdcAcm::flushIfStale(void)
+{
+    if (tx_count && (millis() - tx_first_millis >= USB_CDC_FLUSH_MS)) {
+        flush();
+    }
+}
+
 /* ************************************************************************** */
 size_t UsbCdcAcm::write(uint8_t n)
 {
-    if (acm_present()) {
-        acm_write(&n, 1);
+    return write(&n, 1);
+}
+
+/* ************************************************************************** */
+size_t UsbCdcAcm::write(const uint8_t *buffer, size_t size)
+{
+    if (!acm_present()) {
+        tx_count = 0;
+        return size;
+    }
+
+    // Big blocks go in their own transfer, after the characters already buffered
+    if (size >= USB_CDC_TX_BUFFER_SIZE) {
+        flush();
+        acm_write((uint8_t*)buffer, size);
+        return size;
+    }
+
+    if (tx_count + size > USB_CDC_TX_BUFFER_SIZE) {
+        flush();
+    }
+    if (tx_count == 0) {
+        tx_first_millis = millis();
+    }
+    memcpy(&tx_buffer[tx_count], buffer, size);
+    tx_count += size;
+
+    if (tx_count == USB_CDC_TX_BUFFER_SIZE) {
+        flush();
+    } else {
+        flushIfStale();
     }
-    return 1;
+    return size;
 }
 
 /* ************************************************************************** */
@@ -251,6 +342,7 @@ extern "C" void USB_IRQHandler(void) { usb_event_handler(); }
 /* ************************************************************************** */
 void usbCdcAcmEventRun(void)
 {
+    Serial_USB.flushIfStale();
     if (Serial.available()) serialEvent();
 }
 
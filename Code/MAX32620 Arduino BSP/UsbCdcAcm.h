@@ -44,6 +44,15 @@
 #include "cdc_acm.h"
 #include "HardwareSerial.h"
 
+// Characters are coalesced in a buffer and sent in a single transfer when it is
+// full, on flush(), or USB_CDC_FLUSH_MS after the first one (checked after each loop())
+#if !defined(USB_CDC_TX_BUFFER_SIZE)
+#define USB_CDC_TX_BUFFER_SIZE MXC_USB_MAX_PACKET
+#endif
+#if !defined(USB_CDC_FLUSH_MS)
+#define USB_CDC_FLUSH_MS 2
+#endif
+
 class UsbCdcAcm : public HardwareSerial
 {
 public:
@@ -55,15 +64,25 @@ public:
     int available(void);
     int peek(void);
     int read(void);
+    size_t readBytes(char *buffer, size_t length);
+    using Stream::readBytes; // pull in readBytes(uint8_t*, size) from Stream
     int availableForWrite(void);
-    void flush(void){}
+    void flush(void);
     size_t write(uint8_t n);
+    size_t write(const uint8_t *buffer, size_t size);
+    using Print::write; // pull in write(str) from Print
+    // Sends the coalesced characters once USB_CDC_FLUSH_MS have passed
+    void flushIfStale(void);
 
 private:
     static int configured;
     static int suspended;
     static int remote_wake_en;
     static int peeked;
+
+    static uint8_t tx_buffer[USB_CDC_TX_BUFFER_SIZE];
+    static unsigned int tx_count;
+    static uint32_t tx_first_millis;
     
     static acm_cfg_t acm_cfg;
     static int setconfig_callback(usb_setup_pkt *sud, void *cbdata);
@@ -36,6 +36,7 @@
 #include "mxc_sys.h"
 #include "Wire.h"
 #include "i2cm.h"
+#include <string.h>
 
 TwoWire::TwoWire(uint32_t index) :
   idx(index)
@@ -48,9 +49,13 @@ void TwoWire::begin()
     rxBufferLength = 0;
     txBufferIndex = 0;
     txBufferLength = 0;
+    cmdBufferLength = 0;
+    active = NULL;
+    asyncLocks = 0;
 
     i2cm = MXC_I2CM_GET_I2CM(idx);
     fifo = MXC_I2CM_GET_FIFO(idx);
+    irqn = MXC_I2CM_GET_IRQ(idx);
 
     sys_cfg_i2cm_t i2cm_sys_cfg;
 
@@ -77,6 +82,9 @@ void TwoWire::begin()
 
     i2cm_sys_cfg.clk_scale = CLKMAN_SCALE_DIV_1;
     I2CM_Init(i2cm, &i2cm_sys_cfg, I2CM_SPEED_400KHZ);
+
+    // The driver enables the interrupts it needs for each transfer
+    NVIC_EnableIRQ(irqn);
 }
 
 void TwoWire::begin(uint8_t addr)
@@ -91,7 +99,20 @@ void TwoWire::begin(int addr)
 
 void TwoWire::end(void)
 {
+    async_request_t request;
+
+    NVIC_DisableIRQ(irqn);
+
+    // Calls the callback of the active request with E_SHUTDOWN
     I2CM_Shutdown(i2cm);
+    active = NULL;
+
+    // And of the waiting ones
+    while (requests.pop(request)) {
+        if (request.req->callback != NULL) {
+            request.req->callback(request.req, E_SHUTDOWN);
+        }
+    }
 }
 
 void TwoWire::setClock(uint32_t clock)
@@ -121,109 +142,26 @@ uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop
     // This method returns 0 incase of any error
     // To match the Arduino API compatibility, return type is uint8_t
 
-    int i2cm_num;
-    int error = E_NO_ERROR;
-    mxc_i2cm_fifo_regs_t *fifo;
-
     if (quantity > BUFFER_LENGTH) {
         quantity = BUFFER_LENGTH;
     }
 
     rxBufferIndex = 0;
-
-    if (rxBuffer == NULL) {
-        // Null Pointer error
-        return 0;
-    }
-
-    // Make sure the I2CM has been initialized
-    if (i2cm->ctrl == 0) {
-        // Uninitialized error
-        return 0;
-    }
+    rxBufferLength = 0;
 
     if(!(quantity > 0)) {
         return E_NO_ERROR;
     }
 
-    // Lock this I2CM
-    i2cm_num = MXC_I2CM_GET_IDX(i2cm);
-    while(mxc_get_lock((uint32_t*)&i2cm_states[i2cm_num].req,1) != E_NO_ERROR) {}
-
-    // Get the FIFO pointer for this I2CM
-    fifo = MXC_I2CM_GET_FIFO(i2cm_num);
-
-    // Disable and clear the interrupts
-	i2cm->inten = 0;
-    i2cm->intfl = i2cm->intfl;
-
-    // Write the address to the TXFIFO
-    error = I2CM_WriteTxFifo(i2cm, fifo, (MXC_S_I2CM_TRANS_TAG_START |
-                                        (address << 1) | I2CM_READ_BIT));
-
-    uint8_t i = quantity;
-    // Write to the TXFIFO the number of bytes we want to read
-    while ((i > 256) && !error) {
-        error = I2CM_WriteTxFifo(i2cm, fifo, (MXC_S_I2CM_TRANS_TAG_RXDATA_COUNT | 255));
-        i -= 256;
-    }
-
-    if ((i > 1) && !error) {
-        error = I2CM_WriteTxFifo(i2cm, fifo, (MXC_S_I2CM_TRANS_TAG_RXDATA_COUNT | (i-2)));
-    }
-
-    if (!error) {
-        // Start the transaction if it is not currently ongoing
-        if (!(i2cm->trans & MXC_F_I2CM_TRANS_TX_IN_PROGRESS)) {
-            i2cm->trans |= MXC_F_I2CM_TRANS_TX_START;
-        }
-
-        // NACK the last read byte
-        error = I2CM_WriteTxFifo(i2cm, fifo, MXC_S_I2CM_TRANS_TAG_RXDATA_NACK);
-
-        // Send the stop condition
-        if (sendStop & !error) {
-            error = I2CM_WriteTxFifo(i2cm, fifo, MXC_S_I2CM_TRANS_TAG_STOP);
-        }
-    }
-
-    // Get the data from the RX FIFO
-    int32_t timeout;
-    i = 0;
-    while ((i < quantity) && (!error)) {
-        // Wait for there to be data in the RX FIFO
-        timeout = MXC_I2CM_RX_TIMEOUT;
-        while (!(i2cm->intfl & MXC_F_I2CM_INTFL_RX_FIFO_NOT_EMPTY) &&
-            ((i2cm->bb & MXC_F_I2CM_BB_RX_FIFO_CNT) == 0) &&
-            (!error)) {
-
-            if (timeout-- < 0) {
-                error = E_TIME_OUT;
-            }
-
-            if (i2cm->trans & (MXC_F_I2CM_TRANS_TX_LOST_ARBITR | MXC_F_I2CM_TRANS_TX_NACKED) &&
-                (!error)) {
-                error = E_COMM_ERR;
-            }
-        }
-        i2cm->intfl = MXC_F_I2CM_INTFL_RX_FIFO_NOT_EMPTY;
-
-        // Save the data from the RX FIFO
-        uint16_t tmp;
-        tmp = fifo->rx;
-        if (tmp & MXC_S_I2CM_RSTLS_TAG_EMPTY) {
-            continue;
-        }
-        rxBuffer[i++] = (uint8_t)tmp;
-    }
-
-    // Wait for the transaction to complete
-    if(sendStop && !error){
-        error = I2CM_TxInProgress(i2cm);
+    // The bytes of endTransmission(false) are written first, then the read follows
+    // a repeated start. The driver always ends the read with a stop, so sendStop
+    // only matters to the callers of the original API
+    if ((cmdAddress != address) && (sendCommand() != E_NO_ERROR)) {
+        return 0;
     }
 
-    // Unlock this I2CM
-    mxc_free_lock((uint32_t*)&i2cm_states[i2cm_num].req);
+    int error = transfer(1, address, cmdBuffer, cmdBufferLength, rxBuffer, quantity);
+    cmdBufferLength = 0;
 
     if (error != E_NO_ERROR) {
         return 0;
@@ -264,18 +202,30 @@ void TwoWire::beginTransmission(int addr)
 
 uint8_t TwoWire::endTransmission(uint8_t stop)
 {
-    if (stop) {
-        return (I2CM_Write(i2cm, targetAddr, NULL, 0, txBuffer, txBufferLength) == txBufferLength) ? 0 : 4;
-    }
+    int error;
 
-    i2cm->inten = 0;
-    i2cm->intfl = i2cm->intfl;
+    // Bytes of a previous endTransmission(false) that do not go with this transfer
+    if ((!stop || (cmdAddress != targetAddr)) && (sendCommand() != E_NO_ERROR)) {
+        return 4;
+    }
 
-    if (I2CM_Tx(i2cm, fifo, targetAddr, txBuffer, txBufferLength, 0) == E_NO_ERROR) {
+    if (!stop) {
+        // Kept for the next transfer, which sends them before its repeated start
+        memcpy(cmdBuffer, txBuffer, txBufferLength);
+        cmdBufferLength = txBufferLength;
+        cmdAddress = targetAddr;
         return 0;
     }
 
-    return 4;   // Return "Other Error" in case of error
+    if (txBufferLength == 0) {
+        // Only the command is left to write
+        error = transfer(0, targetAddr, NULL, 0, cmdBuffer, cmdBufferLength);
+    } else {
+        error = transfer(0, targetAddr, cmdBuffer, cmdBufferLength, txBuffer, txBufferLength);
+    }
+    cmdBufferLength = 0;
+
+    return (error == E_NO_ERROR) ? 0 : 4;   // Return "Other Error" in case of error
 }
 
 uint8_t TwoWire::endTransmission(void)
@@ -335,6 +285,181 @@ void TwoWire::flush(void)
     endTransmission(true);
 }
 
+int TwoWire::readAsync(i2cm_req_t *req)
+{
+    return queue(req, 1);
+}
+
+int TwoWire::writeAsync(i2cm_req_t *req)
+{
+    return queue(req, 0);
+}
+
+bool TwoWire::busy(void)
+{
+    return (active != NULL) || !requests.isEmpty();
+}
+
+void TwoWire::_handler(void)
+{
+    // Flags raised after the end of the last transfer
+    if (i2cm_states[idx].req == NULL) {
+        i2cm->intfl = i2cm->intfl;
+        return;
+    }
+
+    I2CM_Handler(i2cm);
+
+    // The driver releases the bus before it calls the callback of the request
+    if ((active != NULL) && (i2cm_states[idx].req == NULL)) {
+        active = NULL;
+        startNext();
+    }
+}
+
+// Adds a request to the queue, and starts it if the bus is free
+// From the loop or from the callbacks (the I2CM interrupt)
+int TwoWire::queue(i2cm_req_t *req, uint8_t read)
+{
+    async_request_t request = { req, read };
+
+    if (req->data == NULL) {
+        return E_NULL_PTR;
+    }
+
+    // Make sure the I2CM has been initialized
+    if ((i2cm == NULL) || (i2cm->ctrl == 0)) {
+        return E_UNINITIALIZED;
+    }
+
+    if (req->data_len == 0) {
+        req->cmd_num = 0;
+        req->data_num = 0;
+        if (req->callback != NULL) {
+            req->callback(req, E_NO_ERROR);
+        }
+        return E_NO_ERROR;
+    }
+
+    // The interrupt starts the next request as well. Nested when the callback
+    // of a request that failed to start queues another one
+    NVIC_DisableIRQ(irqn);
+    asyncLocks++;
+
+    int error = E_NO_ERROR;
+    if (requests.push(request)) {
+        startNext();
+    } else {
+        error = E_BUSY;
+    }
+
+    if (--asyncLocks == 0) {
+        NVIC_EnableIRQ(irqn);
+    }
+    return error;
+}
+
+// Starts the oldest request if the bus is free
+// Called with the I2CM interrupt disabled, or from it
+void TwoWire::startNext(void)
+{
+    async_request_t next;
+    int error;
+
+    while ((active == NULL) && requests.pop(next)) {
+        active = next.req;
+
+        if (next.read) {
+            error = I2CM_ReadAsync(i2cm, next.req);
+        } else {
+            error = I2CM_WriteAsync(i2cm, next.req);
+        }
+
+        if (error != E_NO_ERROR) {
+            // The driver has called the callback, unless the I2CM was shut down
+            if ((error == E_UNINITIALIZED) && (next.req->callback != NULL)) {
+                next.req->callback(next.req, error);
+            }
+            active = NULL;
+        }
+    }
+}
+
+// Transfer of the blocking functions, through the queue so it waits for its turn
+// Only from the loop: the completion comes from the I2CM interrupt
+int TwoWire::transfer(uint8_t read, uint8_t address, const uint8_t *cmd, uint32_t cmdLength,
+                      uint8_t *data, uint32_t length)
+{
+    int error;
+    uint32_t start = millis();
+
+    // The interrupt could not run, the wait would never end
+    if ((__get_IPSR() != 0) || (__get_PRIMASK() != 0)) {
+        return E_BAD_STATE;
+    }
+
+    syncReq.req.addr = address;
+    syncReq.req.cmd_data = cmd;
+    syncReq.req.cmd_len = cmdLength;
+    syncReq.req.data = data;
+    syncReq.req.data_len = length;
+    syncReq.req.callback = syncDone;
+    syncReq.done = 0;
+
+    // Wait for room in the queue
+    while ((error = queue(&syncReq.req, read)) == E_BUSY) {
+        if ((millis() - start) >= WIRE_TIMEOUT_MS) {
+            reset();
+            return E_TIME_OUT;
+        }
+    }
+
+    if (error != E_NO_ERROR) {
+        return error;
+    }
+
+    while (!syncReq.done) {
+        if ((millis() - start) >= WIRE_TIMEOUT_MS) {
+            // A slave holding the bus, the transfer never ends
+            reset();
+            return E_TIME_OUT;
+        }
+    }
+
+    return syncReq.error;
+}
+
+// Writes the bytes of endTransmission(false) on their own
+int TwoWire::sendCommand(void)
+{
+    if (cmdBufferLength == 0) {
+        return E_NO_ERROR;
+    }
+
+    int error = transfer(0, cmdAddress, NULL, 0, cmdBuffer, cmdBufferLength);
+    cmdBufferLength = 0;
+    return error;
+}
+
+// Ends every request with E_SHUTDOWN and starts the I2CM again, at the same clock
+void TwoWire::reset(void)
+{
+    uint32_t clock = i2cm->fs_clk_div;
+
+    end();
+    begin();
+    i2cm->fs_clk_div = clock;
+}
+
+void TwoWire::syncDone(i2cm_req_t *req, int error)
+{
+    // req is the first member of the sync_request_t
+    sync_request_t *sync = (sync_request_t *)req;
+
+    sync->error = error;
+    sync->done = 1;
+}
+
 TwoWire Wire0 = TwoWire(0);
 #if (MXC_CFG_I2CM_INSTANCES > 1)
 TwoWire Wire1 = TwoWire(1);
@@ -353,3 +478,11 @@ TwoWire Wire5 = TwoWire(5);
 #endif
 
 TwoWire& Wire = CONCAT(Wire, DEFAULT_I2CM_PORT);
+
+extern "C" void I2CM0_IRQHandler(void) { Wire0._handler(); }
+#if (MXC_CFG_I2CM_INSTANCES > 1)
+extern "C" void I2CM1_IRQHandler(void) { Wire1._handler(); }
+#endif
+#if (MXC_CFG_I2CM_INSTANCES > 2)
+extern "C" void I2CM2_IRQHandler(void) { Wire2._handler(); }
+#endif
@@ -28,10 +28,22 @@
 #include <Arduino.h>
 #include <inttypes.h>
 #include "Stream.h"
-#include "i2cm_regs.h"
+#include "i2cm.h"
+#include "mxc_errors.h"
+#include "SpscQueue.h"
 
 #define BUFFER_LENGTH 32
 
+// Number of readAsync()/writeAsync() requests that can wait for the bus, power of 2
+#if !defined(WIRE_ASYNC_QUEUE_SIZE)
+#define WIRE_ASYNC_QUEUE_SIZE 4
+#endif
+
+// Time the blocking functions wait for their transfer before they reset the bus, in ms
+#if !defined(WIRE_TIMEOUT_MS)
+#define WIRE_TIMEOUT_MS 100
+#endif
+
 // WIRE_HAS_END means Wire has end()
 #define WIRE_HAS_END 1
 
@@ -49,10 +61,41 @@ class TwoWire : public Stream
 
     uint8_t transmitting;
 
+    // Bytes of endTransmission(false), sent by the next transfer before a repeated start
+    uint8_t cmdAddress;
+    uint8_t cmdBuffer[BUFFER_LENGTH];
+    uint8_t cmdBufferLength;
+
     uint8_t targetAddr;
     uint32_t idx;
     mxc_i2cm_regs_t *i2cm;
     mxc_i2cm_fifo_regs_t *fifo;
+    IRQn_Type irqn;
+
+    // Requests waiting for the bus, started one after the other from the interrupt
+    struct async_request_t {
+      i2cm_req_t *req;
+      uint8_t read;
+    };
+    SpscQueue<async_request_t, WIRE_ASYNC_QUEUE_SIZE> requests;
+    i2cm_req_t * volatile active; // Request being transferred
+    uint8_t asyncLocks;
+
+    // Request of the blocking functions, they wait for its callback
+    struct sync_request_t {
+      i2cm_req_t req;
+      volatile uint8_t done;
+      volatile int error;
+    };
+    sync_request_t syncReq;
+
+    int queue(i2cm_req_t *req, uint8_t read);
+    void startNext(void);
+    int transfer(uint8_t read, uint8_t address, const uint8_t *cmd, uint32_t cmdLength,
+                 uint8_t *data, uint32_t length);
+    int sendCommand(void);
+    void reset(void);
+    static void syncDone(i2cm_req_t *req, int error);
 
   public:
     TwoWire(uint32_t);
@@ -61,6 +104,10 @@ class TwoWire : public Stream
     void begin(int);
     void end();
     void setClock(uint32_t);
+    // Blocking transfers: endTransmission(), requestFrom() and flush() wait for the
+    // I2CM interrupt, so they fail from the callbacks, from the other interrupts and
+    // with the interrupts disabled. After WIRE_TIMEOUT_MS they reset the bus, which
+    // ends the requests of readAsync()/writeAsync() with E_SHUTDOWN
     void beginTransmission(uint8_t);
     void beginTransmission(int);
     uint8_t endTransmission(void);
@@ -81,6 +128,21 @@ class TwoWire : public Stream
     inline size_t write(unsigned int n) { return write((uint8_t)n); }
     inline size_t write(int n) { return write((uint8_t)n); }
     using Print::write;
+
+    // Non-blocking transfers, from caller owned buffers of any length.
+    // req->cmd_data (optional, the register address of a read for instance) is written
+    // first, then req->data is read or written after a repeated start, and the transfer
+    // ends with a stop. A register address to write goes in front of req->data.
+    // req->callback is called from the interrupt with the result.
+    // The request and its buffers have to stay allocated until then.
+    // Requests are queued, so they can be chained from the callbacks.
+    // Returns E_BUSY if WIRE_ASYNC_QUEUE_SIZE requests are already waiting
+    int readAsync(i2cm_req_t *req);
+    int writeAsync(i2cm_req_t *req);
+    // true while requests are waiting or being transferred
+    bool busy(void);
+    // Interrupt handler - Not intended to be called externally
+    void _handler(void);
 };
 
 extern TwoWire Wire0;
@@ -23,7 +23,10 @@
  * libraries or sketches that supports cooperative threads.
  *
  * Its defined as a weak symbol and it can be redefined to implement a
- * real cooperative scheduler.
+ * real cooperative scheduler. delay() calls it while waiting, from thread
+ * mode only: a delay() in an interrupt handler does not call it.
+ * The delays of the core call it as well (tone() with a duration, the
+ * start-up before setup()), so it may run inside those functions.
  */
 static void __empty() {
 	// Empty
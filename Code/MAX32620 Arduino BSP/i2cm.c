@@ -856,13 +856,16 @@ int I2CM_WriteHandler(mxc_i2cm_regs_t *i2cm, i2cm_req_t *req, int i2cm_num)
         }
 
         // Write bytes to the FIFO until it's full or we run out of bytes
-        while(req->data_num < req->data_len) {
+        while((req->data_num < req->data_len) && (!fifo->tx)) {
             fifo->tx = MXC_S_I2CM_TRANS_TAG_TXDATA_ACK | req->data[req->data_num++];
         }
 
-        // Send the stop condition
-        if ((error = I2CM_WriteTxFifo(i2cm, fifo, MXC_S_I2CM_TRANS_TAG_STOP)) != E_NO_ERROR) {
-            return error;
+        // Send the stop condition after the last byte, the FIFO empty interrupts
+        // bring us back here until then
+        if (req->data_num == req->data_len) {
+            if ((error = I2CM_WriteTxFifo(i2cm, fifo, MXC_S_I2CM_TRANS_TAG_STOP)) != E_NO_ERROR) {
+                return error;
+            }
         }
     }
 
@@ -78,6 +78,11 @@ void delay( uint32_t ms )
     uint32_t start = tickCount;
 
     while ((tickCount - start) < ms){
+        // Lets a cooperative scheduler run meanwhile, see hooks.c
+        // Not from an interrupt, the sketch would run inside it
+        if (__get_IPSR() == 0) {
+            yield();
+        }
         __WFI();
     }
 }
@@ -82,6 +82,10 @@
 
 extern int disable_lp1;
 
+/* Longest line of vTaskGetRunTimeStats: the task name, the run time count and
+the percentage, with their tabs. */
+#define cliRUN_TIME_STATS_LINE_LENGTH	( configMAX_TASK_NAME_LEN + 20 )
+
 /*
  * Defines a command that returns a table showing the state of each task at the
  * time the command is called.
@@ -113,7 +117,7 @@ static BaseType_t prvTickless( char *pcWriteBuffer, size_t xWriteBufferLen, cons
 static const CLI_Command_Definition_t xTaskStats =
 {
 	"ps", /* The command string to type. */
-	"\r\nps:\r\n Displays a table showing the state of each FreeRTOS task\r\n\r\n",
+	"\r\nps:\r\n Displays a table showing the state of each FreeRTOS task (and its run time, if counted)\r\n\r\n",
 	prvTaskStatsCommand, /* The function to run. */
 	0 /* No parameters are expected. */
 };
@@ -174,18 +178,33 @@ void vRegisterCLICommands( void )
 static BaseType_t prvTaskStatsCommand( char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString )
 {
 const char *const pcHeader = "Task          State  Priority  Stack	#\r\n************************************************\r\n";
+#if( configGENERATE_RUN_TIME_STATS == 1 )
+const char *const pcStatsHeader = "\r\nTask            Abs Time      % Time\r\n****************************************\r\n";
+#endif
 
 	/* Remove compile time warnings about unused parameters, and check the
 	write buffer is not NULL.  NOTE - for simplicity, this example assumes the
-	write buffer length is adequate, so does not check for buffer overflows. */
+	write buffer length is adequate for the task table. */
 	( void ) pcCommandString;
-	( void ) xWriteBufferLen;
 	configASSERT( pcWriteBuffer );
 
 	/* Generate a table of task stats. */
 	strcpy( pcWriteBuffer, pcHeader );
 	vTaskList( pcWriteBuffer + strlen( pcHeader ) );
 
+#if( configGENERATE_RUN_TIME_STATS == 1 )
+	/* Followed by the run time of each task, when the application counts it.
+	vTaskGetRunTimeStats does not know the buffer length, so the stats are
+	only added when what is left of the buffer holds a line per task. */
+	if( ( strlen( pcWriteBuffer ) + strlen( pcStatsHeader ) + ( uxTaskGetNumberOfTasks() * cliRUN_TIME_STATS_LINE_LENGTH ) ) < xWriteBufferLen )
+	{
+		strcat( pcWriteBuffer, pcStatsHeader );
+		vTaskGetRunTimeStats( pcWriteBuffer + strlen( pcWriteBuffer ) );
+	}
+#else
+	( void ) xWriteBufferLen;
+#endif
+
 	/* There is no more data to return after this single string, so return
 	pdFALSE. */
 	return pdFALSE;
@@ -20,14 +20,35 @@
 //#define ARM_MATH_CM4
 #include "arm_math.h"
 #include "arm_const_structs.h"
+#include "fft_engine.h"
+#include "fft_autotune.h"
+#include "fft_autotune_config.h"
+#include "multires_analyzer.h"
+#include "biquad_bank.h"
+#include "dual_channel.h"
+#include "band_tables.h"
+#include "band_levels.h"
+#include "auto_range.h"
+#include "activity_detector.h"
+#include "telemetry.h"
+#include "spectrum_codec.h"
+#include "deferred_log.h"
+#include "led_strip.h"
+#include "led_renderer.h"
+#include "idle_animation.h"
+#include "pmu_channels.h"
+#include "led_commit.h"
+#include "task_scheduler.h"
 
 #include <Wire.h>
+#include <SpscQueue.h>
 
 /* **** Definitions **** */
 #define ADC_INT_REG     MXC_BASE_ADC + MXC_R_ADC_OFFS_INTR
 #define ADC_CTRL_REG    MXC_BASE_ADC + MXC_R_ADC_OFFS_CTRL
 #define ADC_DATA_REG    MXC_BASE_ADC + MXC_R_ADC_OFFS_DATA
 #define VSYS_REG 0x1B
+#define PMU0_LOOP_REG   MXC_BASE_PMU0 + MXC_R_PMU_OFFS_LOOP
 
 // Number of samples to take before triggering a pmu interrupt
 #define AMOUNT_SAMPLES 256
@@ -82,16 +103,100 @@
 #define TIME_LED_OFF_IDLE 4*SECOND
 #define TIME_IDLE_SEQUENCE_TOTAL TIME_LED_ON_IDLE+TIME_LED_OFF_IDLE
 
-/* Use two different modes, one with 10 singular lights
- One with 5 "coupled" lights
- Comment the following line in order to use the "single use" lights mode
- */
-#define COUPLED_MODE 1
-/* Use a "in house mode" to rescan the signal if the first threshold did not give signals*/
-#define IN_HOUSE_MODE 1
+/* COUPLED_MODE (5 "coupled" lights or 10 singular lights) and IN_HOUSE_MODE
+ are set in band_levels.h, shared with the FreeRTOS build */
+/* Engine used to get the bands from the captured frames
+ BAND_ENGINE_FFT: one FFT per frame, same resolution for every band
+ BAND_ENGINE_MULTIRES: long decimated FFT for the bass, short FFT for the treble
+ BAND_ENGINE_BIQUAD: time domain filters, updated every BIQUAD_BLOCK samples */
+#define BAND_ENGINE_FFT 0
+#define BAND_ENGINE_MULTIRES 1
+#define BAND_ENGINE_BIQUAD 2
+#define BAND_ENGINE BAND_ENGINE_FFT
+/* Capture two microphones, alternating the ADC input on every conversion
+ Both channels share a single complex FFT, the down led of each pair follows
+ channel A and the up led channel B (requires COUPLED_MODE undefined)
+ Each channel gets half the sample rate: the bands sit an octave lower than
+ in mono mode, see dual_channel.h. Calibrate again after switching
+ Uncomment the following line to use it */
+//#define DUAL_CHANNEL_MODE 1
+#define DUAL_CHANNEL_A ADC_CH_0_DIV_5
+#define DUAL_CHANNEL_B ADC_CH_1_DIV_5
+/* Switch the ADC input between the divided and the direct input
+ depending on the level of the signal, see auto_range.h
+ Uncomment the following line to use it (not available with DUAL_CHANNEL_MODE) */
+//#define AUTO_RANGE_MODE 1
+/* Take OVERSAMPLING_FACTOR conversions for every sample of the frame, and store
+ their sum (10 bits + log2(OVERSAMPLING_FACTOR)), 14 bits with 16 conversions
+ The PMU stores the conversions by itself, the CPU only adds them once per frame
+ The sample rate is divided by OVERSAMPLING_FACTOR, and so are the band frequencies
+ Uncomment the following line to use it */
+//#define OVERSAMPLING_MODE 1
+#define OVERSAMPLING_FACTOR 16
+/* After STANDBY_SILENCE_TIME without any led over its threshold, stop processing
+ and sleep until the sound goes over the ADC limits around the silence level
+ Uncomment the following line to use it */
+//#define STANDBY_MODE 1
+#define STANDBY_SILENCE_TIME 30*SECOND
+#define STANDBY_CHANNEL ADC_CH_0_DIV_5
+// Distance from the silence level to the limits, in ADC counts
+#define STANDBY_LIMIT_MARGIN 40
+/* Play the idle mode animations with the pulse trains, see idle_animation.h
+ The capture stops and the core sleeps in LP2 until the boot button is pressed,
+ instead of polling millis() to blink BUILTIN_GREEN
+ IDLE_ANIMATIONS: IDLE_ANIMATION_BREATHE (BUILTIN_GREEN) and/or IDLE_ANIMATION_CHASE (music leds)
+ Uncomment the following line to use it */
+//#define PT_IDLE_MODE 1
+#define IDLE_ANIMATIONS IDLE_ANIMATION_BREATHE
+/* Check the level of each frame before the FFT, silent frames keep the leds off
+ without processing them. During long silences the PMU spaces the frames
+ (see setCaptureGap) and the core sleeps between them
+ Uncomment the following line to use it */
+//#define ACTIVITY_MODE 1
+/* Send every processed frame as a binary packet (bands, leds and the optional
+ TELEMETRY_BLOCKS) instead of text, decode it with "Code/Host tools/telemetry_dump"
+ TELEMETRY_PORT can be any serial port, Serial_USB included. The UART ports
+ (Serial0 to Serial2) send the packets with writeAsync(), Serial and Serial_USB
+ copy them with write(). If it is the port of Serial (Serial1 without USB),
+ undefine DEBUG_MODE: the text messages corrupt the packets they fall into
+ Uncomment the following line to use it */
+//#define TELEMETRY_MODE 1
+#define TELEMETRY_PORT Serial1
+#define TELEMETRY_BAUD 115200
+/* 0 or any of TELEMETRY_BLOCK_RAW, TELEMETRY_BLOCK_MAGNITUDE and TELEMETRY_BLOCK_SPECTRUM
+ TELEMETRY_BLOCK_SPECTRUM is the magnitude compressed to about 1 byte per bin,
+ the whole spectrum fits at 115200 bauds, see spectrum_codec.h */
+#define TELEMETRY_BLOCKS 0
+/* Log the messages of the running modes with DLOG: the records are sent in the
+ telemetry packets and formatted on the host, see deferred_log.h
+ The messages stay enabled without DEBUG_MODE, they take a few dozen cycles
+ Uncomment the following line to use it (requires TELEMETRY_MODE) */
+//#define DEFERRED_LOG_MODE 1
+/* Show the bands on an addressable led strip as well, see led_strip.h
+ Each band lights a bar of LED_STRIP_PIXELS/bands pixels with the color of its leds,
+ full when the band is 2*threshold_values over the environment. The frames only
+ set the targets, the strip is refreshed and faded by a timer, see led_renderer.h
+ Data on the MOSI of LED_STRIP_SPI, SPI0 is P0_5 (and the APA102 clock on SCK, P0_4)
+ Uncomment the following line to use it */
+//#define LED_STRIP_MODE 1
+#define LED_STRIP_TYPE LED_STRIP_WS2812
+#define LED_STRIP_SPI SPI0
+#define LED_STRIP_PIXELS 60
+/* Write the music leds with a second PMU channel, see led_commit.h
+ The loop only publishes the state of the leds, the PMU writes it to the pins
+ at the end of the next captured frame (once per frame with BAND_ENGINE_BIQUAD)
+ Uncomment the following line to use it */
+//#define PMU_LED_MODE 1
 /* A define used to enable/disable the Serial comm messages
  Change to #undef if serial is not required */
 #define DEBUG_MODE 1
+/* Benchmark every FFT algorithm at boot and print a new fft_autotune_config.h
+ Uncomment, run once on the board, and paste the serial output in the header */
+//#define FFT_AUTOTUNE_MODE 1
+/* The benchmarks also time the serial driver at 921600 baud on a spare UART
+ Only its TX pin toggles, nothing has to be connected to it */
+#define SERIAL_BENCHMARK_UART 0
+#define SERIAL_BENCHMARK_BYTES 4096
 
 /* Enable/disable serial port communication*/
 #ifdef DEBUG_MODE
@@ -100,6 +205,106 @@
 #define DEBUG_CMD(cmd)
 #endif
 
+/* Messages of the running modes, deferred or printed as text */
+#ifdef DEFERRED_LOG_MODE
+#define DEBUG_LOG(deferred, text) deferred
+#else
+#define DEBUG_LOG(deferred, text) DEBUG_CMD(text)
+#endif
+
+#ifdef DUAL_CHANNEL_MODE
+#ifdef COUPLED_MODE
+#error "DUAL_CHANNEL_MODE uses one led of each pair per channel, undefine COUPLED_MODE"
+#endif
+#if BAND_ENGINE != BAND_ENGINE_FFT
+#error "DUAL_CHANNEL_MODE only works with BAND_ENGINE_FFT"
+#endif
+#if AMOUNT_SAMPLES != DUAL_CHANNEL_FRAME_SIZE
+#error "DUAL_CHANNEL_FRAME_SIZE has to match AMOUNT_SAMPLES"
+#endif
+#endif
+
+#ifdef OVERSAMPLING_MODE
+#ifdef DUAL_CHANNEL_MODE
+#error "OVERSAMPLING_MODE can not be used with DUAL_CHANNEL_MODE"
+#endif
+#ifdef AUTO_RANGE_MODE
+#error "OVERSAMPLING_MODE can not be used with AUTO_RANGE_MODE, its limits are for 10 bits samples"
+#endif
+#if BAND_ENGINE == BAND_ENGINE_BIQUAD
+#error "OVERSAMPLING_MODE works on whole frames, use BAND_ENGINE_FFT or BAND_ENGINE_MULTIRES"
+#endif
+#if (OVERSAMPLING_FACTOR < 2) || (OVERSAMPLING_FACTOR > 64)
+#error "OVERSAMPLING_FACTOR has to be between 2 and 64, so the sum fits in 16 bits"
+#endif
+// Volts per count of the decimated samples
+#define ADC_COUNT_SCALE (0.005376344086/OVERSAMPLING_FACTOR)
+#else
+#define ADC_COUNT_SCALE 0.005376344086
+#endif
+
+#ifdef ACTIVITY_MODE
+#if BAND_ENGINE == BAND_ENGINE_BIQUAD
+#error "ACTIVITY_MODE works on whole frames, use BAND_ENGINE_FFT or BAND_ENGINE_MULTIRES"
+#endif
+#ifdef OVERSAMPLING_MODE
+#error "ACTIVITY_MODE can not be used with OVERSAMPLING_MODE, the frame is decimated in updateSoundBands"
+#endif
+#if (ACTIVITY_MAX_DIVIDER - 1)*AMOUNT_SAMPLES > 65536
+#error "The gap of ACTIVITY_MAX_DIVIDER frames does not fit in the 16 bits PMU counter"
+#endif
+// Thresholds of the detector, in counts of the current input range
+#ifdef AUTO_RANGE_MODE
+#define ACTIVITY_GAIN autoRangeGain()
+#else
+#define ACTIVITY_GAIN 1.0f
+#endif
+#endif
+
+#ifdef TELEMETRY_MODE
+#if (TELEMETRY_BLOCKS & (TELEMETRY_BLOCK_MAGNITUDE | TELEMETRY_BLOCK_SPECTRUM)) && (BAND_ENGINE != BAND_ENGINE_FFT)
+#error "The magnitude and spectrum blocks are the spectrum of the frame FFT, use BAND_ENGINE_FFT"
+#endif
+#endif
+
+#if defined(DEFERRED_LOG_MODE) && !defined(TELEMETRY_MODE)
+#error "DEFERRED_LOG_MODE sends its records in telemetry packets, define TELEMETRY_MODE"
+#endif
+
+#if defined(LED_STRIP_MODE) && (LED_STRIP_PIXELS > LED_STRIP_MAX_PIXELS)
+#error "LED_STRIP_PIXELS is over LED_STRIP_MAX_PIXELS, raise it in led_strip.h"
+#endif
+
+#ifdef AUTO_RANGE_MODE
+#ifdef DUAL_CHANNEL_MODE
+#error "AUTO_RANGE_MODE can not be used with DUAL_CHANNEL_MODE, the PMU sets the channel"
+#endif
+#if BAND_ENGINE == BAND_ENGINE_BIQUAD
+#error "AUTO_RANGE_MODE works on whole frames, use BAND_ENGINE_FFT or BAND_ENGINE_MULTIRES"
+#endif
+#endif
+
+/* Updates of the bands in a captured frame, the calibration and the armonics
+   test count their sets in frames, whatever the engine */
+#if BAND_ENGINE == BAND_ENGINE_BIQUAD
+#define BAND_SETS_PER_FRAME (AMOUNT_SAMPLES/BIQUAD_BLOCK)
+#else
+#define BAND_SETS_PER_FRAME 1
+#endif
+
+/* Values followed by the armonics test: the spectrum of the frame, or the
+   bands of the engines that do not compute it */
+#if BAND_ENGINE == BAND_ENGINE_FFT
+#define ARMONICS_VALUES fft_result_mag
+#define ARMONICS_COUNT (AMOUNT_SAMPLES/2)
+#elif defined(COUPLED_MODE)
+#define ARMONICS_VALUES bands
+#define ARMONICS_COUNT 5
+#else
+#define ARMONICS_VALUES bands
+#define ARMONICS_COUNT 10
+#endif
+
 /* **** Globals **** */
 unsigned char current_mode = 0;
 unsigned long last_time_led_idle = millis();
@@ -109,7 +314,8 @@ float32_t process_buffer[AMOUNT_SAMPLES];
 float32_t fft_result[AMOUNT_SAMPLES];
 float32_t fft_result_mag[AMOUNT_SAMPLES/2];
 uint16_t fftSize = AMOUNT_SAMPLES;
-static arm_rfft_fast_instance_f32  fft_instance;
+// Transform used for the frames, the fastest one recorded in fft_autotune_config.h
+static fft_engine_t fft_engine;
 
 // Frequency bands RMS 
 float32_t bands[10] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f,  
@@ -120,22 +326,6 @@ float32_t bands[10] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
 float32_t env_bias[10] =  {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 
                       0.0f, 0.0f, 0.0f, 0.0f, 0.0f};                    
 
-/* Constant values used to output music with the bands
- * if current value - avg > threshold, turn on led
-*/
-const float32_t threshold_values[10] = { 10, 10, 
-                                        10, 10, 
-                                        10, 10, 
-                                        10, 10, 
-                                        10, 10};  
-                                        
-/* Constant values used to help the algorithm when the sound is low*/                                        
-const float32_t threshold_halves[10] = { 3, 3, 
-                                         3, 3, 
-                                         3, 3, 
-                                         3, 3, 
-                                         3, 3};
-
 /* Array with the leds ports used 
    Sorted in array form to be able of iterating over them in order to avoid repeating code
 */                                        
@@ -144,17 +334,77 @@ const int music_leds_array[10] = {BLUE_LED_DOWN, BLUE_LED_UP,
                                  WHITE_LED_DOWN, WHITE_LED_UP,
                                  ORANGE_LED_DOWN, ORANGE_LED_UP,
                                  RED_LED_DOWN, RED_LED_UP};
+
+#ifdef LED_STRIP_MODE
+/* Colors of the led pairs on the strip, RGB */
+const uint8_t strip_colors[5][3] = {{0, 0, 255}, {0, 255, 0},
+                                    {255, 255, 255}, {255, 96, 0},
+                                    {255, 0, 0}};
+#endif
                                                                  
 // Array of sampled data
 uint32_t adc_acquired_data[AMOUNT_SAMPLES];
 
+#ifdef OVERSAMPLING_MODE
+// Conversions stored by the PMU, OVERSAMPLING_FACTOR for every sample of adc_acquired_data
+uint16_t adc_oversampled_data[AMOUNT_SAMPLES*OVERSAMPLING_FACTOR];
+#endif
+
+#ifdef DUAL_CHANNEL_MODE
+// Samples of the second channel, and its spectrum
+uint32_t adc_acquired_data_b[AMOUNT_SAMPLES];
+float32_t fft_result_mag_b[AMOUNT_SAMPLES/2];
+#endif
+
 // ADC data, taken from an interrupt routine 
 int16_t adc_buffer[AMOUNT_SAMPLES];
-volatile unsigned int adc_done = 0;
+// Number of each frame captured, pushed by the PMU interrupt
+SpscQueue<uint16_t, 4> frame_queue;
+// Number of the frame in process, taken from frame_queue, and the frames skipped between two of them
+uint16_t frame_number = 0;
+uint32_t frames_dropped = 0;
+// PMU channel of the capture programs, see pmu_channels.h
+int adc_channel = 0;
+
+#if defined(TELEMETRY_MODE) && (TELEMETRY_BLOCKS & TELEMETRY_BLOCK_RAW) && !defined(OVERSAMPLING_MODE)
+#define TELEMETRY_RAW_COPY 1
+// Frame sent in the raw block, copied by the PMU before the capture writes the next one
+uint32_t telemetry_raw[AMOUNT_SAMPLES];
+// Number of the frame in telemetry_raw, set with the copy
+volatile uint16_t telemetry_raw_number = 0;
+// Set while the loop sends telemetry_raw, the captures meanwhile are not copied
+volatile uint8_t telemetry_raw_locked = 0;
+int copy_channel = -1;
+#endif
 volatile uint16_t counts = 0;
 
-// Constant used to change V_SYS voltage to 4.8V
-const byte aux_vsys[2] = {VSYS_REG, 0x1f};
+#ifdef STANDBY_MODE
+// 1 when woken by the sound, 2 by the button
+volatile unsigned int standby_wake = 0;
+unsigned long last_sound_time = 0;
+// Time the core woke up from standby, reported with the first frame
+unsigned long wake_time = 0;
+unsigned char wake_pending = 0;
+#endif
+
+#ifdef PT_IDLE_MODE
+volatile unsigned int idle_wake = 0;
+#endif
+
+#if BAND_ENGINE == BAND_ENGINE_BIQUAD
+// Next sample of adc_acquired_data to be filtered by the biquad bank
+uint16_t biquad_read_index = 0;
+#endif
+
+#if defined(TELEMETRY_MODE) && (TELEMETRY_BLOCKS & TELEMETRY_BLOCK_SPECTRUM)
+// Compressed spectrum of the last frame, and the previous frame it refers to
+spectrum_codec_t spectrum_codec;
+uint8_t spectrum_encoded[SPECTRUM_CODEC_MAX_ENCODED];
+#endif
+
+// Constant used to change V_SYS voltage to 4.8V, written by the request in the background
+byte aux_vsys[2] = {VSYS_REG, 0x1f};
+i2cm_req_t vsys_req = {0x48, NULL, 0, aux_vsys, 2, 0, 0, NULL};
 
 /* Number of 32 bits words:
 // MOVE: 3 = OP + W_Address + R_Address
@@ -167,6 +417,11 @@ const byte aux_vsys[2] = {VSYS_REG, 0x1f};
 // TRANSFER: 4 = OP + W_ADDRESS + R_Address + Int_Mask
 */
 
+#ifdef ACTIVITY_MODE
+// Gap run by the capture programs after each frame, see setCaptureGap
+extern uint32_t pmu_program_gap[];
+#endif
+
 uint32_t pmu_program[] = {    
   // Trigger ADC conversion:
   PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_CTRL_REG, MXC_F_ADC_CTRL_CPU_ADC_START, MXC_F_ADC_CTRL_CPU_ADC_START), 
@@ -185,25 +440,189 @@ uint32_t pmu_program[] = {
   // Loop instruction, loop for the number of "SAMPLES" required to perform the fourier transform
   // Use counter 0, it has to be loaded with the number of samples before starting the program
   PMU_LOOP(PMU_INTERRUPT, PMU_NO_STOP, 0, (uint32_t)&(pmu_program[0])),  
+  #ifdef PMU_LED_MODE
+  // Frame done, the leds of the previous one can be written
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, (uint32_t)&led_commit_tick, 1, 0xffffffff),
+  #endif
   // If the number of samples has been taken, then restart the index pointer
   PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, (uint32_t)&(pmu_program[13]), (uint32_t)&(adc_acquired_data[0]), 0xffffffff),
+  #ifdef ACTIVITY_MODE
+  // Repeat the loop forever, after the gap between frames
+  PMU_JUMP(PMU_NO_INTERRUPT, PMU_NO_STOP, (uint32_t)(pmu_program_gap)),
+  #else
   // Repeat the loop forever
   PMU_JUMP(PMU_NO_INTERRUPT, PMU_NO_STOP, (uint32_t)(pmu_program)),
+  #endif
+};
+
+#ifdef ACTIVITY_MODE
+/* Conversions without storing the data between two frames, the same count of
+   conversions takes the same time as the frames. The number of conversions is
+   the counter 1 value of the write at pmu_program_gap[7], set by setCaptureGap,
+   the branch skips the gap while it is 0. prepareCapture points [4] and [24]
+   to the capture program, and [6] to the loop register of adc_channel */
+uint32_t pmu_program_gap[] = {
+  PMU_BRANCH(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_BRANCH_AND, PMU_BRANCH_TYPE_EQUAL, (uint32_t)&(pmu_program_gap[7]), 0, MXC_F_PMU_LOOP_COUNTER_1, (uint32_t)(pmu_program)),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, PMU0_LOOP_REG, 0, MXC_F_PMU_LOOP_COUNTER_1),
+  // pmu_program_gap[9]
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_CTRL_REG, MXC_F_ADC_CTRL_CPU_ADC_START, MXC_F_ADC_CTRL_CPU_ADC_START),
+  PMU_WAIT(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WAIT_SEL_0, PMU_WAIT_IRQ_MASK1_SEL0_ADC_DONE, 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_INT_REG, MXC_F_ADC_INTR_ADC_DONE_IF, MXC_F_ADC_INTR_ADC_DONE_IF),
+  PMU_LOOP(PMU_NO_INTERRUPT, PMU_NO_STOP, 1, (uint32_t)&(pmu_program_gap[9])),
+  PMU_JUMP(PMU_NO_INTERRUPT, PMU_NO_STOP, (uint32_t)(pmu_program)),
+};
+#endif
+
+#ifdef DUAL_CHANNEL_MODE
+/* Same sequence as pmu_program, done twice per loop: 
+   channel A to adc_acquired_data, then channel B to adc_acquired_data_b.
+   The channel is selected in the same write that triggers the conversion
+   Each channel gets half of the sample rate */
+#define ADC_START_CHANNEL(ch) (((uint32_t)(ch) << MXC_F_ADC_CTRL_ADC_CHSEL_POS) | MXC_F_ADC_CTRL_CPU_ADC_START)
+#define ADC_START_CHANNEL_MASK (MXC_F_ADC_CTRL_ADC_CHSEL | MXC_F_ADC_CTRL_CPU_ADC_START)
+
+uint32_t pmu_program_dual[] = {
+  // Channel A: select input and trigger ADC conversion
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_CTRL_REG, ADC_START_CHANNEL(DUAL_CHANNEL_A), ADC_START_CHANNEL_MASK),
+  PMU_WAIT(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WAIT_SEL_0, PMU_WAIT_IRQ_MASK1_SEL0_ADC_DONE, 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_INT_REG, MXC_F_ADC_INTR_ADC_DONE_IF, MXC_F_ADC_INTR_ADC_DONE_IF),
+  // Write address of this move is pmu_program_dual[13]
+  PMU_MOVE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_MOVE_READ_32_BIT, PMU_MOVE_READ_NO_INC, PMU_MOVE_WRITE_32_BIT, PMU_MOVE_WRITE_NO_INC, PMU_MOVE_NO_CONT, 4, (uint32_t)&(adc_acquired_data[0]), ADC_DATA_REG),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_dual[13]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_dual[13]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_dual[13]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_dual[13]), 0, 0),
+  // Channel B, starts at pmu_program_dual[31]
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_CTRL_REG, ADC_START_CHANNEL(DUAL_CHANNEL_B), ADC_START_CHANNEL_MASK),
+  PMU_WAIT(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WAIT_SEL_0, PMU_WAIT_IRQ_MASK1_SEL0_ADC_DONE, 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_INT_REG, MXC_F_ADC_INTR_ADC_DONE_IF, MXC_F_ADC_INTR_ADC_DONE_IF),
+  // Write address of this move is pmu_program_dual[44]
+  PMU_MOVE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_MOVE_READ_32_BIT, PMU_MOVE_READ_NO_INC, PMU_MOVE_WRITE_32_BIT, PMU_MOVE_WRITE_NO_INC, PMU_MOVE_NO_CONT, 4, (uint32_t)&(adc_acquired_data_b[0]), ADC_DATA_REG),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_dual[44]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_dual[44]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_dual[44]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_dual[44]), 0, 0),
+  // Loop for the number of samples of each channel
+  PMU_LOOP(PMU_INTERRUPT, PMU_NO_STOP, 0, (uint32_t)&(pmu_program_dual[0])),
+  #ifdef PMU_LED_MODE
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, (uint32_t)&led_commit_tick, 1, 0xffffffff),
+  #endif
+  // Restart both index pointers
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, (uint32_t)&(pmu_program_dual[13]), (uint32_t)&(adc_acquired_data[0]), 0xffffffff),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, (uint32_t)&(pmu_program_dual[44]), (uint32_t)&(adc_acquired_data_b[0]), 0xffffffff),
+  #ifdef ACTIVITY_MODE
+  PMU_JUMP(PMU_NO_INTERRUPT, PMU_NO_STOP, (uint32_t)(pmu_program_gap)),
+  #else
+  PMU_JUMP(PMU_NO_INTERRUPT, PMU_NO_STOP, (uint32_t)(pmu_program_dual)),
+  #endif
+};
+#endif
+
+#ifdef STANDBY_MODE
+/* Conversions without storing the data, until one of them is out of the ADC limits
+   Then the channel stops and interrupts the core, so it can sleep meanwhile */
+uint32_t pmu_program_standby[] = {
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_CTRL_REG, MXC_F_ADC_CTRL_CPU_ADC_START, MXC_F_ADC_CTRL_CPU_ADC_START),
+  PMU_WAIT(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WAIT_SEL_0, PMU_WAIT_IRQ_MASK1_SEL0_ADC_DONE, 0, 0),
+  // Check the limits before clearing the done flag, the masked write clears every flag set
+  PMU_BRANCH(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_BRANCH_OR, PMU_BRANCH_TYPE_NOT_EQUAL, ADC_INT_REG, 0, MXC_F_ADC_INTR_ADC_HI_LIMIT_IF | MXC_F_ADC_INTR_ADC_LO_LIMIT_IF, (uint32_t)&(pmu_program_standby[19])),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_INT_REG, MXC_F_ADC_INTR_ADC_DONE_IF, MXC_F_ADC_INTR_ADC_DONE_IF),
+  PMU_JUMP(PMU_NO_INTERRUPT, PMU_NO_STOP, (uint32_t)(pmu_program_standby)),
+  // Sound detected, pmu_program_standby[19]
+  PMU_WRITE(PMU_INTERRUPT, PMU_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_INT_REG, 
+            MXC_F_ADC_INTR_ADC_DONE_IF | MXC_F_ADC_INTR_ADC_HI_LIMIT_IF | MXC_F_ADC_INTR_ADC_LO_LIMIT_IF, 
+            MXC_F_ADC_INTR_ADC_DONE_IF | MXC_F_ADC_INTR_ADC_HI_LIMIT_IF | MXC_F_ADC_INTR_ADC_LO_LIMIT_IF),
+};
+#endif
+
+#ifdef OVERSAMPLING_MODE
+/* Same sequence as pmu_program, with an inner loop on counter 1
+   that takes OVERSAMPLING_FACTOR conversions for every sample of the frame.
+   The PMU can not add, the conversions are stored as 16 bits words in
+   adc_oversampled_data and added by the CPU when the frame is processed */
+uint32_t pmu_program_oversampling[] = {
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_CTRL_REG, MXC_F_ADC_CTRL_CPU_ADC_START, MXC_F_ADC_CTRL_CPU_ADC_START),
+  PMU_WAIT(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WAIT_SEL_0, PMU_WAIT_IRQ_MASK1_SEL0_ADC_DONE, 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_INT_REG, MXC_F_ADC_INTR_ADC_DONE_IF, MXC_F_ADC_INTR_ADC_DONE_IF),
+  // Write address of this move is pmu_program_oversampling[13]
+  PMU_MOVE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_MOVE_READ_16_BIT, PMU_MOVE_READ_NO_INC, PMU_MOVE_WRITE_16_BIT, PMU_MOVE_WRITE_NO_INC, PMU_MOVE_NO_CONT, 2, (uint32_t)&(adc_oversampled_data[0]), ADC_DATA_REG),
+  // Increase the pointer by 2 (16 bits words)
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_oversampling[13]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program_oversampling[13]), 0, 0),
+  // Inner loop, conversions of one sample, counter 1 loaded with OVERSAMPLING_FACTOR-1
+  PMU_LOOP(PMU_NO_INTERRUPT, PMU_NO_STOP, 1, (uint32_t)&(pmu_program_oversampling[0])),
+  // Load counter 1 again for the next sample, pmu_program_oversampling[26] is set to the loop register of adc_channel
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, PMU0_LOOP_REG, (OVERSAMPLING_FACTOR-1) << MXC_F_PMU_LOOP_COUNTER_1_POS, MXC_F_PMU_LOOP_COUNTER_1),
+  // Outer loop, samples of the frame, counter 0 loaded with AMOUNT_SAMPLES-1
+  PMU_LOOP(PMU_INTERRUPT, PMU_NO_STOP, 0, (uint32_t)&(pmu_program_oversampling[0])),
+  #ifdef PMU_LED_MODE
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, (uint32_t)&led_commit_tick, 1, 0xffffffff),
+  #endif
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, (uint32_t)&(pmu_program_oversampling[13]), (uint32_t)&(adc_oversampled_data[0]), 0xffffffff),
+  PMU_JUMP(PMU_NO_INTERRUPT, PMU_NO_STOP, (uint32_t)(pmu_program_oversampling)),
 };
+#endif
+
+#ifdef TELEMETRY_RAW_COPY
+/* Copy of the whole frame, the PMU moves a word in a few cycles
+   so it stays ahead of the capture that starts again from the first sample */
+uint32_t pmu_program_copy[] = {
+  PMU_MOVE(PMU_NO_INTERRUPT, PMU_STOP, PMU_MOVE_READ_32_BIT, PMU_MOVE_READ_INC, PMU_MOVE_WRITE_32_BIT, PMU_MOVE_WRITE_INC, PMU_MOVE_NO_CONT, 4*AMOUNT_SAMPLES, (uint32_t)&(telemetry_raw[0]), (uint32_t)&(adc_acquired_data[0])),
+};
+#endif
 
 // Get here once that the pmu triggers an interrupt
 void PMU_IRQ_Handler(void) {  
-  // PMU_Handler function calls the function callbacks triggered
-  // And clears the needed flags
-  PMU_Handler();    
+  // Calls the callbacks of the channels flagged
+  // And clears the needed flags, see pmu_channels.h
+  pmuChannelsHandler();    
 }
 
 /* ADC interrupt function
  Sets a boolean to start with the program core */
 void Process_ADC_Data(int err){  
   counts++;
-  adc_done=1;
+  #ifdef TELEMETRY_RAW_COPY
+  // Not while the loop sends telemetry_raw, see sendTelemetry
+  if(!telemetry_raw_locked){
+    telemetry_raw_number = counts;
+    pmuChannelStart(copy_channel, pmu_program_copy, NULL);
+  }
+  #endif
+  frame_queue.push((uint16_t)counts);
+}
+
+#ifdef STANDBY_MODE
+// Called when the standby program detects sound
+void Standby_Wake(int err){
+  standby_wake = 1;
+}
+
+// The button has to wake the core too, to be able of changing the mode
+void Standby_Button(void){
+  standby_wake = 2;
 }
+#endif
+
+#ifdef PT_IDLE_MODE
+// Wakes the core from the idle mode, the mode is selected in the loop
+void Idle_Button(void){
+  idle_wake = 1;
+}
+#endif
+
+// Task of each mode, indexed by current_mode
+task_t mode_tasks[] = {
+  TASK_INIT(idleModeOperation, "idle"),
+  TASK_INIT(funkyModeTask, "funky"),
+  TASK_INIT(calibrateVariables, "calibration"),
+  TASK_INIT(powerOff, "power off"),
+  TASK_INIT(armonicsTest, "armonics"),
+};
+task_t button_task = TASK_INIT(selectOperationMode, "button");
+#ifdef DEFERRED_LOG_MODE
+task_t log_task = TASK_INIT(logTask, "log");
+#endif
 
 /* ****************************************************************************/
 void setup() {
@@ -216,10 +635,8 @@ void setup() {
   
   // Init I2C module, and configure VSYS voltage to 4.8V
   Wire2.begin();
-  // Change SYS voltage to maximum (4.8V)  
-  Wire2.beginTransmission(0x48);
-  Wire2.write(aux_vsys, 2);
-  Wire2.endTransmission();
+  // Change SYS voltage to maximum (4.8V), while the rest is configured
+  Wire2.writeAsync(&vsys_req);
   
   // Configure all the outputs
   pinMode(BLUE_LED_DOWN, OUTPUT);
@@ -243,6 +660,12 @@ void setup() {
   digitalWrite(ORANGE_LED_UP, LOW);
   digitalWrite(RED_LED_DOWN, LOW);
   digitalWrite(RED_LED_UP, LOW);  
+  #ifdef LED_STRIP_MODE
+  ledStripBegin(LED_STRIP_SPI, LED_STRIP_TYPE, LED_STRIP_PIXELS);
+  // Strips power up with random colors
+  ledStripShow();
+  ledRenderBegin(LED_STRIP_PIXELS);
+  #endif
   
   //pinMode(LED_BUILTIN, OUTPUT); //builtin = P
   pinMode(BUILTIN_RED, OUTPUT);
@@ -254,88 +677,208 @@ void setup() {
   ADC_Init();
   // Use a dummy conversion to configure reading channel 0 / 5
   ADC_StartConvert(ADC_CH_0_DIV_5, 0, 1);
+  #ifdef AUTO_RANGE_MODE
+  autoRangeInit();
+  #endif
         
   // Enable PMU interrupts
   NVIC_SetVector(PMU_IRQn, PMU_IRQ_Handler);   
+  adc_channel = pmuChannelAlloc();
+  #ifdef TELEMETRY_RAW_COPY
+  copy_channel = pmuChannelAlloc();
+  #endif
+  #ifdef PMU_LED_MODE
+  // The leds are off, from here only the PMU writes them
+  int commit_status = ledCommitBegin(music_leds_array, 10);
+  DEBUG_CMD(Serial.print("Led commit status: "); Serial.println(commit_status);)
+  #endif
   delay(100);
-  // Set flag to 0
-  adc_done = 0;
+  // No frames yet
+  frame_queue.clear();
   
   // Initialize the samples array to zero:
   memset(adc_buffer, 0, 4*AMOUNT_SAMPLES);
-    // Load PMU0 Counter0 to acquire the number of samples
-  PMU_SetCounter(0, 0, AMOUNT_SAMPLES-1);
   
   // Initialize the fft core
   arm_status status;
-  status = arm_rfft_fast_init_f32(	&fft_instance, fftSize);  
+  status = fftEngineInit(&fft_engine, FFT_AUTOTUNE_ALGO(AMOUNT_SAMPLES), fftSize);
   DEBUG_CMD(Serial.print("Status: "); Serial.println(status);)
+  DEBUG_CMD(Serial.print("FFT: "); Serial.println(fftEngineName(FFT_AUTOTUNE_ALGO(AMOUNT_SAMPLES)));)
+  
+  #ifdef DUAL_CHANNEL_MODE
+  status = dualChannelInit();
+  DEBUG_CMD(Serial.print("Dual channel status: "); Serial.println(status);)
+  #endif
+  
+  #if BAND_ENGINE == BAND_ENGINE_MULTIRES
+  #if AMOUNT_SAMPLES != MULTIRES_FRAME_SIZE
+  #error "MULTIRES_FRAME_SIZE has to match AMOUNT_SAMPLES"
+  #endif
+  multiresInit();
+  #elif BAND_ENGINE == BAND_ENGINE_BIQUAD
+  #ifdef COUPLED_MODE
+  biquadBankInit(5);
+  #else
+  biquadBankInit(10);
+  #endif
+  #endif
+  
+  #ifdef FFT_AUTOTUNE_MODE
+  // Run before starting the PMU, so the ADC interrupts do not disturb the timings
+  fftAutotuneRun(Serial);
+  // Compare the latency and cost of the frame FFT against the time domain bank
+  Serial.print("Frame FFT: ");
+  Serial.print(fftAutotuneMeasure(FFT_AUTOTUNE_ALGO(AMOUNT_SAMPLES), AMOUNT_SAMPLES)/AMOUNT_SAMPLES);
+  Serial.print(" cycles per sample, latency "); Serial.print(AMOUNT_SAMPLES); Serial.println(" samples");
+  #ifdef COUPLED_MODE
+  biquadBankBenchmark(5, Serial);
+  multiresBenchmark(5, Serial);
+  #else
+  biquadBankBenchmark(10, Serial);
+  multiresBenchmark(10, Serial);
+  #endif
+  serialBenchmark(Serial);
+  #elif FFT_AUTOTUNE_MEASURED
+  // Warn if a change in the tables or the size made the frame slower than recorded
+  DEBUG_CMD(fftAutotuneCheck(FFT_AUTOTUNE_ALGO(AMOUNT_SAMPLES), AMOUNT_SAMPLES, FFT_AUTOTUNE_CYCLES(AMOUNT_SAMPLES), Serial);)
+  #else
+  /* The shipped fft_autotune_config.h comes from the cycle model of the host
+     (Code/Host tools/fft_autotune_host), there are no cycles of the board to check against */
+  DEBUG_CMD(Serial.println("FFT regression check off, run FFT_AUTOTUNE_MODE to measure fft_autotune_config.h");)
+  #endif
+
+  #ifdef TELEMETRY_MODE
+  TELEMETRY_PORT.begin(TELEMETRY_BAUD);
+  telemetryInit();
+  #if TELEMETRY_BLOCKS & TELEMETRY_BLOCK_SPECTRUM
+  spectrumCodecInit(&spectrum_codec, AMOUNT_SAMPLES/2, SPECTRUM_CODEC_DEFAULT_BITS,
+                    SPECTRUM_CODEC_DEFAULT_LOG2_MIN, SPECTRUM_CODEC_DEFAULT_LOG2_MAX);
+  #endif
+  #endif
 
   // Start the PMU free run adc acquisition
-  PMU_Start(0, pmu_program, Process_ADC_Data); 
+  startCapture();
+  #ifdef STANDBY_MODE
+  last_sound_time = millis();
+  #endif
   
+  // From here the scheduler runs the program, see loop()
+  for(int i = 0; i<(int)(sizeof(mode_tasks)/sizeof(mode_tasks[0])); i++){
+    schedulerAdd(&mode_tasks[i]);
+  }
+  schedulerAdd(&button_task);
+  taskStart(&button_task);
+  #ifdef DEFERRED_LOG_MODE
+  schedulerAdd(&log_task);
+  taskStart(&log_task);
+  #endif
+  setMode(current_mode);
 }
 
 void loop() {
-  // Based on the current mode, proceed with a diferent task    
-  if(current_mode == FUNKY_MUSIC_MODE) mainProcessloop();
-  else if(current_mode == IDLE_MODE) idleModeOperation();
-  else if(current_mode == CALIBRATION_MODE) calibrateVariables();
-  else if(current_mode == POWER_OFF_MODE) powerOff();
-  else if(current_mode == ARMONICS_TEST_MODE) armonicsTest();
-  
-  // Check if boot button is pressed, is pressed, proceed selecting mode
-  if( !digitalRead(BOOT_BUTTON) ) selectOperationMode();
+  // Every task runs until its next wait point: the task of the current mode,
+  // the boot button (selects the mode) and the deferred log
+  schedulerRun();
+  #ifdef ACTIVITY_MODE
+  // Sleep until the next frame, or the systick for the button and the timed waits
+  // With the interrupts masked, one arriving after the check still wakes the core
+  __disable_irq();
+  if(!bandsAvailable()) __WFI();
+  __enable_irq();
+  #endif
 }
 
-// Function used to select between different modes
-void selectOperationMode(void){
-  unsigned long currentTime = millis();  
-  current_mode = 0;
-  last_time_led_idle = millis();
-  DEBUG_CMD(Serial.println( "Activated Idle Mode" );)
-  digitalWrite(BUILTIN_GREEN, LOW);
-  
-  // Stay on this loop if the button is pressed
-  while( !digitalRead(BOOT_BUTTON) ){
-    // Output different modes
-    if( (current_mode==0) && (millis() - currentTime > TIME_FUNKY  )  ){
-      current_mode = 1;
-      digitalWrite(BUILTIN_GREEN, HIGH);
-      DEBUG_CMD(Serial.println( "Activated Funky mode" );)
-      digitalWrite(BUILTIN_RED, LOW);   
-      digitalWrite(BUILTIN_BLUE, LOW);       
-    }
+/* delay() calls it while waiting, the other tasks keep running */
+void yield(void){
+  schedulerRun();
+}
 
-    // Output different modes
-    if( (current_mode==1) && (millis() - currentTime > TIME_CALIBRATION  )  ){
-      current_mode = 2;
-      digitalWrite(BUILTIN_RED, HIGH);
-      DEBUG_CMD(Serial.println( "Activated calibration mode" );)             
-    }
-    // Output different modes
-    if( (current_mode==2) && (millis() - currentTime > TIME_POWER_OFF  )  ){
-      current_mode = 3;
-      digitalWrite(BUILTIN_BLUE, HIGH);
-      DEBUG_CMD(Serial.println( "Activated Power off sequence" );)     
-      digitalWrite(BUILTIN_RED, LOW);
-    }
+/* Stops the task of the current mode and starts the one of mode */
+void setMode(unsigned char mode){
+  taskStop(&mode_tasks[current_mode]);
+  current_mode = mode;
+  taskStart(&mode_tasks[current_mode]);
+}
+
+/* Processes the frames while in FUNKY_MUSIC_MODE */
+uint8_t funkyModeTask(task_t *task){
+  TASK_BEGIN(task);
+  for(;;){
+    TASK_WAIT_UNTIL(task, bandsAvailable());
+    mainProcessloop();
+  }
+  TASK_END(task);
+}
+
+#ifdef DEFERRED_LOG_MODE
+/* Sends the records logged since its last run */
+uint8_t logTask(task_t *task){
+  TASK_BEGIN(task);
+  for(;;){
+    deferredLogFlush(TELEMETRY_PORT);
+    TASK_YIELD(task);
+  }
+  TASK_END(task);
+}
+#endif
+
+// Function used to select between different modes, when the boot button is pressed
+// The task of the current mode is stopped while the button is held
+uint8_t selectOperationMode(task_t *task){
+  static unsigned long currentTime;
+  TASK_BEGIN(task);
+  for(;;){
+    TASK_WAIT_UNTIL(task, !digitalRead(BOOT_BUTTON));
+    currentTime = millis();  
+    taskStop(&mode_tasks[current_mode]);
+    current_mode = 0;
+    last_time_led_idle = millis();
+    DEBUG_LOG(DLOG("Activated Idle Mode");, Serial.println( "Activated Idle Mode" );)
+    digitalWrite(BUILTIN_GREEN, LOW);
     
-    /* Special mode, used for testing */
-    if( (current_mode==3) && (millis() - currentTime > TIME_ARMONICS_TEST  )  ){
-      current_mode = 4;
-      digitalWrite(BUILTIN_GREEN, LOW);
-      DEBUG_CMD(Serial.println( "Activated armonics test" );)     
+    // Stay on this loop if the button is pressed
+    while( !digitalRead(BOOT_BUTTON) ){
+      // Output different modes
+      if( (current_mode==0) && (millis() - currentTime > TIME_FUNKY  )  ){
+        current_mode = 1;
+        digitalWrite(BUILTIN_GREEN, HIGH);
+        DEBUG_LOG(DLOG("Activated Funky mode");, Serial.println( "Activated Funky mode" );)
+        digitalWrite(BUILTIN_RED, LOW);   
+        digitalWrite(BUILTIN_BLUE, LOW);       
+      }
+
+      // Output different modes
+      if( (current_mode==1) && (millis() - currentTime > TIME_CALIBRATION  )  ){
+        current_mode = 2;
+        digitalWrite(BUILTIN_RED, HIGH);
+        DEBUG_LOG(DLOG("Activated calibration mode");, Serial.println( "Activated calibration mode" );)             
+      }
+      // Output different modes
+      if( (current_mode==2) && (millis() - currentTime > TIME_POWER_OFF  )  ){
+        current_mode = 3;
+        digitalWrite(BUILTIN_BLUE, HIGH);
+        DEBUG_LOG(DLOG("Activated Power off sequence");, Serial.println( "Activated Power off sequence" );)     
+        digitalWrite(BUILTIN_RED, LOW);
+      }
+      
+      /* Special mode, used for testing */
+      if( (current_mode==3) && (millis() - currentTime > TIME_ARMONICS_TEST  )  ){
+        current_mode = 4;
+        digitalWrite(BUILTIN_GREEN, LOW);
+        DEBUG_LOG(DLOG("Activated armonics test");, Serial.println( "Activated armonics test" );)     
+      }
+      
+      TASK_YIELD(task);
     }
-    
-    
+    // After selecting mode, wait 100ms to avoid debounce
+    TASK_DELAY(task, 100);
+    // Turn off the three leds
+    digitalWrite(BUILTIN_RED, HIGH);
+    digitalWrite(BUILTIN_GREEN, HIGH);
+    digitalWrite(BUILTIN_BLUE, HIGH);  
+    setMode(current_mode);
   }
-  // After selecting mode, delay system execution 100ms to avoid debounce
-  delay(100);  
-  // Turn off the three leds
-  digitalWrite(BUILTIN_RED, HIGH);
-  digitalWrite(BUILTIN_GREEN, HIGH);
-  digitalWrite(BUILTIN_BLUE, HIGH);  
+  TASK_END(task);
 }
 
 /* Main system task, proceeds by 
@@ -350,87 +893,28 @@ void selectOperationMode(void){
  */
 void mainProcessloop(void){
   // Once a set of data has been acquired, process it
-  if(adc_done){
+  if(bandsAvailable()){
+    takeFrame();
     
+    #ifdef ACTIVITY_MODE
+    // Silent frames leave the bands at the environment level, so the leds turn off
+    // In dual channel mode the level of channel A is used
+    if(activityProcessFrame(adc_acquired_data, AMOUNT_SAMPLES, ACTIVITY_GAIN)) updateSoundBands();
+    else memcpy(bands, env_bias, sizeof(bands));
+    // Fewer frames are captured during long silences
+    setCaptureGap(activityDivider());
+    #else
     updateSoundBands();
+    #endif
     
-    // Keep a count of the leds that were turned on
+    // Keep a count of the bands that turned on their leds
     int leds_on = 0;
-    
-    #ifdef COUPLED_MODE
-    // If coupled mode, turn lights in pairs
-    for(int i=0; i<5; i++){
-      float32_t aux_difference = bands[i]-env_bias[i];
-      // Serial.print(aux_difference, 2); Serial.print(" ");
-      // Check if the current value requires a change in the output
-      if(aux_difference > threshold_values[i]){
-        // Turn on
-        digitalWrite(music_leds_array[2*i], HIGH);
-        digitalWrite(music_leds_array[2*i+1], HIGH);
-        leds_on++;
-      }
-      else{
-        // Turn off
-        digitalWrite(music_leds_array[2*i], LOW);
-        digitalWrite(music_leds_array[2*i+1], LOW);
-      }
+    // Bands over their threshold, or over the lower one if none is ("in house" mode)
+    uint16_t leds = bandLevelLeds(bands, env_bias, &leds_on);
+    for(int i=0; i<BAND_LEVEL_LEDS; i++){
+      musicLedWrite(music_leds_array[i], ((leds >> i) & 1) ? HIGH : LOW);
     }
     
-    #else
-    // If coupled mode, turn lights individually
-    for(int i=0; i<10; i++){
-      float32_t aux_difference = bands[i]-env_bias[i];
-      // Serial.print(aux_difference, 2); Serial.print(" ");
-      // Check if the current value requires a change in the output
-      if(aux_difference > threshold_values[i]){
-        // Turn on
-        digitalWrite(music_leds_array[i], HIGH);
-        leds_on++;
-      }
-      else{
-        // Turn off
-        digitalWrite(music_leds_array[i], LOW);
-      }
-    }
-    #endif  
-    
-    /* If only a led (or none) is on, test again with a lower threshold 
-       Only for the "in house" mode
-    */
-    #ifdef IN_HOUSE_MODE    
-    #ifdef COUPLED_MODE
-    if(leds_on<1){ 
-      for(int i=0; i<5; i++){
-        float32_t aux_difference = bands[i]-env_bias[i];
-        if(aux_difference > threshold_halves[i]){
-          // Turn on
-          digitalWrite(music_leds_array[2*i], HIGH);
-          digitalWrite(music_leds_array[2*i+1], HIGH);
-        }
-        else{
-          // Turn off
-          digitalWrite(music_leds_array[2*i], LOW);
-          digitalWrite(music_leds_array[2*i+1], LOW);
-        }
-      }
-    }    
-    #else
-    if(leds_on<1){ 
-      for(int i=0; i<10; i++){
-        float32_t aux_difference = bands[i]-env_bias[i];
-        if(aux_difference > threshold_halves[i]){
-          // Turn on
-          digitalWrite(music_leds_array[i], HIGH);
-        }
-        else{
-          // Turn off
-          digitalWrite(music_leds_array[i], LOW);
-        }
-      }
-    }      
-    #endif
-    #endif
-    
     /*
     Serial.print(bands[0]-env_bias[0], 2); Serial.print(" ");    
     Serial.print(bands[1]-env_bias[1], 2); Serial.print(" ");    
@@ -441,117 +925,381 @@ void mainProcessloop(void){
     Serial.print(bands[6]-env_bias[6], 2); Serial.print(" ");
     Serial.print(bands[7]-env_bias[7], 2); Serial.println(" ");
     */    
+    #ifdef PMU_LED_MODE
+    // Written by the PMU at the end of the next frame
+    ledCommitPublish();
+    #endif
+    #ifdef LED_STRIP_MODE
+    showLedStrip();
+    #endif
+    #ifdef TELEMETRY_MODE
+    sendTelemetry();
+    #endif
     // Allow the system to process the next set of data
-    adc_done = 0;
+    frame_queue.clear();
+    
+    #ifdef STANDBY_MODE
+    if(wake_pending){
+      wake_pending = 0;
+      DEBUG_LOG(DLOG("Wake to first frame: %lu us", micros() - wake_time);,
+                Serial.print("Wake to first frame: "); Serial.print(micros() - wake_time); Serial.println(" us");)
+    }
+    if(leds_on > 0) last_sound_time = millis();
+    else if(millis() - last_sound_time > STANDBY_SILENCE_TIME) enterStandby();
+    #endif
   }  
 }
 
-/* Basically blinks a led every certain amount of time
- This method should be changed for a sleep mode of the max32620 */
-void idleModeOperation(void){
+#ifdef LED_STRIP_MODE
+/* A bar for each band, lit from env_bias up to 2*threshold_values over it
+   Only the targets are set, the renderer fades the pixels to them */
+void showLedStrip(void){
+  #ifdef COUPLED_MODE
+  const int strip_bands = 5;
+  #else
+  const int strip_bands = 10;
+  #endif
+  const int segment = LED_STRIP_PIXELS/strip_bands;
   
-  if( millis() - last_time_led_idle > TIME_LED_ON_IDLE){
-    digitalWrite(P2_5, HIGH);        
+  for(int i=0; i<strip_bands; i++){
+    float32_t level = (bands[i]-env_bias[i])/(2*threshold_values[i]);
+    if(level > 1.0f) level = 1.0f;
+    int lit = (level > 0.0f) ? (int)(level*segment + 0.5f) : 0;
+    const uint8_t *color = strip_colors[(strip_bands == 5) ? i : i/2];
+    // Every pixel is written, the renderer never sees a cleared bar
+    ledRenderFillTarget(i*segment, lit, color[0], color[1], color[2]);
+    ledRenderFillTarget(i*segment + lit, segment - lit, 0, 0, 0);
+  }
+}
+#endif
+
+#ifdef TELEMETRY_MODE
+/* Sends the bands of the last frame, and the state of the leds */
+void sendTelemetry(void){
+  telemetry_frame_t frame;
+  frame.timestamp = micros();
+  frame.bands = bands;
+  #ifdef COUPLED_MODE
+  frame.bands_count = 5;
+  #else
+  frame.bands_count = 10;
+  #endif
+  frame.leds = ledsState();
+  #ifdef TELEMETRY_RAW_COPY
+  // The copy may hold a later frame, taken while this one was processed.
+  // The raw block is left out then, the bands would not match the samples
+  telemetry_raw_locked = 1;
+  while(pmuChannelActive(copy_channel)) {}
+  if(telemetry_raw_number == frame_number){
+    frame.raw = telemetry_raw;
+    frame.raw_count = AMOUNT_SAMPLES;
+  }
+  else{
+    frame.raw = NULL;
+    frame.raw_count = 0;
+  }
+  #elif TELEMETRY_BLOCKS & TELEMETRY_BLOCK_RAW
+  frame.raw = adc_acquired_data;
+  frame.raw_count = AMOUNT_SAMPLES;
+  #else
+  frame.raw = NULL;
+  frame.raw_count = 0;
+  #endif
+  #if TELEMETRY_BLOCKS & TELEMETRY_BLOCK_MAGNITUDE
+  frame.magnitude = fft_result_mag;
+  frame.magnitude_count = AMOUNT_SAMPLES/2;
+  #else
+  frame.magnitude = NULL;
+  frame.magnitude_count = 0;
+  #endif
+  #if TELEMETRY_BLOCKS & TELEMETRY_BLOCK_SPECTRUM
+  frame.spectrum_length = spectrumCodecEncode(&spectrum_codec, fft_result_mag, spectrum_encoded);
+  frame.spectrum = spectrum_encoded;
+  frame.spectrum_cycles = spectrum_codec.last_cycles;
+  #else
+  frame.spectrum = NULL;
+  frame.spectrum_length = 0;
+  frame.spectrum_cycles = 0;
+  #endif
+  if(telemetrySendFrame(&frame, TELEMETRY_PORT) == 0){
+    #if TELEMETRY_BLOCKS & TELEMETRY_BLOCK_SPECTRUM
+    // Dropped (the async buffers were busy): the host never gets the reference
+    // of the next deltas, so the next frame is a keyframe
+    spectrumCodecReset(&spectrum_codec);
+    #endif
   }
+  #ifdef TELEMETRY_RAW_COPY
+  telemetry_raw_locked = 0;
+  #endif
+}
+
+/* Bit i is set if music_leds_array[i] is on
+   The pins are read back, so the state of every mode (in house included) is reported
+   With PMU_LED_MODE the pins still show the previous frame, the state published is used */
+uint16_t ledsState(void){
+  uint16_t state = 0;
+  for(int i=0; i<10; i++){
+    #ifdef PMU_LED_MODE
+    if(ledCommitGet(music_leds_array[i])) state |= (1 << i);
+    #else
+    if(digitalRead(music_leds_array[i])) state |= (1 << i);
+    #endif
+  }
+  return state;
+}
+#endif
+
+/* Loads the counters and the pointers of the capture program, from the first sample
+   Returns the program to start on adc_channel */
+const uint32_t *prepareCapture(void){
+  const uint32_t *program;
+  // Load the Counter0 of the channel to acquire the number of samples
+  PMU_SetCounter(adc_channel, 0, AMOUNT_SAMPLES-1);
+  #ifdef DUAL_CHANNEL_MODE
+  pmu_program_dual[13] = (uint32_t)&(adc_acquired_data[0]);
+  pmu_program_dual[44] = (uint32_t)&(adc_acquired_data_b[0]);
+  program = pmu_program_dual;
+  #elif defined(OVERSAMPLING_MODE)
+  // And Counter1 with the conversions of each sample
+  PMU_SetCounter(adc_channel, 1, OVERSAMPLING_FACTOR-1);
+  pmu_program_oversampling[13] = (uint32_t)&(adc_oversampled_data[0]);
+  pmu_program_oversampling[26] = (uint32_t)&(MXC_PMU0[adc_channel].loop);
+  program = pmu_program_oversampling;
+  #else
+  pmu_program[13] = (uint32_t)&(adc_acquired_data[0]);
+  #if BAND_ENGINE == BAND_ENGINE_BIQUAD
+  biquad_read_index = 0;
+  #endif
+  program = pmu_program;
+  #endif
+  #ifdef ACTIVITY_MODE
+  // The gap goes back to this program, and counts with the Counter1 of the channel
+  pmu_program_gap[4] = (uint32_t)program;
+  pmu_program_gap[6] = (uint32_t)&(MXC_PMU0[adc_channel].loop);
+  pmu_program_gap[24] = (uint32_t)program;
+  setCaptureGap(activityDivider());
+  #endif
+  return program;
+}
+
+#ifdef ACTIVITY_MODE
+/* Spaces the captured frames by "divider" frame periods: the PMU converts
+   (divider - 1) frames without storing them after each frame, and the core
+   sleeps in loop() meanwhile. 1 captures every frame
+   The PMU reads the new value at the end of the next frame */
+void setCaptureGap(uint8_t divider){
+  uint32_t conversions = (uint32_t)(divider - 1)*AMOUNT_SAMPLES;
+  pmu_program_gap[7] = conversions ? ((conversions - 1) << MXC_F_PMU_LOOP_COUNTER_1_POS) : 0;
+}
+#endif
+
+/* Starts the PMU program that captures the frames, from the first sample */
+void startCapture(void){
+  pmuChannelStart(adc_channel, prepareCapture(), Process_ADC_Data); 
+}
+
+#ifdef STANDBY_MODE
+/* Sleeps in LP2 until there is sound again, the ADC keeps converting with
+   the PMU and the limits are checked by the hardware.
+   LP1 and LP0 power down the ADC, only GPIO, RTC and USB can wake from them */
+void enterStandby(void){
+  DEBUG_LOG(DLOG("Standby");, Serial.println("Standby");)
+  turnOffLeds();
+  #ifdef LED_STRIP_MODE
+  // The refresh timer would wake the core
+  ledRenderStop();
+  #endif
+  #ifdef PMU_LED_MODE
+  // No frames in standby, the leds are turned off by the core
+  ledCommitStop();
+  #endif
+  pmuChannelStop(adc_channel);
+  frame_queue.clear();
+  
+  // Silence level, used to place the limits
+  uint32_t silence = 0;
+  uint16_t sample;
+  for(int i = 0; i<16; i++){
+    ADC_StartConvert(STANDBY_CHANNEL, 0, 1);
+    ADC_GetData(&sample);
+    silence += sample;
+  }
+  silence /= 16;
+  ADC_SetLimit(ADC_LIMIT_0, STANDBY_CHANNEL, 
+               silence > STANDBY_LIMIT_MARGIN, silence - STANDBY_LIMIT_MARGIN,
+               1, silence + STANDBY_LIMIT_MARGIN);
+  ADC_ClearFlags(MXC_F_ADC_INTR_ADC_HI_LIMIT_IF | MXC_F_ADC_INTR_ADC_LO_LIMIT_IF);
   
-  if( millis() - last_time_led_idle > TIME_IDLE_SEQUENCE_TOTAL){
+  standby_wake = 0;
+  attachInterrupt(BOOT_BUTTON, Standby_Button, FALLING);
+  pmuChannelStart(adc_channel, pmu_program_standby, Standby_Wake);
+  // The capture starts again by itself as soon as there is sound
+  pmuChannelChain(adc_channel, prepareCapture(), Process_ADC_Data);
+  // The systick would wake the core every millisecond
+  SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+  while(!standby_wake) LP_EnterLP2();
+  SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+  wake_time = micros();
+  
+  detachInterrupt(BOOT_BUTTON);
+  ADC_SetLimit(ADC_LIMIT_0, STANDBY_CHANNEL, 0, 0, 0, 0);
+  #ifdef AUTO_RANGE_MODE
+  // Standby used the divided input
+  autoRangeInit();
+  #endif
+  
+  // Back to full processing
+  #ifdef LED_STRIP_MODE
+  ledRenderStart();
+  #endif
+  #ifdef PMU_LED_MODE
+  ledCommitStart();
+  #endif
+  // Woken by the button, the standby program may still be waiting for sound
+  if(standby_wake != 1){
+    pmuChannelStop(adc_channel);
+    frame_queue.clear();
+    startCapture();
+  }
+  wake_pending = 1;
+  last_sound_time = millis();
+  DEBUG_LOG(DLOG("Wake");, Serial.println("Wake");)
+}
+#endif
+
+#ifdef PT_IDLE_MODE
+/* The pulse trains play the animations while the core sleeps in LP2
+   Only the boot button wakes it, the capture is stopped meanwhile
+   Nothing else runs while the core sleeps, there are no frames */
+uint8_t idleModeOperation(task_t *task){
+  TASK_BEGIN(task);
+  for(;;){
+    turnOffLeds();
+    #ifdef PMU_LED_MODE
+    // The pulse trains take the leds
+    ledCommitStop();
+    #endif
+    pmuChannelStop(adc_channel);
+    #ifdef LED_STRIP_MODE
+    ledRenderStop();
+    #endif
+    idleAnimationStart(IDLE_ANIMATIONS, music_leds_array, 10, BUILTIN_GREEN);
+    
+    idle_wake = 0;
+    attachInterrupt(BOOT_BUTTON, Idle_Button, FALLING);
+    // The systick would wake the core every millisecond
+    SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+    while(!idle_wake && digitalRead(BOOT_BUTTON)) LP_EnterLP2();
+    SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+    detachInterrupt(BOOT_BUTTON);
+    
+    idleAnimationStop();
+    #ifdef LED_STRIP_MODE
+    ledRenderStart();
+    #endif
+    #ifdef PMU_LED_MODE
+    ledCommitStart();
+    #endif
+    frame_queue.clear();
+    startCapture();
+    #ifdef STANDBY_MODE
+    last_sound_time = millis();
+    #endif
+    // The button task selects the mode
+    TASK_YIELD(task);
+  }
+  TASK_END(task);
+}
+#else
+/* Basically blinks a led every certain amount of time
+ This method should be changed for a sleep mode of the max32620 */
+uint8_t idleModeOperation(task_t *task){
+  TASK_BEGIN(task);
+  for(;;){
+    TASK_WAIT_UNTIL(task, millis() - last_time_led_idle > TIME_LED_ON_IDLE);
+    digitalWrite(P2_5, HIGH);        
+    
+    TASK_WAIT_UNTIL(task, millis() - last_time_led_idle > TIME_IDLE_SEQUENCE_TOTAL);
     // Turn of the leds, in case these are ON 
     turnOffLeds();
     digitalWrite(P2_5, LOW);
     last_time_led_idle = millis();    
   }
+  TASK_END(task);
 }
+#endif
 
 /* Method used to calibrate the default sound of the environment
- * Takes 50 sets of measurements, 
+ * Takes 50 sets of measurements, see band_levels.h
 */
-void calibrateVariables(){
-  float32_t auxBias[10];
-  // Erase previously saved values
-  for(int i=0; i<10; i++){
-    auxBias[i] = 0.0f;
-  }
+uint8_t calibrateVariables(task_t *task){
+  // Kept across the wait points
+  static band_calibration_t calibration;
+  static int done;
+  TASK_BEGIN(task);
+  bandCalibrationBegin(&calibration, BAND_SETS_PER_FRAME);
   
-  /* For some reason, the first two set of variables are not valid
-     Discard the 5 first set of values to avoid possible errors
-  */
-  for(int i = 0; i<55; i++){
+  do{
     // Wait until a new set of value is obtained
-    while(!adc_done);
+    TASK_WAIT_UNTIL(task, bandsAvailable());
     
-    // Process the new set of data
+    // Process the new set of data, and add it to the average
     updateSoundBands();
-    
-    // Save the values to the array of bias
-    if(i>4){
-      #ifdef COUPLED_MODE
-      for(int j = 0; j<5; j++){
-        auxBias[j] = auxBias[j] + bands[j]; 
-      }
-      #else
-      for(int j = 0; j<10; j++){
-        auxBias[j] = auxBias[j] + bands[j]; 
-      }
-      #endif
-    }
+    done = bandCalibrationAdd(&calibration, bands, env_bias);
     
     // Allow the system to process the next set of data
-    adc_done = 0;
-  }  
+    frame_queue.clear();
+  }while(!done);
   
-  // After 50 iterations, divide the bias values by 50
-  delay(100);
+  TASK_DELAY(task, 100);
   Serial.println("New average values");  
-  #ifdef COUPLED_MODE
-  for(int k = 0; k <5; k++){    
-    env_bias[k] = auxBias[k]/50; 
+  for(int k = 0; k <BAND_LEVEL_BANDS; k++){    
     Serial.print("Band "); Serial.print(k); Serial.print(": ");
     Serial.println(env_bias[k], 2);
   }
-  #else
-  for(int k = 0; k <10; k++){    
-    env_bias[k] = auxBias[k]/50; 
-    Serial.print("Band "); Serial.print(k); Serial.print(": ");
-    Serial.println(env_bias[k], 2);
-  }
-  #endif
   
   // Restore the system to IDLE mode
-  current_mode = IDLE_MODE;
   last_time_led_idle = millis();
+  setMode(IDLE_MODE);
+  TASK_END(task);
 }
 
 /* Method used to power off the system */
-void powerOff(){
+uint8_t powerOff(task_t *task){
+  TASK_BEGIN(task);
   Serial.println("Powering off...");
   digitalWrite(P2_2, LOW);
   // If using USB as power, output some text to the serial port
   // blink a red led, and continue  
   digitalWrite(LED_BUILTIN, LOW);
-  delay(1000);
+  TASK_DELAY(task, 1000);
   digitalWrite(LED_BUILTIN, HIGH);
-  delay(1000);
+  TASK_DELAY(task, 1000);
   digitalWrite(LED_BUILTIN, LOW);
-  delay(1000);
+  TASK_DELAY(task, 1000);
   digitalWrite(LED_BUILTIN, HIGH);
-  delay(1000);
-  current_mode = IDLE_MODE;
+  TASK_DELAY(task, 1000);
   last_time_led_idle = millis();
   Serial.println("Leaving power off...");
+  setMode(IDLE_MODE);
+  TASK_END(task);
 }
 
 /* Mode used to print in the screen the frequency bands, 
    specifically, it is output the changes in armonics content
    measured from 300 samples. "Change" is measured as the current
    magnitude, substracted from the previous magnitude*/
-void armonicsTest(){
-  float32_t aux_change[AMOUNT_SAMPLES/2];
-  float32_t previous[AMOUNT_SAMPLES/2];
-  float32_t aux_total[AMOUNT_SAMPLES/2];
+uint8_t armonicsTest(task_t *task){
+  // Kept across the wait points
+  static float32_t aux_change[ARMONICS_COUNT];
+  static float32_t previous[ARMONICS_COUNT];
+  static float32_t aux_total[ARMONICS_COUNT];
+  static int i;
+  TASK_BEGIN(task);
   Serial.println("Starting armonics test");
   
   // Init the arrays to 0
-  for(int i=0; i<(AMOUNT_SAMPLES/2); i++){
+  for(i=0; i<ARMONICS_COUNT; i++){
     aux_change[i] = 0.0f;
     previous[i] = 0.0f;
     aux_total[i] = 0.0f;
@@ -560,9 +1308,9 @@ void armonicsTest(){
   /* For some reason, the first two set of variables are not valid
      Discard the 5 first set of values to avoid possible errors
   */
-  for(int i = 0; i<305; i++){
+  for(i = 0; i<305*BAND_SETS_PER_FRAME; i++){
     // Wait until a new set of value is obtained
-    while(!adc_done);
+    TASK_WAIT_UNTIL(task, bandsAvailable());
     
     // Process the new set of data
     updateSoundBands();
@@ -570,13 +1318,13 @@ void armonicsTest(){
     // Save the current complex value to the current array
     
     
-    if(i>4){      
+    if(i>=5*BAND_SETS_PER_FRAME){      
       // Substract the current value vs the previous
-      arm_sub_f32	(	previous, fft_result_mag, aux_change, AMOUNT_SAMPLES/2);	
+      arm_sub_f32	(	previous, ARMONICS_VALUES, aux_change, ARMONICS_COUNT);	
       // Get the absolute value of this change
-      arm_abs_f32	(	aux_change, aux_change, AMOUNT_SAMPLES/2);	      
+      arm_abs_f32	(	aux_change, aux_change, ARMONICS_COUNT);	      
       // Add it to a "total" vector
-      arm_add_f32	(	aux_change, aux_total, aux_total, AMOUNT_SAMPLES/2);		
+      arm_add_f32	(	aux_change, aux_total, aux_total, ARMONICS_COUNT);		
       
       /*
       for(int j = 0; j <8; j++){        
@@ -591,39 +1339,77 @@ void armonicsTest(){
     
     
     /* Save the processed complex vector as "previous"
-       Number of bytes is AMOUNT_SAMPLES/2*4*/
-    memcpy ( previous, fft_result_mag, AMOUNT_SAMPLES*2);
+       Number of bytes is ARMONICS_COUNT*4*/
+    memcpy ( previous, ARMONICS_VALUES, ARMONICS_COUNT*sizeof(float32_t));
     
     // Allow the system to process the next set of data
-    adc_done = 0;
+    frame_queue.clear();
   }  
   
   // Print the array of measured changes
   // Init the arrays to 0
-  for(int i=0; i<(AMOUNT_SAMPLES/2); i++){
+  for(int i=0; i<ARMONICS_COUNT; i++){
     if(i%8==0) Serial.println("");
     Serial.print(aux_total[i]); Serial.print(" ");
   }  
   
     // Restore the system to IDLE mode
-  current_mode = IDLE_MODE;
   last_time_led_idle = millis();
-  
+  setMode(IDLE_MODE);
+  TASK_END(task);
 }
 
 /* Operates on the adc data to obtain magnitude of sound 
    perceived in different bands */
 void updateSoundBands(void){
+    #if BAND_ENGINE == BAND_ENGINE_BIQUAD
+    uint16_t write_index = pmuWriteIndex();
+    // The PMU buffer is circular, filter up to its end first if it wrapped
+    if(write_index < biquad_read_index){
+      biquadBankProcess(&adc_acquired_data[biquad_read_index], AMOUNT_SAMPLES - biquad_read_index, bands);
+      biquad_read_index = 0;
+    }
+    biquadBankProcess(&adc_acquired_data[biquad_read_index], write_index - biquad_read_index, bands);
+    biquad_read_index = write_index;
+    #elif defined(DUAL_CHANNEL_MODE)
+    // Both channels in a single complex FFT
+    dualChannelSpectrum(adc_acquired_data, adc_acquired_data_b, 0.005376344086f, fft_result_mag, fft_result_mag_b);
+    // Even bands follow channel A and odd bands channel B, using the coupled split
+    // At half the sample rate these bins are an octave lower than in mono mode
+    for(int i = 0; i<5; i++){
+      uint32_t first = band_table_coupled[i][0];
+      uint32_t count = band_table_coupled[i][1] - first;
+      arm_rms_f32(&fft_result_mag[first], count, &bands[2*i]);
+      arm_rms_f32(&fft_result_mag_b[first], count, &bands[2*i+1]);
+    }
+    #else
+    #ifdef OVERSAMPLING_MODE
+    decimateSamples();
+    #endif
+    #ifdef AUTO_RANGE_MODE
+    // Converts to volts with the gain of the current range, and keeps the
+    // previous bands if the frame was captured while changing range
+    if(!autoRangeConvert(adc_acquired_data, process_buffer, AMOUNT_SAMPLES)) return;
+    #else
       // Move the data to the processing buffer
     for(int i = 0; i<AMOUNT_SAMPLES; i++){
       // 5.5/1023.0 = 0.00537634408602150537634408602151
       process_buffer[i] = (float) adc_acquired_data[i];// * 0.005376344086;   
-      process_buffer[i] *= 0.005376344086; 
+      process_buffer[i] *= ADC_COUNT_SCALE; 
     }    
+    #endif
     
+    #if BAND_ENGINE == BAND_ENGINE_MULTIRES
+    // Bass and treble are analyzed with different resolutions, see multires_analyzer.h
+    #ifdef COUPLED_MODE
+    multiresProcess(process_buffer, bands, 5);
+    #else
+    multiresProcess(process_buffer, bands, 10);
+    #endif
+    #else
     // Init the RFFT system
     //arm_rfft_fast_f32(&arm_rfft_fast_sR_f32_len2048, process_buffer, fft_result, 0);
-    arm_rfft_fast_f32(&fft_instance, process_buffer, fft_result, 0);    
+    fftEngineRun(&fft_engine, process_buffer, fft_result);
     arm_cmplx_mag_f32(fft_result, fft_result_mag, fftSize);
     
     /* Calculate RMS of frequency bands 
@@ -650,25 +1436,70 @@ void updateSoundBands(void){
     arm_rms_f32	(	&fft_result_mag[210], 23, &bands[8]); 
     arm_rms_f32	(	&fft_result_mag[233], 47, &bands[9]);
     #endif
+    #endif
+    #endif
         
     // Apply log scale to the results
-    bands[0] = 16 * log2(bands[0]);
-    bands[1] = 16 * log2(bands[1]);
-    bands[2] = 16 * log2(bands[2]);
-    bands[3] = 16 * log2(bands[3]);
-    bands[4] = 16 * log2(bands[4]);    
-    #ifndef COUPLED_MODE
-    bands[5] = 16 * log2(bands[5]);
-    bands[6] = 16 * log2(bands[6]);
-    bands[7] = 16 * log2(bands[7]);
-    bands[8] = 16 * log2(bands[8]);
-    bands[9] = 16 * log2(bands[9]);
-    #endif
+    bandLevelLog(bands, BAND_LEVEL_BANDS);
+}
+
+/* Returns 1 when the selected band engine has new data to update the bands */
+int bandsAvailable(void){
+  #if BAND_ENGINE == BAND_ENGINE_BIQUAD
+  uint16_t pending = (pmuWriteIndex() + AMOUNT_SAMPLES - biquad_read_index) % AMOUNT_SAMPLES;
+  return (pending >= BIQUAD_BLOCK);
+  #else
+  return !frame_queue.isEmpty();
+  #endif
+}
+
+/* Takes the number of the newest frame from frame_queue, adc_acquired_data holds that one
+   The older numbers, and the ones cleared since the last frame, count as dropped */
+void takeFrame(void){
+  uint16_t number;
+  while(frame_queue.pop(number)){
+    frames_dropped += (uint16_t)(number - frame_number - 1);
+    frame_number = number;
+  }
+}
+
+/* Index of the next sample the PMU is going to write in adc_acquired_data
+   Taken from the write address of the MOVE instruction, the program updates it by itself */
+uint16_t pmuWriteIndex(void){
+  uint32_t offset = pmu_program[13] - (uint32_t)&(adc_acquired_data[0]);
+  return (offset / 4) % AMOUNT_SAMPLES;
+}
+
+#ifdef OVERSAMPLING_MODE
+/* Adds the conversions taken by the PMU for each sample of the frame */
+void decimateSamples(void){
+  const uint16_t *conversions = adc_oversampled_data;
+  for(int i = 0; i<AMOUNT_SAMPLES; i++){
+    uint32_t sum = 0;
+    for(int j = 0; j<OVERSAMPLING_FACTOR; j++) sum += *conversions++;
+    adc_acquired_data[i] = sum;
+  }
+}
+#endif
+
+/* Sets one of the funky leds, only staged for the PMU with PMU_LED_MODE */
+void musicLedWrite(int pin, int value){
+  #ifdef PMU_LED_MODE
+  ledCommitSet(pin, value);
+  #else
+  digitalWrite(pin, value);
+  #endif
 }
 
 /* Function used to turn off the funky leds*/
 void turnOffLeds(){
-  for (int i=0; i<10; i++) digitalWrite(music_leds_array[i], LOW); 
+  for (int i=0; i<10; i++) musicLedWrite(music_leds_array[i], LOW); 
+  #ifdef PMU_LED_MODE
+  ledCommitPublish();
+  #endif
+  #ifdef LED_STRIP_MODE
+  ledRenderClearTargets();
+  #endif
 }
 
 // Functions used for debugging purposes, can be removed any time 
@@ -746,4 +1577,71 @@ void printBands(void){
   Serial.println(bands[8]);
   Serial.println(bands[9]);
   #endif  
-}
\ No newline at end of file
+}
+
+// Print the statistics of the PMU channels in use, debug purposes
+void printPmuStats(void){
+  Serial.print("Frames: last "); Serial.print(frame_number);
+  Serial.print(", dropped "); Serial.println(frames_dropped);
+  for(int i=0; i<MXC_CFG_PMU_CHANNELS; i++){
+    if(!(pmuChannelsUsed() & (1 << i))) continue;
+    pmu_channel_stats_t stats;
+    pmuChannelStats(i, &stats);
+    Serial.print("PMU channel "); Serial.print(i);
+    Serial.print(": starts "); Serial.print(stats.starts);
+    Serial.print(", interrupts "); Serial.print(stats.interrupts);
+    Serial.print(", bus errors "); Serial.print(stats.bus_errors);
+    Serial.print(", timeouts "); Serial.println(stats.timeouts);
+  }
+}
+
+#ifdef FFT_AUTOTUNE_MODE
+/* Sends SERIAL_BENCHMARK_BYTES with write() and with writeAsync() at 921600 baud,
+   and prints the bytes per second against the 92160 of the line */
+void serialBenchmark(Print &out){
+  static uint8_t data[SERIAL_BENCHMARK_BYTES];
+  MXC_HardwareSerial &port = CONCAT(Serial, SERIAL_BENCHMARK_UART);
+  mxc_uart_regs_t *uart = MXC_UART_GET_UART(SERIAL_BENCHMARK_UART);
+  memset(data, 0x55, sizeof(data));
+  port.begin(921600);
+  int ring_free = port.availableForWrite();
+
+  for(int async = 0; async<2; async++){
+    uart_req_t req = {data, sizeof(data), 0, NULL};
+    uint32_t start = micros();
+    if(async) port.writeAsync(&req);
+    // In chunks, as the sketch prints
+    else for(int i = 0; i<SERIAL_BENCHMARK_BYTES; i += 64) port.write(data+i, 64);
+    // Until the last byte leaves the shift register
+    while(async && (req.num < req.len));
+    while((port.availableForWrite() < ring_free) || (UART_Busy(uart) != E_NO_ERROR));
+    uint32_t elapsed = micros() - start;
+
+    out.print(async ? "Serial writeAsync(): " : "Serial write(): ");
+    out.print((uint32_t)((uint64_t)SERIAL_BENCHMARK_BYTES*1000000/elapsed));
+    out.print(" bytes/s at 921600 baud, ");
+    out.print((uint32_t)((uint64_t)SERIAL_BENCHMARK_BYTES*1000000*100/elapsed/92160));
+    out.println("% of the line");
+  }
+  port.end();
+}
+#endif
+
+// Print the calls and time spent in each task, debug purposes
+void printTaskStats(void){
+  for(int i=0; i<schedulerCount(); i++){
+    task_t *task = schedulerTask(i);
+    Serial.print("Task "); Serial.print(task->name);
+    Serial.print(": runs "); Serial.print(task->runs);
+    Serial.print(", busy us "); Serial.println(task->busy_us);
+  }
+}
+
+#ifdef ACTIVITY_MODE
+// Print the frames checked and skipped by the activity detector, debug purposes
+void printActivityStats(void){
+  Serial.print("Activity: frames "); Serial.print(activityFrames());
+  Serial.print(", skipped "); Serial.print(activitySkipped());
+  Serial.print(", frame spacing "); Serial.println(activityDivider());
+}
+#endif
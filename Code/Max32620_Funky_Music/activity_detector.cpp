@@ -0,0 +1,75 @@
+/*
+ * Silence / activity detector run on the raw frames before the FFT
+ * See activity_detector.h
+ *
+*/
+
+/* **** Includes **** */
+#include "activity_detector.h"
+
+/* **** Globals **** */
+static uint32_t frames = 0;
+static uint32_t skipped = 0;
+static uint8_t divider = 1;
+static uint16_t quiet_frames = 0;
+// Level of the signal (DC), taken from the previous checked frame
+static int32_t level = 0;
+
+/* Single pass over the frame: RMS around the previous level, and crossings of it */
+static int frameIsActive(const uint32_t *samples, int count, float32_t gain){
+  int32_t sum = 0;
+  uint64_t sum_squares = 0;
+  int crossings = 0;
+  int previous_sign = ((int32_t)samples[0] >= level);
+
+  for(int i = 0; i<count; i++){
+    int32_t value = (int32_t)samples[i] - level;
+    sum += value;
+    sum_squares += (uint64_t)((int64_t)value * value);
+    int sign = (value >= 0);
+    crossings += (sign != previous_sign);
+    previous_sign = sign;
+  }
+
+  float32_t mean = (float32_t)sum / count;
+  float32_t variance = (float32_t)sum_squares / count - mean*mean;
+  float32_t rms;
+  arm_sqrt_f32(variance > 0.0f ? variance : 0.0f, &rms);
+  level += (int32_t)mean;
+
+  // The same sound gives "gain" times more counts in the sensitive ranges
+  float32_t threshold = ACTIVITY_RMS_THRESHOLD*gain;
+  if(rms < threshold) return 0;
+  if(rms < 2*threshold && crossings > ACTIVITY_MAX_ZERO_CROSS*count) return 0;
+  return 1;
+}
+
+int activityProcessFrame(const uint32_t *samples, int count, float32_t gain){
+  frames++;
+
+  if(frameIsActive(samples, count, gain)){
+    divider = 1;
+    quiet_frames = 0;
+    return 1;
+  }
+
+  // Space the frames more while the silence lasts
+  if(++quiet_frames >= ACTIVITY_QUIET_FRAMES && divider < ACTIVITY_MAX_DIVIDER){
+    divider *= 2;
+    quiet_frames = 0;
+  }
+  skipped++;
+  return 0;
+}
+
+uint32_t activityFrames(void){
+  return frames;
+}
+
+uint32_t activitySkipped(void){
+  return skipped;
+}
+
+uint8_t activityDivider(void){
+  return divider;
+}
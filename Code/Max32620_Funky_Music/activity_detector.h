@@ -0,0 +1,45 @@
+/*
+ * Silence / activity detector run on the raw frames before the FFT
+ * A frame is active when its RMS (around the level of the previous frames)
+ * is over ACTIVITY_RMS_THRESHOLD, and it is not just low level noise,
+ * which crosses the level in almost every sample.
+ * Silent frames skip the FFT. Every frame captured is checked, during long
+ * silences the capture itself slows down: activityDivider() is the spacing
+ * of the frames the sketch gives to the PMU (2, 4 or 8 frame periods), and
+ * the core sleeps in between, so the CPU time follows the audio activity.
+ *
+*/
+
+#ifndef ACTIVITY_DETECTOR_H
+#define ACTIVITY_DETECTOR_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "arm_math.h"
+
+/* **** Definitions **** */
+// Minimum RMS of an active frame, in ADC counts of the divided input (ADC_CH_0_DIV_5)
+#define ACTIVITY_RMS_THRESHOLD    3.0f
+// Frames under 2*ACTIVITY_RMS_THRESHOLD crossing the level more often than this are noise
+#define ACTIVITY_MAX_ZERO_CROSS   0.4f
+
+// Silent frames in a row before doubling the spacing of the frames
+#define ACTIVITY_QUIET_FRAMES     32
+// Maximum spacing of the frames during silence, in frame periods
+#define ACTIVITY_MAX_DIVIDER      8
+
+/* **** Function Prototypes **** */
+
+/* Returns 1 if the frame has to be processed (FFT and bands), 0 to skip it
+   "gain" is the one of the input range against the divided input (see
+   autoRangeGain), the thresholds are scaled by it */
+int activityProcessFrame(const uint32_t *samples, int count, float32_t gain);
+
+/* Frames checked and frames skipped since boot, the skip ratio is skipped/frames */
+uint32_t activityFrames(void);
+uint32_t activitySkipped(void);
+
+/* Spacing of the frames to capture, in frame periods, 1 while there is sound */
+uint8_t activityDivider(void);
+
+#endif /* ACTIVITY_DETECTOR_H */
@@ -0,0 +1,118 @@
+/*
+ * Auto ranging of the ADC input
+ * See auto_range.h
+ *
+*/
+
+/* **** Includes **** */
+#include "auto_range.h"
+#include "mxc_config.h"
+#include "adc.h"
+
+/* **** Definitions **** */
+typedef struct {
+  mxc_adc_chsel_t channel;
+  uint8_t adc_scale;
+  // Gain against the divided input, nominal values of the input ranges
+  float32_t gain;
+} adc_range_t;
+
+// Volts per count of the divided input, 5.5/1023.0
+#define VOLTS_PER_COUNT 0.005376344086f
+
+/* **** Globals **** */
+// Sorted from the least to the most sensitive
+static const adc_range_t ranges[] = {
+  {ADC_CH_0_DIV_5, 1, 1.0f},
+  {ADC_CH_0, 1, 2.5f},
+  {ADC_CH_0, 0, 5.0f},
+};
+#define RANGES_COUNT (sizeof(ranges)/sizeof(ranges[0]))
+
+static uint8_t current_range = 0;
+static float32_t volts_per_count = VOLTS_PER_COUNT;
+static uint16_t quiet_frames = 0;
+static uint8_t settling = 0;
+static uint16_t last_clipped = 0;
+static uint16_t last_near_full = 0;
+
+/* Changes the input of the running conversions
+   The PMU only sets the start bit, so the new channel is used from the next conversion */
+static void applyRange(uint8_t range){
+  uint32_t ctrl = MXC_ADC->ctrl;
+  ctrl &= ~(MXC_F_ADC_CTRL_ADC_CHSEL | MXC_F_ADC_CTRL_ADC_SCALE | MXC_F_ADC_CTRL_CPU_ADC_START);
+  ctrl |= ((uint32_t)ranges[range].channel << MXC_F_ADC_CTRL_ADC_CHSEL_POS) & MXC_F_ADC_CTRL_ADC_CHSEL;
+  if(ranges[range].adc_scale) ctrl |= MXC_F_ADC_CTRL_ADC_SCALE;
+  MXC_ADC->ctrl = ctrl;
+
+  current_range = range;
+  volts_per_count = VOLTS_PER_COUNT / ranges[range].gain;
+  quiet_frames = 0;
+  // The frame being captured mixes both ranges
+  settling = 1;
+}
+
+void autoRangeInit(void){
+  applyRange(0);
+  settling = 0;
+}
+
+int autoRangeConvert(const uint32_t *samples, float32_t *out, int count){
+  uint32_t peak = 0;
+  uint16_t clipped = 0;
+  uint16_t near_full = 0;
+
+  // Statistics are taken in the same pass that converts the samples
+  for(int i = 0; i<count; i++){
+    uint32_t raw = samples[i];
+    if(raw > peak) peak = raw;
+    if(raw >= AUTO_RANGE_NEAR_FULL){
+      near_full++;
+      if(raw >= AUTO_RANGE_CLIP_HIGH) clipped++;
+    }
+    else if(raw <= AUTO_RANGE_CLIP_LOW){
+      clipped++;
+    }
+    out[i] = (float32_t)raw * volts_per_count;
+  }
+  last_clipped = clipped;
+  last_near_full = near_full;
+
+  if(settling){
+    settling = 0;
+    return 0;
+  }
+
+  // Too loud, go to a less sensitive range right away
+  if(clipped > AUTO_RANGE_MAX_CLIPPED || near_full > AUTO_RANGE_MAX_NEAR_FULL){
+    if(current_range > 0) applyRange(current_range - 1);
+    quiet_frames = 0;
+    return 1;
+  }
+
+  // Quiet enough for the next range during a while, go to it
+  if(current_range + 1 < RANGES_COUNT){
+    float32_t predicted = (float32_t)peak * ranges[current_range + 1].gain / ranges[current_range].gain;
+    if(predicted < AUTO_RANGE_HEADROOM) quiet_frames++;
+    else quiet_frames = 0;
+
+    if(quiet_frames >= AUTO_RANGE_HOLD_FRAMES) applyRange(current_range + 1);
+  }
+  return 1;
+}
+
+uint8_t autoRangeCurrent(void){
+  return current_range;
+}
+
+float32_t autoRangeGain(void){
+  return ranges[current_range].gain;
+}
+
+uint16_t autoRangeClipped(void){
+  return last_clipped;
+}
+
+uint16_t autoRangeNearFull(void){
+  return last_near_full;
+}
@@ -0,0 +1,56 @@
+/*
+ * Auto ranging of the ADC input
+ * The divided input (ADC_CH_0_DIV_5) wastes most of the 10 bits on quiet signals,
+ * and loud signals clip at 1023 with no indication. Clipped and near full scale
+ * samples are counted while each frame is converted to volts, and the input
+ * is switched between the divided and the direct input (with or without adc_scale).
+ * The samples are always given in volts, so the bands stay continuous
+ * across range changes.
+ *
+*/
+
+#ifndef AUTO_RANGE_H
+#define AUTO_RANGE_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "arm_math.h"
+
+/* **** Definitions **** */
+// Raw values considered clipped
+#define AUTO_RANGE_CLIP_HIGH      1020
+#define AUTO_RANGE_CLIP_LOW       3
+// Raw values considered near full scale
+#define AUTO_RANGE_NEAR_FULL      960
+
+// Go to a less sensitive range if a frame has more samples than these
+#define AUTO_RANGE_MAX_CLIPPED    2
+#define AUTO_RANGE_MAX_NEAR_FULL  16
+
+/* Go to a more sensitive range once the peak of the frame would stay below
+   this raw value in it, during AUTO_RANGE_HOLD_FRAMES frames in a row */
+#define AUTO_RANGE_HEADROOM       800
+#define AUTO_RANGE_HOLD_FRAMES    16
+
+/* **** Function Prototypes **** */
+
+/* Selects the least sensitive range (the divided input) */
+void autoRangeInit(void);
+
+/* Converts a frame of raw ADC words to volts with the current range,
+   and switches range if needed. Returns 0 if the frame has to be discarded,
+   because it was captured while the range was changing */
+int autoRangeConvert(const uint32_t *samples, float32_t *out, int count);
+
+/* Current range, 0 is the least sensitive */
+uint8_t autoRangeCurrent(void);
+
+/* Gain of the current range against the divided input, counts of the
+   same signal are multiplied by it */
+float32_t autoRangeGain(void);
+
+/* Clipped and near full scale samples of the last frame */
+uint16_t autoRangeClipped(void);
+uint16_t autoRangeNearFull(void);
+
+#endif /* AUTO_RANGE_H */
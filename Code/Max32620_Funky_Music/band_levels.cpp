@@ -0,0 +1,79 @@
+/*
+ * Levels of the bands, shared by the sketch and the FreeRTOS pipeline
+ * See band_levels.h
+ *
+*/
+
+/* **** Includes **** */
+#include <string.h>
+#include <math.h>
+#include "band_levels.h"
+
+/* **** Globals **** */
+const float32_t threshold_values[10] = {10, 10, 10, 10, 10,
+                                        10, 10, 10, 10, 10};
+
+const float32_t threshold_halves[10] = {3, 3, 3, 3, 3,
+                                        3, 3, 3, 3, 3};
+
+/* **** Functions **** */
+
+/* Leds of a band, the two leds of the pair in coupled mode */
+static uint16_t bandLeds(int band){
+  #ifdef COUPLED_MODE
+  return 3 << (2*band);
+  #else
+  return 1 << band;
+  #endif
+}
+
+void bandLevelLog(float32_t *bands, int count){
+  for(int i = 0; i<count; i++){
+    bands[i] = 16 * log2f(bands[i]);
+  }
+}
+
+uint16_t bandLevelLeds(const float32_t *bands, const float32_t *env_bias, int *bands_on){
+  uint16_t leds = 0;
+  int on = 0;
+
+  for(int i = 0; i<BAND_LEVEL_BANDS; i++){
+    if(bands[i] - env_bias[i] > threshold_values[i]){
+      leds |= bandLeds(i);
+      on++;
+    }
+  }
+
+  #ifdef IN_HOUSE_MODE
+  // If no led is on, test again with a lower threshold
+  if(on<1){
+    for(int i = 0; i<BAND_LEVEL_BANDS; i++){
+      if(bands[i] - env_bias[i] > threshold_halves[i]) leds |= bandLeds(i);
+    }
+  }
+  #endif
+
+  *bands_on = on;
+  return leds;
+}
+
+void bandCalibrationBegin(band_calibration_t *calibration, uint16_t sets_per_frame){
+  memset(calibration->sum, 0, sizeof(calibration->sum));
+  calibration->sets = 0;
+  calibration->sets_per_frame = sets_per_frame;
+}
+
+int bandCalibrationAdd(band_calibration_t *calibration, const float32_t *bands, float32_t *env_bias){
+  const uint16_t discarded = BAND_LEVEL_DISCARDED_FRAMES*calibration->sets_per_frame;
+  const uint16_t averaged = BAND_LEVEL_CALIBRATION_FRAMES*calibration->sets_per_frame;
+
+  /* For some reason, the first two set of variables are not valid
+     Discard the first ones to avoid possible errors */
+  if(calibration->sets >= discarded){
+    for(int i = 0; i<BAND_LEVEL_BANDS; i++) calibration->sum[i] += bands[i];
+  }
+  if(++calibration->sets < discarded + averaged) return 0;
+
+  for(int i = 0; i<BAND_LEVEL_BANDS; i++) env_bias[i] = calibration->sum[i]/averaged;
+  return 1;
+}
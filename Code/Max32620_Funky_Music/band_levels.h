@@ -0,0 +1,72 @@
+/*
+ * Levels of the bands, shared by the sketch and the FreeRTOS pipeline
+ * - The RMS of each band is taken to a log scale
+ * - The calibration averages the bands of the environment, after discarding
+ *   the first frames
+ * - A band over the environment by threshold_values turns on its leds. With
+ *   IN_HOUSE_MODE, when no band does, the bands over threshold_halves do
+ * The split of the bands (5 coupled, or 10) is the one of band_tables.h.
+ *
+*/
+
+#ifndef BAND_LEVELS_H
+#define BAND_LEVELS_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "arm_math.h"
+
+/* **** Definitions **** */
+/* Use two different modes, one with 10 singular lights
+ One with 5 "coupled" lights
+ Comment the following line in order to use the "single use" lights mode
+ */
+#define COUPLED_MODE 1
+/* Use a "in house mode" to rescan the signal if the first threshold did not give signals*/
+#define IN_HOUSE_MODE 1
+
+#ifdef COUPLED_MODE
+#define BAND_LEVEL_BANDS 5
+#else
+#define BAND_LEVEL_BANDS 10
+#endif
+// Music leds, two per band in coupled mode
+#define BAND_LEVEL_LEDS 10
+
+// Frames averaged as environment level, after discarding the first ones
+#define BAND_LEVEL_DISCARDED_FRAMES 5
+#define BAND_LEVEL_CALIBRATION_FRAMES 50
+
+typedef struct {
+  float32_t sum[BAND_LEVEL_BANDS];
+  // Sets of bands added, and sets given by each frame
+  uint16_t sets;
+  uint16_t sets_per_frame;
+} band_calibration_t;
+
+/* **** Globals **** */
+/* Constant values used to output music with the bands
+ * if current value - avg > threshold, turn on led
+*/
+extern const float32_t threshold_values[10];
+/* Constant values used to help the algorithm when the sound is low*/
+extern const float32_t threshold_halves[10];
+
+/* **** Function Prototypes **** */
+
+/* Takes the RMS of "count" bands to the log scale, in place */
+void bandLevelLog(float32_t *bands, int count);
+
+/* Leds of the bands over the environment, bit i on for the led i
+   bands_on gets the number of bands over threshold_values */
+uint16_t bandLevelLeds(const float32_t *bands, const float32_t *env_bias, int *bands_on);
+
+/* Starts measuring the environment, with the bands updated "sets_per_frame"
+   times in each frame */
+void bandCalibrationBegin(band_calibration_t *calibration, uint16_t sets_per_frame);
+
+/* Adds a set of bands to the calibration
+   Returns 1 when the environment is measured, and writes it to env_bias */
+int bandCalibrationAdd(band_calibration_t *calibration, const float32_t *bands, float32_t *env_bias);
+
+#endif /* BAND_LEVELS_H */
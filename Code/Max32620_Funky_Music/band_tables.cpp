@@ -0,0 +1,18 @@
+/*
+ * Frequency bands used by the analyzers that do not work over the frame FFT
+ * See band_tables.h
+ *
+*/
+
+/* **** Includes **** */
+#include "band_tables.h"
+
+/* **** Globals **** */
+const uint8_t band_table_coupled[5][2] = {
+  {10, 24}, {24, 48}, {48, 94}, {94, 112}, {112, 128}
+};
+
+const uint8_t band_table_single[10][2] = {
+  {10, 17}, {17, 24}, {24, 36}, {36, 48}, {48, 71},
+  {71, 94}, {94, 106}, {106, 117}, {117, 123}, {123, 128}
+};
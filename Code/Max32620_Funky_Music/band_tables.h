@@ -0,0 +1,24 @@
+/*
+ * Frequency bands used by the analyzers that do not work over the frame FFT
+ * Bands are described with the bins of a BAND_TABLE_FRAME_SIZE FFT,
+ * as {first bin, last bin + 1}, the same split used in the sketch.
+ * The sketch tables reach past the Nyquist bin (128), here the top bands
+ * share what is left up to it.
+ *
+*/
+
+#ifndef BAND_TABLES_H
+#define BAND_TABLES_H
+
+/* **** Includes **** */
+#include <stdint.h>
+
+/* **** Definitions **** */
+// FFT size the bins of the tables refer to
+#define BAND_TABLE_FRAME_SIZE 256
+
+/* **** Globals **** */
+extern const uint8_t band_table_coupled[5][2];
+extern const uint8_t band_table_single[10][2];
+
+#endif /* BAND_TABLES_H */
@@ -0,0 +1,178 @@
+/*
+ * Time domain band splitter, alternative to the frame FFT
+ * See biquad_bank.h
+ *
+*/
+
+/* **** Includes **** */
+#include <math.h>
+#include <string.h>
+#include "Arduino.h"
+#include "biquad_bank.h"
+#include "band_tables.h"
+
+/* **** Definitions **** */
+#define BIQUAD_MAX_BANDS 10
+// Quality factor of every section (butterworth)
+#define BIQUAD_Q 0.7071f
+
+// Tone of biquadBankLatency in ADC counts, around the middle of the 10 bits
+#define BIQUAD_LATENCY_MIDDLE    512
+#define BIQUAD_LATENCY_AMPLITUDE 200
+// Samples to settle, then averaged as the steady level of the tone
+#define BIQUAD_LATENCY_SETTLE    4096
+#define BIQUAD_LATENCY_LEVEL     1024
+// Longest latency looked for
+#define BIQUAD_LATENCY_MAX       4096
+
+/* **** Globals **** */
+/* Coefficients, same layout as arm_biquad_cascade_df1_f32: {b0, b1, b2, a1, a2}
+   with a1 and a2 already negated, y = b0*x0 + b1*x1 + b2*x2 + a1*y1 + a2*y2 */
+static float32_t coeffs[BIQUAD_MAX_BANDS][BIQUAD_BANK_STAGES][5];
+// State of every section: {x1, x2, y1, y2}
+static float32_t state[BIQUAD_MAX_BANDS][BIQUAD_BANK_STAGES][4];
+static float32_t envelope[BIQUAD_MAX_BANDS];
+static int bank_bands = 0;
+// State settled on silence, where every tone of biquadBankLatency starts
+static float32_t silent_state[BIQUAD_MAX_BANDS][BIQUAD_BANK_STAGES][4];
+static float32_t silent_envelope[BIQUAD_MAX_BANDS];
+
+/* Designs one section, "high" selects high pass or low pass
+   Frequency is given as a fraction of the sampling frequency */
+static void designSection(float32_t *c, float32_t frequency, int high){
+  // A low pass at (or close to) Nyquist lets everything through
+  if(!high && frequency >= 0.48f){
+    c[0] = 1.0f; c[1] = 0.0f; c[2] = 0.0f; c[3] = 0.0f; c[4] = 0.0f;
+    return;
+  }
+
+  float32_t w0 = 2.0f*PI*frequency;
+  float32_t cos_w0 = cosf(w0);
+  float32_t alpha = sinf(w0)/(2.0f*BIQUAD_Q);
+  float32_t a0 = 1.0f + alpha;
+
+  if(high){
+    c[0] = (1.0f + cos_w0)/2.0f;
+    c[1] = -(1.0f + cos_w0);
+  }
+  else{
+    c[0] = (1.0f - cos_w0)/2.0f;
+    c[1] = 1.0f - cos_w0;
+  }
+  c[2] = c[0];
+  c[3] = 2.0f*cos_w0;
+  c[4] = -(1.0f - alpha);
+
+  for(int i = 0; i<5; i++) c[i] /= a0;
+}
+
+void biquadBankInit(int band_count){
+  const uint8_t (*table)[2] = (band_count == 5) ? band_table_coupled : band_table_single;
+
+  bank_bands = band_count;
+  for(int i = 0; i<band_count; i++){
+    designSection(coeffs[i][0], (float32_t)table[i][0]/BAND_TABLE_FRAME_SIZE, 1);
+    designSection(coeffs[i][1], (float32_t)table[i][1]/BAND_TABLE_FRAME_SIZE, 0);
+  }
+  memset(state, 0, sizeof(state));
+  memset(envelope, 0, sizeof(envelope));
+}
+
+void biquadBankProcess(const uint32_t *samples, int count, float32_t *bands){
+  for(int n = 0; n<count; n++){
+    float32_t input = (float32_t)samples[n] * BIQUAD_ADC_SCALE;
+
+    for(int i = 0; i<bank_bands; i++){
+      float32_t x = input;
+      for(int s = 0; s<BIQUAD_BANK_STAGES; s++){
+        const float32_t *c = coeffs[i][s];
+        float32_t *st = state[i][s];
+        float32_t y = c[0]*x + c[1]*st[0] + c[2]*st[1] + c[3]*st[2] + c[4]*st[3];
+        st[1] = st[0];
+        st[0] = x;
+        st[3] = st[2];
+        st[2] = y;
+        x = y;
+      }
+
+      // Envelope follower, fast attack and slow release
+      float32_t level = fabsf(x);
+      float32_t k = (level > envelope[i]) ? BIQUAD_ATTACK : BIQUAD_RELEASE;
+      envelope[i] += k*(level - envelope[i]);
+    }
+  }
+
+  for(int i = 0; i<bank_bands; i++) bands[i] = envelope[i];
+}
+
+/* Sample "n" after the onset of a tone, frequency as a fraction of the sampling frequency */
+static uint32_t toneSample(float32_t frequency, int n){
+  return BIQUAD_LATENCY_MIDDLE + lroundf(BIQUAD_LATENCY_AMPLITUDE*sinf(2.0f*PI*frequency*n));
+}
+
+/* Back to the state settled on silence */
+static void restoreSilence(void){
+  memcpy(state, silent_state, sizeof(state));
+  memcpy(envelope, silent_envelope, sizeof(envelope));
+}
+
+int biquadBankLatency(int band_count){
+  const uint8_t (*table)[2] = (band_count == 5) ? band_table_coupled : band_table_single;
+  float32_t aux_bands[BIQUAD_MAX_BANDS];
+  uint32_t sample = BIQUAD_LATENCY_MIDDLE;
+  int latency = 0;
+
+  biquadBankInit(band_count);
+  for(int n = 0; n<BIQUAD_LATENCY_SETTLE; n++) biquadBankProcess(&sample, 1, aux_bands);
+  memcpy(silent_state, state, sizeof(state));
+  memcpy(silent_envelope, envelope, sizeof(envelope));
+
+  for(int i = 0; i<band_count; i++){
+    const float32_t frequency = 0.5f*(table[i][0] + table[i][1])/BAND_TABLE_FRAME_SIZE;
+
+    // Steady level of the tone, averaged as the envelope ripples
+    float32_t level = 0.0f;
+    restoreSilence();
+    for(int n = 0; n<BIQUAD_LATENCY_SETTLE + BIQUAD_LATENCY_LEVEL; n++){
+      sample = toneSample(frequency, n);
+      biquadBankProcess(&sample, 1, aux_bands);
+      if(n >= BIQUAD_LATENCY_SETTLE) level += aux_bands[i];
+    }
+    level /= BIQUAD_LATENCY_LEVEL;
+
+    // The same tone from silence, sample by sample up to half that level
+    int n = 0;
+    restoreSilence();
+    do{
+      sample = toneSample(frequency, n++);
+      biquadBankProcess(&sample, 1, aux_bands);
+    }while((aux_bands[i] < level/2) && (n < BIQUAD_LATENCY_MAX));
+    if(n > latency) latency = n;
+  }
+
+  biquadBankInit(band_count);
+  // The bands are refreshed every BIQUAD_BLOCK samples, the worst tone
+  // crosses the level on the first sample of a block
+  return latency + BIQUAD_BLOCK - 1;
+}
+
+void biquadBankBenchmark(int band_count, Print &out){
+  uint32_t samples[BIQUAD_BLOCK];
+  float32_t aux_bands[BIQUAD_MAX_BANDS];
+  for(int i = 0; i<BIQUAD_BLOCK; i++) samples[i] = (i & 0x08) ? 600 : 400;
+
+  // Enable the DWT cycle counter
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  // Warm blocks, as in the loop of the sketch
+  biquadBankInit(band_count);
+  for(int b = 0; b<BIQUAD_BENCH_BLOCKS; b++) biquadBankProcess(samples, BIQUAD_BLOCK, aux_bands);
+  uint32_t start = DWT->CYCCNT;
+  for(int b = 0; b<BIQUAD_BENCH_BLOCKS; b++) biquadBankProcess(samples, BIQUAD_BLOCK, aux_bands);
+  uint32_t cycles = DWT->CYCCNT - start;
+
+  out.print("Biquad bank: "); out.print(cycles/(BIQUAD_BENCH_BLOCKS*BIQUAD_BLOCK));
+  out.print(" cycles per sample, latency "); out.print(biquadBankLatency(band_count));
+  out.println(" samples");
+}
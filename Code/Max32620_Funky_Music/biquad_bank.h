@@ -0,0 +1,54 @@
+/*
+ * Time domain band splitter, alternative to the frame FFT
+ * Every band is a cascade of biquad sections (high pass at the lower edge,
+ * low pass at the upper edge) followed by an envelope follower.
+ * Samples are processed one by one as the PMU moves them to memory,
+ * so the bands are updated every BIQUAD_BLOCK samples instead of every frame.
+ *
+*/
+
+#ifndef BIQUAD_BANK_H
+#define BIQUAD_BANK_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "arm_math.h"
+#include "Print.h"
+
+/* **** Definitions **** */
+// Sections per band, high pass + low pass
+#define BIQUAD_BANK_STAGES  2
+
+// Samples processed before the bands are refreshed
+#define BIQUAD_BLOCK        32
+
+// Envelope follower coefficients, per sample
+#define BIQUAD_ATTACK       0.05f
+#define BIQUAD_RELEASE      0.002f
+
+// Conversion from ADC counts to volts, same as the FFT path (5.5/1023.0)
+#define BIQUAD_ADC_SCALE    0.005376344086f
+
+// Blocks timed by biquadBankBenchmark, after as many to warm up
+#define BIQUAD_BENCH_BLOCKS 64
+
+/* **** Function Prototypes **** */
+
+/* Designs the sections of "band_count" bands (5 coupled, or 10) from band_tables.h */
+void biquadBankInit(int band_count);
+
+/* Filters "count" raw ADC words and writes the envelope of every band */
+void biquadBankProcess(const uint32_t *samples, int count, float32_t *bands);
+
+/* Measures the latency of a bank of "band_count" bands: the samples from the
+   onset of a tone in the middle of a band to the refresh of the bands that
+   shows it over half its steady level, worst band, tone started at the worst
+   place of the block. The bank is left initialized and cleared */
+int biquadBankLatency(int band_count);
+
+/* Prints the cycles per sample of a bank of "band_count" bands, averaged over
+   BIQUAD_BENCH_BLOCKS blocks, and its latency (biquadBankLatency)
+   The bank is left initialized and cleared */
+void biquadBankBenchmark(int band_count, Print &out);
+
+#endif /* BIQUAD_BANK_H */
@@ -0,0 +1,99 @@
+/*
+ * Deferred binary logging
+ * See deferred_log.h
+ *
+*/
+
+/* **** Includes **** */
+#include "Arduino.h"
+#include "deferred_log.h"
+#include "telemetry.h"
+
+/* **** Definitions **** */
+#define RING_MASK (DEFERRED_LOG_RING_WORDS - 1)
+// Records sent in a single packet, at most
+#define LOG_PACKET_SIZE 256
+
+#if (DEFERRED_LOG_RING_WORDS & RING_MASK) != 0
+#error "DEFERRED_LOG_RING_WORDS has to be a power of 2"
+#endif
+
+/* **** Globals **** */
+static uint32_t ring[DEFERRED_LOG_RING_WORDS];
+// Free running, written with the interrupts disabled by the producers, and by the loop
+static volatile uint16_t ring_head = 0;
+static volatile uint16_t ring_tail = 0;
+static volatile uint32_t dropped = 0;
+static uint32_t dropped_sent = 0;
+static uint32_t log_packet[LOG_PACKET_SIZE/4];
+
+void deferredLogWrite(const char *format, uint32_t count, const uint32_t *args){
+  uint32_t timestamp = millis();
+  uint16_t words = 2 + count;
+
+  // Any interrupt can log, the record is reserved and written at once
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint16_t head = ring_head;
+  if((uint16_t)(head - ring_tail) + words > DEFERRED_LOG_RING_WORDS){
+    dropped++;
+    __set_PRIMASK(primask);
+    return;
+  }
+  ring[head & RING_MASK] = ((uint32_t)format & TELEMETRY_LOG_ADDRESS_MASK) | (count << TELEMETRY_LOG_COUNT_POS);
+  ring[(head + 1) & RING_MASK] = timestamp;
+  for(uint32_t i = 0; i<count; i++) ring[(head + 2 + i) & RING_MASK] = args[i];
+  __DMB();
+  ring_head = head + words;
+  __set_PRIMASK(primask);
+}
+
+static uint16_t flush(Print *out, MXC_HardwareSerial *port){
+  uint16_t sent = 0;
+
+  while(1){
+    // Nothing taken from the ring if the packet could not be sent
+    if(port && !telemetryAsyncFree()) break;
+    uint16_t head = ring_head;
+    __DMB();
+    uint16_t tail = ring_tail;
+    if(head == tail) break;
+
+    uint8_t *header = (uint8_t *)log_packet;
+    uint16_t length = TELEMETRY_LOG_HEADER_SIZE / 4;
+    uint8_t records = 0;
+    // Whole records, as many as fit in the packet
+    while(tail != head){
+      uint16_t words = 2 + (ring[tail & RING_MASK] >> TELEMETRY_LOG_COUNT_POS);
+      if(length + words > LOG_PACKET_SIZE/4) break;
+      for(uint16_t i = 0; i<words; i++) log_packet[length++] = ring[(tail + i) & RING_MASK];
+      tail += words;
+      records++;
+    }
+    __DMB();
+    ring_tail = tail;
+
+    uint32_t lost = dropped - dropped_sent;
+    dropped_sent += lost;
+    header[0] = TELEMETRY_PACKET_LOG;
+    header[1] = records;
+    header[2] = (uint8_t)(lost > 0xFFFF ? 0xFFFF : lost);
+    header[3] = (uint8_t)((lost > 0xFFFF ? 0xFFFF : lost) >> 8);
+    if(port) telemetrySendPacket((const uint8_t *)log_packet, 4*length, *port);
+    else telemetrySendPacket((const uint8_t *)log_packet, 4*length, *out);
+    sent += records;
+  }
+  return sent;
+}
+
+uint16_t deferredLogFlush(Print &out){
+  return flush(&out, NULL);
+}
+
+uint16_t deferredLogFlush(MXC_HardwareSerial &port){
+  return flush(NULL, &port);
+}
+
+uint32_t deferredLogDropped(void){
+  return dropped;
+}
@@ -0,0 +1,75 @@
+/*
+ * Deferred binary logging
+ * DEBUG_CMD(Serial.print(...)) formats the text and the floats on the MCU, in the
+ * middle of the processing. A DLOG("Wake: %lu us", t) site only stores the address
+ * of its format string, millis() and the raw arguments (one word each) in a ring,
+ * a few dozen cycles, from the loop or from an interrupt.
+ * deferredLogFlush sends the records later, in telemetry packets (TELEMETRY_PACKET_LOG),
+ * and the host rebuilds the text: the format strings are looked up at their address
+ * in the .elf of the build (Code/Host tools/telemetry_dump).
+ * Floats are sent as their bits, %s arguments have to be string literals (in flash).
+ *
+*/
+
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include <string.h>
+#include "Print.h"
+#include "MXC_HardwareSerial.h"
+#include "telemetry_protocol.h"
+
+/* **** Definitions **** */
+// Words of the ring, power of 2. A record takes 2 words plus one per argument
+#define DEFERRED_LOG_RING_WORDS 256
+#define DEFERRED_LOG_MAX_ARGS   4
+
+/* DLOG(format, arguments...), up to DEFERRED_LOG_MAX_ARGS arguments
+   The format has to be a string literal */
+#define DLOG(...) DLOG_SELECT(DLOG_COUNT(__VA_ARGS__, 4, 3, 2, 1, 0, _))(__VA_ARGS__)
+#define DLOG_COUNT(format, a, b, c, d, n, ...) n
+#define DLOG_SELECT(n) DLOG_PASTE(DLOG_, n)
+#define DLOG_PASTE(a, b) DLOG_PASTE_I(a, b)
+#define DLOG_PASTE_I(a, b) a##b
+#define DLOG_0(format) deferredLogWrite("" format, 0, 0)
+#define DLOG_1(format, a) do{ uint32_t _dlog_args[] = {dlogWord(a)}; \
+    deferredLogWrite("" format, 1, _dlog_args); }while(0)
+#define DLOG_2(format, a, b) do{ uint32_t _dlog_args[] = {dlogWord(a), dlogWord(b)}; \
+    deferredLogWrite("" format, 2, _dlog_args); }while(0)
+#define DLOG_3(format, a, b, c) do{ uint32_t _dlog_args[] = {dlogWord(a), dlogWord(b), dlogWord(c)}; \
+    deferredLogWrite("" format, 3, _dlog_args); }while(0)
+#define DLOG_4(format, a, b, c, d) do{ uint32_t _dlog_args[] = {dlogWord(a), dlogWord(b), dlogWord(c), dlogWord(d)}; \
+    deferredLogWrite("" format, 4, _dlog_args); }while(0)
+
+/* Raw word of each argument, the host reads it following the format */
+static inline uint32_t dlogWord(int value){ return (uint32_t)value; }
+static inline uint32_t dlogWord(unsigned int value){ return value; }
+static inline uint32_t dlogWord(long value){ return (uint32_t)value; }
+static inline uint32_t dlogWord(unsigned long value){ return (uint32_t)value; }
+static inline uint32_t dlogWord(const char *value){ return (uint32_t)(uintptr_t)value; }
+static inline uint32_t dlogWord(const void *value){ return (uint32_t)(uintptr_t)value; }
+static inline uint32_t dlogWord(float value){
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+static inline uint32_t dlogWord(double value){ return dlogWord((float)value); }
+
+/* **** Function Prototypes **** */
+
+/* Stores a record, safe from interrupts. The record is dropped if the ring is full */
+void deferredLogWrite(const char *format, uint32_t count, const uint32_t *args);
+
+/* Sends the stored records in telemetry packets, from the loop
+   On a UART port the packets go with writeAsync(), while telemetry has free buffers,
+   the rest stay in the ring for the next call
+   Returns the number of records sent */
+uint16_t deferredLogFlush(Print &out);
+uint16_t deferredLogFlush(MXC_HardwareSerial &port);
+
+/* Records dropped since the start */
+uint32_t deferredLogDropped(void);
+
+#endif /* DEFERRED_LOG_H */
@@ -0,0 +1,52 @@
+/*
+ * Dual channel (stereo) spectrum with a single complex FFT
+ * See dual_channel.h
+ *
+*/
+
+/* **** Includes **** */
+#include "dual_channel.h"
+#include "fft_engine.h"
+
+/* **** Globals **** */
+static fft_engine_t dual_engine;
+// Complex frame, channel A in the real part, channel B in the imaginary part
+static float32_t dual_buffer[2*DUAL_CHANNEL_FRAME_SIZE];
+
+arm_status dualChannelInit(void){
+  return fftEngineInit(&dual_engine, FFT_ALGO_CFFT, DUAL_CHANNEL_FRAME_SIZE);
+}
+
+void dualChannelSpectrum(const uint32_t *samples_a, const uint32_t *samples_b, float32_t scale,
+                         float32_t *mag_a, float32_t *mag_b){
+  const int n = DUAL_CHANNEL_FRAME_SIZE;
+
+  for(int i = 0; i<n; i++){
+    dual_buffer[2*i] = (float32_t)samples_a[i] * scale;
+    dual_buffer[2*i+1] = (float32_t)samples_b[i] * scale;
+  }
+
+  fftEngineRunComplex(&dual_engine, dual_buffer);
+
+  // Bin 0 of both channels is real, Z[0] = A[0] + jB[0]
+  mag_a[0] = fabsf(dual_buffer[0]);
+  mag_b[0] = fabsf(dual_buffer[1]);
+
+  for(int k = 1; k<n/2; k++){
+    float32_t zr = dual_buffer[2*k];
+    float32_t zi = dual_buffer[2*k+1];
+    // Mirrored bin Z[N-k]
+    float32_t mr = dual_buffer[2*(n-k)];
+    float32_t mi = dual_buffer[2*(n-k)+1];
+
+    // A[k] = (Z[k] + conj(Z[N-k])) / 2
+    float32_t ar = 0.5f*(zr + mr);
+    float32_t ai = 0.5f*(zi - mi);
+    // B[k] = (Z[k] - conj(Z[N-k])) / 2j, only the magnitude is needed
+    float32_t br = 0.5f*(zi + mi);
+    float32_t bi = 0.5f*(mr - zr);
+
+    arm_sqrt_f32(ar*ar + ai*ai, &mag_a[k]);
+    arm_sqrt_f32(br*br + bi*bi, &mag_b[k]);
+  }
+}
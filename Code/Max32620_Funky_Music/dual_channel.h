@@ -0,0 +1,37 @@
+/*
+ * Dual channel (stereo) spectrum with a single complex FFT
+ * The frames of both channels are loaded as the real and imaginary parts
+ * of one complex frame, and both spectra are separated after the transform:
+ *   A[k] = (Z[k] + conj(Z[N-k])) / 2
+ *   B[k] = (Z[k] - conj(Z[N-k])) / 2j
+ * Two channels cost about the same as one real FFT of the same size.
+ * The ADC alternates the channels, each one is sampled at half the rate of
+ * the mono capture. The sketch keeps the bins of band_table_coupled, so each
+ * band is an octave lower than in mono mode, and what is over a quarter of
+ * the ADC rate is not seen. threshold_values are the same, the environment
+ * is measured again by the calibration in this mode.
+ *
+*/
+
+#ifndef DUAL_CHANNEL_H
+#define DUAL_CHANNEL_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "arm_math.h"
+
+/* **** Definitions **** */
+// Samples of each channel in a frame, has to match AMOUNT_SAMPLES in the sketch
+#define DUAL_CHANNEL_FRAME_SIZE 256
+
+/* **** Function Prototypes **** */
+
+/* Initializes the complex FFT */
+arm_status dualChannelInit(void);
+
+/* Gets the magnitude of bins 0..DUAL_CHANNEL_FRAME_SIZE/2-1 of both channels
+   "scale" converts the raw ADC words to the units used by the bands */
+void dualChannelSpectrum(const uint32_t *samples_a, const uint32_t *samples_b, float32_t scale,
+                         float32_t *mag_a, float32_t *mag_b);
+
+#endif /* DUAL_CHANNEL_H */
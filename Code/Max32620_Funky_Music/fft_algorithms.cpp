@@ -0,0 +1,41 @@
+/*
+ * Transforms of the FFT engine, and the frame sizes each one supports
+ * See fft_algorithms.h
+ *
+*/
+
+/* **** Includes **** */
+#include "fft_algorithms.h"
+
+/* **** Functions **** */
+int fftEngineSupports(uint8_t algorithm, uint16_t size){
+  // Every transform works over powers of 2
+  if(size < 16 || (size & (size - 1)) != 0) return 0;
+
+  switch(algorithm){
+    case FFT_ALGO_RFFT_FAST:
+      return (size >= 32 && size <= 4096);
+    case FFT_ALGO_RFFT:
+      // Only the twiddle tables of these lengths are available
+      return (size == 128 || size == 512 || size == 2048) && (size <= FFT_ENGINE_MAX_SIZE);
+    case FFT_ALGO_CFFT:
+    case FFT_ALGO_CFFT_RADIX2:
+      return (size <= FFT_ENGINE_MAX_SIZE);
+    case FFT_ALGO_CFFT_RADIX4:
+      // Powers of 4 only
+      return ((size & 0x5555) != 0) && (size <= FFT_ENGINE_MAX_SIZE);
+    default:
+      return 0;
+  }
+}
+
+const char *fftEngineName(uint8_t algorithm){
+  switch(algorithm){
+    case FFT_ALGO_RFFT_FAST: return "FFT_ALGO_RFFT_FAST";
+    case FFT_ALGO_RFFT: return "FFT_ALGO_RFFT";
+    case FFT_ALGO_CFFT: return "FFT_ALGO_CFFT";
+    case FFT_ALGO_CFFT_RADIX2: return "FFT_ALGO_CFFT_RADIX2";
+    case FFT_ALGO_CFFT_RADIX4: return "FFT_ALGO_CFFT_RADIX4";
+    default: return "FFT_ALGO_UNKNOWN";
+  }
+}
@@ -0,0 +1,35 @@
+/*
+ * Transforms of the FFT engine, and the frame sizes each one supports
+ * Kept apart from fft_engine.h, which needs arm_math.h, so the autotuner
+ * model (fft_autotune_model.h) also builds on the host.
+ *
+*/
+
+#ifndef FFT_ALGORITHMS_H
+#define FFT_ALGORITHMS_H
+
+/* **** Includes **** */
+#include <stdint.h>
+
+/* **** Definitions **** */
+// Transforms that can be selected for the engine
+#define FFT_ALGO_RFFT_FAST    0 // arm_rfft_fast_f32
+#define FFT_ALGO_RFFT         1 // arm_rfft_f32 (radix 4 + split)
+#define FFT_ALGO_CFFT         2 // arm_cfft_f32 (mixed radix 8) over zero imaginary data
+#define FFT_ALGO_CFFT_RADIX2  3 // arm_cfft_radix2_f32 over zero imaginary data
+#define FFT_ALGO_CFFT_RADIX4  4 // arm_cfft_radix4_f32 over zero imaginary data
+#define FFT_ALGO_COUNT        5
+
+// Biggest real frame the engine is able to process
+// Sets the size of the scratch buffer shared by every engine (2 floats per sample)
+#define FFT_ENGINE_MAX_SIZE   1024
+
+/* **** Function Prototypes **** */
+
+/* Returns 1 if the algorithm can process frames of "size" real samples */
+int fftEngineSupports(uint8_t algorithm, uint16_t size);
+
+/* Name of the algorithm, used when printing results */
+const char *fftEngineName(uint8_t algorithm);
+
+#endif /* FFT_ALGORITHMS_H */
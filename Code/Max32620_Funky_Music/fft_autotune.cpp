@@ -0,0 +1,75 @@
+/*
+ * Benchmark driven selection of the FFT algorithm
+ * See fft_autotune.h
+ *
+*/
+
+/* **** Includes **** */
+#include "Arduino.h"
+#include "fft_autotune.h"
+
+/* **** Globals **** */
+static fft_engine_t autotune_engine;
+static float32_t autotune_input[FFT_ENGINE_MAX_SIZE];
+static float32_t autotune_output[FFT_ENGINE_MAX_SIZE];
+
+/* Fills the input with a deterministic signal, similar to the ADC data
+   (offset + tone + noise), as the transforms modify their input */
+static void loadTestSignal(uint16_t size){
+  uint32_t seed = 0x1234567;
+  for(int i = 0; i<size; i++){
+    seed = seed*1664525 + 1013904223;
+    autotune_input[i] = 2.5f + ((i & 0x0F) < 8 ? 0.5f : -0.5f) + (float)(seed >> 24) * 0.001f;
+  }
+}
+
+uint32_t fftAutotuneMeasure(uint8_t algorithm, uint16_t size){
+  if(fftEngineInit(&autotune_engine, algorithm, size) != ARM_MATH_SUCCESS) return 0;
+
+  // Enable the DWT cycle counter
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  uint32_t best = 0xFFFFFFFF;
+  for(int run = 0; run<FFT_AUTOTUNE_RUNS; run++){
+    loadTestSignal(size);
+    uint32_t start = DWT->CYCCNT;
+    fftEngineRun(&autotune_engine, autotune_input, autotune_output);
+    uint32_t cycles = DWT->CYCCNT - start;
+    if(cycles < best) best = cycles;
+  }
+  return best;
+}
+
+/* Measured or estimated cost of a transform, based on the configuration */
+static uint32_t autotuneCycles(uint8_t algorithm, uint16_t size){
+  #ifdef FFT_AUTOTUNE_USE_MODEL
+  return fftAutotuneEstimate(algorithm, size);
+  #else
+  return fftAutotuneMeasure(algorithm, size);
+  #endif
+}
+
+/* Sends the text of the generated header to the Print of fftAutotuneRun */
+static void autotuneWrite(const char *text, void *context){
+  ((Print *)context)->print(text);
+}
+
+void fftAutotuneRun(Print &out){
+  #ifdef FFT_AUTOTUNE_USE_MODEL
+  fftAutotuneWriteConfig(autotuneCycles, 0, autotuneWrite, &out);
+  #else
+  fftAutotuneWriteConfig(autotuneCycles, 1, autotuneWrite, &out);
+  #endif
+}
+
+int fftAutotuneCheck(uint8_t algorithm, uint16_t size, uint32_t recorded_cycles, Print &out){
+  uint32_t cycles = fftAutotuneMeasure(algorithm, size);
+  if(cycles <= recorded_cycles + (recorded_cycles*FFT_AUTOTUNE_TOLERANCE)/100) return 0;
+
+  out.print("FFT regression: "); out.print(fftEngineName(algorithm));
+  out.print(" "); out.print(size); out.print(" samples took ");
+  out.print(cycles); out.print(" cycles, recorded ");
+  out.println(recorded_cycles);
+  return 1;
+}
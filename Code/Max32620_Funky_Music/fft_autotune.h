@@ -0,0 +1,51 @@
+/*
+ * Benchmark driven selection of the FFT algorithm
+ * Every transform supported by the engine is timed for each configured size,
+ * and the result is printed as the content of fft_autotune_config.h,
+ * which the sketch uses to pick the fastest transform for its frame size.
+ * The cycle model and the header writer are in fft_autotune_model.h, the
+ * host version of the autotuner is Code/Host tools/fft_autotune_host.cpp
+ *
+*/
+
+#ifndef FFT_AUTOTUNE_H
+#define FFT_AUTOTUNE_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "Print.h"
+#include "fft_engine.h"
+#include "fft_autotune_model.h"
+
+/* **** Definitions **** */
+// Number of runs of every transform, the fastest one is kept to filter out interrupts
+#define FFT_AUTOTUNE_RUNS 8
+
+// Allowed slowdown (percent) against the recorded cycles before reporting a regression
+#define FFT_AUTOTUNE_TOLERANCE 10
+
+/* Uncomment to use the cycle estimate model instead of the DWT cycle counter
+   Useful on a simulator or when the debug unit is not available */
+//#define FFT_AUTOTUNE_USE_MODEL 1
+
+// Recorded choice for a frame size, the size has to be a literal (e.g. FFT_AUTOTUNE_ALGO(256))
+#define FFT_AUTOTUNE_ALGO(size) FFT_AUTOTUNE_PASTE(FFT_AUTOTUNE_ALGO_, size)
+#define FFT_AUTOTUNE_CYCLES(size) FFT_AUTOTUNE_PASTE(FFT_AUTOTUNE_CYCLES_, size)
+#define FFT_AUTOTUNE_PASTE(a, b) FFT_AUTOTUNE_PASTE_I(a, b)
+#define FFT_AUTOTUNE_PASTE_I(a, b) a##b
+
+/* **** Function Prototypes **** */
+
+/* Cycles taken by one transform, measured with the DWT cycle counter
+   Returns 0 if the algorithm does not support the size */
+uint32_t fftAutotuneMeasure(uint8_t algorithm, uint16_t size);
+
+/* Times every algorithm for every size in FFT_AUTOTUNE_SIZES,
+   and prints a new fft_autotune_config.h to "out" */
+void fftAutotuneRun(Print &out);
+
+/* Measures the selected transform again and compares it against the recorded cycles
+   Returns 1 (and prints a warning) if it got slower than FFT_AUTOTUNE_TOLERANCE */
+int fftAutotuneCheck(uint8_t algorithm, uint16_t size, uint32_t recorded_cycles, Print &out);
+
+#endif /* FFT_AUTOTUNE_H */
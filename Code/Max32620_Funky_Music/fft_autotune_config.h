@@ -0,0 +1,33 @@
+/* fft_autotune_config.h
+ * Generated by fftAutotuneWriteConfig(), do not edit by hand
+ * Cycles estimated with the model in fft_autotune_model.cpp (Host tools/fft_autotune_host)
+*/
+
+#ifndef FFT_AUTOTUNE_CONFIG_H
+#define FFT_AUTOTUNE_CONFIG_H
+
+#include "fft_algorithms.h"
+
+#define FFT_AUTOTUNE_MEASURED 0
+
+// 64 samples: FFT_ALGO_RFFT_FAST=1152 FFT_ALGO_CFFT=1984 FFT_ALGO_CFFT_RADIX2=2752 FFT_ALGO_CFFT_RADIX4=2176
+#define FFT_AUTOTUNE_ALGO_64 FFT_ALGO_RFFT_FAST
+#define FFT_AUTOTUNE_CYCLES_64 1152
+
+// 128 samples: FFT_ALGO_RFFT_FAST=2432 FFT_ALGO_RFFT=3008 FFT_ALGO_CFFT=4608 FFT_ALGO_CFFT_RADIX2=6144
+#define FFT_AUTOTUNE_ALGO_128 FFT_ALGO_RFFT_FAST
+#define FFT_AUTOTUNE_CYCLES_128 2432
+
+// 256 samples: FFT_ALGO_RFFT_FAST=5504 FFT_ALGO_CFFT=9728 FFT_ALGO_CFFT_RADIX2=13568 FFT_ALGO_CFFT_RADIX4=10496
+#define FFT_AUTOTUNE_ALGO_256 FFT_ALGO_RFFT_FAST
+#define FFT_AUTOTUNE_CYCLES_256 5504
+
+// 512 samples: FFT_ALGO_RFFT_FAST=11520 FFT_ALGO_RFFT=13824 FFT_ALGO_CFFT=20480 FFT_ALGO_CFFT_RADIX2=29696
+#define FFT_AUTOTUNE_ALGO_512 FFT_ALGO_RFFT_FAST
+#define FFT_AUTOTUNE_CYCLES_512 11520
+
+// 1024 samples: FFT_ALGO_RFFT_FAST=24064 FFT_ALGO_CFFT=46080 FFT_ALGO_CFFT_RADIX2=64512 FFT_ALGO_CFFT_RADIX4=49152
+#define FFT_AUTOTUNE_ALGO_1024 FFT_ALGO_RFFT_FAST
+#define FFT_AUTOTUNE_CYCLES_1024 24064
+
+#endif /* FFT_AUTOTUNE_CONFIG_H */
@@ -0,0 +1,123 @@
+/*
+ * Cycle model of the FFT transforms, and writer of fft_autotune_config.h
+ * See fft_autotune_model.h
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include "fft_autotune_model.h"
+
+/* **** Definitions **** */
+/* Costs used by the estimate model, in cycles
+   Rough values for a Cortex-M4F, only the relation between them matters */
+#define MODEL_RADIX2_BUTTERFLY  10  // 1 complex multiply + 2 complex adds
+#define MODEL_RADIX4_BUTTERFLY  28  // 3 complex multiplies + 8 complex adds
+#define MODEL_RADIX8_BUTTERFLY  72  // 7 complex multiplies + 24 complex adds
+#define MODEL_BITREVERSAL        4  // per complex element
+#define MODEL_SPLIT             16  // per bin of the real to complex split stage
+#define MODEL_COPY               3  // per sample loaded or packed
+
+/* **** Functions **** */
+
+/* Integer log2 of a power of 2 */
+static uint32_t log2Size(uint16_t size){
+  uint32_t result = 0;
+  while(size > 1){
+    size >>= 1;
+    result++;
+  }
+  return result;
+}
+
+/* Model of the complex transforms, "size" complex elements */
+static uint32_t modelRadix2(uint32_t size){
+  return (size/2)*log2Size(size)*MODEL_RADIX2_BUTTERFLY + size*MODEL_BITREVERSAL;
+}
+
+static uint32_t modelRadix4(uint32_t size){
+  return (size/4)*(log2Size(size)/2)*MODEL_RADIX4_BUTTERFLY + size*MODEL_BITREVERSAL;
+}
+
+static uint32_t modelRadix8(uint32_t size){
+  // arm_cfft_f32 does a radix 2 or 4 first pass when log2(size) is not a multiple of 3
+  uint32_t stages = log2Size(size);
+  uint32_t cycles = (size/8)*(stages/3)*MODEL_RADIX8_BUTTERFLY;
+  if(stages % 3 == 1) cycles += (size/2)*MODEL_RADIX2_BUTTERFLY;
+  if(stages % 3 == 2) cycles += (size/4)*MODEL_RADIX4_BUTTERFLY;
+  return cycles + size*MODEL_BITREVERSAL;
+}
+
+uint32_t fftAutotuneEstimate(uint8_t algorithm, uint16_t size){
+  if(!fftEngineSupports(algorithm, size)) return 0;
+
+  // The complex transforms load the real frame as complex data and pack the result
+  uint32_t complex_overhead = 3*size*MODEL_COPY;
+
+  switch(algorithm){
+    case FFT_ALGO_RFFT_FAST:
+      return modelRadix8(size/2) + (size/2)*MODEL_SPLIT;
+    case FFT_ALGO_RFFT:
+      return modelRadix4(size/2) + (size/2)*MODEL_SPLIT + size*MODEL_COPY;
+    case FFT_ALGO_CFFT:
+      return modelRadix8(size) + complex_overhead;
+    case FFT_ALGO_CFFT_RADIX2:
+      return modelRadix2(size) + complex_overhead;
+    case FFT_ALGO_CFFT_RADIX4:
+      return modelRadix4(size) + complex_overhead;
+    default:
+      return 0;
+  }
+}
+
+/* Writes "text" followed by a number */
+static void writeNumber(fft_autotune_write_t write, void *context, const char *text, uint32_t value){
+  char number[12];
+  snprintf(number, sizeof(number), "%lu", (unsigned long)value);
+  write(text, context);
+  write(number, context);
+}
+
+void fftAutotuneWriteConfig(fft_autotune_cycles_t cycles, int measured,
+                            fft_autotune_write_t write, void *context){
+  const uint16_t sizes[] = FFT_AUTOTUNE_SIZES;
+
+  write("/* fft_autotune_config.h\n", context);
+  write(" * Generated by fftAutotuneWriteConfig(), do not edit by hand\n", context);
+  if(measured) write(" * Cycles measured on target with the DWT cycle counter (FFT_AUTOTUNE_MODE)\n", context);
+  else write(" * Cycles estimated with the model in fft_autotune_model.cpp (Host tools/fft_autotune_host)\n", context);
+  write("*/\n\n", context);
+  write("#ifndef FFT_AUTOTUNE_CONFIG_H\n", context);
+  write("#define FFT_AUTOTUNE_CONFIG_H\n\n", context);
+  write("#include \"fft_algorithms.h\"\n\n", context);
+  writeNumber(write, context, "#define FFT_AUTOTUNE_MEASURED ", measured ? 1 : 0);
+  write("\n", context);
+
+  for(unsigned int s = 0; s<sizeof(sizes)/sizeof(sizes[0]); s++){
+    uint8_t best_algorithm = FFT_ALGO_RFFT_FAST;
+    uint32_t best_cycles = 0xFFFFFFFF;
+
+    // Keep the timings of every candidate in a comment, to see the margins
+    writeNumber(write, context, "\n// ", sizes[s]);
+    write(" samples:", context);
+    for(uint8_t algorithm = 0; algorithm<FFT_ALGO_COUNT; algorithm++){
+      uint32_t algorithm_cycles = cycles(algorithm, sizes[s]);
+      if(algorithm_cycles == 0) continue;
+      write(" ", context); write(fftEngineName(algorithm), context);
+      writeNumber(write, context, "=", algorithm_cycles);
+      if(algorithm_cycles < best_cycles){
+        best_cycles = algorithm_cycles;
+        best_algorithm = algorithm;
+      }
+    }
+    write("\n", context);
+
+    writeNumber(write, context, "#define FFT_AUTOTUNE_ALGO_", sizes[s]);
+    write(" ", context); write(fftEngineName(best_algorithm), context); write("\n", context);
+    writeNumber(write, context, "#define FFT_AUTOTUNE_CYCLES_", sizes[s]);
+    writeNumber(write, context, " ", best_cycles);
+    write("\n", context);
+  }
+
+  write("\n#endif /* FFT_AUTOTUNE_CONFIG_H */\n", context);
+}
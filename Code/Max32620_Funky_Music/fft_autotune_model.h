@@ -0,0 +1,38 @@
+/*
+ * Cycle model of the FFT transforms, and writer of fft_autotune_config.h
+ * Only depends on fft_algorithms.h, so it also builds on the host:
+ * Code/Host tools/fft_autotune_host.cpp writes the header from the model,
+ * fftAutotuneRun (fft_autotune.h) from the cycles measured on the board.
+ *
+*/
+
+#ifndef FFT_AUTOTUNE_MODEL_H
+#define FFT_AUTOTUNE_MODEL_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "fft_algorithms.h"
+
+/* **** Definitions **** */
+// Frame sizes benchmarked, all of them have to be <= FFT_ENGINE_MAX_SIZE
+#define FFT_AUTOTUNE_SIZES {64, 128, 256, 512, 1024}
+
+// Cycles taken by one transform, 0 if the algorithm does not support the size
+typedef uint32_t (*fft_autotune_cycles_t)(uint8_t algorithm, uint16_t size);
+
+// Receives the text of the generated header, in pieces
+typedef void (*fft_autotune_write_t)(const char *text, void *context);
+
+/* **** Function Prototypes **** */
+
+/* Cycles taken by one transform, estimated from the butterflies it performs
+   Returns 0 if the algorithm does not support the size */
+uint32_t fftAutotuneEstimate(uint8_t algorithm, uint16_t size);
+
+/* Picks the fastest algorithm of every size in FFT_AUTOTUNE_SIZES, timed with
+   "cycles", and writes the resulting fft_autotune_config.h through "write"
+   "measured" is 1 for cycles of the board, it enables the regression check */
+void fftAutotuneWriteConfig(fft_autotune_cycles_t cycles, int measured,
+                            fft_autotune_write_t write, void *context);
+
+#endif /* FFT_AUTOTUNE_MODEL_H */
@@ -0,0 +1,88 @@
+/*
+ * FFT engine used by the sketch to get the spectrum of a captured frame
+ * See fft_engine.h
+ *
+*/
+
+/* **** Includes **** */
+#include <string.h>
+#include "fft_engine.h"
+#include "arm_const_structs.h"
+
+/* **** Globals **** */
+// Complex working buffer, shared by all the engines (interleaved re/im)
+static float32_t fft_scratch[2*FFT_ENGINE_MAX_SIZE];
+
+/* Returns the precomputed arm_cfft_f32 instance of a given complex length */
+static const arm_cfft_instance_f32 *cfftInstance(uint16_t size){
+  switch(size){
+    case 16: return &arm_cfft_sR_f32_len16;
+    case 32: return &arm_cfft_sR_f32_len32;
+    case 64: return &arm_cfft_sR_f32_len64;
+    case 128: return &arm_cfft_sR_f32_len128;
+    case 256: return &arm_cfft_sR_f32_len256;
+    case 512: return &arm_cfft_sR_f32_len512;
+    case 1024: return &arm_cfft_sR_f32_len1024;
+    case 2048: return &arm_cfft_sR_f32_len2048;
+    case 4096: return &arm_cfft_sR_f32_len4096;
+    default: return NULL;
+  }
+}
+
+arm_status fftEngineInit(fft_engine_t *engine, uint8_t algorithm, uint16_t size){
+  if(!fftEngineSupports(algorithm, size)) return ARM_MATH_ARGUMENT_ERROR;
+
+  engine->algorithm = algorithm;
+  engine->size = size;
+
+  switch(algorithm){
+    case FFT_ALGO_RFFT_FAST:
+      return arm_rfft_fast_init_f32(&engine->instance.rfft_fast, size);
+    case FFT_ALGO_RFFT:
+      return arm_rfft_init_f32(&engine->instance.rfft, &engine->rfft_cfft, size, 0, 1);
+    case FFT_ALGO_CFFT:
+      engine->instance.cfft = cfftInstance(size);
+      return ARM_MATH_SUCCESS;
+    case FFT_ALGO_CFFT_RADIX2:
+      return arm_cfft_radix2_init_f32(&engine->instance.radix2, size, 0, 1);
+    case FFT_ALGO_CFFT_RADIX4:
+      return arm_cfft_radix4_init_f32(&engine->instance.radix4, size, 0, 1);
+    default:
+      return ARM_MATH_ARGUMENT_ERROR;
+  }
+}
+
+void fftEngineRun(fft_engine_t *engine, float32_t *input, float32_t *output){
+  uint16_t n = engine->size;
+
+  if(engine->algorithm == FFT_ALGO_RFFT_FAST){
+    // Already gives the packed format, nothing else to do
+    arm_rfft_fast_f32(&engine->instance.rfft_fast, input, output, 0);
+    return;
+  }
+
+  if(engine->algorithm == FFT_ALGO_RFFT){
+    // Gives the full complex spectrum (n bins) in the scratch buffer
+    arm_rfft_f32(&engine->instance.rfft, input, fft_scratch);
+  }
+  else{
+    // Complex transforms, load the samples with a zero imaginary part
+    for(int i = 0; i<n; i++){
+      fft_scratch[2*i] = input[i];
+      fft_scratch[2*i+1] = 0.0f;
+    }
+    fftEngineRunComplex(engine, fft_scratch);
+  }
+
+  // Pack the first half of the spectrum as arm_rfft_fast_f32 does
+  // The Nyquist bin is real, its value goes in the imaginary slot of the DC bin
+  output[0] = fft_scratch[0];
+  output[1] = fft_scratch[n];
+  memcpy(&output[2], &fft_scratch[2], (n - 2)*sizeof(float32_t));
+}
+
+void fftEngineRunComplex(fft_engine_t *engine, float32_t *buffer){
+  if(engine->algorithm == FFT_ALGO_CFFT) arm_cfft_f32(engine->instance.cfft, buffer, 0, 1);
+  else if(engine->algorithm == FFT_ALGO_CFFT_RADIX2) arm_cfft_radix2_f32(&engine->instance.radix2, buffer);
+  else if(engine->algorithm == FFT_ALGO_CFFT_RADIX4) arm_cfft_radix4_f32(&engine->instance.radix4, buffer);
+}
@@ -0,0 +1,49 @@
+/*
+ * FFT engine used by the sketch to get the spectrum of a captured frame
+ * Wraps the different CMSIS transforms available in the sketch folder,
+ * so the algorithm used for a given FFT size can be changed without
+ * touching the processing code.
+ *
+*/
+
+#ifndef FFT_ENGINE_H
+#define FFT_ENGINE_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "arm_math.h"
+#include "fft_algorithms.h"
+
+/* **** Definitions **** */
+/* State of one transform, several engines of different sizes can coexist
+   as they only share the scratch buffer */
+typedef struct {
+  uint8_t algorithm;
+  uint16_t size;
+  union {
+    arm_rfft_fast_instance_f32 rfft_fast;
+    arm_rfft_instance_f32 rfft;
+    arm_cfft_radix2_instance_f32 radix2;
+    arm_cfft_radix4_instance_f32 radix4;
+    const arm_cfft_instance_f32 *cfft;
+  } instance;
+  // Complex stage used internally by arm_rfft_f32
+  arm_cfft_radix4_instance_f32 rfft_cfft;
+} fft_engine_t;
+
+/* **** Function Prototypes **** */
+
+/* Prepares the engine, returns ARM_MATH_ARGUMENT_ERROR for unsupported pairs */
+arm_status fftEngineInit(fft_engine_t *engine, uint8_t algorithm, uint16_t size);
+
+/* Forward transform of "size" real samples. The input buffer is used as
+   working memory and is modified. The output always follows the
+   arm_rfft_fast_f32 packing, whatever the algorithm:
+   output[0] = DC, output[1] = Nyquist (real parts), then re/im pairs of bins 1..size/2-1 */
+void fftEngineRun(fft_engine_t *engine, float32_t *input, float32_t *output);
+
+/* In-place forward transform of "size" complex samples (interleaved re/im)
+   Only for the complex algorithms: FFT_ALGO_CFFT, FFT_ALGO_CFFT_RADIX2 and FFT_ALGO_CFFT_RADIX4 */
+void fftEngineRunComplex(fft_engine_t *engine, float32_t *buffer);
+
+#endif /* FFT_ENGINE_H */
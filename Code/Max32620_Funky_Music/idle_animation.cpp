@@ -0,0 +1,171 @@
+/*
+ * Idle animations played by the pulse trains
+ * See idle_animation.h
+ *
+*/
+
+/* **** Includes **** */
+#include "Arduino.h"
+#include "idle_animation.h"
+#include <math.h>
+#include "pt.h"
+#include "nvic_table.h"
+
+/* **** Definitions **** */
+// 750 kHz with the 96 MHz clock, enough for IDLE_BREATH_BPS
+#define PT_CLOCK_SCALE CLKMAN_SCALE_DIV_128
+// Loops of each breathing pattern before the next one
+#define BREATH_LOOPS (IDLE_BREATH_PERIOD_MS*IDLE_BREATH_BPS/(32*1000*IDLE_BREATH_STEPS))
+
+#if BREATH_LOOPS < 1
+#error "IDLE_BREATH_BPS is too slow for IDLE_BREATH_STEPS in IDLE_BREATH_PERIOD_MS"
+#endif
+
+/* **** Globals **** */
+static uint32_t breath_patterns[IDLE_BREATH_STEPS];
+static uint8_t breath_patterns_ready = 0;
+static volatile uint8_t breath_step = 0;
+static mxc_pt_regs_t *breath_pt = NULL;
+static int breath_led = -1;
+static const int *chase_leds = NULL;
+static int chase_leds_count = 0;
+// Pulse trains started
+static uint32_t running = 0;
+
+/* **** Functions **** */
+static int ptIndex(int pin){
+  uint32_t bit = PIN_MASK_TO_PIN(GET_PIN_MASK(pin));
+  return (GET_PIN_PORT(pin) % 2 == 0) ? bit : bit + 8;
+}
+
+/* The pin is given to its PT, length 32 is written as 0 */
+static int configPt(int pin, uint32_t pattern, uint8_t length, uint32_t bps, uint16_t loop){
+  gpio_cfg_t gpio = *GET_PIN_CFG(pin);
+  gpio.func = GPIO_FUNC_PT;
+  gpio.pad = GPIO_PAD_NORMAL;
+
+  pt_pt_cfg_t cfg;
+  cfg.bps = bps;
+  cfg.pattern = pattern;
+  cfg.ptLength = (length == 32) ? 0 : length;
+  cfg.loop = loop;
+  cfg.loopDelay = 0;
+  return PT_PTConfig(MXC_PT_GET_PT(ptIndex(pin)), &cfg, &gpio);
+}
+
+/* Brightness (1 - cos)/2 squared, as evenly spread ones */
+static void computeBreathPatterns(void){
+  for(int step = 0; step<IDLE_BREATH_STEPS; step++){
+    float level = 0.5f*(1.0f - cosf(2.0f*PI*step/IDLE_BREATH_STEPS));
+    uint32_t ones = (uint32_t)(32.0f*level*level + 0.5f);
+    uint32_t pattern = 0;
+    for(uint32_t i = 0; i<32; i++){
+      if((i + 1)*ones/32 != i*ones/32) pattern |= (1UL << i);
+    }
+    breath_patterns[step] = IDLE_BREATH_ACTIVE_LOW ? ~pattern : pattern;
+  }
+  breath_patterns_ready = 1;
+}
+
+/* End of the loops of a breathing pattern, the next one is loaded */
+static void Breath_Handler(void){
+  uint32_t flags = PT_GetFlags();
+  PT_ClearFlags(flags);
+  if(breath_pt == NULL || !(flags & (1 << MXC_PT_GET_IDX(breath_pt)))) return;
+
+  breath_step = (breath_step + 1) % IDLE_BREATH_STEPS;
+  PT_SetPattern(breath_pt, breath_patterns[breath_step]);
+  breath_pt->loop = (BREATH_LOOPS << MXC_F_PT_LOOP_COUNT_POS) & MXC_F_PT_LOOP_COUNT;
+  PT_Start(breath_pt);
+}
+
+int idleAnimationStart(uint8_t animations, const int *chase_pins, int chase_count, int breath_pin){
+  int error;
+  int breath_index = -1;
+
+  idleAnimationStop();
+  PT_Init(PT_CLOCK_SCALE);
+
+  if(animations & IDLE_ANIMATION_BREATHE){
+    if(!breath_patterns_ready) computeBreathPatterns();
+    breath_step = 0;
+    breath_led = breath_pin;
+    error = configPt(breath_pin, breath_patterns[0], 32, IDLE_BREATH_BPS, BREATH_LOOPS);
+    if(error != E_NO_ERROR){
+      idleAnimationStop();
+      return error;
+    }
+    breath_index = ptIndex(breath_pin);
+    breath_pt = MXC_PT_GET_PT(breath_index);
+    running |= (1 << breath_index);
+  }
+
+  if((animations & IDLE_ANIMATION_CHASE) && chase_count > 0){
+    // Steps of the chase, the PTs in the order of their first led
+    int steps[16];
+    int step_count = 0;
+    for(int i = 0; i<chase_count; i++){
+      int index = ptIndex(chase_pins[i]);
+      if(index == breath_index) continue;
+      int known = 0;
+      for(int j = 0; j<step_count; j++) known |= (steps[j] == index);
+      if(!known) steps[step_count++] = index;
+    }
+
+    // There and back: 0 1 .. n-1 n-2 .. 1
+    uint8_t length = (step_count > 1) ? 2*(step_count - 1) : 2;
+    uint32_t patterns[16] = {0};
+    for(int bit = 0; bit<length; bit++){
+      int step = (bit < step_count) ? bit : length - bit;
+      patterns[step] |= (1UL << bit);
+    }
+
+    chase_leds = chase_pins;
+    chase_leds_count = chase_count;
+    for(int i = 0; i<chase_count; i++){
+      int index = ptIndex(chase_pins[i]);
+      if(index == breath_index) continue;
+      int step = 0;
+      while(steps[step] != index) step++;
+      // Continuous, the leds of a PT are configured with the same pattern
+      error = configPt(chase_pins[i], patterns[step], length, 1000/IDLE_CHASE_STEP_MS, 0);
+      if(error != E_NO_ERROR){
+        idleAnimationStop();
+        return error;
+      }
+      running |= (1 << index);
+    }
+  }
+
+  if(breath_pt){
+    PT_ClearFlags(1 << breath_index);
+    PT_EnableINT(breath_pt);
+    NVIC_SetVector(PT_IRQn, Breath_Handler);
+    NVIC_EnableIRQ(PT_IRQn);
+  }
+  // Together, so the chase steps stay aligned
+  if(running) PT_StartMulti(running);
+  return E_NO_ERROR;
+}
+
+void idleAnimationStop(void){
+  NVIC_DisableIRQ(PT_IRQn);
+  PT_StopMulti(running);
+  PT_DisableINTMulti(running);
+  PT_ClearFlags(running);
+  running = 0;
+  breath_pt = NULL;
+
+  // Back to the GPIO function, leds off
+  for(int i = 0; i<chase_leds_count; i++){
+    digitalWrite(chase_leds[i], LOW);
+    GPIO_Config(GET_PIN_CFG(chase_leds[i]));
+  }
+  chase_leds = NULL;
+  chase_leds_count = 0;
+  if(breath_led >= 0){
+    digitalWrite(breath_led, IDLE_BREATH_ACTIVE_LOW ? HIGH : LOW);
+    GPIO_Config(GET_PIN_CFG(breath_led));
+    breath_led = -1;
+  }
+}
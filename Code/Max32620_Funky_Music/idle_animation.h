@@ -0,0 +1,47 @@
+/*
+ * Idle animations played by the pulse trains, so the core can sleep
+ * The PT of a pin is fixed: pin n of an even port is PT n, of an odd port PT n+8,
+ * so leds on the same PT (P3_3 and P5_3...) always show the same pattern.
+ * - Chase: a light moving back and forth over the leds, one bit of the pattern
+ *   per step. The patterns of every PT are started together and loop forever,
+ *   the core is not needed at all
+ * - Breathe: the brightness of one led follows a cosine, as the density of the
+ *   ones in a 32 bits pattern shifted at IDLE_BREATH_BPS. The patterns of the
+ *   IDLE_BREATH_STEPS levels are computed once, the PT interrupt only loads the
+ *   next one every IDLE_BREATH_PERIOD_MS/IDLE_BREATH_STEPS
+ * The pulse trains need the system clock, the core can use LP2 but not LP1.
+ *
+*/
+
+#ifndef IDLE_ANIMATION_H
+#define IDLE_ANIMATION_H
+
+/* **** Includes **** */
+#include <stdint.h>
+
+/* **** Definitions **** */
+#define IDLE_ANIMATION_CHASE   0x01
+#define IDLE_ANIMATION_BREATHE 0x02
+
+// Time each led of the chase stays on
+#define IDLE_CHASE_STEP_MS 120
+
+// Breathing cycle, and brightness levels in it
+#define IDLE_BREATH_PERIOD_MS 4000
+#define IDLE_BREATH_STEPS 32
+// 128 patterns per second, the ones are spread so the led does not flicker
+#define IDLE_BREATH_BPS (32*128)
+// The breathing led is on when its pin is low (the builtin leds)
+#define IDLE_BREATH_ACTIVE_LOW 1
+
+/* **** Function Prototypes **** */
+
+/* Starts the animations selected (IDLE_ANIMATION_xxx), chase over chase_pins
+   (in their order, on when high) and breathe on breath_pin.
+   The pins are given to the pulse trains until idleAnimationStop */
+int idleAnimationStart(uint8_t animations, const int *chase_pins, int chase_count, int breath_pin);
+
+/* Stops the pulse trains and gives the pins back as outputs, leds off */
+void idleAnimationStop(void);
+
+#endif /* IDLE_ANIMATION_H */
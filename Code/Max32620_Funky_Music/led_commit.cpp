@@ -0,0 +1,111 @@
+/*
+ * Leds written by a PMU channel
+ * See led_commit.h
+ *
+*/
+
+/* **** Includes **** */
+#include "Arduino.h"
+#include "led_commit.h"
+#include "pmu_channels.h"
+
+/* **** Definitions **** */
+#define OUT_VAL_REG(port) (MXC_BASE_GPIO + MXC_R_GPIO_OFFS_OUT_VAL_P0 + 4*(port))
+
+// Words of commit_program patched at run time
+#define VALUE_LOW  16
+#define MASK_LOW   17
+#define VALUE_HIGH 20
+#define MASK_HIGH  21
+
+/* **** Globals **** */
+volatile uint32_t led_commit_tick = 0;
+// Read by the PMU, written only by ledCommitPublish
+static volatile uint32_t mailbox = 0;
+static uint32_t staged = 0;
+// Copy of the mailbox, both halves come from the same publish
+static uint32_t snapshot = 0;
+static uint32_t mask_low = 0;
+static uint32_t mask_high = 0;
+static int commit_channel = -1;
+
+static uint32_t commit_program[] = {
+  // Wait for the end of a frame
+  PMU_POLL(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_POLL_AND, (uint32_t)&led_commit_tick, 1, 1, LED_COMMIT_POLL_CYCLES),
+  // Single read of the mailbox
+  PMU_MOVE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_MOVE_READ_32_BIT, PMU_MOVE_READ_NO_INC, PMU_MOVE_WRITE_32_BIT, PMU_MOVE_WRITE_NO_INC, PMU_MOVE_NO_CONT, 4, (uint32_t)&snapshot, (uint32_t)&mailbox),
+  // Each half to the value of its write, commit_program[16] and commit_program[20]
+  PMU_MOVE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_MOVE_READ_16_BIT, PMU_MOVE_READ_NO_INC, PMU_MOVE_WRITE_16_BIT, PMU_MOVE_WRITE_NO_INC, PMU_MOVE_NO_CONT, 2, (uint32_t)&(commit_program[VALUE_LOW]), (uint32_t)&snapshot),
+  PMU_MOVE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_MOVE_READ_16_BIT, PMU_MOVE_READ_NO_INC, PMU_MOVE_WRITE_16_BIT, PMU_MOVE_WRITE_NO_INC, PMU_MOVE_NO_CONT, 2, (uint32_t)&(commit_program[VALUE_HIGH]), (uint32_t)&snapshot + 2),
+  // Only the bits of the leds change, the masks are set by ledCommitBegin
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, OUT_VAL_REG(LED_COMMIT_PORT_LOW), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, OUT_VAL_REG(LED_COMMIT_PORT_HIGH), 0, 0),
+  // Done, wait for the next frame
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, (uint32_t)&led_commit_tick, 0, 0xffffffff),
+  PMU_JUMP(PMU_NO_INTERRUPT, PMU_NO_STOP, (uint32_t)(commit_program)),
+};
+
+/* **** Functions **** */
+static uint32_t pinBit(int pin){
+  uint32_t port = GET_PIN_PORT(pin);
+  if(port == LED_COMMIT_PORT_LOW) return GET_PIN_MASK(pin) & mask_low;
+  if(port == LED_COMMIT_PORT_HIGH) return (GET_PIN_MASK(pin) & mask_high) << 16;
+  return 0;
+}
+
+int ledCommitBegin(const int *pins, int count){
+  uint32_t low = 0;
+  uint32_t high = 0;
+  for(int i = 0; i<count; i++){
+    uint32_t port = GET_PIN_PORT(pins[i]);
+    if(port == LED_COMMIT_PORT_LOW) low |= GET_PIN_MASK(pins[i]);
+    else if(port == LED_COMMIT_PORT_HIGH) high |= GET_PIN_MASK(pins[i]);
+    else return E_BAD_PARAM;
+  }
+
+  if(commit_channel < 0){
+    commit_channel = pmuChannelAlloc();
+    if(commit_channel < 0) return commit_channel;
+  }
+  else pmuChannelStop(commit_channel);
+
+  mask_low = low;
+  mask_high = high;
+  commit_program[MASK_LOW] = low;
+  commit_program[MASK_HIGH] = high;
+  staged = (MXC_GPIO->out_val[LED_COMMIT_PORT_LOW] & low) | ((MXC_GPIO->out_val[LED_COMMIT_PORT_HIGH] & high) << 16);
+  mailbox = staged;
+  return ledCommitStart();
+}
+
+void ledCommitStop(void){
+  if(commit_channel < 0) return;
+  pmuChannelStop(commit_channel);
+  led_commit_tick = 0;
+
+  // Nothing else writes the leds now
+  uint32_t state = mailbox;
+  MXC_GPIO->out_val[LED_COMMIT_PORT_LOW] = (MXC_GPIO->out_val[LED_COMMIT_PORT_LOW] & ~mask_low) | (state & mask_low);
+  MXC_GPIO->out_val[LED_COMMIT_PORT_HIGH] = (MXC_GPIO->out_val[LED_COMMIT_PORT_HIGH] & ~mask_high) | ((state >> 16) & mask_high);
+}
+
+int ledCommitStart(void){
+  if(commit_channel < 0) return E_UNINITIALIZED;
+  // A tick of the previous run would commit at once
+  led_commit_tick = 0;
+  return pmuChannelStart(commit_channel, commit_program, NULL);
+}
+
+void ledCommitSet(int pin, int value){
+  uint32_t bit = pinBit(pin);
+  if(value) staged |= bit;
+  else staged &= ~bit;
+}
+
+int ledCommitGet(int pin){
+  return (staged & pinBit(pin)) != 0;
+}
+
+void ledCommitPublish(void){
+  mailbox = staged;
+}
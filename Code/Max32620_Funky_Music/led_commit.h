@@ -0,0 +1,52 @@
+/*
+ * Leds of two GPIO ports written by a PMU channel, once per captured frame
+ * The processing loop only stages the state of the leds and publishes it to
+ * a mailbox in SRAM, with a single 32 bits store: LED_COMMIT_PORT_LOW in the
+ * low half, LED_COMMIT_PORT_HIGH in the high half.
+ * The capture program sets led_commit_tick at the end of every frame. The
+ * commit program polls it, copies the mailbox with MOVE descriptors into the
+ * values of two masked WRITE descriptors and writes the output registers,
+ * so the leds change at a fixed time after each frame, whatever the core is
+ * doing. Only the pins given to ledCommitBegin are written, the rest of both
+ * ports keeps its value, as long as the core does not write them at the same time.
+ *
+*/
+
+#ifndef LED_COMMIT_H
+#define LED_COMMIT_H
+
+/* **** Includes **** */
+#include <stdint.h>
+
+/* **** Definitions **** */
+// Ports of the leds
+#define LED_COMMIT_PORT_LOW  3
+#define LED_COMMIT_PORT_HIGH 5
+
+// PMU clocks between the reads of led_commit_tick, 10 us at 96 MHz
+#define LED_COMMIT_POLL_CYCLES 960
+
+/* **** Globals **** */
+// Set to 1 by the capture program at the end of each frame, cleared by the commit
+extern volatile uint32_t led_commit_tick;
+
+/* **** Function Prototypes **** */
+
+/* Starts the commit program on a free PMU channel, for the pins given (outputs
+   of the two ports). The leds start with the current state of the pins
+   Returns E_NO_ERROR, E_BAD_PARAM for a pin of another port or E_NONE_AVAIL */
+int ledCommitBegin(const int *pins, int count);
+
+/* Stops the channel and writes the last state published to the pins,
+   ledCommitStart starts it again */
+void ledCommitStop(void);
+int ledCommitStart(void);
+
+/* State of a led, staged until ledCommitPublish */
+void ledCommitSet(int pin, int value);
+int ledCommitGet(int pin);
+
+/* Makes the staged state the one written at the next frame */
+void ledCommitPublish(void);
+
+#endif /* LED_COMMIT_H */
@@ -0,0 +1,181 @@
+/*
+ * Output engine of the led strip
+ * See led_renderer.h
+ *
+*/
+
+/* **** Includes **** */
+#include "led_renderer.h"
+#include "led_strip.h"
+#include <math.h>
+#include <string.h>
+#include "tmr.h"
+#include "prng.h"
+#include "nvic_table.h"
+
+/* **** Definitions **** */
+#define RENDER_TMR MXC_TMR_GET_TMR(LED_RENDER_TMR)
+#define RENDER_IRQ MXC_TMR_GET_IRQ_32(LED_RENDER_TMR)
+#define CHANNELS (3*LED_STRIP_MAX_PIXELS)
+
+/* **** Gamma table **** */
+// x^(1/5), Newton iterations from 1 (always above the root)
+static constexpr double root5(double x, double y, int n){
+  return (n == 0) ? y : root5(x, (4*y + x/(y*y*y*y))/5, n - 1);
+}
+
+// 65535*(i/255)^2.2, one more entry for the interpolation of 255
+static constexpr uint16_t gammaEntry(int i){
+  return (i >= 255) ? 65535 : (uint16_t)(65535.0*(i/255.0)*(i/255.0)*root5(i/255.0, 1.0, 40) + 0.5);
+}
+
+template<int... I> struct GammaIndices {};
+template<int N, int... I> struct MakeGammaIndices : MakeGammaIndices<N - 1, N - 1, I...> {};
+template<int... I> struct MakeGammaIndices<0, I...> { typedef GammaIndices<I...> type; };
+
+struct GammaTable {
+  uint16_t value[257];
+};
+
+template<int... I> static constexpr GammaTable makeGammaTable(GammaIndices<I...>){
+  return GammaTable{{gammaEntry(I)...}};
+}
+
+// Built by the compiler, stored in flash
+static constexpr GammaTable gamma_table = makeGammaTable(MakeGammaIndices<257>::type());
+
+static_assert(gamma_table.value[0] == 0 && gamma_table.value[255] == 65535, "Gamma table limits");
+static_assert(gamma_table.value[128] == 14386, "(128/255)^2.2 is 0.2195");
+
+/* **** Globals **** */
+static uint16_t render_count = 0;
+// Written by the processing loop, 8 bits each
+static volatile uint8_t targets[CHANNELS];
+// Smoothed levels, 8.8 fixed point
+static uint16_t levels[CHANNELS];
+// Smoothing per frame, 0.16 fixed point
+static uint32_t attack = 0;
+static uint32_t release = 0;
+static uint32_t random_state = 1;
+static volatile uint32_t frames = 0;
+
+/* **** Functions **** */
+static inline uint32_t nextRandom(void){
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+/* Part of the distance to the target covered in a frame, for a time constant */
+static uint32_t smoothingFactor(uint32_t ms){
+  if(ms == 0) return 65536;
+  return (uint32_t)(65536.0f*(1.0f - expf(-1000.0f/((float)LED_RENDER_RATE*ms))));
+}
+
+static inline uint8_t renderChannel(int channel){
+  int32_t level = levels[channel];
+  int32_t difference = ((int32_t)targets[channel] << 8) - level;
+  if(difference != 0){
+    int32_t step = (int32_t)(((int64_t)difference*(difference > 0 ? attack : release)) >> 16);
+    // The shift rounds down, so the falling levels always reach the target
+    if(step == 0 && difference > 0) step = 1;
+    level += step;
+    levels[channel] = (uint16_t)level;
+  }
+
+  // Gamma, interpolated between the entries
+  uint32_t index = level >> 8;
+  uint32_t fraction = level & 0xFF;
+  uint32_t linear = gamma_table.value[index] + (((gamma_table.value[index + 1] - gamma_table.value[index])*fraction) >> 8);
+
+  // Rounded up with a probability equal to the fraction lost
+  uint32_t out = (linear + (nextRandom() & 0xFF)) >> 8;
+  return (out > 255) ? 255 : (uint8_t)out;
+}
+
+static void Render_Handler(void){
+  TMR32_ClearFlag(RENDER_TMR);
+
+  // New entropy in every frame
+  random_state ^= PRNG_GetSeed();
+  if(random_state == 0) random_state = 1;
+
+  for(uint16_t i = 0; i<render_count; i++){
+    uint8_t red = renderChannel(3*i);
+    uint8_t green = renderChannel(3*i + 1);
+    uint8_t blue = renderChannel(3*i + 2);
+    ledStripSetPixel(i, red, green, blue);
+  }
+  ledStripShow();
+  frames++;
+}
+
+int ledRenderBegin(uint16_t count){
+  if(count == 0 || count > LED_STRIP_MAX_PIXELS) return E_BAD_PARAM;
+  render_count = count;
+  frames = 0;
+  attack = smoothingFactor(LED_RENDER_ATTACK_MS);
+  release = smoothingFactor(LED_RENDER_RELEASE_MS);
+
+  PRNG_Init();
+  while(!PRNG_Ready()) {}
+  random_state = ((uint32_t)PRNG_GetSeed() << 16) | PRNG_GetSeed();
+  if(random_state == 0) random_state = 1;
+
+  int error = TMR_Init(RENDER_TMR, TMR_PRESCALE_DIV_2_0, NULL);
+  if(error != E_NO_ERROR) return error;
+  tmr32_cfg_t cfg;
+  cfg.mode = TMR32_MODE_CONTINUOUS;
+  cfg.polarity = TMR_POLARITY_UNUSED;
+  error = TMR32_TimeToTicks(RENDER_TMR, 1000000/LED_RENDER_RATE, TMR_UNIT_MICROSEC, &cfg.compareCount);
+  if(error != E_NO_ERROR) return error;
+  TMR32_Config(RENDER_TMR, &cfg);
+  TMR32_EnableINT(RENDER_TMR);
+
+  // Below the SPI and PMU interrupts
+  NVIC_SetVector(RENDER_IRQ, Render_Handler);
+  NVIC_SetPriority(RENDER_IRQ, (1 << __NVIC_PRIO_BITS) - 1);
+  ledRenderStart();
+  return E_NO_ERROR;
+}
+
+void ledRenderStop(void){
+  TMR32_Stop(RENDER_TMR);
+  NVIC_DisableIRQ(RENDER_IRQ);
+  TMR32_ClearFlag(RENDER_TMR);
+  NVIC_ClearPendingIRQ(RENDER_IRQ);
+
+  // The interrupt is off, the strip can be written from here. Both buffers may
+  // still hold rendered frames, the black one would be dropped with E_BUSY
+  while(ledStripBusy()) {}
+  ledStripClear();
+  ledStripShow();
+  // Off on return, before the core goes to sleep
+  while(ledStripBusy()) {}
+}
+
+void ledRenderStart(void){
+  memset(levels, 0, sizeof(levels));
+  NVIC_EnableIRQ(RENDER_IRQ);
+  TMR32_Start(RENDER_TMR);
+}
+
+void ledRenderSetTarget(uint16_t index, uint8_t red, uint8_t green, uint8_t blue){
+  if(index >= render_count) return;
+  targets[3*index] = red;
+  targets[3*index + 1] = green;
+  targets[3*index + 2] = blue;
+}
+
+void ledRenderFillTarget(uint16_t first, uint16_t count, uint8_t red, uint8_t green, uint8_t blue){
+  for(uint16_t i = first; i<render_count && i - first < count; i++) ledRenderSetTarget(i, red, green, blue);
+}
+
+void ledRenderClearTargets(void){
+  for(int i = 0; i<CHANNELS; i++) targets[i] = 0;
+}
+
+uint32_t ledRenderFrames(void){
+  return frames;
+}
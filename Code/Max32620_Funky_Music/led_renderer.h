@@ -0,0 +1,48 @@
+/*
+ * Output engine of the led strip, refreshed by a timer at LED_RENDER_RATE
+ * The processing loop only writes the target color of each pixel, whenever
+ * a frame is ready. On every tick of the timer each color moves towards its
+ * target (attack when rising, release when falling), goes through a gamma 2.2
+ * table to 16 bits, and is rounded to the 8 bits of the strip with a random
+ * threshold (temporal dithering), so the low levels fade smoothly instead of
+ * stepping. The random numbers come from a xorshift seeded by the hardware PRNG.
+ * The rendering runs in the timer interrupt, at the lowest priority.
+ *
+*/
+
+#ifndef LED_RENDERER_H
+#define LED_RENDERER_H
+
+/* **** Includes **** */
+#include <stdint.h>
+
+/* **** Definitions **** */
+// Frames per second sent to the strip
+#define LED_RENDER_RATE 100
+// 32 bits timer used for the refresh
+#define LED_RENDER_TMR 4
+
+// Time constants of the smoothing, in ms
+#define LED_RENDER_ATTACK_MS 15
+#define LED_RENDER_RELEASE_MS 150
+
+/* **** Function Prototypes **** */
+
+/* Renders count pixels (up to LED_STRIP_MAX_PIXELS) on the strip started with
+   ledStripBegin, and starts the timer. Returns E_NO_ERROR or an error code */
+int ledRenderBegin(uint16_t count);
+
+/* Stops the timer and turns the strip off, ledRenderStart resumes from black
+   Waits for the frames being sent and the black one, from the loop only */
+void ledRenderStop(void);
+void ledRenderStart(void);
+
+/* Colors the pixels move to, written by the processing loop */
+void ledRenderSetTarget(uint16_t index, uint8_t red, uint8_t green, uint8_t blue);
+void ledRenderFillTarget(uint16_t first, uint16_t count, uint8_t red, uint8_t green, uint8_t blue);
+void ledRenderClearTargets(void);
+
+/* Frames rendered since ledRenderBegin */
+uint32_t ledRenderFrames(void);
+
+#endif /* LED_RENDERER_H */
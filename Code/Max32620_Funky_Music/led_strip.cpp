@@ -0,0 +1,173 @@
+/*
+ * Addressable led strips driven by a SPI master
+ * See led_strip.h
+ *
+*/
+
+/* **** Includes **** */
+#include "led_strip.h"
+#include <string.h>
+
+/* **** Definitions **** */
+#define FRAME_BUFFER_SIZE LED_STRIP_WS2812_FRAME_SIZE(LED_STRIP_MAX_PIXELS)
+
+#if LED_STRIP_APA102_FRAME_SIZE(LED_STRIP_MAX_PIXELS) > FRAME_BUFFER_SIZE
+#error "The frame buffers are sized for the WS2812"
+#endif
+
+/* **** Globals **** */
+// 3 SPI bits for each bit of a nibble, MSB first: 100 for a 0, 110 for a 1
+static const uint16_t ws2812_nibbles[16] = {
+  0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6,
+  0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6
+};
+
+static SPIClass *strip_spi = NULL;
+static uint8_t strip_type = LED_STRIP_WS2812;
+static uint16_t strip_count = 0;
+static uint8_t strip_brightness = 255;
+static uint8_t strip_pixels[3*LED_STRIP_MAX_PIXELS];
+
+// A frame is encoded in one buffer while the other one is sent
+static uint8_t frame_buffers[2][FRAME_BUFFER_SIZE];
+static spim_req_t frame_requests[2];
+static volatile uint8_t frame_busy[2] = {0, 0};
+static uint8_t next_buffer = 0;
+static uint32_t frames = 0;
+static uint32_t dropped = 0;
+
+/* **** Functions **** */
+static inline uint8_t scale(uint8_t value, uint8_t brightness){
+  return (uint8_t)((value * (brightness + 1)) >> 8);
+}
+
+/* 24 SPI bits of a data byte, MSB first */
+static inline uint8_t *ws2812Byte(uint8_t *out, uint8_t value){
+  uint32_t bits = ((uint32_t)ws2812_nibbles[value >> 4] << 12) | ws2812_nibbles[value & 0x0F];
+  out[0] = (uint8_t)(bits >> 16);
+  out[1] = (uint8_t)(bits >> 8);
+  out[2] = (uint8_t)bits;
+  return out + 3;
+}
+
+size_t ledStripEncodeWs2812(const uint8_t *pixels, uint16_t count, uint8_t brightness, uint8_t *out){
+  uint8_t *p = out;
+  // MOSI low before the first bit, whatever its level between transfers
+  *p++ = 0;
+  for(uint16_t i = 0; i<count; i++){
+    p = ws2812Byte(p, scale(pixels[3*i + 1], brightness));
+    p = ws2812Byte(p, scale(pixels[3*i], brightness));
+    p = ws2812Byte(p, scale(pixels[3*i + 2], brightness));
+  }
+  // Every symbol ends low, so the reset is just low bits
+  memset(p, 0, LED_STRIP_WS2812_RESET_BYTES);
+  p += LED_STRIP_WS2812_RESET_BYTES;
+  return p - out;
+}
+
+size_t ledStripEncodeApa102(const uint8_t *pixels, uint16_t count, uint8_t brightness, uint8_t *out){
+  uint8_t *p = out;
+  // Start frame
+  memset(p, 0, 4);
+  p += 4;
+  for(uint16_t i = 0; i<count; i++){
+    *p++ = 0xE0 | 31;
+    *p++ = scale(pixels[3*i + 2], brightness);
+    *p++ = scale(pixels[3*i + 1], brightness);
+    *p++ = scale(pixels[3*i], brightness);
+  }
+  // The data is delayed half a clock by every pixel, count/2 more clocks push it
+  // to the end of the strip. Zeros, so the SK9822 gets its reset frame as well
+  size_t end = 4 + (count + 15)/16;
+  memset(p, 0, end);
+  p += end;
+  return p - out;
+}
+
+static void frameDone(spim_req_t *req, int error){
+  (void)error;
+  frame_busy[req - frame_requests] = 0;
+}
+
+int ledStripBegin(SPIClass &spi, uint8_t type, uint16_t count){
+  if(type != LED_STRIP_WS2812 && type != LED_STRIP_APA102) return E_BAD_PARAM;
+  if(count == 0 || count > LED_STRIP_MAX_PIXELS) return E_BAD_PARAM;
+
+  // Frames of a previous strip are sent before changing the clock
+  while(ledStripBusy()) {}
+
+  strip_spi = &spi;
+  strip_type = type;
+  strip_count = count;
+  frames = 0;
+  dropped = 0;
+  ledStripClear();
+
+  spi.begin();
+  spi.beginTransaction(SPISettings(type == LED_STRIP_WS2812 ? LED_STRIP_WS2812_CLOCK : LED_STRIP_APA102_CLOCK,
+                                   MSBFIRST, SPI_MODE0));
+  spi.endTransaction();
+  return E_NO_ERROR;
+}
+
+void ledStripSetPixel(uint16_t index, uint8_t red, uint8_t green, uint8_t blue){
+  if(index >= strip_count) return;
+  strip_pixels[3*index] = red;
+  strip_pixels[3*index + 1] = green;
+  strip_pixels[3*index + 2] = blue;
+}
+
+void ledStripFill(uint16_t first, uint16_t count, uint8_t red, uint8_t green, uint8_t blue){
+  for(uint16_t i = first; i<strip_count && i - first < count; i++) ledStripSetPixel(i, red, green, blue);
+}
+
+void ledStripClear(void){
+  memset(strip_pixels, 0, sizeof(strip_pixels));
+}
+
+void ledStripSetBrightness(uint8_t brightness){
+  strip_brightness = brightness;
+}
+
+int ledStripShow(void){
+  if(!strip_spi) return E_UNINITIALIZED;
+
+  uint8_t buffer = next_buffer;
+  if(frame_busy[buffer]){
+    dropped++;
+    return E_BUSY;
+  }
+
+  spim_req_t *req = &frame_requests[buffer];
+  req->ssel = 0;
+  req->deass = 1;
+  req->tx_data = frame_buffers[buffer];
+  req->rx_data = NULL;
+  req->width = SPIM_WIDTH_1;
+  if(strip_type == LED_STRIP_WS2812) req->len = ledStripEncodeWs2812(strip_pixels, strip_count, strip_brightness, frame_buffers[buffer]);
+  else req->len = ledStripEncodeApa102(strip_pixels, strip_count, strip_brightness, frame_buffers[buffer]);
+  req->callback = frameDone;
+
+  frame_busy[buffer] = 1;
+  int error = strip_spi->transferAsync(req);
+  if(error != E_NO_ERROR){
+    frame_busy[buffer] = 0;
+    dropped++;
+    return error;
+  }
+  next_buffer = buffer ^ 1;
+  frames++;
+  return E_NO_ERROR;
+}
+
+bool ledStripBusy(void){
+  return frame_busy[0] || frame_busy[1];
+}
+
+uint32_t ledStripFrames(void){
+  return frames;
+}
+
+uint32_t ledStripDropped(void){
+  return dropped;
+}
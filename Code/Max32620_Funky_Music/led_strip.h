@@ -0,0 +1,72 @@
+/*
+ * Addressable led strips driven by a SPI master, without bit-banging
+ * - WS2812 / WS2812B / SK6812 (RGB): one data line, on MOSI. Each data bit is
+ *   sent as 3 SPI bits at LED_STRIP_WS2812_CLOCK, 100 for a 0 and 110 for a 1,
+ *   taken from a table of the 16 nibbles. Colors are sent in GRB order
+ * - APA102 / SK9822: data on MOSI and clock on SCK, BGR order
+ * The frames are encoded in one of two buffers and sent with SPIClass::transferAsync,
+ * so the next frame is encoded while the previous one is still being sent.
+ * A WS2812 pixel takes 30 us, 300 pixels refresh at over 100 frames per second.
+ * WS2812 strips powered at 5V need a level shifter on the data line.
+ *
+*/
+
+#ifndef LED_STRIP_H
+#define LED_STRIP_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include <stddef.h>
+#include <SPI.h>
+#include "mxc_errors.h"
+
+/* **** Definitions **** */
+#define LED_STRIP_WS2812 0
+#define LED_STRIP_APA102 1
+
+// Pixels of the longest strip, sets the size of the buffers
+#define LED_STRIP_MAX_PIXELS 300
+
+// 3 SPI bits of 417 ns for every data bit, 1.25 us
+// SK6812 strips missing the 1 bits can use 2666666 (375 ns, 750 ns high)
+#define LED_STRIP_WS2812_CLOCK 2400000
+#define LED_STRIP_APA102_CLOCK 4000000
+
+// Low time after the frame latching the colors, 300 us at 2.4 MHz (280 us for the WS2812B)
+#define LED_STRIP_WS2812_RESET_BYTES 90
+
+// Bytes sent for count pixels
+#define LED_STRIP_WS2812_FRAME_SIZE(count) (1 + 9*(count) + LED_STRIP_WS2812_RESET_BYTES)
+#define LED_STRIP_APA102_FRAME_SIZE(count) (4 + 4*(count) + 4 + ((count) + 15)/16)
+
+/* **** Function Prototypes **** */
+
+/* Starts the SPI port and clears the pixels, count up to LED_STRIP_MAX_PIXELS
+   Returns E_NO_ERROR, or E_BAD_PARAM for a wrong type or count */
+int ledStripBegin(SPIClass &spi, uint8_t type, uint16_t count);
+
+/* Colors of the pixels, sent by the next ledStripShow */
+void ledStripSetPixel(uint16_t index, uint8_t red, uint8_t green, uint8_t blue);
+void ledStripFill(uint16_t first, uint16_t count, uint8_t red, uint8_t green, uint8_t blue);
+void ledStripClear(void);
+
+/* Scale of every color when encoded, 255 (default) sends them as they are */
+void ledStripSetBrightness(uint8_t brightness);
+
+/* Encodes the pixels and queues the frame, without waiting
+   Returns E_BUSY if both buffers are still being sent, the frame is dropped */
+int ledStripShow(void);
+
+/* true while a frame is being sent */
+bool ledStripBusy(void);
+
+/* Frames queued and frames dropped since ledStripBegin */
+uint32_t ledStripFrames(void);
+uint32_t ledStripDropped(void);
+
+/* Encoders used by ledStripShow, pixels are RGB triplets
+   Return the bytes written, LED_STRIP_xxx_FRAME_SIZE(count) */
+size_t ledStripEncodeWs2812(const uint8_t *pixels, uint16_t count, uint8_t brightness, uint8_t *out);
+size_t ledStripEncodeApa102(const uint8_t *pixels, uint16_t count, uint8_t brightness, uint8_t *out);
+
+#endif /* LED_STRIP_H */
@@ -0,0 +1,163 @@
+/*
+ * Multi-resolution (constant-Q like) band analyzer
+ * See multires_analyzer.h
+ *
+*/
+
+/* **** Includes **** */
+#include <math.h>
+#include <string.h>
+#include "Arduino.h"
+#include "multires_analyzer.h"
+#include "fft_engine.h"
+#include "fft_autotune.h"
+#include "fft_autotune_config.h"
+#include "band_tables.h"
+
+/* **** Definitions **** */
+#define LOW_FRAME_SIZE (MULTIRES_FRAME_SIZE/MULTIRES_DECIMATION)
+
+/* **** Globals **** */
+/* Low pass filter for the decimation, hamming windowed sinc
+   Cutoff at 0.1 fs, the decimated stream has its Nyquist at 0.125 fs */
+static const float32_t fir_coeffs[MULTIRES_FIR_TAPS] = {
+  -0.000507108f, 0.000605885f, 0.002234629f, 0.004132057f,
+  0.004989660f, 0.002776106f, -0.003932565f, -0.014233556f,
+  -0.023880160f, -0.025932499f, -0.013265496f, 0.017937982f,
+  0.065337906f, 0.119829196f, 0.167867385f, 0.196040578f,
+  0.196040578f, 0.167867385f, 0.119829196f, 0.065337906f,
+  0.017937982f, -0.013265496f, -0.025932499f, -0.023880160f,
+  -0.014233556f, -0.003932565f, 0.002776106f, 0.004989660f,
+  0.004132057f, 0.002234629f, 0.000605885f, -0.000507108f,
+};
+
+// Previous samples of the filter followed by the new frame
+static float32_t fir_state[MULTIRES_FIR_TAPS - 1 + MULTIRES_FRAME_SIZE];
+
+// Decimated stream, the low FFT runs once it is full
+static float32_t low_buffer[MULTIRES_LOW_SIZE];
+static uint16_t low_count = 0;
+
+static fft_engine_t low_engine;
+static fft_engine_t high_engine;
+static float32_t fft_input[MULTIRES_LOW_SIZE];
+static float32_t fft_output[MULTIRES_LOW_SIZE];
+static float32_t low_mag[MULTIRES_LOW_SIZE/2];
+static float32_t high_mag[MULTIRES_HIGH_SIZE/2];
+
+// The low path updates once every few frames, keep its results in between
+static float32_t low_bands[10];
+
+void multiresInit(void){
+  fftEngineInit(&low_engine, FFT_AUTOTUNE_ALGO(MULTIRES_LOW_SIZE), MULTIRES_LOW_SIZE);
+  fftEngineInit(&high_engine, FFT_AUTOTUNE_ALGO(MULTIRES_HIGH_SIZE), MULTIRES_HIGH_SIZE);
+  memset(fir_state, 0, sizeof(fir_state));
+  memset(low_bands, 0, sizeof(low_bands));
+  low_count = 0;
+}
+
+/* Low pass filters the new frame, keeping one of every MULTIRES_DECIMATION outputs
+   Only the kept outputs are computed (polyphase form of the decimator) */
+static void decimateFrame(const float32_t *frame){
+  memcpy(&fir_state[MULTIRES_FIR_TAPS - 1], frame, MULTIRES_FRAME_SIZE*sizeof(float32_t));
+
+  for(int i = 0; i<LOW_FRAME_SIZE; i++){
+    // Oldest sample used by this output
+    const float32_t *x = &fir_state[i*MULTIRES_DECIMATION + MULTIRES_DECIMATION - 1];
+    float32_t acc = 0.0f;
+    for(int k = 0; k<MULTIRES_FIR_TAPS; k++){
+      acc += fir_coeffs[k] * x[k];
+    }
+    low_buffer[low_count++] = acc;
+  }
+
+  // Keep the newest samples as history for the next frame
+  memmove(fir_state, &fir_state[MULTIRES_FRAME_SIZE], (MULTIRES_FIR_TAPS - 1)*sizeof(float32_t));
+}
+
+void multiresProcess(const float32_t *frame, float32_t *bands, int band_count){
+  const uint8_t (*table)[2] = (band_count == 5) ? band_table_coupled : band_table_single;
+
+  decimateFrame(frame);
+
+  /* Low path, once the decimated window is full
+     Its bins are MULTIRES_DECIMATION*MULTIRES_LOW_SIZE/MULTIRES_FRAME_SIZE times narrower */
+  if(low_count >= MULTIRES_LOW_SIZE){
+    const int scale = (MULTIRES_DECIMATION*MULTIRES_LOW_SIZE)/MULTIRES_FRAME_SIZE;
+    memcpy(fft_input, low_buffer, MULTIRES_LOW_SIZE*sizeof(float32_t));
+    fftEngineRun(&low_engine, fft_input, fft_output);
+    arm_cmplx_mag_f32(fft_output, low_mag, MULTIRES_LOW_SIZE/2);
+
+    for(int i = 0; i<band_count; i++){
+      if(table[i][1] > MULTIRES_LOW_MAX_BIN) continue;
+      arm_rms_f32(&low_mag[table[i][0]*scale], (table[i][1] - table[i][0])*scale, &low_bands[i]);
+      /* A tone peaks as in the frame FFT (same FFT size), but the RMS spreads it
+         over "scale" times more bins: sqrt(scale) gives back the frame FFT value */
+      low_bands[i] *= sqrtf((float32_t)scale);
+    }
+    low_count = 0;
+  }
+
+  /* High path, newest samples of the frame
+     Its bins are MULTIRES_FRAME_SIZE/MULTIRES_HIGH_SIZE times wider */
+  const int step = MULTIRES_FRAME_SIZE/MULTIRES_HIGH_SIZE;
+  memcpy(fft_input, &frame[MULTIRES_FRAME_SIZE - MULTIRES_HIGH_SIZE], MULTIRES_HIGH_SIZE*sizeof(float32_t));
+  fftEngineRun(&high_engine, fft_input, fft_output);
+  arm_cmplx_mag_f32(fft_output, high_mag, MULTIRES_HIGH_SIZE/2);
+
+  for(int i = 0; i<band_count; i++){
+    if(table[i][1] <= MULTIRES_LOW_MAX_BIN){
+      bands[i] = low_bands[i];
+      continue;
+    }
+    uint32_t first = table[i][0]/step;
+    uint32_t count = (table[i][1] - table[i][0])/step;
+    if(count == 0) count = 1;
+    if(first + count > MULTIRES_HIGH_SIZE/2) count = MULTIRES_HIGH_SIZE/2 - first;
+    arm_rms_f32(&high_mag[first], count, &bands[i]);
+    /* A tone peaks "step" times lower than in the frame FFT, and the RMS spreads
+       it over "step" times fewer bins: sqrt(step) gives back the frame FFT value */
+    bands[i] *= sqrtf((float32_t)step);
+  }
+}
+
+void multiresBenchmark(int band_count, Print &out){
+  const uint8_t (*table)[2] = (band_count == 5) ? band_table_coupled : band_table_single;
+  // Frames between two runs of the low FFT
+  const int frames = MULTIRES_LOW_SIZE/LOW_FRAME_SIZE;
+  static float32_t frame[MULTIRES_FRAME_SIZE];
+  float32_t aux_bands[10];
+  fft_engine_t frame_engine;
+  for(int i = 0; i<MULTIRES_FRAME_SIZE; i++) frame[i] = (i & 0x08) ? 3.0f : 2.0f;
+
+  // Enable the DWT cycle counter
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  // Both paths over a whole period of the low path
+  multiresInit();
+  uint32_t start = DWT->CYCCNT;
+  for(int f = 0; f<frames; f++) multiresProcess(frame, aux_bands, band_count);
+  uint32_t cycles = DWT->CYCCNT - start;
+
+  // The frame path it replaces: frame FFT, magnitude and RMS of the bands
+  fftEngineInit(&frame_engine, FFT_AUTOTUNE_ALGO(MULTIRES_FRAME_SIZE), MULTIRES_FRAME_SIZE);
+  start = DWT->CYCCNT;
+  for(int f = 0; f<frames; f++){
+    memcpy(fft_input, frame, MULTIRES_FRAME_SIZE*sizeof(float32_t));
+    fftEngineRun(&frame_engine, fft_input, fft_output);
+    arm_cmplx_mag_f32(fft_output, low_mag, MULTIRES_FRAME_SIZE/2);
+    for(int i = 0; i<band_count; i++){
+      arm_rms_f32(&low_mag[table[i][0]], table[i][1] - table[i][0], &aux_bands[i]);
+    }
+  }
+  uint32_t frame_cycles = DWT->CYCCNT - start;
+
+  out.print("Multires: "); out.print(cycles/(frames*MULTIRES_FRAME_SIZE));
+  out.print(" cycles per sample, bass window "); out.print(MULTIRES_LOW_SIZE*MULTIRES_DECIMATION);
+  out.print(" samples. Frame path: "); out.print(frame_cycles/(frames*MULTIRES_FRAME_SIZE));
+  out.println(" cycles per sample");
+
+  // Clear the state left by the test
+  multiresInit();
+}
@@ -0,0 +1,51 @@
+/*
+ * Multi-resolution (constant-Q like) band analyzer
+ * Bass bands need fine frequency resolution, treble bands need fine time resolution.
+ * The captured stream is low pass filtered and decimated, so a long window
+ * of the low octaves fits in a small FFT, while the high octaves use a short
+ * FFT over the newest samples of the frame.
+ * The results are merged in the same bands[] array the FFT engine fills.
+ *
+*/
+
+#ifndef MULTIRES_ANALYZER_H
+#define MULTIRES_ANALYZER_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "arm_math.h"
+#include "Print.h"
+
+/* **** Definitions **** */
+// Samples in each captured frame, has to match AMOUNT_SAMPLES in the sketch
+#define MULTIRES_FRAME_SIZE   256
+
+// Decimation applied to the stream used for the low octaves
+#define MULTIRES_DECIMATION   4
+// Taps of the decimation low pass filter
+#define MULTIRES_FIR_TAPS     32
+
+// FFT over the decimated stream (4 frames of history, 4 times the resolution)
+#define MULTIRES_LOW_SIZE     256
+// FFT over the newest samples of the frame (half a frame, twice the time resolution)
+#define MULTIRES_HIGH_SIZE    128
+
+/* Bands ending below this bin (see band_tables.h) use the low path,
+   the rest the high path */
+#define MULTIRES_LOW_MAX_BIN  28
+
+/* **** Function Prototypes **** */
+
+/* Initializes both FFT paths and clears the filter history */
+void multiresInit(void);
+
+/* Feeds a new frame of MULTIRES_FRAME_SIZE samples
+   Writes the RMS magnitude of "band_count" bands (5 coupled, or 10) */
+void multiresProcess(const float32_t *frame, float32_t *bands, int band_count);
+
+/* Prints the cycles per sample of the analyzer, averaged over a run of the
+   low path, next to the ones of the frame FFT path with the same bands
+   The analyzer is left initialized and cleared */
+void multiresBenchmark(int band_count, Print &out);
+
+#endif /* MULTIRES_ANALYZER_H */
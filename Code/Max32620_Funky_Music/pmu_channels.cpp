@@ -0,0 +1,196 @@
+/*
+ * Manager of the PMU channels
+ * See pmu_channels.h
+ *
+*/
+
+/* **** Includes **** */
+#include "pmu_channels.h"
+#include <string.h>
+#include "mxc_config.h"
+#include "mxc_errors.h"
+
+/* **** Definitions **** */
+// Cleared when written back as 1
+#define W1C_FLAGS (MXC_F_PMU_CFG_LL_STOPPED | MXC_F_PMU_CFG_BUS_ERROR | MXC_F_PMU_CFG_TO_STAT | MXC_F_PMU_CFG_INTERRUPT)
+
+typedef struct {
+  const void *program;
+  pmu_callback callback;
+  // Programs chained, oldest first
+  const void *chain_programs[PMU_CHANNEL_CHAIN_DEPTH];
+  pmu_callback chain_callbacks[PMU_CHANNEL_CHAIN_DEPTH];
+  uint8_t chain_head;
+  uint8_t chain_count;
+  pmu_channel_stats_t stats;
+} channel_state_t;
+
+/* **** Globals **** */
+static channel_state_t channels[MXC_CFG_PMU_CHANNELS];
+static uint8_t used = 0;
+// Channels started by the manager, the ones read by the interrupt
+static volatile uint8_t started = 0;
+// Nesting of the sections with the PMU interrupt masked, the handler counts as one
+static uint8_t locks = 0;
+
+/* **** Functions **** */
+static void lock(void){
+  NVIC_DisableIRQ(PMU_IRQn);
+  locks++;
+}
+
+static void unlock(void){
+  if(--locks == 0) NVIC_EnableIRQ(PMU_IRQn);
+}
+
+static int reserved(int channel){
+  return (channel >= 0) && (channel < MXC_CFG_PMU_CHANNELS) && (used & (1 << channel));
+}
+
+static void countErrors(channel_state_t *state, uint32_t flags){
+  if(flags & MXC_F_PMU_CFG_BUS_ERROR) state->stats.bus_errors++;
+  if(flags & MXC_F_PMU_CFG_TO_STAT) state->stats.timeouts++;
+}
+
+static int startProgram(int channel, const void *program, pmu_callback callback){
+  channel_state_t *state = &channels[channel];
+  int error = PMU_Start(channel, program, NULL);
+  if(error != E_NO_ERROR) return error;
+  state->program = program;
+  state->callback = callback;
+  state->stats.starts++;
+
+  // PMU_Start only enables the interrupt for the callbacks of PMU_Handler
+  mxc_pmu_regs_t *regs = &MXC_PMU0[channel];
+  regs->cfg = (regs->cfg & ~W1C_FLAGS) | MXC_F_PMU_CFG_INT_EN;
+  started |= (1 << channel);
+  return E_NO_ERROR;
+}
+
+/* The oldest program chained, if any */
+static void startNext(int channel){
+  channel_state_t *state = &channels[channel];
+  if(state->chain_count == 0){
+    started &= ~(1 << channel);
+    return;
+  }
+  const void *program = state->chain_programs[state->chain_head];
+  pmu_callback callback = state->chain_callbacks[state->chain_head];
+  state->chain_head = (state->chain_head + 1) % PMU_CHANNEL_CHAIN_DEPTH;
+  state->chain_count--;
+  startProgram(channel, program, callback);
+}
+
+int pmuChannelAlloc(void){
+  for(int channel = 0; channel<MXC_CFG_PMU_CHANNELS; channel++){
+    #if (MXC_PMU_REV == 0)
+    // Runs the workaround program when any other channel is enabled
+    if(channel == 5) break;
+    #endif
+    if(!(used & (1 << channel)) && !PMU_IsActive(channel)){
+      memset(&channels[channel], 0, sizeof(channel_state_t));
+      used |= (1 << channel);
+      return channel;
+    }
+  }
+  return E_NONE_AVAIL;
+}
+
+void pmuChannelFree(int channel){
+  if(!reserved(channel)) return;
+  pmuChannelStop(channel);
+  used &= ~(1 << channel);
+}
+
+uint8_t pmuChannelsUsed(void){
+  return used;
+}
+
+int pmuChannelStart(int channel, const void *program, pmu_callback callback){
+  if(!reserved(channel) || program == NULL) return E_BAD_PARAM;
+  lock();
+  int error = startProgram(channel, program, callback);
+  unlock();
+  return error;
+}
+
+int pmuChannelChain(int channel, const void *program, pmu_callback callback){
+  if(!reserved(channel) || program == NULL) return E_BAD_PARAM;
+  int error = E_NO_ERROR;
+  lock();
+  channel_state_t *state = &channels[channel];
+  if(state->chain_count < PMU_CHANNEL_CHAIN_DEPTH){
+    int tail = (state->chain_head + state->chain_count) % PMU_CHANNEL_CHAIN_DEPTH;
+    state->chain_programs[tail] = program;
+    state->chain_callbacks[tail] = callback;
+    state->chain_count++;
+    if(!PMU_IsActive(channel)) startNext(channel);
+  }
+  else{
+    error = E_BUSY;
+  }
+  unlock();
+  return error;
+}
+
+int pmuChannelRestart(int channel){
+  if(!reserved(channel)) return E_BAD_PARAM;
+  if(channels[channel].program == NULL) return E_UNINITIALIZED;
+  lock();
+  PMU_Stop(channel);
+  int error = startProgram(channel, channels[channel].program, channels[channel].callback);
+  unlock();
+  return error;
+}
+
+void pmuChannelStop(int channel){
+  if(!reserved(channel)) return;
+  lock();
+  PMU_Stop(channel);
+  channels[channel].chain_count = 0;
+  started &= ~(1 << channel);
+  unlock();
+}
+
+int pmuChannelActive(int channel){
+  return reserved(channel) && PMU_IsActive(channel);
+}
+
+void pmuChannelsHandler(void){
+  // The callbacks can start channels, the interrupt stays masked until the end
+  locks++;
+  uint32_t pending = started;
+  while(pending){
+    int channel = 31 - __CLZ(pending);
+    pending &= ~(1UL << channel);
+
+    uint32_t flags = PMU_GetFlags(channel);
+    if(!(flags & MXC_F_PMU_CFG_INTERRUPT)) continue;
+    PMU_ClearFlags(channel, flags & W1C_FLAGS);
+
+    channel_state_t *state = &channels[channel];
+    state->stats.interrupts++;
+    countErrors(state, flags);
+    if(state->callback) state->callback(flags);
+
+    // Stopped by the program or by an error
+    if(!PMU_IsActive(channel)) startNext(channel);
+  }
+  unlock();
+}
+
+void pmuChannelStats(int channel, pmu_channel_stats_t *stats){
+  if(!reserved(channel)){
+    memset(stats, 0, sizeof(pmu_channel_stats_t));
+    return;
+  }
+  lock();
+  // The errors of a descriptor without interrupt are only seen here
+  uint32_t errors = PMU_GetFlags(channel) & (MXC_F_PMU_CFG_BUS_ERROR | MXC_F_PMU_CFG_TO_STAT);
+  if(errors){
+    countErrors(&channels[channel], errors);
+    PMU_ClearFlags(channel, errors);
+  }
+  *stats = channels[channel].stats;
+  unlock();
+}
@@ -0,0 +1,73 @@
+/*
+ * Manager of the PMU channels shared by the programs of the sketch
+ * - Allocation: the ADC capture, the led commit and the telemetry copy run on
+ *   their own channel, each one takes the first channel free instead of a fixed
+ *   number. A channel already running (started directly with PMU_Start) is never
+ *   given. With MXC_PMU_REV 0 the channel 5 is kept for the erratum workaround of pmu.c
+ * - Chaining: programs queued on a channel start from the interrupt, as soon as
+ *   the running one stops. The stop descriptor has to interrupt (PMU_INTERRUPT, PMU_STOP)
+ * - Restart: the last program of a channel starts again from its first descriptor
+ * - Dispatch: pmuChannelsHandler replaces PMU_Handler in the PMU interrupt. There is
+ *   no register with the flags of every channel, so only the channels started here
+ *   are read, in a count leading zeros loop over their mask, and the callback of a
+ *   channel is only called when its interrupt flag is set
+ * - Statistics of each channel: interrupts, bus errors and timeouts seen in its flags
+ * The channels are started and stopped from the loop or from the callbacks.
+ *
+*/
+
+#ifndef PMU_CHANNELS_H
+#define PMU_CHANNELS_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "pmu.h"
+
+/* **** Definitions **** */
+// Programs waiting on each channel
+#define PMU_CHANNEL_CHAIN_DEPTH 2
+
+typedef struct {
+  uint32_t interrupts;
+  uint32_t bus_errors;
+  uint32_t timeouts;
+  // Programs started, chained and restarted included
+  uint32_t starts;
+} pmu_channel_stats_t;
+
+/* **** Function Prototypes **** */
+
+/* Returns the channel reserved, or E_NONE_AVAIL if all of them are used */
+int pmuChannelAlloc(void);
+
+/* Stops the channel and gives it back */
+void pmuChannelFree(int channel);
+
+/* Bit n set if the channel n is reserved */
+uint8_t pmuChannelsUsed(void);
+
+/* Starts a program on a reserved channel, callback (or NULL) is called with the
+   flags of the channel on every interrupt of the program
+   Returns E_NO_ERROR, E_BAD_PARAM or E_BUSY if the channel is running */
+int pmuChannelStart(int channel, const void *program, pmu_callback callback);
+
+/* Starts the program when the one running stops, or at once if the channel is stopped
+   Returns E_BUSY if PMU_CHANNEL_CHAIN_DEPTH programs are waiting already */
+int pmuChannelChain(int channel, const void *program, pmu_callback callback);
+
+/* Stops the channel and starts its last program again, from the first descriptor */
+int pmuChannelRestart(int channel);
+
+/* Stops the channel, the programs chained are dropped */
+void pmuChannelStop(int channel);
+
+/* 1 while the channel runs a program */
+int pmuChannelActive(int channel);
+
+/* Called by the PMU interrupt */
+void pmuChannelsHandler(void);
+
+/* Statistics of the channel since it was reserved, errors not dispatched yet included */
+void pmuChannelStats(int channel, pmu_channel_stats_t *stats);
+
+#endif /* PMU_CHANNELS_H */
@@ -0,0 +1,201 @@
+/*
+ * Streaming compression of spectrum frames
+ * See spectrum_codec.h
+ *
+*/
+
+/* **** Includes **** */
+#include "spectrum_codec.h"
+#include <string.h>
+#include <math.h>
+#if defined(__arm__)
+#include "mxc_config.h"
+#include "max32620.h"
+#endif
+
+/* **** Definitions **** */
+// Segments of the log2 table, the mantissa between them is interpolated
+#define LOG2_TABLE_BITS 5
+#define LOG2_TABLE_SIZE (1 << LOG2_TABLE_BITS)
+
+/* **** Globals **** */
+// log2(1 + i/LOG2_TABLE_SIZE)
+static float log2_table[LOG2_TABLE_SIZE + 1];
+static uint8_t log2_table_done = 0;
+
+/* log2 from the exponent of the float, and the mantissa looked up in log2_table
+   The interpolation error is below 0.0002, a small part of a code */
+static inline float fastLog2(float x){
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127;
+  uint32_t mantissa = bits & 0x7FFFFF;
+  uint32_t index = mantissa >> (23 - LOG2_TABLE_BITS);
+  float fraction = (float)(mantissa & ((1 << (23 - LOG2_TABLE_BITS)) - 1)) * (1.0f / (1 << (23 - LOG2_TABLE_BITS)));
+  return (float)exponent + log2_table[index] + (log2_table[index + 1] - log2_table[index]) * fraction;
+}
+
+static inline uint32_t zigzag(int32_t value){
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value){
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline uint8_t *putVarint(uint8_t *p, uint32_t value){
+  while(value >= 0x80){
+    *p++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *p++ = (uint8_t)value;
+  return p;
+}
+
+int spectrumCodecInit(spectrum_codec_t *codec, uint16_t bins, uint8_t bits, int8_t log2_min, int8_t log2_max){
+  if(bins == 0 || bins > SPECTRUM_CODEC_MAX_BINS) return 0;
+  if(bits < SPECTRUM_CODEC_MIN_BITS || bits > SPECTRUM_CODEC_MAX_BITS) return 0;
+  if(log2_max <= log2_min) return 0;
+
+  if(!log2_table_done){
+    for(int i = 0; i<=LOG2_TABLE_SIZE; i++) log2_table[i] = log2f(1.0f + (float)i / LOG2_TABLE_SIZE);
+    log2_table_done = 1;
+  }
+
+  codec->bins = bins;
+  codec->bits = bits;
+  codec->log2_min = log2_min;
+  codec->log2_max = log2_max;
+  codec->steps_per_octave = (float)((1 << bits) - 1) / (float)(log2_max - log2_min);
+  codec->last_cycles = 0;
+  codec->last_size = 0;
+  codec->total_raw = 0;
+  codec->total_encoded = 0;
+  spectrumCodecReset(codec);
+
+  #if defined(__arm__)
+  // Enable the DWT cycle counter, used for the encoder statistics
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  #endif
+  return 1;
+}
+
+void spectrumCodecReset(spectrum_codec_t *codec){
+  codec->frames = 0;
+}
+
+size_t spectrumCodecEncode(spectrum_codec_t *codec, const float *magnitude, uint8_t *out){
+  #if defined(__arm__)
+  uint32_t start = DWT->CYCCNT;
+  #endif
+  const int32_t max_code = (1 << codec->bits) - 1;
+  const float offset = (float)codec->log2_min;
+  const float steps = codec->steps_per_octave;
+  uint8_t keyframe = (codec->frames == 0);
+
+  uint8_t *p = out;
+  *p++ = keyframe ? SPECTRUM_CODEC_KEYFRAME : 0;
+  *p++ = codec->bits;
+  *p++ = (uint8_t)codec->log2_min;
+  *p++ = (uint8_t)codec->log2_max;
+  *p++ = (uint8_t)codec->bins;
+  *p++ = (uint8_t)(codec->bins >> 8);
+
+  // Keyframes are coded against the previous bin, the other frames against the previous frame
+  int32_t reference = 0;
+  for(int i = 0; i<codec->bins; i++){
+    int32_t code = 0;
+    // Zero, negative and denormal magnitudes get code 0
+    if(magnitude[i] >= 1.17549435e-38f){
+      float level = (fastLog2(magnitude[i]) - offset) * steps + 0.5f;
+      if(level >= (float)max_code) code = max_code;
+      else if(level > 0.0f) code = (int32_t)level;
+    }
+    if(!keyframe) reference = codec->previous[i];
+    p = putVarint(p, zigzag(code - reference));
+    codec->previous[i] = (uint16_t)code;
+    reference = code;
+  }
+
+  codec->frames++;
+  if(codec->frames >= SPECTRUM_CODEC_KEYFRAME_INTERVAL) codec->frames = 0;
+
+  size_t size = p - out;
+  codec->last_size = (uint16_t)size;
+  codec->total_raw += 4*codec->bins;
+  codec->total_encoded += size;
+  #if defined(__arm__)
+  codec->last_cycles = DWT->CYCCNT - start;
+  #endif
+  return size;
+}
+
+int spectrumCodecDecode(spectrum_codec_t *codec, const uint8_t *in, size_t length, float *magnitude){
+  if(length < SPECTRUM_CODEC_HEADER_SIZE) return -1;
+  const uint8_t *end = in + length;
+  uint8_t keyframe = in[0] & SPECTRUM_CODEC_KEYFRAME;
+  uint8_t bits = in[1];
+  int8_t log2_min = (int8_t)in[2];
+  int8_t log2_max = (int8_t)in[3];
+  uint16_t bins = (uint16_t)(in[4] | (in[5] << 8));
+  const uint8_t *p = in + SPECTRUM_CODEC_HEADER_SIZE;
+
+  uint8_t same_config = (bins == codec->bins && bits == codec->bits &&
+                         log2_min == codec->log2_min && log2_max == codec->log2_max);
+  if(keyframe){
+    // The encoder configuration changed, the statistics restart
+    if(!same_config && !spectrumCodecInit(codec, bins, bits, log2_min, log2_max)) return -1;
+  }
+  else{
+    // Deltas against a frame that was not received, or of another configuration
+    if(codec->frames == 0) return 0;
+    if(!same_config){
+      spectrumCodecReset(codec);
+      return 0;
+    }
+  }
+
+  const int32_t max_code = (1 << codec->bits) - 1;
+  const float step = 1.0f / codec->steps_per_octave;
+  int32_t reference = 0;
+  for(int i = 0; i<bins; i++){
+    uint32_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do{
+      if(p >= end || shift > 28){
+        spectrumCodecReset(codec);
+        return -1;
+      }
+      byte = *p++;
+      value |= (uint32_t)(byte & 0x7F) << shift;
+      shift += 7;
+    } while(byte & 0x80);
+
+    if(!keyframe) reference = codec->previous[i];
+    int32_t code = reference + unzigzag(value);
+    if(code < 0 || code > max_code){
+      spectrumCodecReset(codec);
+      return -1;
+    }
+    codec->previous[i] = (uint16_t)code;
+    reference = code;
+    magnitude[i] = (code == 0) ? 0.0f : exp2f((float)code * step + (float)codec->log2_min);
+  }
+  if(p != end){
+    spectrumCodecReset(codec);
+    return -1;
+  }
+
+  // Any non zero value, the next deltas can be decoded
+  codec->frames = 1;
+  codec->total_raw += 4*bins;
+  codec->total_encoded += length;
+  return bins;
+}
+
+float spectrumCodecRatio(const spectrum_codec_t *codec){
+  if(codec->total_encoded == 0) return 0.0f;
+  return (float)codec->total_raw / (float)codec->total_encoded;
+}
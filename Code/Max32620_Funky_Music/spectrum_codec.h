@@ -0,0 +1,84 @@
+/*
+ * Streaming compression of spectrum frames
+ * A 128 bins magnitude frame is 512 bytes as floats, too much for 115200 bauds
+ * at the frame rate. Each bin is quantized to SPECTRUM_CODEC bits in the log domain
+ * (the leds work on a log scale too), delta coded against the same bin of the
+ * previous frame, and packed with zig-zag + varint, so the usual small changes
+ * take a single byte. Every SPECTRUM_CODEC_KEYFRAME_INTERVAL frames a keyframe
+ * is sent, delta coded against the previous bin instead, so a decoder can start
+ * or recover from a lost frame.
+ * Fixed memory, no float math libraries on the encoder side. Only depends on
+ * stdint.h, the same file is built by the host tools for decoding.
+ *
+ * Encoded frame:
+ *   uint8  flags            SPECTRUM_CODEC_KEYFRAME
+ *   uint8  bits             quantization bits
+ *   int8   log2 min         code 0 is a magnitude <= 2^log2 min
+ *   int8   log2 max         the last code is a magnitude >= 2^log2 max
+ *   uint16 bins             little endian
+ *   varint zig-zag deltas, one per bin
+ *
+*/
+
+#ifndef SPECTRUM_CODEC_H
+#define SPECTRUM_CODEC_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include <stddef.h>
+
+/* **** Definitions **** */
+#define SPECTRUM_CODEC_MAX_BINS           256
+#define SPECTRUM_CODEC_MIN_BITS           8
+#define SPECTRUM_CODEC_MAX_BITS           12
+#define SPECTRUM_CODEC_KEYFRAME_INTERVAL  32
+
+// Defaults for the FFT magnitudes of the sketch (volts), about 0.14 dB per code
+#define SPECTRUM_CODEC_DEFAULT_BITS       10
+#define SPECTRUM_CODEC_DEFAULT_LOG2_MIN   -12
+#define SPECTRUM_CODEC_DEFAULT_LOG2_MAX   12
+
+#define SPECTRUM_CODEC_KEYFRAME           0x01
+
+#define SPECTRUM_CODEC_HEADER_SIZE        6
+// A delta of 12 bits codes takes 13 bits after the zig-zag, 2 varint bytes
+#define SPECTRUM_CODEC_MAX_ENCODED (SPECTRUM_CODEC_HEADER_SIZE + 2*SPECTRUM_CODEC_MAX_BINS)
+
+typedef struct {
+  uint16_t bins;
+  uint8_t bits;
+  int8_t log2_min;
+  int8_t log2_max;
+  float steps_per_octave;
+  // Frames since the last keyframe, 0 if the next frame has to be a keyframe
+  uint16_t frames;
+  // Codes of the previous frame, the reference of the deltas
+  uint16_t previous[SPECTRUM_CODEC_MAX_BINS];
+  // Statistics of the encoder
+  uint32_t last_cycles;
+  uint16_t last_size;
+  uint32_t total_raw;
+  uint32_t total_encoded;
+} spectrum_codec_t;
+
+/* **** Function Prototypes **** */
+
+/* Configures the codec for frames of bins magnitudes
+   Returns 0 if the parameters are out of range */
+int spectrumCodecInit(spectrum_codec_t *codec, uint16_t bins, uint8_t bits, int8_t log2_min, int8_t log2_max);
+
+/* The next frame encoded is a keyframe, and the decoder waits for one */
+void spectrumCodecReset(spectrum_codec_t *codec);
+
+/* Encodes a frame of magnitudes, out needs SPECTRUM_CODEC_MAX_ENCODED bytes
+   Returns the size of the encoded frame */
+size_t spectrumCodecEncode(spectrum_codec_t *codec, const float *magnitude, uint8_t *out);
+
+/* Decodes a frame, taking the parameters from its header
+   Returns the number of bins, 0 if a keyframe is needed first, -1 if the data is wrong */
+int spectrumCodecDecode(spectrum_codec_t *codec, const uint8_t *in, size_t length, float *magnitude);
+
+/* Raw size (4 bytes per bin) divided by the encoded size, of all the frames encoded */
+float spectrumCodecRatio(const spectrum_codec_t *codec);
+
+#endif /* SPECTRUM_CODEC_H */
@@ -0,0 +1,70 @@
+/*
+ * Cooperative scheduler of stackless tasks
+ * See task_scheduler.h
+ *
+*/
+
+/* **** Includes **** */
+#include "task_scheduler.h"
+#include "mxc_errors.h"
+
+/* **** Globals **** */
+static task_t *tasks[SCHEDULER_MAX_TASKS];
+static uint8_t tasks_count = 0;
+// Time of the task calls at any nesting level, a call takes off the part of its
+// nested calls (from yield) so it is not counted twice
+static uint32_t called_us = 0;
+
+/* **** Functions **** */
+int schedulerAdd(task_t *task){
+  if(tasks_count >= SCHEDULER_MAX_TASKS) return E_NONE_AVAIL;
+  task->started = 0;
+  task->running = 0;
+  task->restart = 0;
+  tasks[tasks_count++] = task;
+  return E_NO_ERROR;
+}
+
+void taskStart(task_t *task){
+  // The function would overwrite the resume point when it returns
+  if(task->running) task->restart = 1;
+  task->resume = 0;
+  task->started = 1;
+}
+
+void taskStop(task_t *task){
+  task->started = 0;
+  task->restart = 0;
+}
+
+void schedulerRun(void){
+  for(uint8_t i = 0; i<tasks_count; i++){
+    task_t *task = tasks[i];
+    if(!task->started || task->running) continue;
+
+    uint32_t nested_start = called_us;
+    uint32_t start = micros();
+    task->running = 1;
+    uint8_t state = task->function(task);
+    task->running = 0;
+    uint32_t elapsed = micros() - start;
+    task->runs++;
+    task->busy_us += elapsed - (called_us - nested_start);
+    called_us = nested_start + elapsed;
+    if(task->restart){
+      task->restart = 0;
+      task->resume = 0;
+    }
+    else if(state == TASK_DONE){
+      task->started = 0;
+    }
+  }
+}
+
+uint8_t schedulerCount(void){
+  return tasks_count;
+}
+
+task_t *schedulerTask(uint8_t index){
+  return (index < tasks_count) ? tasks[index] : NULL;
+}
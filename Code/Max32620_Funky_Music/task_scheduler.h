@@ -0,0 +1,87 @@
+/*
+ * Cooperative scheduler of stackless tasks (protothreads)
+ * A task is a function that runs until its next wait point and returns, the
+ * point reached is kept in the task, and the next call resumes from it
+ * (a switch on the line of the wait, hidden in the TASK_xxx macros).
+ * The local variables are lost at every wait point, the ones used across
+ * them have to be static.
+ * schedulerRun calls every task started once, in the order they were added,
+ * so the tasks always interleave the same way. It is called by loop() and
+ * by yield(), so a blocking delay() in a task lets the other ones run, the
+ * task waiting in it is not called again until it returns. delay() of the
+ * BSP functions, tone() with a duration for instance, runs the tasks as well.
+ * No switch statement can hold a wait point, it would take the case labels.
+ *
+*/
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "Arduino.h"
+
+/* **** Definitions **** */
+// Tasks added with schedulerAdd
+#define SCHEDULER_MAX_TASKS 8
+
+// Returned by the task functions
+#define TASK_WAITING 0
+#define TASK_DONE    1
+
+typedef struct task_t task_t;
+typedef uint8_t (*task_function_t)(task_t *task);
+
+struct task_t {
+  task_function_t function;
+  const char *name;
+  // Line of the wait point to resume from, 0 to start from the beginning
+  uint16_t resume;
+  uint8_t started;
+  // In the function, yield() does not call it again
+  uint8_t running;
+  // taskStart called while running, applied when the function returns
+  uint8_t restart;
+  // Start of the TASK_DELAY being waited
+  uint32_t timer;
+  // Calls and time spent in them, in us, without the other tasks run by its yield()
+  uint32_t runs;
+  uint32_t busy_us;
+};
+
+#define TASK_INIT(function, name) {function, name, 0, 0, 0, 0, 0, 0, 0}
+
+/* Body of a task function: TASK_BEGIN(task); ... TASK_END(task); */
+#define TASK_BEGIN(task) switch((task)->resume){ case 0:
+#define TASK_END(task) } (task)->resume = 0; return TASK_DONE
+
+/* Returns to the scheduler until the condition is true */
+#define TASK_WAIT_UNTIL(task, condition) \
+  do{ (task)->resume = __LINE__; case __LINE__: if(!(condition)) return TASK_WAITING; }while(0)
+
+/* Lets every other task run once */
+#define TASK_YIELD(task) \
+  do{ (task)->resume = __LINE__; return TASK_WAITING; case __LINE__:; }while(0)
+
+/* Waits ms milliseconds without blocking */
+#define TASK_DELAY(task, ms) \
+  do{ (task)->timer = millis(); TASK_WAIT_UNTIL(task, millis() - (task)->timer >= (uint32_t)(ms)); }while(0)
+
+/* **** Function Prototypes **** */
+
+/* Adds a task to the scheduler, stopped. Returns E_NO_ERROR or E_NONE_AVAIL */
+int schedulerAdd(task_t *task);
+
+/* Starts the task from its beginning, or stops it where it is */
+void taskStart(task_t *task);
+void taskStop(task_t *task);
+
+/* Calls every task started until its next wait point
+   Nested calls (from yield) skip the tasks that are running */
+void schedulerRun(void);
+
+/* Tasks added, to read their statistics */
+uint8_t schedulerCount(void);
+task_t *schedulerTask(uint8_t index);
+
+#endif /* TASK_SCHEDULER_H */
@@ -0,0 +1,195 @@
+/*
+ * Binary telemetry of the processed frames
+ * See telemetry.h
+ *
+*/
+
+/* **** Includes **** */
+#include "telemetry.h"
+#include <string.h>
+#include "mxc_config.h"
+#include "crc.h"
+
+/* **** Globals **** */
+// Words, so the packet can be given to the CRC32 peripheral as it is
+static uint32_t packet[TELEMETRY_MAX_PACKET/4];
+// Owned by the port until the callback of the request clears its busy flag
+static uint8_t encoded[TELEMETRY_ASYNC_BUFFERS][TELEMETRY_MAX_ENCODED];
+static uart_req_t requests[TELEMETRY_ASYNC_BUFFERS];
+static volatile uint8_t busy[TELEMETRY_ASYNC_BUFFERS];
+static uint16_t sequence = 0;
+static uint8_t started = 0;
+
+void telemetryInit(void){
+  // Little endian, the words are taken in the same order they are sent
+  CRC32_Init(1);
+  sequence = 0;
+  started = 0;
+}
+
+static inline uint8_t *put16(uint8_t *p, uint16_t value){
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  return p + 2;
+}
+
+static inline uint8_t *put32(uint8_t *p, uint32_t value){
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+  return p + 4;
+}
+
+/* Consistent Overhead Byte Stuffing: every zero is replaced by the distance
+   to the next one, so the only zero of the stream is the delimiter */
+static size_t cobsEncode(const uint8_t *in, size_t length, uint8_t *out){
+  size_t code_index = 0;
+  size_t o = 1;
+  uint8_t code = 1;
+
+  for(size_t i = 0; i<length; i++){
+    if(in[i] == 0){
+      out[code_index] = code;
+      code_index = o++;
+      code = 1;
+    }
+    else{
+      out[o++] = in[i];
+      code++;
+      // Block of 254 bytes without zeros
+      if(code == 0xFF){
+        out[code_index] = code;
+        code_index = o++;
+        code = 1;
+      }
+    }
+  }
+  out[code_index] = code;
+  return o;
+}
+
+/* Called once the port has every byte of the buffer in its FIFO
+   From the interrupt, or from writeAsync() itself if it fit in the FIFO */
+static void sentCallback(uart_req_t *req, int err){
+  (void)err;
+  busy[req - requests] = 0;
+}
+
+/* Adds the CRC to the packet built up to end, and writes it COBS encoded
+   To "port" with writeAsync() if given, or to "out" */
+static size_t sendPacket(uint8_t *end, Print *out, MXC_HardwareSerial *port){
+  // A free buffer, the loop is the only one that sets the flags
+  int index = 0;
+  while((index < TELEMETRY_ASYNC_BUFFERS) && busy[index]) index++;
+  if(index == TELEMETRY_ASYNC_BUFFERS) return 0;
+  uint8_t *buffer = encoded[index];
+
+  // Every part is a multiple of 4 bytes, so the CRC is taken a word at a time
+  // The words are written one by one, a memcpy could use byte writes, that would be padded to 32 bits
+  size_t words = (end - (uint8_t *)packet)/4;
+  CRC32_Reseed(0xFFFFFFFF);
+  for(size_t i = 0; i<words; i++) CRC32_AddData(packet[i]);
+  end = put32(end, CRC32_GetCRC());
+
+  // The first packet starts with a delimiter too, so the host does not wait for the next one to sync
+  size_t length = 0;
+  uint8_t first = !started;
+  if(first) buffer[length++] = TELEMETRY_DELIMITER;
+  started = 1;
+  length += cobsEncode((const uint8_t *)packet, end - (uint8_t *)packet, &buffer[length]);
+  buffer[length++] = TELEMETRY_DELIMITER;
+
+  if(port == NULL) return out->write(buffer, length);
+
+  uart_req_t *req = &requests[index];
+  req->data = buffer;
+  req->len = length;
+  req->callback = sentCallback;
+  busy[index] = 1;
+  if(port->writeAsync(req) != E_NO_ERROR){
+    busy[index] = 0;
+    if(first) started = 0;
+    return 0;
+  }
+  return length;
+}
+
+static size_t sendFrame(const telemetry_frame_t *frame, Print *out, MXC_HardwareSerial *port){
+  if(frame->bands_count > TELEMETRY_MAX_BANDS) return 0;
+  if(frame->raw && frame->raw_count > TELEMETRY_MAX_RAW) return 0;
+  if(frame->magnitude && frame->magnitude_count > TELEMETRY_MAX_MAGNITUDE) return 0;
+  if(frame->spectrum && frame->spectrum_length > TELEMETRY_MAX_SPECTRUM) return 0;
+
+  uint8_t blocks = 0;
+  if(frame->raw) blocks |= TELEMETRY_BLOCK_RAW;
+  if(frame->magnitude) blocks |= TELEMETRY_BLOCK_MAGNITUDE;
+  if(frame->spectrum) blocks |= TELEMETRY_BLOCK_SPECTRUM;
+
+  uint8_t *p = (uint8_t *)packet;
+  *p++ = TELEMETRY_PACKET_FRAME;
+  *p++ = blocks;
+  p = put16(p, sequence);
+  p = put32(p, frame->timestamp);
+  *p++ = frame->bands_count;
+  *p++ = 0;
+  p = put16(p, frame->leds);
+  // The core is little endian, the floats are copied as they are
+  memcpy(p, frame->bands, 4*frame->bands_count);
+  p += 4*frame->bands_count;
+
+  if(frame->raw){
+    p = put16(p, frame->raw_count);
+    p = put16(p, 0);
+    for(int i = 0; i<frame->raw_count; i++) p = put16(p, (uint16_t)frame->raw[i]);
+    if(frame->raw_count & 1) p = put16(p, 0);
+  }
+  if(frame->magnitude){
+    p = put16(p, frame->magnitude_count);
+    p = put16(p, 0);
+    memcpy(p, frame->magnitude, 4*frame->magnitude_count);
+    p += 4*frame->magnitude_count;
+  }
+  if(frame->spectrum){
+    p = put16(p, frame->spectrum_length);
+    p = put16(p, frame->spectrum_cycles > 0xFFFF ? 0xFFFF : (uint16_t)frame->spectrum_cycles);
+    memcpy(p, frame->spectrum, frame->spectrum_length);
+    p += frame->spectrum_length;
+    while((p - (uint8_t *)packet) & 3) *p++ = 0;
+  }
+
+  sequence++;
+  return sendPacket(p, out, port);
+}
+
+size_t telemetrySendFrame(const telemetry_frame_t *frame, Print &out){
+  return sendFrame(frame, &out, NULL);
+}
+
+size_t telemetrySendFrame(const telemetry_frame_t *frame, MXC_HardwareSerial &port){
+  return sendFrame(frame, NULL, &port);
+}
+
+static size_t sendData(const uint8_t *data, size_t length, Print *out, MXC_HardwareSerial *port){
+  if((length & 3) || length > TELEMETRY_MAX_PACKET - TELEMETRY_CRC_SIZE) return 0;
+  memcpy(packet, data, length);
+  return sendPacket((uint8_t *)packet + length, out, port);
+}
+
+size_t telemetrySendPacket(const uint8_t *data, size_t length, Print &out){
+  return sendData(data, length, &out, NULL);
+}
+
+size_t telemetrySendPacket(const uint8_t *data, size_t length, MXC_HardwareSerial &port){
+  return sendData(data, length, NULL, &port);
+}
+
+uint8_t telemetryAsyncFree(void){
+  uint8_t count = 0;
+  for(int i = 0; i<TELEMETRY_ASYNC_BUFFERS; i++) if(!busy[i]) count++;
+  return count;
+}
+
+uint16_t telemetrySequence(void){
+  return sequence;
+}
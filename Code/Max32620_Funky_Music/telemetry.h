@@ -0,0 +1,68 @@
+/*
+ * Binary telemetry of the processed frames
+ * Printing the bands with Serial.print(x, 2) formats every float on the MCU,
+ * and fills 115200 bauds with a few frames per second. Instead each frame is sent
+ * as a binary packet (see telemetry_protocol.h), protected with the CRC32 peripheral
+ * and COBS framed, so the host can find the start of the packets and drop the bad ones.
+ * Any Print can carry it: a MXC_HardwareSerial port or Serial_USB.
+ * The UART ports (Serial0 to Serial2) send the encoded packet with writeAsync():
+ * it stays in a buffer of this module, not copied to the ring of the port, and
+ * the loop does not wait for the room in the ring.
+ * The packets are decoded on the host with the library in "Code/Host tools"
+ *
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "arm_math.h"
+#include "Print.h"
+#include "MXC_HardwareSerial.h"
+#include "telemetry_protocol.h"
+
+/* **** Definitions **** */
+// Encoded packets that can be sent at the same time with writeAsync()
+#define TELEMETRY_ASYNC_BUFFERS 2
+
+typedef struct {
+  uint32_t timestamp;
+  const float32_t *bands;
+  uint8_t bands_count;
+  uint16_t leds;
+  // Optional blocks, not sent if NULL
+  const uint32_t *raw;
+  uint16_t raw_count;
+  const float32_t *magnitude;
+  uint16_t magnitude_count;
+  // Encoded by spectrumCodecEncode
+  const uint8_t *spectrum;
+  uint16_t spectrum_length;
+  uint32_t spectrum_cycles;
+} telemetry_frame_t;
+
+/* **** Function Prototypes **** */
+
+/* Configures the CRC32 peripheral and restarts the sequence number */
+void telemetryInit(void);
+
+/* Builds, encodes and writes the packet of a frame
+   Returns the number of bytes written, 0 if the frame does not fit in a packet
+   On a UART port, 0 as well if the TELEMETRY_ASYNC_BUFFERS are still being sent:
+   the frame is dropped, its sequence number is skipped */
+size_t telemetrySendFrame(const telemetry_frame_t *frame, Print &out);
+size_t telemetrySendFrame(const telemetry_frame_t *frame, MXC_HardwareSerial &port);
+
+/* Adds the CRC to a packet built by another module (deferred_log), encodes and writes it
+   The length has to be a multiple of 4 bytes. Returns the number of bytes written */
+size_t telemetrySendPacket(const uint8_t *data, size_t length, Print &out);
+size_t telemetrySendPacket(const uint8_t *data, size_t length, MXC_HardwareSerial &port);
+
+/* Number of buffers not being sent with writeAsync(), a packet for a UART port needs one */
+uint8_t telemetryAsyncFree(void);
+
+/* Sequence number of the next frame packet */
+uint16_t telemetrySequence(void);
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,71 @@
+/*
+ * Wire format of the binary telemetry stream
+ * Shared by the sketch (telemetry.cpp) and the host decoder (Code/Host tools),
+ * so it only depends on stdint.h
+ *
+ * Every packet is little endian and a multiple of 4 bytes long, ended by a CRC:
+ * Frame packet
+ *   uint8   type            TELEMETRY_PACKET_FRAME
+ *   uint8   blocks          TELEMETRY_BLOCK_* flags of the optional blocks present
+ *   uint16  sequence        +1 on every frame, gaps are lost frames
+ *   uint32  timestamp       micros() when the frame was sent
+ *   uint8   bands count
+ *   uint8   0
+ *   uint16  leds            bit i set if music_leds_array[i] is on
+ *   float32 bands[bands count]
+ *   Raw block (TELEMETRY_BLOCK_RAW): uint16 count, uint16 0, uint16 samples[count], padded to 4 bytes
+ *   Magnitude block (TELEMETRY_BLOCK_MAGNITUDE): uint16 count, uint16 0, float32 bins[count]
+ *   Spectrum block (TELEMETRY_BLOCK_SPECTRUM): uint16 length, uint16 encode cycles (saturated),
+ *     uint8 data[length] padded to 4 bytes, the magnitudes compressed by spectrum_codec.h
+ *   uint32  crc             CRC-32 (the one of zlib) of all the previous bytes
+ * Log packet, records of deferred_log.h
+ *   uint8   type            TELEMETRY_PACKET_LOG
+ *   uint8   records count
+ *   uint16  dropped         records lost since the previous log packet (saturated)
+ *   records: uint32 format address (bits 0-27) | arguments count << 28,
+ *            uint32 millis, uint32 arguments[count]
+ *   uint32  crc
+ *
+ * The packet is COBS encoded, so it has no zero bytes, and followed by a 0x00 delimiter
+ * The CRC is the one given by the CRC32 peripheral in little endian mode, seeded with 0xFFFFFFFF
+ *
+*/
+
+#ifndef TELEMETRY_PROTOCOL_H
+#define TELEMETRY_PROTOCOL_H
+
+/* **** Includes **** */
+#include <stdint.h>
+
+/* **** Definitions **** */
+#define TELEMETRY_PACKET_FRAME      0x01
+#define TELEMETRY_PACKET_LOG        0x02
+
+#define TELEMETRY_BLOCK_RAW         0x01
+#define TELEMETRY_BLOCK_MAGNITUDE   0x02
+#define TELEMETRY_BLOCK_SPECTRUM    0x04
+
+#define TELEMETRY_DELIMITER         0x00
+
+// Maximum sizes of the packet parts
+#define TELEMETRY_MAX_BANDS         16
+#define TELEMETRY_MAX_RAW           512
+#define TELEMETRY_MAX_MAGNITUDE     256
+// Bytes, SPECTRUM_CODEC_MAX_ENCODED rounded up to 4
+#define TELEMETRY_MAX_SPECTRUM      520
+
+#define TELEMETRY_HEADER_SIZE       12
+#define TELEMETRY_LOG_HEADER_SIZE   4
+#define TELEMETRY_LOG_ADDRESS_MASK  0x0FFFFFFFUL
+#define TELEMETRY_LOG_COUNT_POS     28
+#define TELEMETRY_BLOCK_HEADER_SIZE 4
+#define TELEMETRY_CRC_SIZE          4
+#define TELEMETRY_MAX_PACKET (TELEMETRY_HEADER_SIZE + 4*TELEMETRY_MAX_BANDS \
+                              + TELEMETRY_BLOCK_HEADER_SIZE + 2*TELEMETRY_MAX_RAW \
+                              + TELEMETRY_BLOCK_HEADER_SIZE + 4*TELEMETRY_MAX_MAGNITUDE \
+                              + TELEMETRY_BLOCK_HEADER_SIZE + TELEMETRY_MAX_SPECTRUM \
+                              + TELEMETRY_CRC_SIZE)
+// COBS adds one byte every 254, plus the first code and the delimiters around it
+#define TELEMETRY_MAX_ENCODED (TELEMETRY_MAX_PACKET + TELEMETRY_MAX_PACKET/254 + 3)
+
+#endif /* TELEMETRY_PROTOCOL_H */
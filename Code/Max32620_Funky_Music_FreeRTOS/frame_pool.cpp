@@ -0,0 +1,41 @@
+/*
+ * Fixed pool of the frames passed between the tasks of the pipeline
+ * See frame_pool.h
+ *
+*/
+
+/* **** Includes **** */
+#include "frame_pool.h"
+#include "queue.h"
+#include "mxc_errors.h"
+
+/* **** Globals **** */
+static frame_t frames[FRAME_POOL_SIZE];
+static QueueHandle_t free_frames = NULL;
+
+/* **** Functions **** */
+int framePoolInit(void){
+  free_frames = xQueueCreate(FRAME_POOL_SIZE, sizeof(frame_t *));
+  if(free_frames == NULL) return E_NONE_AVAIL;
+
+  for(int i = 0; i<FRAME_POOL_SIZE; i++){
+    frame_t *frame = &frames[i];
+    xQueueSend(free_frames, &frame, 0);
+  }
+  return E_NO_ERROR;
+}
+
+frame_t *framePoolGet(TickType_t wait){
+  frame_t *frame;
+  if(xQueueReceive(free_frames, &frame, wait) != pdTRUE) return NULL;
+  return frame;
+}
+
+void framePoolPut(frame_t *frame){
+  // Never blocks, the queue has room for every frame
+  xQueueSend(free_frames, &frame, 0);
+}
+
+UBaseType_t framePoolFree(void){
+  return uxQueueMessagesWaiting(free_frames);
+}
@@ -0,0 +1,53 @@
+/*
+ * Fixed pool of the frames passed between the tasks of the pipeline
+ * The frames are never copied: the PMU captures straight into the frame
+ * taken from the pool, and the tasks pass its pointer through their queues
+ * until the last one returns it. A frame has a single owner at a time, so
+ * its content needs no locking.
+ * The free frames are kept in a queue of pointers, taking one blocks
+ * (up to the wait given) while all of them are in use.
+ *
+*/
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "arm_math.h"
+
+/* **** Definitions **** */
+// Samples of a frame, the same as AMOUNT_SAMPLES in the sketch
+#define FRAME_SIZE 256
+// Frames in the pool: one capturing, one in the DSP, one in the leds and a spare
+#define FRAME_POOL_SIZE 4
+// Bands of the biggest split (single leds)
+#define FRAME_MAX_BANDS 10
+
+typedef struct {
+  // ADC counts, the PMU moves 32 bits words
+  uint32_t samples[FRAME_SIZE];
+  // Bands in the log scale of the sketch, filled by the DSP
+  float32_t bands[FRAME_MAX_BANDS];
+  // Frames captured before this one, and the tick of its capture
+  uint32_t sequence;
+  TickType_t captured;
+} frame_t;
+
+/* **** Function Prototypes **** */
+
+/* Creates the queue of free frames and fills it
+   Returns E_NO_ERROR, or E_NONE_AVAIL if the queue could not be created */
+int framePoolInit(void);
+
+/* Takes a free frame, waiting up to "wait" ticks. NULL if none was freed */
+frame_t *framePoolGet(TickType_t wait);
+
+/* Returns a frame to the pool, from a task */
+void framePoolPut(frame_t *frame);
+
+/* Frames in the pool now */
+UBaseType_t framePoolFree(void);
+
+#endif /* FRAME_POOL_H */
@@ -0,0 +1,58 @@
+/*
+ * Configuration of the host build of the pipeline, for the POSIX port of
+ * the FreeRTOS kernel (portable/ThirdParty/GCC/Posix, V10.4 or newer)
+ * Same tasks and priorities as ../FreeRTOSConfig.h, with a 1 ms tick and
+ * the run time counted in microseconds of the host.
+ *
+*/
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <assert.h>
+#include <stdint.h>
+
+/* Microseconds of CLOCK_MONOTONIC, see main_host.cpp */
+#ifdef __cplusplus
+extern "C"
+#endif
+uint32_t ulGetRunTimeCounterValue(void);
+
+#define configTICK_RATE_HZ          ((TickType_t)1000)
+
+/* The tasks are pthreads, their stacks have to be bigger than PTHREAD_STACK_MIN */
+#define configMINIMAL_STACK_SIZE    ((unsigned short)4096)
+#define configMAX_TASK_NAME_LEN     16
+
+#define configMAX_PRIORITIES        5
+#define configUSE_PREEMPTION        1
+#define configUSE_IDLE_HOOK         0
+#define configUSE_TICK_HOOK         0
+#define configUSE_CO_ROUTINES       0
+#define configUSE_TIMERS            0
+#define configUSE_16_BIT_TICKS      0
+#define configUSE_MUTEXES           1
+#define configSUPPORT_DYNAMIC_ALLOCATION 1
+/* heap_3.c, malloc of the host */
+#define configTOTAL_HEAP_SIZE       ((size_t)(64 * 1024))
+
+/* Run time and task stats gathering related definitions. */
+#define configUSE_TRACE_FACILITY                1
+#define configUSE_STATS_FORMATTING_FUNCTIONS    1
+#define configGENERATE_RUN_TIME_STATS           1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        ulGetRunTimeCounterValue()
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+#define INCLUDE_vTaskPrioritySet    0
+#define INCLUDE_vTaskDelete         0
+#define INCLUDE_vTaskSuspend        1
+#define INCLUDE_vTaskDelayUntil     1
+#define INCLUDE_xTaskDelayUntil     1
+#define INCLUDE_uxTaskPriorityGet   0
+#define INCLUDE_vTaskDelay          1
+
+#define configASSERT(x) assert(x)
+
+#endif /* FREERTOS_CONFIG_H */
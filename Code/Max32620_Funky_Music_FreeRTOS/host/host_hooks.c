@@ -0,0 +1,32 @@
+/*
+ * Functions of the board build that the host build has to give itself,
+ * shared by funky_music_host and pipeline_test, and by band_engine_bench of Host tools
+ * - ulGetRunTimeCounterValue: run time of the tasks (see FreeRTOSConfig.h), in us
+ * - arm_bitreversal_32: arm_cfft_f32 uses the assembler version of the board
+ *   (arm_bitreversal2.S), this is the same swap of the table in C
+ *
+*/
+
+/* **** Includes **** */
+#include <stdint.h>
+#include <time.h>
+
+/* **** Functions **** */
+uint32_t ulGetRunTimeCounterValue(void){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(now.tv_sec*1000000ull + now.tv_nsec/1000);
+}
+
+void arm_bitreversal_32(uint32_t *pSrc, const uint16_t bitRevLen, const uint16_t *pBitRevTab){
+  for(uint32_t i = 0; i<bitRevLen; i += 2){
+    uint32_t a = pBitRevTab[i] >> 2;
+    uint32_t b = pBitRevTab[i+1] >> 2;
+    uint32_t tmp = pSrc[a];
+    pSrc[a] = pSrc[b];
+    pSrc[b] = tmp;
+    tmp = pSrc[a+1];
+    pSrc[a+1] = pSrc[b+1];
+    pSrc[b+1] = tmp;
+  }
+}
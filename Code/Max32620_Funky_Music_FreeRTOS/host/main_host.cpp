@@ -0,0 +1,166 @@
+/*
+ * Host build of the FreeRTOS pipeline, over a WAV file
+ * The same tasks as on the MAX32620 run on the POSIX port of FreeRTOS:
+ * - captureStart copies the samples of the frame period from the WAV file,
+ *   converted to ADC counts (10 bits, centered as the microphone), and
+ *   calls pipelineCaptureDoneFromISR itself, the host has no capture interrupt
+ * - ledsWrite prints the leds of each frame, with the time of the frame
+ * - The report task waits for the end of the file, and prints the frames
+ *   processed and the state and run time of each task, as "ps" does on the board
+ * The WAV has to be 16 bits PCM, only the first channel is used. The bands of
+ * band_tables.h follow the sample rate, resample the file to the rate of the
+ * ADC to get the same bands as the board.
+ *
+ * Usage: funky_music_host file.wav
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "mxc_errors.h"
+#include "pipeline.h"
+
+/* **** Definitions **** */
+// Stats of the report, see prvTaskStatsCommand in CLI-commands.c
+#define REPORT_BUF_SIZE 2048
+
+/* **** Globals **** */
+static int16_t *wav_samples = NULL;
+static uint32_t wav_length = 0;
+static uint32_t wav_rate = 0;
+
+static TaskHandle_t report_task = NULL;
+
+/* **** Functions **** */
+static uint32_t readLe(const uint8_t *data, int bytes){
+  uint32_t value = 0;
+  for(int i = bytes-1; i>=0; i--) value = (value << 8) | data[i];
+  return value;
+}
+
+/* Loads the first channel of a 16 bits PCM WAV file. Returns E_NO_ERROR or E_BAD_PARAM */
+static int wavLoad(const char *path){
+  FILE *file = fopen(path, "rb");
+  if(file == NULL) return E_BAD_PARAM;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = (uint8_t *)malloc(size);
+  size_t read = fread(data, 1, size, file);
+  fclose(file);
+
+  int err = E_BAD_PARAM;
+  uint32_t channels = 0;
+  uint32_t bits = 0;
+  if((read == (size_t)size) && (size >= 12) && !memcmp(data, "RIFF", 4) && !memcmp(data+8, "WAVE", 4)){
+    // Chunks after the header: id, size, data
+    long offset = 12;
+    while(offset + 8 <= size){
+      uint32_t chunk = readLe(data+offset+4, 4);
+      const uint8_t *body = data+offset+8;
+      if(offset + 8 + (long)chunk > size) chunk = size - offset - 8;
+      if(!memcmp(data+offset, "fmt ", 4) && (chunk >= 16)){
+        if(readLe(body, 2) != 1) break;
+        channels = readLe(body+2, 2);
+        wav_rate = readLe(body+4, 4);
+        bits = readLe(body+14, 2);
+      }
+      else if(!memcmp(data+offset, "data", 4) && (channels > 0) && (bits == 16)){
+        wav_length = chunk/(2*channels);
+        wav_samples = (int16_t *)malloc(wav_length*sizeof(int16_t));
+        for(uint32_t i = 0; i<wav_length; i++){
+          wav_samples[i] = (int16_t)readLe(body + 2*channels*i, 2);
+        }
+        err = E_NO_ERROR;
+        break;
+      }
+      offset += 8 + chunk + (chunk & 1);
+    }
+  }
+  free(data);
+  return err;
+}
+
+int captureStart(frame_t *frame){
+  // Samples at the time of the frame, as the board only captures at the start of each period
+  uint64_t first = (uint64_t)frame->sequence*wav_rate*PIPELINE_FRAME_PERIOD_MS/1000;
+  if(first + FRAME_SIZE > wav_length){
+    xTaskNotifyGive(report_task);
+    return E_SHUTDOWN;
+  }
+
+  for(int i = 0; i<FRAME_SIZE; i++){
+    // 16 bits signed to the 10 bits of the ADC
+    frame->samples[i] = (uint32_t)(((int32_t)wav_samples[first+i] + 32768) >> 6);
+  }
+  pipelineCaptureDoneFromISR(E_NO_ERROR);
+  return E_NO_ERROR;
+}
+
+void captureStop(void){
+}
+
+void ledsWrite(uint16_t leds){
+  char text[PIPELINE_LEDS+1];
+  for(int i = 0; i<PIPELINE_LEDS; i++) text[i] = (leds & (1 << i)) ? '#' : '.';
+  text[PIPELINE_LEDS] = 0;
+  printf("%8u ms  %s\n", (unsigned)(xTaskGetTickCount()*1000/configTICK_RATE_HZ), text);
+}
+
+/* =| vReportTask |=======================================
+ *
+ * Telemetry of the host: prints the statistics once the
+ *  whole file has gone through the pipeline
+ *
+ * =======================================================
+ */
+static void vReportTask(void *pvParameters){
+  static char buffer[REPORT_BUF_SIZE];
+  pipeline_stats_t stats;
+
+  // Woken by captureStart at the end of the file
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  // The frames already captured are still in the tasks
+  while(framePoolFree() < FRAME_POOL_SIZE) vTaskDelay(1);
+
+  pipelineStats(&stats);
+  printf("\nCaptured %u, processed %u, dropped %u, capture errors %u\n",
+         (unsigned)stats.captured, (unsigned)stats.processed,
+         (unsigned)stats.dropped, (unsigned)stats.capture_errors);
+
+  printf("\nTask          State  Priority  Stack\t#\n************************************************\n");
+  vTaskList(buffer);
+  printf("%s", buffer);
+  printf("\nTask            Abs Time      %% Time\n****************************************\n");
+  vTaskGetRunTimeStats(buffer);
+  printf("%s", buffer);
+  fflush(stdout);
+  exit(0);
+}
+
+int main(int argc, char **argv){
+  if(argc < 2){
+    printf("Usage: %s file.wav\n", argv[0]);
+    return 1;
+  }
+  if(wavLoad(argv[1]) != E_NO_ERROR){
+    printf("%s is not a 16 bits PCM WAV file\n", argv[1]);
+    return 1;
+  }
+  printf("%s: %u samples at %u Hz, a frame of %u samples every %u ms\n", argv[1],
+         (unsigned)wav_length, (unsigned)wav_rate, FRAME_SIZE, PIPELINE_FRAME_PERIOD_MS);
+
+  if((pipelineStart() != E_NO_ERROR) ||
+     (xTaskCreate(vReportTask, (const char *)"Report",
+                  configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY+1, &report_task) != pdPASS)){
+    printf("The pipeline could not be started\n");
+    return 1;
+  }
+  vTaskStartScheduler();
+  return 0;
+}
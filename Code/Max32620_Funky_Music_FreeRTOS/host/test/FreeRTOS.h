@@ -0,0 +1,38 @@
+/*
+ * Stand-in of the FreeRTOS kernel for the host test, see freertos_standin.c
+ * The types and the part of the port used by the pipeline, with the
+ * settings of host/FreeRTOSConfig.h
+ *
+*/
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+/* **** Includes **** */
+#include <stddef.h>
+#include <stdint.h>
+
+/* **** Definitions **** */
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#include "FreeRTOSConfig.h"
+
+#ifndef configSTACK_DEPTH_TYPE
+#define configSTACK_DEPTH_TYPE uint16_t
+#endif
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+#define pdPASS  (pdTRUE)
+#define pdFAIL  (pdFALSE)
+#define errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY (-1)
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1000/configTICK_RATE_HZ)
+
+// The interrupts of the host are calls from a task, which keeps running
+#define portYIELD_FROM_ISR(xSwitchRequired) ((void)(xSwitchRequired))
+
+#endif /* INC_FREERTOS_H */
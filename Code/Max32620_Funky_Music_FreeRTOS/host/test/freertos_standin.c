@@ -0,0 +1,277 @@
+/*
+ * Stand-in of the FreeRTOS kernel for the host test, without the FreeRTOS-Kernel sources
+ * Each task is a thread, and only the thread holding the kernel lock runs: a
+ * task keeps the processor until it blocks (queue, notification, delay), as
+ * if every task had the same priority and there was no time slicing.
+ * The priorities and the stack sizes are not followed, the ticks are the
+ * time since the scheduler started, at configTICK_RATE_HZ. The run time
+ * of the tasks comes from portGET_RUN_TIME_COUNTER_VALUE, as in the kernel.
+ * Only the API used by the pipeline and pipeline_test.cpp is provided.
+ *
+*/
+
+/* **** Includes **** */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/* **** Definitions **** */
+#define STANDIN_MAX_TASKS 8
+
+struct tskTaskControlBlock {
+  TaskFunction_t code;
+  void *parameters;
+  const char *name;
+  UBaseType_t priority;
+  pthread_t thread;
+  uint32_t notification;
+  uint8_t blocked;
+  uint8_t suspended;
+  // Run time counter at the last resume, and the total while running
+  uint32_t resumed;
+  uint32_t run_time;
+};
+
+struct QueueDefinition {
+  UBaseType_t length;
+  UBaseType_t item_size;
+  UBaseType_t waiting;
+  UBaseType_t head;
+  uint8_t *storage;
+};
+
+/* **** Globals **** */
+static pthread_mutex_t kernel_lock = PTHREAD_MUTEX_INITIALIZER;
+// Broadcast on every change a blocked task can wait for
+static pthread_cond_t kernel_event;
+
+static struct tskTaskControlBlock tasks[STANDIN_MAX_TASKS];
+static int task_count = 0;
+static int scheduler_running = 0;
+static struct timespec start_time;
+static uint32_t start_run_time;
+
+// Task of the calling thread
+static __thread TaskHandle_t current = NULL;
+
+/* **** Functions **** */
+static uint64_t nanoseconds(const struct timespec *time){
+  return (uint64_t)time->tv_sec*1000000000ull + time->tv_nsec;
+}
+
+TickType_t xTaskGetTickCount(void){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (TickType_t)((nanoseconds(&now) - nanoseconds(&start_time))*configTICK_RATE_HZ/1000000000ull);
+}
+
+/* Blocks the calling task until ready(argument) is true, or for "wait" ticks
+   The kernel lock is released meanwhile. Returns ready(argument) */
+static int waitFor(int (*ready)(void *), void *argument, TickType_t wait){
+  struct timespec deadline;
+
+  if(ready(argument)) return 1;
+  if(wait != portMAX_DELAY){
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t end = nanoseconds(&deadline) + (uint64_t)wait*1000000000ull/configTICK_RATE_HZ;
+    deadline.tv_sec = end/1000000000ull;
+    deadline.tv_nsec = end%1000000000ull;
+  }
+
+  current->run_time += portGET_RUN_TIME_COUNTER_VALUE() - current->resumed;
+  current->blocked = 1;
+  while(!ready(argument)){
+    if(wait == portMAX_DELAY) pthread_cond_wait(&kernel_event, &kernel_lock);
+    else if(pthread_cond_timedwait(&kernel_event, &kernel_lock, &deadline) == ETIMEDOUT) break;
+  }
+  current->blocked = 0;
+  current->resumed = portGET_RUN_TIME_COUNTER_VALUE();
+  return ready(argument);
+}
+
+static int never(void *argument){
+  return 0;
+}
+
+static void *taskThread(void *parameters){
+  pthread_mutex_lock(&kernel_lock);
+  current = (TaskHandle_t)parameters;
+  current->resumed = portGET_RUN_TIME_COUNTER_VALUE();
+  current->code(current->parameters);
+  // A task never returns, as in FreeRTOS
+  configASSERT(0);
+  return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName,
+                       const configSTACK_DEPTH_TYPE usStackDepth, void * const pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask){
+  if(task_count == STANDIN_MAX_TASKS) return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+
+  TaskHandle_t task = &tasks[task_count++];
+  memset(task, 0, sizeof(*task));
+  task->code = pxTaskCode;
+  task->parameters = pvParameters;
+  task->name = pcName;
+  task->priority = uxPriority;
+  if(pxCreatedTask != NULL) *pxCreatedTask = task;
+
+  // Created by a running task, it starts once that one blocks
+  if(scheduler_running) pthread_create(&task->thread, NULL, taskThread, task);
+  return pdPASS;
+}
+
+void vTaskStartScheduler(void){
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(&kernel_event, &attributes);
+
+  pthread_mutex_lock(&kernel_lock);
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+  portCONFIGURE_TIMER_FOR_RUN_TIME_STATS();
+  start_run_time = portGET_RUN_TIME_COUNTER_VALUE();
+  scheduler_running = 1;
+  for(int i = 0; i<task_count; i++) pthread_create(&tasks[i].thread, NULL, taskThread, &tasks[i]);
+  pthread_mutex_unlock(&kernel_lock);
+
+  // The tasks end the program
+  while(1) pause();
+}
+
+void vTaskSuspend(TaskHandle_t xTaskToSuspend){
+  // Only the calling task can be suspended, and it is never resumed
+  configASSERT((xTaskToSuspend == NULL) || (xTaskToSuspend == current));
+  current->suspended = 1;
+  waitFor(never, NULL, portMAX_DELAY);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay){
+  waitFor(never, NULL, xTicksToDelay);
+}
+
+void vTaskDelayUntil(TickType_t * const pxPreviousWakeTime, const TickType_t xTimeIncrement){
+  *pxPreviousWakeTime += xTimeIncrement;
+  TickType_t remaining = *pxPreviousWakeTime - xTaskGetTickCount();
+  // Late already, return at once as the kernel does
+  if((int32_t)remaining > 0) vTaskDelay(remaining);
+}
+
+static int notified(void *argument){
+  return ((TaskHandle_t)argument)->notification > 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait){
+  waitFor(notified, current, xTicksToWait);
+  uint32_t value = current->notification;
+  if(xClearCountOnExit) current->notification = 0;
+  else if(value > 0) current->notification--;
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify){
+  xTaskToNotify->notification++;
+  pthread_cond_broadcast(&kernel_event);
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken){
+  xTaskNotifyGive(xTaskToNotify);
+  if(pxHigherPriorityTaskWoken != NULL) *pxHigherPriorityTaskWoken = pdFALSE;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void){
+  return task_count;
+}
+
+void vTaskList(char *pcWriteBuffer){
+  *pcWriteBuffer = 0;
+  for(int i = 0; i<task_count; i++){
+    const TaskHandle_t task = &tasks[i];
+    char state = (task == current) ? 'X' : task->suspended ? 'S' : task->blocked ? 'B' : 'R';
+    // No stack to measure, the high water mark is given as 0
+    pcWriteBuffer += sprintf(pcWriteBuffer, "%-*s\t%c\t%u\t0\t%d\r\n", configMAX_TASK_NAME_LEN - 1,
+                             task->name, state, (unsigned)task->priority, i + 1);
+  }
+}
+
+void vTaskGetRunTimeStats(char *pcWriteBuffer){
+  uint32_t total = (portGET_RUN_TIME_COUNTER_VALUE() - start_run_time)/100;
+
+  *pcWriteBuffer = 0;
+  for(int i = 0; i<task_count; i++){
+    const TaskHandle_t task = &tasks[i];
+    uint32_t run_time = task->run_time;
+    if(task == current) run_time += portGET_RUN_TIME_COUNTER_VALUE() - task->resumed;
+    uint32_t percentage = (total > 0) ? run_time/total : 0;
+    if(percentage > 0){
+      pcWriteBuffer += sprintf(pcWriteBuffer, "%-*s\t%u\t\t%u%%\r\n", configMAX_TASK_NAME_LEN - 1,
+                               task->name, (unsigned)run_time, (unsigned)percentage);
+    }
+    else{
+      pcWriteBuffer += sprintf(pcWriteBuffer, "%-*s\t%u\t\t<1%%\r\n", configMAX_TASK_NAME_LEN - 1,
+                               task->name, (unsigned)run_time);
+    }
+  }
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize){
+  QueueHandle_t queue = (QueueHandle_t)calloc(1, sizeof(*queue));
+  if(queue == NULL) return NULL;
+  queue->storage = (uint8_t *)malloc(uxQueueLength*uxItemSize);
+  if(queue->storage == NULL){
+    free(queue);
+    return NULL;
+  }
+  queue->length = uxQueueLength;
+  queue->item_size = uxItemSize;
+  return queue;
+}
+
+static int hasRoom(void *argument){
+  QueueHandle_t queue = (QueueHandle_t)argument;
+  return queue->waiting < queue->length;
+}
+
+static int hasItems(void *argument){
+  return ((QueueHandle_t)argument)->waiting > 0;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait){
+  // Before the scheduler starts nothing can wait, as in the kernel
+  if(scheduler_running){
+    if(!waitFor(hasRoom, xQueue, xTicksToWait)) return pdFALSE;
+  }
+  else if(!hasRoom(xQueue)) return pdFALSE;
+
+  UBaseType_t tail = (xQueue->head + xQueue->waiting) % xQueue->length;
+  memcpy(&xQueue->storage[tail*xQueue->item_size], pvItemToQueue, xQueue->item_size);
+  xQueue->waiting++;
+  pthread_cond_broadcast(&kernel_event);
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait){
+  if(scheduler_running){
+    if(!waitFor(hasItems, xQueue, xTicksToWait)) return pdFALSE;
+  }
+  else if(!hasItems(xQueue)) return pdFALSE;
+
+  memcpy(pvBuffer, &xQueue->storage[xQueue->head*xQueue->item_size], xQueue->item_size);
+  xQueue->head = (xQueue->head + 1) % xQueue->length;
+  xQueue->waiting--;
+  pthread_cond_broadcast(&kernel_event);
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue){
+  return xQueue->waiting;
+}
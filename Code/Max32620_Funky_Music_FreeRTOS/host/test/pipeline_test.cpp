@@ -0,0 +1,196 @@
+/*
+ * Host test of the FreeRTOS pipeline (pipeline.cpp), over synthetic frames
+ * - The first frames are low noise, the environment measured by the calibration
+ * - Then a tone in the middle of one band: only the leds of that band are on.
+ *   Halving the tone takes 16 from its level, the log scale of the sketch
+ * - Then the noise again: the levels of pipelineLevels are around 0
+ * - The leds of every frame are the ones of its levels: the bands over
+ *   threshold_values, or if none is (the "in house" mode) over threshold_halves
+ * - Every frame is captured and processed in its period, none is dropped
+ * Built by "make test" in host/, over the stand-in kernel of this folder
+ * (freertos_standin.c), or over the POSIX port when FREERTOS_KERNEL is set.
+ *
+ * Usage: pipeline_test, returns 0 if every check passed
+ *
+*/
+
+/* **** Includes **** */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "mxc_errors.h"
+#include "pipeline.h"
+#include "band_tables.h"
+
+/* **** Definitions **** */
+#define TEST_CALIBRATION_FRAMES (BAND_LEVEL_DISCARDED_FRAMES + BAND_LEVEL_CALIBRATION_FRAMES)
+// The tone, then the tone halved
+#define TEST_TONE_FRAMES 20
+#define TEST_QUIET_FRAMES 20
+#define TEST_FRAMES (TEST_CALIBRATION_FRAMES + TEST_TONE_FRAMES + TEST_QUIET_FRAMES)
+// A period of 4 samples, bin 64 of the frame FFT, without leakage to the other bins
+#define TEST_TONE_BIN 64
+#define TEST_TONE_AMPLITUDE 300
+// ADC counts of the environment, around the middle of the 10 bits
+#define TEST_NOISE_AMPLITUDE 8
+#define TEST_ADC_MIDDLE 512
+#define CHECK(condition) do{ if(!(condition)){ printf("FAILED line %d: %s\n", __LINE__, #condition); failures++; } }while(0)
+
+/* **** Globals **** */
+static int failures = 0;
+static TaskHandle_t test_task = NULL;
+
+// Leds written by the pipeline, in order
+static uint16_t leds_written[TEST_FRAMES + 1];
+static int leds_count = 0;
+// Levels of each frame, 0 if not processed before the next capture
+static float32_t frame_levels[TEST_FRAMES][PIPELINE_BANDS];
+static int frame_bands[TEST_FRAMES];
+
+/* **** Functions **** */
+
+/* Band holding TEST_TONE_BIN */
+static int toneBand(void){
+  for(int i = 0; i<PIPELINE_BANDS; i++){
+    #ifdef COUPLED_MODE
+    const uint8_t *band = band_table_coupled[i];
+    #else
+    const uint8_t *band = band_table_single[i];
+    #endif
+    if((band[0] <= TEST_TONE_BIN) && (TEST_TONE_BIN < band[1])) return i;
+  }
+  return -1;
+}
+
+/* Leds of a band, the two leds of the pair in coupled mode */
+static uint16_t bandLeds(int band){
+  #ifdef COUPLED_MODE
+  return 3 << (2*band);
+  #else
+  return 1 << band;
+  #endif
+}
+
+/* Leds the sketch turns on for the levels of a frame */
+static uint16_t levelLeds(const float32_t *levels){
+  uint16_t over = 0;
+  uint16_t over_halves = 0;
+  for(int i = 0; i<PIPELINE_BANDS; i++){
+    if(levels[i] > threshold_values[i]) over |= bandLeds(i);
+    if(levels[i] > threshold_halves[i]) over_halves |= bandLeds(i);
+  }
+  #ifdef IN_HOUSE_MODE
+  if(over == 0) return over_halves;
+  #endif
+  return over;
+}
+
+int captureStart(frame_t *frame){
+  // A period after the previous capture, its frame has gone through the tasks
+  pipeline_stats_t stats;
+  pipelineStats(&stats);
+  if((frame->sequence > 0) && (frame->sequence <= TEST_FRAMES) && (stats.processed == frame->sequence)){
+    frame_bands[frame->sequence - 1] = pipelineLevels(frame_levels[frame->sequence - 1]);
+  }
+
+  if(frame->sequence >= TEST_FRAMES){
+    xTaskNotifyGive(test_task);
+    return E_SHUTDOWN;
+  }
+
+  // The same noise on every run, a different one on every frame
+  uint32_t seed = frame->sequence*2654435761u + 1;
+  float32_t amplitude = 0.0f;
+  if((frame->sequence >= TEST_CALIBRATION_FRAMES) && (frame->sequence < TEST_CALIBRATION_FRAMES + TEST_TONE_FRAMES)){
+    amplitude = (frame->sequence < TEST_CALIBRATION_FRAMES + TEST_TONE_FRAMES/2) ? TEST_TONE_AMPLITUDE : TEST_TONE_AMPLITUDE/2;
+  }
+  for(int i = 0; i<FRAME_SIZE; i++){
+    seed = seed*1664525u + 1013904223u;
+    int32_t value = TEST_ADC_MIDDLE + (int32_t)(seed >> 16) % (TEST_NOISE_AMPLITUDE + 1);
+    value += lroundf(amplitude*sinf(2*PI*TEST_TONE_BIN*i/FRAME_SIZE));
+    frame->samples[i] = (uint32_t)value;
+  }
+  pipelineCaptureDoneFromISR(E_NO_ERROR);
+  return E_NO_ERROR;
+}
+
+void captureStop(void){
+}
+
+void ledsWrite(uint16_t leds){
+  if(leds_count < TEST_FRAMES + 1) leds_written[leds_count] = leds;
+  leds_count++;
+}
+
+/* =| vTestTask |=========================================
+ *
+ * Waits for the last frame, then checks what the
+ *  pipeline did with them
+ *
+ * =======================================================
+ */
+static void vTestTask(void *pvParameters){
+  pipeline_stats_t stats;
+  float32_t levels[PIPELINE_BANDS];
+
+  // Woken by captureStart after the last frame
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  while(framePoolFree() < FRAME_POOL_SIZE) vTaskDelay(1);
+
+  pipelineStats(&stats);
+  CHECK(stats.captured == TEST_FRAMES);
+  CHECK(stats.processed == TEST_FRAMES);
+  CHECK(stats.dropped == 0);
+  CHECK(stats.capture_errors == 0);
+
+  // Turned off when the calibration starts, then once per frame after it
+  CHECK(leds_count == 1 + TEST_TONE_FRAMES + TEST_QUIET_FRAMES);
+  CHECK(leds_written[0] == 0);
+  CHECK(toneBand() >= 0);
+  for(int i = 1; i<leds_count; i++){
+    if(i <= TEST_TONE_FRAMES) CHECK(leds_written[i] == bandLeds(toneBand()));
+    CHECK(leds_written[i] == levelLeds(frame_levels[TEST_CALIBRATION_FRAMES + i - 1]));
+  }
+
+  CHECK(pipelineLevels(levels) == PIPELINE_BANDS);
+  for(int i = 0; i<PIPELINE_BANDS; i++) CHECK(levels[i] < threshold_values[i]);
+
+  // No levels while calibrating, then every frame has them
+  CHECK(frame_bands[TEST_CALIBRATION_FRAMES - 2] == 0);
+  for(int i = TEST_CALIBRATION_FRAMES; i<TEST_FRAMES; i++) CHECK(frame_bands[i] == PIPELINE_BANDS);
+
+  // Level of the tone, and of the tone halved
+  const int band = toneBand();
+  const float32_t full = frame_levels[TEST_CALIBRATION_FRAMES + TEST_TONE_FRAMES/2 - 1][band];
+  const float32_t half = frame_levels[TEST_CALIBRATION_FRAMES + TEST_TONE_FRAMES - 1][band];
+  CHECK(full > 2*threshold_values[band]);
+  CHECK(fabsf(full - half - 16) < 0.5f);
+
+  // The environment is the average of the noise, its frames are around it
+  for(int i = 0; i<PIPELINE_BANDS; i++){
+    float32_t sum = 0;
+    for(int j = 0; j<TEST_QUIET_FRAMES; j++) sum += frame_levels[TEST_CALIBRATION_FRAMES + TEST_TONE_FRAMES + j][i];
+    CHECK(fabsf(sum/TEST_QUIET_FRAMES) < threshold_halves[i]);
+  }
+
+  if(failures){
+    printf("%d checks failed\n", failures);
+    exit(1);
+  }
+  printf("All checks passed\n");
+  exit(0);
+}
+
+int main(void){
+  if((pipelineStart() != E_NO_ERROR) ||
+     (xTaskCreate(vTestTask, (const char *)"Test",
+                  configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY+1, &test_task) != pdPASS)){
+    printf("The pipeline could not be started\n");
+    return 1;
+  }
+  vTaskStartScheduler();
+  return 1;
+}
@@ -0,0 +1,31 @@
+/*
+ * Stand-in of the FreeRTOS kernel for the host test, see freertos_standin.c
+ * Queues of items copied in and out
+ *
+*/
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#ifndef INC_FREERTOS_H
+#error "include FreeRTOS.h must appear in source files before include queue.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* **** Definitions **** */
+typedef struct QueueDefinition *QueueHandle_t;
+
+/* **** Function Prototypes **** */
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait);
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_H */
@@ -0,0 +1,51 @@
+/*
+ * Stand-in of the FreeRTOS kernel for the host test, see freertos_standin.c
+ * Tasks, delays and notifications
+ *
+*/
+
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#ifndef INC_FREERTOS_H
+#error "include FreeRTOS.h must appear in source files before include task.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* **** Definitions **** */
+#define tskIDLE_PRIORITY ((UBaseType_t)0U)
+
+// A single task runs at a time, there is nothing to lock out
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+/* **** Function Prototypes **** */
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName,
+                       const configSTACK_DEPTH_TYPE usStackDepth, void * const pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask);
+void vTaskStartScheduler(void);
+void vTaskSuspend(TaskHandle_t xTaskToSuspend);
+
+void vTaskDelay(const TickType_t xTicksToDelay);
+void vTaskDelayUntil(TickType_t * const pxPreviousWakeTime, const TickType_t xTimeIncrement);
+TickType_t xTaskGetTickCount(void);
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken);
+
+UBaseType_t uxTaskGetNumberOfTasks(void);
+void vTaskList(char *pcWriteBuffer);
+void vTaskGetRunTimeStats(char *pcWriteBuffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_TASK_H */
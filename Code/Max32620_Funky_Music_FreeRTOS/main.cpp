@@ -0,0 +1,447 @@
+/*
+ * FreeRTOS build of Funky_Music for the MAX32620
+ * The processing runs in the tasks of pipeline.h, this file gives them the
+ * capture (PMU + ADC, as in the sketch but a single frame per start) and the
+ * leds, and adds the command line task of the FreeRTOS demo
+ * (MAX32620_EVKIT_examples/FreeRTOSDemo) with a few commands of the pipeline.
+ * The frames are captured every PIPELINE_FRAME_PERIOD_MS, in between every task
+ * is blocked and the idle task sleeps in LP1 (freertos_lp1.c). LP1 stops the
+ * ADC, so it is not entered while a frame is being captured.
+ *
+*/
+
+/* **** Includes **** */
+#include "mxc_config.h"
+#include "board.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* FreeRTOS */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+ */
+extern "C" {
+#include "FreeRTOS_CLI.h"
+}
+
+/* Maxim CMSIS SDK */
+#include "rtc.h"
+#include "uart.h"
+#include "lp.h"
+#include "adc.h"
+#include "gpio.h"
+
+#include "pmu_channels.h"
+#include "pipeline.h"
+
+/* **** Definitions **** */
+#define ADC_INT_REG     MXC_BASE_ADC + MXC_R_ADC_OFFS_INTR
+#define ADC_CTRL_REG    MXC_BASE_ADC + MXC_R_ADC_OFFS_CTRL
+#define ADC_DATA_REG    MXC_BASE_ADC + MXC_R_ADC_OFFS_DATA
+
+// Input of the microphone, as in the sketch
+#define CAPTURE_CHANNEL ADC_CH_0_DIV_5
+// Word of pmu_program with the address the next sample is written to
+#define CAPTURE_WRITE_ADDRESS 13
+
+/* Array sizes */
+#define CMD_LINE_BUF_SIZE  80
+#define OUTPUT_BUF_SIZE  1024
+
+/* Stringification macros */
+#define STRING(x) STRING_(x)
+#define STRING_(x) #x
+
+/* **** Globals **** */
+extern "C" {
+/* FreeRTOS+CLI */
+void vRegisterCLICommands(void);
+
+/* Enables/disables LP1 tick-less mode, used by CLI-commands.c */
+unsigned int disable_lp1 = 0;
+
+int freertos_permit_lp1(void);
+void PMU_IRQHandler(void);
+void UART0_IRQHandler(void);
+}
+
+/* Task IDs */
+TaskHandle_t cmd_task_id;
+
+static int adc_channel = -1;
+
+/* Same sequence as the pmu_program of the sketch, but it stops after the
+   frame instead of starting it again. The destination is set by captureStart */
+static uint32_t pmu_program[] = {
+  // Trigger ADC conversion:
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_CTRL_REG, MXC_F_ADC_CTRL_CPU_ADC_START, MXC_F_ADC_CTRL_CPU_ADC_START),
+  // Wait for ADC Done interrupt
+  PMU_WAIT(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WAIT_SEL_0, PMU_WAIT_IRQ_MASK1_SEL0_ADC_DONE, 0, 0),
+  // Clear interrupt ADC_DONE flag, to re enable module
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_INT_REG, MXC_F_ADC_INTR_ADC_DONE_IF, MXC_F_ADC_INTR_ADC_DONE_IF),
+  // Move ADC data to the frame
+  PMU_MOVE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_MOVE_READ_32_BIT, PMU_MOVE_READ_NO_INC, PMU_MOVE_WRITE_32_BIT, PMU_MOVE_WRITE_NO_INC, PMU_MOVE_NO_CONT, 4, 0, ADC_DATA_REG),
+  // Increase the write address of the move by 4 bytes
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program[CAPTURE_WRITE_ADDRESS]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program[CAPTURE_WRITE_ADDRESS]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program[CAPTURE_WRITE_ADDRESS]), 0, 0),
+  PMU_WRITE(PMU_NO_INTERRUPT, PMU_NO_STOP, PMU_WRITE_PLUS_1, (uint32_t)&(pmu_program[CAPTURE_WRITE_ADDRESS]), 0, 0),
+  // Loop for the samples of the frame, counter 0 is loaded by captureStart
+  PMU_LOOP(PMU_NO_INTERRUPT, PMU_NO_STOP, 0, (uint32_t)&(pmu_program[0])),
+  // Frame done, the stop descriptor interrupts (see pmu_channels.h)
+  PMU_WRITE(PMU_INTERRUPT, PMU_STOP, PMU_WRITE_MASKED_WRITE_VALUE, ADC_INT_REG, MXC_F_ADC_INTR_ADC_DONE_IF, MXC_F_ADC_INTR_ADC_DONE_IF),
+};
+
+/* Music leds, in the order of music_leds_array in the sketch */
+static const gpio_cfg_t music_leds[PIPELINE_LEDS] = {
+  {PORT_5, PIN_3, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, {PORT_3, PIN_3, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, // Blue
+  {PORT_3, PIN_2, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, {PORT_5, PIN_0, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, // Green
+  {PORT_5, PIN_1, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, {PORT_5, PIN_2, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, // White
+  {PORT_3, PIN_0, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, {PORT_3, PIN_1, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, // Orange
+  {PORT_3, PIN_5, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, {PORT_3, PIN_4, GPIO_FUNC_GPIO, GPIO_PAD_NORMAL}, // Red
+};
+
+/* Commands of the pipeline */
+static BaseType_t prvFramesCommand(char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString);
+static BaseType_t prvLevelsCommand(char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString);
+static BaseType_t prvCalibrateCommand(char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString);
+
+static const CLI_Command_Definition_t xFrames =
+{
+  "frames",
+  "\r\nframes:\r\n Displays the frames captured, processed and dropped, and the PMU statistics\r\n\r\n",
+  prvFramesCommand,
+  0
+};
+
+static const CLI_Command_Definition_t xLevels =
+{
+  "levels",
+  "\r\nlevels:\r\n Displays the bands of the last frame over the environment\r\n\r\n",
+  prvLevelsCommand,
+  0
+};
+
+static const CLI_Command_Definition_t xCalibrate =
+{
+  "calibrate",
+  "\r\ncalibrate:\r\n Measures the environment again, the leds stay off meanwhile\r\n\r\n",
+  prvCalibrateCommand,
+  0
+};
+
+/* **** Functions **** */
+
+/* =| Capture |===========================================
+ *
+ * Platform functions of pipeline.h, the PMU writes the
+ *  samples straight into the frame
+ *
+ * =======================================================
+ */
+static void captureDone(int err){
+  pipelineCaptureDoneFromISR(err);
+}
+
+int captureStart(frame_t *frame){
+  // Selects the channel with a dummy conversion, as the sketch does at start
+  ADC_StartConvert(CAPTURE_CHANNEL, 0, 1);
+  PMU_SetCounter(adc_channel, 0, FRAME_SIZE-1);
+  pmu_program[CAPTURE_WRITE_ADDRESS] = (uint32_t)&(frame->samples[0]);
+  return pmuChannelStart(adc_channel, pmu_program, captureDone);
+}
+
+void captureStop(void){
+  pmuChannelStop(adc_channel);
+}
+
+void ledsWrite(uint16_t leds){
+  for(int i = 0; i<PIPELINE_LEDS; i++){
+    if(leds & (1 << i)) GPIO_OutSet(&music_leds[i]);
+    else GPIO_OutClr(&music_leds[i]);
+  }
+}
+
+/* =| PMU_IRQHandler |====================================
+ *
+ * Calls the callbacks of the channels flagged, the one of
+ *  the capture wakes the acquisition task
+ *
+ * =======================================================
+ */
+void PMU_IRQHandler(void)
+{
+  pmuChannelsHandler();
+}
+
+/* =| UART0_IRQHandler |======================================
+ *
+ * This function overrides the weakly-declared interrupt handler
+ *  in system_max326xx.c and is needed for asynchronous UART
+ *  calls to work properly
+ *
+ * ===========================================================
+ */
+void UART0_IRQHandler(void)
+{
+  UART_Handler(MXC_UART0);
+}
+
+/* =| Pipeline commands |=================================
+ *
+ * Telemetry of the pipeline on the command line
+ *
+ * =======================================================
+ */
+static BaseType_t prvFramesCommand(char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString)
+{
+  pipeline_stats_t stats;
+  pmu_channel_stats_t pmu_stats;
+
+  pipelineStats(&stats);
+  pmuChannelStats(adc_channel, &pmu_stats);
+  snprintf(pcWriteBuffer, xWriteBufferLen,
+           "Captured %u, processed %u, dropped %u, capture errors %u, free frames %u\r\n"
+           "PMU starts %u, interrupts %u, bus errors %u, timeouts %u\r\n",
+           (unsigned)stats.captured, (unsigned)stats.processed, (unsigned)stats.dropped,
+           (unsigned)stats.capture_errors, (unsigned)framePoolFree(),
+           (unsigned)pmu_stats.starts, (unsigned)pmu_stats.interrupts,
+           (unsigned)pmu_stats.bus_errors, (unsigned)pmu_stats.timeouts);
+  return pdFALSE;
+}
+
+static BaseType_t prvLevelsCommand(char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString)
+{
+  float32_t levels[PIPELINE_BANDS];
+  int count = pipelineLevels(levels);
+
+  if(count == 0){
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Calibrating\r\n");
+    return pdFALSE;
+  }
+  for(int i = 0; i<count; i++){
+    // Tenths of the log scale, printf of newlib-nano has no floats
+    int written = snprintf(pcWriteBuffer, xWriteBufferLen, "Band %d: %d\r\n", i, (int)(levels[i]*10));
+    pcWriteBuffer += written;
+    xWriteBufferLen -= written;
+  }
+  return pdFALSE;
+}
+
+static BaseType_t prvCalibrateCommand(char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString)
+{
+  pipelineCalibrate();
+  snprintf(pcWriteBuffer, xWriteBufferLen, "Keep quiet, measuring the environment\r\n");
+  return pdFALSE;
+}
+
+/* =| vCmdLineTask_cb |======================================
+ *
+ * Callback on asynchronous reads to wake the waiting command
+ *  processor task
+ *
+ * ===========================================================
+ */
+static void vCmdLineTask_cb(uart_req_t *req, int error)
+{
+  BaseType_t xHigherPriorityTaskWoken;
+
+  /* Wake the task */
+  xHigherPriorityTaskWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(cmd_task_id, &xHigherPriorityTaskWoken);
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/* =| vCmdLineTask |======================================
+ *
+ * The command line task of the FreeRTOS demo, with the
+ *  commands of the pipeline added
+ *
+ * =======================================================
+ */
+static void vCmdLineTask(void *pvParameters)
+{
+  unsigned char tmp;
+  unsigned int index;     /* Index into buffer */
+  unsigned int x;
+  char buffer[CMD_LINE_BUF_SIZE];        /* Buffer for input */
+  char output[OUTPUT_BUF_SIZE];        /* Buffer for output */
+  BaseType_t xMore;
+  uart_req_t async_read_req;
+
+  memset(buffer, 0, CMD_LINE_BUF_SIZE);
+  index = 0;
+
+  /* Register available CLI commands */
+  vRegisterCLICommands();
+  FreeRTOS_CLIRegisterCommand(&xFrames);
+  FreeRTOS_CLIRegisterCommand(&xLevels);
+  FreeRTOS_CLIRegisterCommand(&xCalibrate);
+
+  /* Configure wake-up for GPIO pin corresponding to the UART RX line */
+  LP_ConfigGPIOWakeUpDetect(&console_uart_rx, 0, LP_WEAK_PULL_UP);
+
+  /* Enable UART0 interrupt, at a priority allowed to call FreeRTOS */
+  NVIC_ClearPendingIRQ(UART0_IRQn);
+  NVIC_DisableIRQ(UART0_IRQn);
+  NVIC_SetPriority(UART0_IRQn, configMAX_SYSCALL_INTERRUPT_PRIORITY >> (8 - configPRIO_BITS));
+  NVIC_EnableIRQ(UART0_IRQn);
+
+  /* Async read will be used to wake process */
+  async_read_req.data = &tmp;
+  async_read_req.len = 1;
+  async_read_req.callback = vCmdLineTask_cb;
+
+  printf("\nEnter 'help' to view a list of available commands.\n");
+  printf("cmd> ");
+  fflush(stdout);
+  while (1) {
+    /* Register async read request */
+    if (UART_ReadAsync(MXC_UART0, &async_read_req) != E_NO_ERROR) {
+      printf("Error registering async request. Command line unavailable.\n");
+      vTaskDelay(portMAX_DELAY);
+    }
+    /* Hang here until ISR wakes us for a character */
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    /* Check that we have a valid character */
+    if (async_read_req.num > 0) {
+      /* Process character */
+      do {
+        if (tmp == 0x08) {
+          /* Backspace */
+          if (index > 0) {
+            index--;
+            printf("\x08 \x08");
+          }
+          fflush(stdout);
+        } else if (tmp == 0x03) {
+          /* ^C abort */
+          index = 0;
+          printf("^C");
+          printf("\ncmd> ");
+          fflush(stdout);
+        } else if ((tmp == '\r') ||
+                   (tmp == '\n')) {
+          printf("\r\n");
+          /* Null terminate for safety */
+          buffer[index] = 0x00;
+          /* Evaluate */
+          do {
+            xMore = FreeRTOS_CLIProcessCommand(buffer, output, OUTPUT_BUF_SIZE);
+            /* If xMore == pdTRUE, then output buffer contains no null termination, so
+             *  we know it is OUTPUT_BUF_SIZE. If pdFALSE, we can use strlen.
+             */
+            for (x = 0; x < (xMore == pdTRUE ? OUTPUT_BUF_SIZE : strlen(output)) ; x++) {
+              putchar(*(output+x));
+            }
+          } while (xMore != pdFALSE);
+          /* New prompt */
+          index = 0;
+          printf("\ncmd> ");
+          fflush(stdout);
+        } else if (index < CMD_LINE_BUF_SIZE) {
+          putchar(tmp);
+          buffer[index++] = tmp;
+          fflush(stdout);
+        } else {
+          /* Throw away data and beep terminal */
+          putchar(0x07);
+          fflush(stdout);
+        }
+        /* If more characters are ready, process them here */
+      } while ((UART_NumReadAvail(MXC_UART_GET_UART(CONSOLE_UART)) > 0) &&
+               UART_Read(MXC_UART_GET_UART(CONSOLE_UART), (uint8_t *)&tmp, 1, NULL));
+    }
+  }
+}
+
+/* =| freertos_permit_lp1 |===============================
+ *
+ * Determine if any hardware activity should prevent
+ *  low-power tickless operation: the capture of a frame
+ *  needs the ADC
+ *
+ * =======================================================
+ */
+int freertos_permit_lp1(void)
+{
+  if (disable_lp1 == 1) {
+    return E_BUSY;
+  }
+  if (pmuChannelActive(adc_channel)) {
+    return E_BUSY;
+  }
+
+  return Console_PrepForSleep();
+}
+
+/* =| main |==============================================
+ *
+ * Starts the pipeline and the command line
+ *
+ * =======================================================
+ */
+int main(void)
+{
+  rtc_cfg_t rtc_cfg = {RTC_PRESCALE_DIV_2_0, RTC_PRESCALE_DIV_2_0, {0, 0}, 0, RTC_SNOOZE_MODE_B};
+  uart_cfg_t uart_cfg;
+
+  /* RTC interrupt synchronization must be enabled for interrupts to work */
+  MXC_CLKMAN->sys_clk_ctrl_1_sync = 1;
+
+  /* If running tickless idle, must reduce baud rate to avoid loosing character */
+  memcpy(&uart_cfg, &console_uart_cfg, sizeof(uart_cfg));
+  uart_cfg.baud = 57600;
+  if (UART_Init(MXC_UART_GET_UART(CONSOLE_UART), &uart_cfg, &console_sys_cfg) != E_NO_ERROR) {
+    MXC_ASSERT_FAIL();
+  }
+
+  /* Clear all previous wake-up configuration */
+  LP_ClearWakeUpConfig();
+  /* Reconfigure for only RTC COMP1 */
+  LP_ConfigRTCWakeUp(0, 1, 0, 0);
+
+  /* The RTC must be enabled for tickless operation, and counts the run time of the tasks */
+  RTC_Init(&rtc_cfg);
+  RTC_SetCount(0);
+  RTC_Start();
+
+  /* Leds off */
+  for (int i = 0; i < PIPELINE_LEDS; i++) {
+    GPIO_Config(&music_leds[i]);
+  }
+  ledsWrite(0);
+
+  /* ADC, and the PMU channel of the capture. The PMU interrupt wakes the
+     acquisition task, so it has to be allowed to call FreeRTOS */
+  ADC_Init();
+  adc_channel = pmuChannelAlloc();
+  NVIC_SetPriority(PMU_IRQn, configMAX_SYSCALL_INTERRUPT_PRIORITY >> (8 - configPRIO_BITS));
+
+  /* Print banner (RTOS scheduler not running) */
+  printf("\n-=- %s Funky Music FreeRTOS (%s) -=-\n", STRING(TARGET), tskKERNEL_VERSION_NUMBER);
+  printf("Tickless LP1 idle between the frames. Type 'tickless 0' to disable.\n");
+
+  if ((adc_channel < 0) ||
+      (pipelineStart() != E_NO_ERROR) ||
+      (xTaskCreate(vCmdLineTask, (const char *)"CmdLineTask",
+                   configMINIMAL_STACK_SIZE+CMD_LINE_BUF_SIZE+OUTPUT_BUF_SIZE, NULL, tskIDLE_PRIORITY+1, &cmd_task_id) != pdPASS)) {
+    printf("The pipeline could not be started.\n");
+  } else {
+    /* Start scheduler */
+    printf("Starting scheduler.\n");
+    vTaskStartScheduler();
+  }
+
+  /* This code is only reached if the scheduler failed to start */
+  printf("ERROR: FreeRTOS did not start due to above error!\n");
+  while (1) {
+    __NOP();
+  }
+
+  /* Quiet GCC warnings */
+  return -1;
+}
@@ -0,0 +1,215 @@
+/*
+ * Funky_Music processing as FreeRTOS tasks
+ * See pipeline.h
+ *
+*/
+
+/* **** Includes **** */
+#include <string.h>
+#include "pipeline.h"
+#include "queue.h"
+#include "mxc_errors.h"
+#include "fft_engine.h"
+#include "band_tables.h"
+#include "band_levels.h"
+
+/* **** Definitions **** */
+#if FRAME_SIZE != BAND_TABLE_FRAME_SIZE
+#error "FRAME_SIZE has to match BAND_TABLE_FRAME_SIZE"
+#endif
+
+/* **** Globals **** */
+static TaskHandle_t acquisition_task = NULL;
+// Frames captured, and frames with their bands. Both can hold the whole pool
+static QueueHandle_t dsp_queue = NULL;
+static QueueHandle_t led_queue = NULL;
+// Result of the last capture, written by the interrupt before the notification
+static volatile int capture_status = E_NO_ERROR;
+
+static pipeline_stats_t stats;
+
+// Working memory of the DSP task
+static fft_engine_t fft_engine;
+static float32_t process_buffer[FRAME_SIZE];
+static float32_t fft_result[FRAME_SIZE];
+static float32_t fft_result_mag[FRAME_SIZE/2];
+
+// Set by pipelineCalibrate, taken by the led task
+static volatile uint8_t calibrate_request = 0;
+static volatile uint8_t calibrating = 0;
+// Owned by the led task, levels is copied by pipelineLevels
+static float32_t env_bias[PIPELINE_BANDS];
+static float32_t levels[PIPELINE_BANDS];
+
+/* **** Functions **** */
+
+/* =| vAcquisitionTask |==================================
+ *
+ * Captures a frame every PIPELINE_FRAME_PERIOD_MS, it sleeps
+ *  while the PMU fills it
+ *
+ * =======================================================
+ */
+static void vAcquisitionTask(void *pvParameters){
+  TickType_t xLastWakeTime = xTaskGetTickCount();
+  uint32_t sequence = 0;
+
+  while(1){
+    frame_t *frame = framePoolGet(0);
+    if(frame == NULL){
+      // The DSP or the leds are late, skip this period to keep the rate
+      stats.dropped++;
+    }
+    else{
+      frame->sequence = sequence;
+      frame->captured = xTaskGetTickCount();
+      // Forget the notification of a capture that ended after its timeout
+      ulTaskNotifyTake(pdTRUE, 0);
+      int err = captureStart(frame);
+      if(err == E_NO_ERROR){
+        // Woken by pipelineCaptureDoneFromISR
+        if(ulTaskNotifyTake(pdTRUE, PIPELINE_FRAME_TICKS) == 0){
+          captureStop();
+          err = E_TIME_OUT;
+        }
+        else err = capture_status;
+      }
+
+      if(err == E_NO_ERROR){
+        stats.captured++;
+        xQueueSend(dsp_queue, &frame, portMAX_DELAY);
+      }
+      else{
+        framePoolPut(frame);
+        // No more input, the frames already queued are still processed
+        if(err == E_SHUTDOWN) vTaskSuspend(NULL);
+        stats.capture_errors++;
+      }
+    }
+
+    sequence++;
+    vTaskDelayUntil(&xLastWakeTime, PIPELINE_FRAME_TICKS);
+  }
+}
+
+/* =| vDspTask |==========================================
+ *
+ * Gets the bands of each frame captured
+ *
+ * =======================================================
+ */
+static void vDspTask(void *pvParameters){
+  frame_t *frame;
+
+  while(1){
+    xQueueReceive(dsp_queue, &frame, portMAX_DELAY);
+
+    for(int i = 0; i<FRAME_SIZE; i++){
+      process_buffer[i] = (float32_t)frame->samples[i] * PIPELINE_COUNT_SCALE;
+    }
+    fftEngineRun(&fft_engine, process_buffer, fft_result);
+    arm_cmplx_mag_f32(fft_result, fft_result_mag, FRAME_SIZE/2);
+
+    for(int i = 0; i<PIPELINE_BANDS; i++){
+      #ifdef COUPLED_MODE
+      const uint8_t *band = band_table_coupled[i];
+      #else
+      const uint8_t *band = band_table_single[i];
+      #endif
+      arm_rms_f32(&fft_result_mag[band[0]], band[1] - band[0], &frame->bands[i]);
+    }
+    // Apply log scale to the results
+    bandLevelLog(frame->bands, PIPELINE_BANDS);
+
+    xQueueSend(led_queue, &frame, portMAX_DELAY);
+  }
+}
+
+/* =| vLedTask |==========================================
+ *
+ * Measures the environment, then turns on the leds of the
+ *  bands over it. Last owner of the frames
+ *
+ * =======================================================
+ */
+static void vLedTask(void *pvParameters){
+  frame_t *frame;
+  band_calibration_t calibration;
+
+  while(1){
+    xQueueReceive(led_queue, &frame, portMAX_DELAY);
+
+    if(calibrate_request){
+      calibrate_request = 0;
+      calibrating = 1;
+      bandCalibrationBegin(&calibration, 1);
+      ledsWrite(0);
+    }
+
+    if(calibrating){
+      // The first frames are discarded, as in the sketch
+      if(bandCalibrationAdd(&calibration, frame->bands, env_bias)) calibrating = 0;
+    }
+    else{
+      float32_t frame_levels[PIPELINE_BANDS];
+      int leds_on;
+      ledsWrite(bandLevelLeds(frame->bands, env_bias, &leds_on));
+
+      for(int i = 0; i<PIPELINE_BANDS; i++) frame_levels[i] = frame->bands[i] - env_bias[i];
+      taskENTER_CRITICAL();
+      memcpy(levels, frame_levels, sizeof(levels));
+      taskEXIT_CRITICAL();
+    }
+
+    stats.processed++;
+    framePoolPut(frame);
+  }
+}
+
+int pipelineStart(void){
+  if(framePoolInit() != E_NO_ERROR) return E_NONE_AVAIL;
+  dsp_queue = xQueueCreate(FRAME_POOL_SIZE, sizeof(frame_t *));
+  led_queue = xQueueCreate(FRAME_POOL_SIZE, sizeof(frame_t *));
+  if((dsp_queue == NULL) || (led_queue == NULL)) return E_NONE_AVAIL;
+
+  fftEngineInit(&fft_engine, PIPELINE_FFT_ALGO, FRAME_SIZE);
+  memset(&stats, 0, sizeof(stats));
+  // Start measuring the environment
+  calibrate_request = 1;
+
+  if((xTaskCreate(vAcquisitionTask, (const char *)"Acquisition",
+                  PIPELINE_ACQUISITION_STACK, NULL, PIPELINE_ACQUISITION_PRIORITY, &acquisition_task) != pdPASS) ||
+     (xTaskCreate(vDspTask, (const char *)"DSP",
+                  PIPELINE_DSP_STACK, NULL, PIPELINE_DSP_PRIORITY, NULL) != pdPASS) ||
+     (xTaskCreate(vLedTask, (const char *)"Leds",
+                  PIPELINE_LED_STACK, NULL, PIPELINE_LED_PRIORITY, NULL) != pdPASS)) {
+    return E_NONE_AVAIL;
+  }
+  return E_NO_ERROR;
+}
+
+void pipelineCaptureDoneFromISR(int err){
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+  capture_status = err;
+  vTaskNotifyGiveFromISR(acquisition_task, &xHigherPriorityTaskWoken);
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+void pipelineCalibrate(void){
+  calibrate_request = 1;
+}
+
+void pipelineStats(pipeline_stats_t *copy){
+  taskENTER_CRITICAL();
+  *copy = stats;
+  taskEXIT_CRITICAL();
+}
+
+int pipelineLevels(float32_t *copy){
+  if(calibrating || calibrate_request) return 0;
+  taskENTER_CRITICAL();
+  memcpy(copy, levels, sizeof(levels));
+  taskEXIT_CRITICAL();
+  return PIPELINE_BANDS;
+}
@@ -0,0 +1,95 @@
+/*
+ * Funky_Music processing as FreeRTOS tasks
+ * The frames of frame_pool.h go through three tasks, by pointer:
+ * - Acquisition: once every PIPELINE_FRAME_PERIOD_MS takes a frame of the pool,
+ *   starts its capture and blocks until the capture interrupt wakes it, then
+ *   queues the frame to the DSP. Without a free frame the period is skipped
+ * - DSP: FFT of the frame and RMS of the bands (band_tables.h), in the
+ *   log scale of the sketch (band_levels.h), then queues the frame to the leds
+ * - Leds: the first frames give the level of the environment (the calibration
+ *   mode of the sketch), then the leds of the bands over it are turned on,
+ *   with the thresholds of band_levels.h. It returns the frame to the pool
+ * Between the frames every task is blocked, so the idle task can sleep.
+ * The capture and the leds are given by the platform: main.cpp on the
+ * MAX32620 (PMU and GPIO), host/main_host.cpp on the PC (WAV file and text).
+ *
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/* **** Includes **** */
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "arm_math.h"
+#include "frame_pool.h"
+#include "band_levels.h"
+
+/* **** Definitions **** */
+// 5 coupled or 10 bands, COUPLED_MODE is set in band_levels.h
+#define PIPELINE_BANDS BAND_LEVEL_BANDS
+// Music leds, bit i of ledsWrite is the led i of music_leds_array in the sketch
+#define PIPELINE_LEDS BAND_LEVEL_LEDS
+
+// A frame every 50 ms, the leds are updated at 20 Hz
+#define PIPELINE_FRAME_PERIOD_MS 50
+#define PIPELINE_FRAME_TICKS ((TickType_t)((PIPELINE_FRAME_PERIOD_MS*configTICK_RATE_HZ)/1000))
+// 5.5/1023.0, ADC counts to volts
+#define PIPELINE_COUNT_SCALE 0.005376344086f
+
+// Transform of the frames, see fft_engine.h
+#define PIPELINE_FFT_ALGO FFT_ALGO_RFFT_FAST
+
+// The acquisition preempts the processing, the command line runs below them
+#define PIPELINE_ACQUISITION_PRIORITY (tskIDLE_PRIORITY+3)
+#define PIPELINE_DSP_PRIORITY         (tskIDLE_PRIORITY+2)
+#define PIPELINE_LED_PRIORITY         (tskIDLE_PRIORITY+2)
+#define PIPELINE_ACQUISITION_STACK    (configMINIMAL_STACK_SIZE)
+#define PIPELINE_DSP_STACK            (2*configMINIMAL_STACK_SIZE)
+#define PIPELINE_LED_STACK            (configMINIMAL_STACK_SIZE)
+
+typedef struct {
+  uint32_t captured;
+  uint32_t processed;
+  // Frame periods skipped, the pool was empty
+  uint32_t dropped;
+  // Captures that failed or did not end in a frame period
+  uint32_t capture_errors;
+} pipeline_stats_t;
+
+/* **** Function Prototypes **** */
+
+/* Creates the pool, the queues and the tasks, before vTaskStartScheduler
+   Returns E_NO_ERROR, or E_NONE_AVAIL if FreeRTOS ran out of heap */
+int pipelineStart(void);
+
+/* To be called by the platform when the capture started by captureStart ends,
+   from its interrupt. err is E_NO_ERROR if the frame is complete */
+void pipelineCaptureDoneFromISR(int err);
+
+/* Measures the environment again with the next frames */
+void pipelineCalibrate(void);
+
+/* Copies the statistics of the frames */
+void pipelineStats(pipeline_stats_t *stats);
+
+/* Copies the bands of the last frame over the environment
+   Returns the number of bands, 0 while calibrating */
+int pipelineLevels(float32_t *levels);
+
+/* **** Platform **** */
+
+/* Starts the capture of FRAME_SIZE samples into frame->samples, without
+   waiting for it. Returns E_NO_ERROR, or an error if it could not be started
+   (E_SHUTDOWN when there is no more input, only on the host) */
+int captureStart(frame_t *frame);
+
+/* Stops a capture that did not end in a frame period, before the frame
+   goes back to the pool */
+void captureStop(void);
+
+/* Sets the music leds, bit i on turns on the led i */
+void ledsWrite(uint16_t leds);
+
+#endif /* PIPELINE_H */